@@ -219,3 +219,23 @@ typedef struct aas_predictroute_s
 	int numareas;			//number of areas predicted ahead
 	int time;				//time predicted ahead (in hundreth of a sec)
 } aas_predictroute_t;
+
+// batched AAS queries, see AAS_QueryBatch
+#define AASQUERY_POINTAREANUM	1	//areanum of the point start
+#define AASQUERY_TRACE			2	//client bbox trace from start to end
+#define AASQUERY_ROUTE			3	//route from areanum at start towards goalareanum
+
+typedef struct aas_query_s
+{
+	int type;				//AASQUERY_?
+	vec3_t start;			//query point, trace start or route origin
+	vec3_t end;				//trace end
+	int areanum;			//route start area
+	int goalareanum;		//route goal area
+	int travelflags;		//route travel flags
+	int presencetype;		//trace presence type
+	int passent;			//trace pass entity, -1 to ignore entities
+	int result;				//areanum, qtrue when the trace hit something, route travel time
+	int reachnum;			//first reachability of the route
+	aas_trace_t trace;		//trace result
+} aas_query_t;
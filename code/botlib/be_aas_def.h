@@ -130,6 +130,7 @@ typedef struct aas_settings_s
 typedef struct aas_routingcache_s
 {
 	byte type;									//portal or area cache
+	byte resident;								//stored in the precomputed cache block, never freed
 	float time;									//last time accessed or updated
 	int size;									//size of the routing cache
 	int cluster;								//cluster the cache is for
@@ -139,6 +140,7 @@ typedef struct aas_routingcache_s
 	int travelflags;							//combinations of the travel flags
 	struct aas_routingcache_s *prev, *next;
 	struct aas_routingcache_s *time_prev, *time_next;
+	struct aas_cacheslab_s *slab;				//slab the cache was carved from, NULL when allocated from the heap
 	unsigned char *reachabilities;				//reachabilities used for routing
 	unsigned short int traveltimes[1];			//travel time for every area (variable sized)
 } aas_routingcache_t;
@@ -262,6 +264,9 @@ typedef struct aas_s
 	//cache list sorted on time
 	aas_routingcache_t *oldestcache;		// start of cache list sorted on time
 	aas_routingcache_t *newestcache;		// end of cache list sorted on time
+	//precomputed or loaded routing cache, one allocation
+	byte *residentcache;
+	int residentcachesize;
 	//maximum travel time through portal areas
 	int *portalmaxtraveltimes;
 	//areas the reachabilities go through
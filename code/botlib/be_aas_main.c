@@ -44,6 +44,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "be_interface.h"
 #include "be_aas_def.h"
 
+//minimum number of batched queries per job
+#define QUERYBATCH_MINJOB		8
+
 aas_t aasworld;
 
 libvar_t *saveroutingcache;
@@ -212,6 +215,137 @@ void AAS_ProjectPointOntoVector( vec3_t point, vec3_t vStart, vec3_t vEnd, vec3_
 	VectorMA( vStart, DotProduct( pVec, vec ), vec, vProj );
 } //end of the function AAS_ProjectPointOntoVector
 //===========================================================================
+// evaluates a single batched query, returns qfalse when the query needs
+// the calling thread (missing routing cache or entity collision)
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static qboolean AAS_EvaluateQuery(aas_query_t *query, qboolean mainthread)
+{
+	int traveltime;
+
+	switch(query->type)
+	{
+		case AASQUERY_POINTAREANUM:
+		{
+			query->result = AAS_PointAreaNum(query->start);
+			return qtrue;
+		} //end case
+		case AASQUERY_TRACE:
+		{
+			//entity collision traces through the server
+			if (query->passent >= 0 && !mainthread) return qfalse;
+			query->trace = AAS_TraceClientBBox(query->start, query->end, query->presencetype, query->passent);
+			query->result = query->trace.fraction < 1.0 || query->trace.startsolid;
+			return qtrue;
+		} //end case
+		case AASQUERY_ROUTE:
+		{
+			traveltime = 0;
+			query->reachnum = 0;
+			if (mainthread)
+			{
+				if (!AAS_AreaRouteToGoalArea(query->areanum, query->start, query->goalareanum,
+												query->travelflags, &traveltime, &query->reachnum)) traveltime = 0;
+			} //end if
+			else
+			{
+				switch(AAS_CachedRouteToGoalArea(query->areanum, query->start, query->goalareanum,
+													query->travelflags, &traveltime, &query->reachnum))
+				{
+					case -1: return qfalse;
+					case qfalse: traveltime = 0; break;
+				} //end switch
+			} //end else
+			query->result = traveltime;
+			return qtrue;
+		} //end case
+		default:
+		{
+			query->result = 0;
+			return qtrue;
+		} //end default
+	} //end switch
+} //end of the function AAS_EvaluateQuery
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+typedef struct
+{
+	aas_query_t *queries;
+	int numqueries;
+	int numjobs;
+} aas_querybatch_t;
+
+static void AAS_QueryJob(void *arg, int index)
+{
+	aas_querybatch_t *batch = (aas_querybatch_t *) arg;
+	aas_query_t *query;
+	int i, last;
+
+	i = batch->numqueries * index / batch->numjobs;
+	last = batch->numqueries * (index + 1) / batch->numjobs;
+	for (; i < last; i++)
+	{
+		query = &batch->queries[i];
+		if (!AAS_EvaluateQuery(query, qfalse)) query->result = -1;
+	} //end for
+} //end of the function AAS_QueryJob
+//===========================================================================
+// evaluates many point area, client bbox trace and route queries at once,
+// usually gathered from all bots before they think. the queries are split
+// over the job threads using only data that is not written during the
+// batch, queries that need a new routing cache or a trace against entities
+// are finished afterwards on the calling thread
+//
+// Parameter:			-
+// Returns:				number of queries evaluated
+// Changes Globals:		-
+//===========================================================================
+int AAS_QueryBatch(aas_query_t *queries, int numqueries)
+{
+	aas_querybatch_t batch;
+	aas_query_t *query;
+	int i;
+
+	if (!aasworld.loaded || !aasworld.initialized) return 0;
+	if (numqueries <= 0) return 0;
+
+	batch.queries = queries;
+	batch.numqueries = numqueries;
+	batch.numjobs = botimport.NumJobThreads();
+	//a few queries per job at least
+	if (batch.numjobs > numqueries / QUERYBATCH_MINJOB) batch.numjobs = numqueries / QUERYBATCH_MINJOB;
+	if (batch.numjobs > 1)
+	{
+		botimport.RunJobs(AAS_QueryJob, &batch, batch.numjobs);
+	} //end if
+	else
+	{
+		batch.numjobs = 1;
+		AAS_QueryJob(&batch, 0);
+	} //end else
+	//finish the deferred queries and age the routing caches that were used
+	for (i = 0; i < numqueries; i++)
+	{
+		query = &queries[i];
+		if (query->result == -1)
+		{
+			AAS_EvaluateQuery(query, qtrue);
+		} //end if
+		else if (query->type == AASQUERY_ROUTE)
+		{
+			AAS_TouchRouteToGoalArea(query->areanum, query->goalareanum, query->travelflags);
+		} //end else if
+	} //end for
+	return numqueries;
+} //end of the function AAS_QueryBatch
+//===========================================================================
 //
 // Parameter:				-
 // Returns:					-
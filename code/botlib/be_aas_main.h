@@ -55,3 +55,5 @@ int AAS_Loaded(void);
 float AAS_Time(void);
 //
 void AAS_ProjectPointOntoVector( vec3_t point, vec3_t vStart, vec3_t vEnd, vec3_t vProj );
+//evaluates a batch of point area, trace and route queries on the job threads
+int AAS_QueryBatch(struct aas_query_s *queries, int numqueries);
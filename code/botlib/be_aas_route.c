@@ -58,6 +58,16 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 //maximum number of routing updates each frame
 #define MAX_FRAMEROUTINGUPDATES		10
 
+//routing cache size classes, four classes per power of two
+#define MIN_SIZECLASS_SIZE			256
+#define NUM_SIZECLASSES				48
+//size of a slab, caches larger than that get a slab of their own
+#define CACHESLAB_SIZE				(64*1024)
+
+//alignment of routing caches in the resident cache block and route cache file
+#define ROUTECACHE_ALIGN			8
+#define ROUTECACHE_PAD(x)			(((x) + ROUTECACHE_ALIGN - 1) & ~(ROUTECACHE_ALIGN - 1))
+
 
 /*
 
@@ -84,6 +94,42 @@ int numportalcacheupdates;
 int routingcachesize;
 int max_routingcachesize;
 
+typedef struct aas_cacheslab_s
+{
+	struct aas_cacheslab_s *prev, *next;		//all slabs
+	struct aas_cacheslab_s *freeprev, *freenext;	//slabs of the size class with unused caches
+	aas_routingcache_t *freecaches;				//unused caches linked through next
+	int sizeclass;								//size class the slab is carved into
+	int numused;								//number of caches in use
+	int size;									//allocated size of the slab
+} aas_cacheslab_t;
+
+#define CACHESLAB_HEADER			ROUTECACHE_PAD(sizeof(aas_cacheslab_t))
+
+typedef struct aas_sizeclass_s
+{
+	int size;									//size of the caches in this class
+	aas_cacheslab_t *freeslabs;					//slabs with unused caches
+} aas_sizeclass_t;
+
+//slab allocator and statistics of the dynamic routing cache
+//whole slabs count towards routingcachesize, a slab is freed
+//as soon as all its caches are released
+static struct
+{
+	aas_sizeclass_t classes[NUM_SIZECLASSES];
+	aas_cacheslab_t *slabs;
+	int slabbytes;
+	int cachebytes;
+	int numcaches;
+	int peakbytes;
+	int hits;
+	int misses;
+	int evictions;
+} cachepool;
+
+static void AAS_ReleaseSlabCache(aas_routingcache_t *cache);
+
 //===========================================================================
 //
 // Parameter:			-
@@ -96,9 +142,28 @@ void AAS_RoutingInfo(void)
 	botimport.Print(PRT_MESSAGE, "%d area cache updates\n", numareacacheupdates);
 	botimport.Print(PRT_MESSAGE, "%d portal cache updates\n", numportalcacheupdates);
 	botimport.Print(PRT_MESSAGE, "%d bytes routing cache\n", routingcachesize);
+	botimport.Print(PRT_MESSAGE, "%d bytes precomputed routing cache\n", aasworld.residentcachesize);
 } //end of the function AAS_RoutingInfo
 #endif //ROUTING_DEBUG
 //===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_RoutingCacheStats(void)
+{
+	int lookups;
+
+	lookups = cachepool.hits + cachepool.misses;
+	botimport.Print(PRT_MESSAGE, "%d KB routing cache of %d KB, peak %d KB\n",
+					routingcachesize / 1024, max_routingcachesize / 1024, cachepool.peakbytes / 1024);
+	botimport.Print(PRT_MESSAGE, "%d caches, %d KB used of %d KB in slabs, %d KB precomputed\n",
+					cachepool.numcaches, cachepool.cachebytes / 1024, cachepool.slabbytes / 1024, aasworld.residentcachesize / 1024);
+	botimport.Print(PRT_MESSAGE, "%d hits, %d misses (%.1f%% hits), %d evictions\n",
+					cachepool.hits, cachepool.misses, lookups ? 100.0f * cachepool.hits / lookups : 0.0f, cachepool.evictions);
+} //end of the function AAS_RoutingCacheStats
+//===========================================================================
 // returns the number of the area in the cluster
 // assumes the given area is in the given cluster or a portal of the cluster
 //
@@ -235,9 +300,24 @@ void AAS_LinkCache(aas_routingcache_t *cache)
 //===========================================================================
 void AAS_FreeRoutingCache(aas_routingcache_t *cache)
 {
-	AAS_UnlinkCache(cache);
-	routingcachesize -= cache->size;
-	FreeMemory(cache);
+	//released together with the resident cache block
+	if (cache->resident) return;
+	//pinned caches are not in the time list
+	if (cache->time_prev || cache->time_next || aasworld.oldestcache == cache)
+	{
+		AAS_UnlinkCache(cache);
+	} //end if
+	cachepool.cachebytes -= cache->size;
+	cachepool.numcaches--;
+	if (cache->slab)
+	{
+		AAS_ReleaseSlabCache(cache);
+	} //end if
+	else
+	{
+		routingcachesize -= cache->size;
+		FreeMemory(cache);
+	} //end else
 } //end of the function AAS_FreeRoutingCache
 //===========================================================================
 //
@@ -700,13 +780,9 @@ int AAS_FreeOldestCache(void)
 	int clusterareanum;
 	aas_routingcache_t *cache;
 
-	for (cache = aasworld.oldestcache; cache; cache = cache->time_next) {
-		// never free area cache leading towards a portal
-		if (cache->type == CACHETYPE_AREA && aasworld.areasettings[cache->areanum].cluster < 0) {
-			continue;
-		}
-		break;
-	}
+	// area caches leading towards a portal are never linked into the
+	// time list, so the oldest cache can always be freed
+	cache = aasworld.oldestcache;
 	if (cache) {
 		// unlink the cache
 		if (cache->type == CACHETYPE_AREA) {
@@ -724,6 +800,7 @@ int AAS_FreeOldestCache(void)
 			if (cache->next) cache->next->prev = cache->prev;
 		}
 		AAS_FreeRoutingCache(cache);
+		cachepool.evictions++;
 		return qtrue;
 	}
 	return qfalse;
@@ -734,19 +811,186 @@ int AAS_FreeOldestCache(void)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-aas_routingcache_t *AAS_AllocRoutingCache(int numtraveltimes)
+static ID_INLINE int AAS_RoutingCacheSize(int numtraveltimes)
+{
+	return sizeof(aas_routingcache_t)
+						+ numtraveltimes * sizeof(unsigned short int)
+						+ numtraveltimes * sizeof(unsigned char);
+} //end of the function AAS_RoutingCacheSize
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_InitSizeClasses(void)
 {
+	int i, base;
+
+	for (i = 0; i < NUM_SIZECLASSES; i++)
+	{
+		base = MIN_SIZECLASS_SIZE << (i >> 2);
+		cachepool.classes[i].size = base + (base >> 2) * (i & 3);
+		cachepool.classes[i].freeslabs = NULL;
+	} //end for
+} //end of the function AAS_InitSizeClasses
+//===========================================================================
+// carves a new slab into unused caches of the given size class
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_AddCacheSlab(int classnum)
+{
+	aas_sizeclass_t *sizeclass;
+	aas_cacheslab_t *slab;
 	aas_routingcache_t *cache;
-	int size;
+	int i, slabsize, numcaches;
 
+	sizeclass = &cachepool.classes[classnum];
+	numcaches = (CACHESLAB_SIZE - CACHESLAB_HEADER) / sizeclass->size;
+	if (numcaches < 1) numcaches = 1;
+	slabsize = CACHESLAB_HEADER + numcaches * sizeclass->size;
 	//
-	size = sizeof(aas_routingcache_t)
-						+ numtraveltimes * sizeof(unsigned short int)
-						+ numtraveltimes * sizeof(unsigned char);
+	slab = (aas_cacheslab_t *) GetMemory(slabsize);
+	slab->prev = NULL;
+	slab->next = cachepool.slabs;
+	if (slab->next) slab->next->prev = slab;
+	cachepool.slabs = slab;
+	slab->freeprev = NULL;
+	slab->freenext = sizeclass->freeslabs;
+	if (slab->freenext) slab->freenext->freeprev = slab;
+	sizeclass->freeslabs = slab;
+	slab->freecaches = NULL;
+	slab->sizeclass = classnum;
+	slab->numused = 0;
+	slab->size = slabsize;
+	cachepool.slabbytes += slabsize;
+	routingcachesize += slabsize;
 	//
-	routingcachesize += size;
+	for (i = 0; i < numcaches; i++)
+	{
+		cache = (aas_routingcache_t *) ((byte *) slab + CACHESLAB_HEADER + i * sizeclass->size);
+		cache->next = slab->freecaches;
+		slab->freecaches = cache;
+	} //end for
+} //end of the function AAS_AddCacheSlab
+//===========================================================================
+// removes the slab from the list of slabs with unused caches
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_UnlinkFreeSlab(aas_cacheslab_t *slab)
+{
+	if (slab->freeprev) slab->freeprev->freenext = slab->freenext;
+	else cachepool.classes[slab->sizeclass].freeslabs = slab->freenext;
+	if (slab->freenext) slab->freenext->freeprev = slab->freeprev;
+	slab->freeprev = NULL;
+	slab->freenext = NULL;
+} //end of the function AAS_UnlinkFreeSlab
+//===========================================================================
+// returns the cache to its slab and frees the slab once it is empty
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_ReleaseSlabCache(aas_routingcache_t *cache)
+{
+	aas_sizeclass_t *sizeclass;
+	aas_cacheslab_t *slab;
+
+	slab = cache->slab;
+	sizeclass = &cachepool.classes[slab->sizeclass];
+	slab->numused--;
+	if (!slab->numused)
+	{
+		//the slab is on the free list unless it held a single cache
+		if (slab->freecaches) AAS_UnlinkFreeSlab(slab);
+		if (slab->prev) slab->prev->next = slab->next;
+		else cachepool.slabs = slab->next;
+		if (slab->next) slab->next->prev = slab->prev;
+		cachepool.slabbytes -= slab->size;
+		routingcachesize -= slab->size;
+		FreeMemory(slab);
+		return;
+	} //end if
+	//a full slab gets unused caches again
+	if (!slab->freecaches)
+	{
+		slab->freeprev = NULL;
+		slab->freenext = sizeclass->freeslabs;
+		if (slab->freenext) slab->freenext->freeprev = slab;
+		sizeclass->freeslabs = slab;
+	} //end if
+	cache->next = slab->freecaches;
+	slab->freecaches = cache;
+} //end of the function AAS_ReleaseSlabCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_FreeCacheSlabs(void)
+{
+	aas_cacheslab_t *slab, *next;
+	int i;
+
+	for (slab = cachepool.slabs; slab; slab = next)
+	{
+		next = slab->next;
+		FreeMemory(slab);
+	} //end for
+	cachepool.slabs = NULL;
+	cachepool.slabbytes = 0;
+	for (i = 0; i < NUM_SIZECLASSES; i++)
+	{
+		cachepool.classes[i].freeslabs = NULL;
+	} //end for
+} //end of the function AAS_FreeCacheSlabs
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+aas_routingcache_t *AAS_AllocRoutingCache(int numtraveltimes)
+{
+	aas_routingcache_t *cache;
+	aas_cacheslab_t *slab;
+	int size, i;
+
 	//
-	cache = (aas_routingcache_t *) GetClearedMemory(size);
+	size = AAS_RoutingCacheSize(numtraveltimes);
+	//
+	cachepool.cachebytes += size;
+	cachepool.numcaches++;
+	//find the smallest size class the cache fits in
+	for (i = 0; i < NUM_SIZECLASSES; i++)
+	{
+		if (cachepool.classes[i].size >= size) break;
+	} //end for
+	if (i < NUM_SIZECLASSES)
+	{
+		if (!cachepool.classes[i].freeslabs) AAS_AddCacheSlab(i);
+		slab = cachepool.classes[i].freeslabs;
+		cache = slab->freecaches;
+		slab->freecaches = cache->next;
+		slab->numused++;
+		if (!slab->freecaches) AAS_UnlinkFreeSlab(slab);
+		Com_Memset(cache, 0, size);
+		cache->slab = slab;
+	} //end if
+	else
+	{
+		cache = (aas_routingcache_t *) GetClearedMemory(size);
+		routingcachesize += size;
+	} //end else
+	if (routingcachesize > cachepool.peakbytes) cachepool.peakbytes = routingcachesize;
 	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t)
 								+ numtraveltimes * sizeof(unsigned short int);
 	cache->size = size;
@@ -887,26 +1131,196 @@ void AAS_InitRoutingUpdate(void)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+//precompute state, every job uses its own routing update fields
+typedef struct routingjobs_s
+{
+	aas_routingcache_t **caches;
+	int numcaches;
+	int numjobs;
+	int maxreachabilityareas;
+	aas_routingupdate_t *areaupdate;			//numjobs * maxreachabilityareas
+	aas_routingupdate_t *portalupdate;			//numjobs * (numportals + 1)
+} routingjobs_t;
+
+static void AAS_UpdateAreaRoutingCacheWith(aas_routingcache_t *areacache, aas_routingupdate_t *areaupdate);
+static void AAS_UpdatePortalRoutingCacheWith(aas_routingcache_t *portalcache, aas_routingupdate_t *portalupdate, qboolean precomputed);
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_AreaCacheJob(void *arg, int index)
+{
+	routingjobs_t *jobs = (routingjobs_t *) arg;
+	int i;
+
+	for (i = index; i < jobs->numcaches; i += jobs->numjobs)
+	{
+		AAS_UpdateAreaRoutingCacheWith(jobs->caches[i], jobs->areaupdate + index * jobs->maxreachabilityareas);
+	} //end for
+} //end of the function AAS_AreaCacheJob
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_PortalCacheJob(void *arg, int index)
+{
+	routingjobs_t *jobs = (routingjobs_t *) arg;
+	int i;
+
+	for (i = index; i < jobs->numcaches; i += jobs->numjobs)
+	{
+		AAS_UpdatePortalRoutingCacheWith(jobs->caches[i], jobs->portalupdate + index * (aasworld.numportals + 1), qtrue);
+	} //end for
+} //end of the function AAS_PortalCacheJob
+//===========================================================================
+// carves a routing cache out of the resident cache block
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static aas_routingcache_t *AAS_ResidentRoutingCache(byte **ptr, int type, int cluster, int areanum, int numtraveltimes)
+{
+	aas_routingcache_t *cache;
+
+	cache = (aas_routingcache_t *) *ptr;
+	cache->size = AAS_RoutingCacheSize(numtraveltimes);
+	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t)
+								+ numtraveltimes * sizeof(unsigned short int);
+	cache->resident = qtrue;
+	cache->type = type;
+	cache->cluster = cluster;
+	cache->areanum = areanum;
+	VectorCopy(aasworld.areas[areanum].center, cache->origin);
+	cache->starttraveltime = 1;
+	cache->travelflags = TFL_DEFAULT;
+	*ptr += ROUTECACHE_PAD(cache->size);
+	return cache;
+} //end of the function AAS_ResidentRoutingCache
+//===========================================================================
+// precomputes area and portal routing cache with default travel flags
+// for every area with reachabilities, called at routing initialization
+// before any cache exists
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 void AAS_CreateAllRoutingCache(void)
 {
-	int i, j;
-	//int t;
+	int i, side, cluster, areacluster, clusterareanum, numareacache, numportalcache;
+	int size, starttime;
+	aas_portal_t *portal;
+	aas_routingcache_t *cache, **caches;
+	routingjobs_t jobs;
+	byte *ptr;
+
+	if (aasworld.residentcache) return;
 
-	aasworld.initialized = qtrue;
-	botimport.Print(PRT_MESSAGE, "AAS_CreateAllRoutingCache\n");
+	starttime = botimport.Sys_Milliseconds();
+	//count the caches, areas get an area cache in their cluster (both
+	//clusters for portals) and goal areas get a portal cache
+	size = 0;
+	numareacache = 0;
+	numportalcache = 0;
 	for (i = 1; i < aasworld.numareas; i++)
 	{
-		if (!AAS_AreaReachability(i)) continue;
-		for (j = 1; j < aasworld.numareas; j++)
+		cluster = aasworld.areasettings[i].cluster;
+		if (cluster < 0)
+		{
+			portal = &aasworld.portals[-cluster];
+			size += ROUTECACHE_PAD(AAS_RoutingCacheSize(aasworld.clusters[portal->frontcluster].numreachabilityareas));
+			size += ROUTECACHE_PAD(AAS_RoutingCacheSize(aasworld.clusters[portal->backcluster].numreachabilityareas));
+			numareacache += 2;
+		} //end if
+		else if (cluster > 0 && AAS_AreaReachability(i))
+		{
+			size += ROUTECACHE_PAD(AAS_RoutingCacheSize(aasworld.clusters[cluster].numreachabilityareas));
+			numareacache++;
+		} //end else if
+		if (AAS_AreaReachability(i))
+		{
+			size += ROUTECACHE_PAD(AAS_RoutingCacheSize(aasworld.numportals));
+			numportalcache++;
+		} //end if
+	} //end for
+	if (!size) return;
+	//
+	aasworld.residentcache = (byte *) GetClearedMemory(size);
+	aasworld.residentcachesize = size;
+	caches = (aas_routingcache_t **) GetMemory((numareacache + numportalcache) * sizeof(aas_routingcache_t *));
+	//create and link the caches, area caches first
+	ptr = aasworld.residentcache;
+	numareacache = 0;
+	for (i = 1; i < aasworld.numareas; i++)
+	{
+		cluster = aasworld.areasettings[i].cluster;
+		for (side = 0; side < 2; side++)
 		{
-			if (i == j) continue;
-			if (!AAS_AreaReachability(j)) continue;
-			AAS_AreaTravelTimeToGoalArea(i, aasworld.areas[i].center, j, TFL_DEFAULT);
-			//t = AAS_AreaTravelTimeToGoalArea(i, aasworld.areas[i].center, j, TFL_DEFAULT);
-			//Log_Write("traveltime from %d to %d is %d", i, j, t);
+			if (cluster < 0)
+			{
+				portal = &aasworld.portals[-cluster];
+				areacluster = side ? portal->backcluster : portal->frontcluster;
+			} //end if
+			else if (cluster > 0 && AAS_AreaReachability(i) && !side)
+			{
+				areacluster = cluster;
+			} //end else if
+			else
+			{
+				continue;
+			} //end else
+			cache = AAS_ResidentRoutingCache(&ptr, CACHETYPE_AREA, areacluster, i,
+												aasworld.clusters[areacluster].numreachabilityareas);
+			clusterareanum = AAS_ClusterAreaNum(areacluster, i);
+			cache->next = aasworld.clusterareacache[areacluster][clusterareanum];
+			if (cache->next) cache->next->prev = cache;
+			aasworld.clusterareacache[areacluster][clusterareanum] = cache;
+			caches[numareacache++] = cache;
 		} //end for
 	} //end for
-	aasworld.initialized = qfalse;
+	numportalcache = 0;
+	for (i = 1; i < aasworld.numareas; i++)
+	{
+		if (!AAS_AreaReachability(i)) continue;
+		//portal goal areas are assumed to be part of the front cluster
+		cluster = aasworld.areasettings[i].cluster;
+		if (cluster < 0) cluster = aasworld.portals[-cluster].frontcluster;
+		cache = AAS_ResidentRoutingCache(&ptr, CACHETYPE_PORTAL, cluster, i, aasworld.numportals);
+		cache->next = aasworld.portalcache[i];
+		if (cache->next) cache->next->prev = cache;
+		aasworld.portalcache[i] = cache;
+		caches[numareacache + numportalcache++] = cache;
+	} //end for
+	//allocate the routing update fields for every job
+	jobs.numjobs = botimport.NumJobThreads();
+	jobs.maxreachabilityareas = 0;
+	for (i = 0; i < aasworld.numclusters; i++)
+	{
+		if (aasworld.clusters[i].numreachabilityareas > jobs.maxreachabilityareas)
+		{
+			jobs.maxreachabilityareas = aasworld.clusters[i].numreachabilityareas;
+		} //end if
+	} //end for
+	jobs.areaupdate = (aas_routingupdate_t *) GetClearedMemory(jobs.numjobs *
+							(jobs.maxreachabilityareas + aasworld.numportals + 1) * sizeof(aas_routingupdate_t));
+	jobs.portalupdate = jobs.areaupdate + jobs.numjobs * jobs.maxreachabilityareas;
+	//the portal caches are built from the area caches
+	jobs.caches = caches;
+	jobs.numcaches = numareacache;
+	botimport.RunJobs(AAS_AreaCacheJob, &jobs, jobs.numjobs);
+	jobs.caches = caches + numareacache;
+	jobs.numcaches = numportalcache;
+	botimport.RunJobs(AAS_PortalCacheJob, &jobs, jobs.numjobs);
+	//
+	FreeMemory(jobs.areaupdate);
+	FreeMemory(caches);
+	botimport.Print(PRT_MESSAGE, "precomputed %d area and %d portal routing caches (%d KB) in %d msec using %d threads\n",
+					numareacache, numportalcache, size / 1024, botimport.Sys_Milliseconds() - starttime, jobs.numjobs);
 } //end of the function AAS_CreateAllRoutingCache
 //===========================================================================
 //
@@ -916,8 +1330,9 @@ void AAS_CreateAllRoutingCache(void)
 //===========================================================================
 
 //the route cache header
-//this header is followed by numportalcache + numareacache aas_routingcache_t
-//structures that store routing cache
+//this header is followed by datasize bytes with numportalcache + numareacache
+//aas_routingcache_t images, each padded to ROUTECACHE_ALIGN bytes, so the
+//whole data is read with one call and used in place after pointer fix up
 typedef struct routecacheheader_s
 {
 	int ident;
@@ -928,14 +1343,35 @@ typedef struct routecacheheader_s
 	int clustercrc;
 	int numportalcache;
 	int numareacache;
+	int cachestructsize;						//sizeof(aas_routingcache_t) of the writer
+	int datasize;								//size of the cache data following the header
 } routecacheheader_t;
 
 #define RCID						(('C'<<24)+('R'<<16)+('E'<<8)+'M')
-#define RCVERSION					2
+#define RCVERSION					3
 
 //void AAS_DecompressVis(byte *in, int numareas, byte *decompressed);
 //int AAS_CompressVis(byte *vis, int numareas, byte *dest);
 
+static void AAS_WriteCache(aas_routingcache_t *cache, fileHandle_t fp)
+{
+	static const byte pad[ROUTECACHE_ALIGN];
+	aas_routingcache_t header;
+
+	//links and pointers are restored when the cache is read
+	Com_Memcpy(&header, cache, sizeof(header));
+	header.resident = qfalse;
+	header.prev = header.next = NULL;
+	header.time_prev = header.time_next = NULL;
+	header.reachabilities = NULL;
+	botimport.FS_Write(&header, sizeof(header), fp);
+	botimport.FS_Write((byte *) cache + sizeof(header), cache->size - sizeof(header), fp);
+	if (ROUTECACHE_PAD(cache->size) != cache->size)
+	{
+		botimport.FS_Write(pad, ROUTECACHE_PAD(cache->size) - cache->size, fp);
+	} //end if
+} //end of the function AAS_WriteCache
+
 void AAS_WriteRouteCache(void)
 {
 	int i, j, numportalcache, numareacache, totalsize;
@@ -946,11 +1382,13 @@ void AAS_WriteRouteCache(void)
 	routecacheheader_t routecacheheader;
 
 	numportalcache = 0;
+	totalsize = 0;
 	for (i = 0; i < aasworld.numareas; i++)
 	{
 		for (cache = aasworld.portalcache[i]; cache; cache = cache->next)
 		{
 			numportalcache++;
+			totalsize += ROUTECACHE_PAD(cache->size);
 		} //end for
 	} //end for
 	numareacache = 0;
@@ -962,6 +1400,7 @@ void AAS_WriteRouteCache(void)
 			for (cache = aasworld.clusterareacache[i][j]; cache; cache = cache->next)
 			{
 				numareacache++;
+				totalsize += ROUTECACHE_PAD(cache->size);
 			} //end for
 		} //end for
 	} //end for
@@ -982,17 +1421,16 @@ void AAS_WriteRouteCache(void)
 	routecacheheader.clustercrc = CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters );
 	routecacheheader.numportalcache = numportalcache;
 	routecacheheader.numareacache = numareacache;
+	routecacheheader.cachestructsize = sizeof(aas_routingcache_t);
+	routecacheheader.datasize = totalsize;
 	//write the header
 	botimport.FS_Write(&routecacheheader, sizeof(routecacheheader_t), fp);
-	//
-	totalsize = 0;
 	//write all the cache
 	for (i = 0; i < aasworld.numareas; i++)
 	{
 		for (cache = aasworld.portalcache[i]; cache; cache = cache->next)
 		{
-			botimport.FS_Write(cache, cache->size, fp);
-			totalsize += cache->size;
+			AAS_WriteCache(cache, fp);
 		} //end for
 	} //end for
 	for (i = 0; i < aasworld.numclusters; i++)
@@ -1002,50 +1440,57 @@ void AAS_WriteRouteCache(void)
 		{
 			for (cache = aasworld.clusterareacache[i][j]; cache; cache = cache->next)
 			{
-				botimport.FS_Write(cache, cache->size, fp);
-				totalsize += cache->size;
+				AAS_WriteCache(cache, fp);
 			} //end for
 		} //end for
 	} //end for
-	// write the visareas
-	/*
-	for (i = 0; i < aasworld.numareas; i++)
-	{
-		if (!aasworld.areavisibility[i]) {
-			size = 0;
-			botimport.FS_Write(&size, sizeof(int), fp);
-			continue;
-		}
-		AAS_DecompressVis( aasworld.areavisibility[i], aasworld.numareas, aasworld.decompressedvis );
-		size = AAS_CompressVis( aasworld.decompressedvis, aasworld.numareas, aasworld.decompressedvis );
-		botimport.FS_Write(&size, sizeof(int), fp);
-		botimport.FS_Write(aasworld.decompressedvis, size, fp);
-	}
-	*/
 	//
 	botimport.FS_FCloseFile(fp);
 	botimport.Print(PRT_MESSAGE, "\nroute cache written to %s\n", filename);
 	botimport.Print(PRT_MESSAGE, "written %d bytes of routing cache\n", totalsize);
 } //end of the function AAS_WriteRouteCache
 //===========================================================================
+// returns the routing cache at the given offset of the route cache data
+// if it is valid for the current map
 //
 // Parameter:			-
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
+static aas_routingcache_t *AAS_CheckCache(byte *data, int datasize, int offset, int type)
 {
-	int size;
 	aas_routingcache_t *cache;
-
-	botimport.FS_Read(&size, sizeof(size), fp);
-	cache = (aas_routingcache_t *) GetMemory(size);
-	cache->size = size;
-	botimport.FS_Read((unsigned char *)cache + sizeof(size), size - sizeof(size), fp);
-	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t) - sizeof(unsigned short) +
-		(size - sizeof(aas_routingcache_t) + sizeof(unsigned short)) / 3 * 2;
+	aas_portal_t *portal;
+	int numtraveltimes, cluster;
+
+	if (offset + (int) sizeof(aas_routingcache_t) > datasize) return NULL;
+	cache = (aas_routingcache_t *) (data + offset);
+	if (cache->type != type) return NULL;
+	if (cache->areanum <= 0 || cache->areanum >= aasworld.numareas) return NULL;
+	if (cache->cluster <= 0 || cache->cluster >= aasworld.numclusters) return NULL;
+	if (type == CACHETYPE_AREA)
+	{
+		//the area must be part of the cluster
+		cluster = aasworld.areasettings[cache->areanum].cluster;
+		if (cluster < 0)
+		{
+			portal = &aasworld.portals[-cluster];
+			if (portal->frontcluster != cache->cluster && portal->backcluster != cache->cluster) return NULL;
+		} //end if
+		else if (cluster != cache->cluster)
+		{
+			return NULL;
+		} //end else if
+		numtraveltimes = aasworld.clusters[cache->cluster].numreachabilityareas;
+	} //end if
+	else
+	{
+		numtraveltimes = aasworld.numportals;
+	} //end else
+	if (cache->size != AAS_RoutingCacheSize(numtraveltimes)) return NULL;
+	if (offset + ROUTECACHE_PAD(cache->size) > datasize) return NULL;
 	return cache;
-} //end of the function AAS_ReadCache
+} //end of the function AAS_CheckCache
 //===========================================================================
 //
 // Parameter:			-
@@ -1054,11 +1499,12 @@ aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
 //===========================================================================
 int AAS_ReadRouteCache(void)
 {
-	int i, clusterareanum;//, size;
+	int i, pass, offset, clusterareanum, numtraveltimes;
 	fileHandle_t fp;
 	char filename[MAX_QPATH];
 	routecacheheader_t routecacheheader;
 	aas_routingcache_t *cache;
+	byte *data;
 
 	Com_sprintf(filename, MAX_QPATH, "maps/%s.rcd", aasworld.mapname);
 	botimport.FS_FOpenFile( filename, &fp, FS_READ );
@@ -1069,72 +1515,106 @@ int AAS_ReadRouteCache(void)
 	botimport.FS_Read(&routecacheheader, sizeof(routecacheheader_t), fp );
 	if (routecacheheader.ident != RCID)
 	{
+		botimport.FS_FCloseFile(fp);
 		AAS_Error("%s is not a route cache dump\n", filename);
 		return qfalse;
 	} //end if
 	if (routecacheheader.version != RCVERSION)
 	{
+		botimport.FS_FCloseFile(fp);
 		AAS_Error("route cache dump has wrong version %d, should be %d\n", routecacheheader.version, RCVERSION);
 		return qfalse;
 	} //end if
 	if (routecacheheader.numareas != aasworld.numareas)
 	{
 		//AAS_Error("route cache dump has wrong number of areas\n");
+		botimport.FS_FCloseFile(fp);
 		return qfalse;
 	} //end if
 	if (routecacheheader.numclusters != aasworld.numclusters)
 	{
 		//AAS_Error("route cache dump has wrong number of clusters\n");
+		botimport.FS_FCloseFile(fp);
 		return qfalse;
 	} //end if
 	if (routecacheheader.areacrc !=
 		CRC_ProcessString( (unsigned char *)aasworld.areas, sizeof(aas_area_t) * aasworld.numareas ))
 	{
 		//AAS_Error("route cache dump area CRC incorrect\n");
+		botimport.FS_FCloseFile(fp);
 		return qfalse;
 	} //end if
 	if (routecacheheader.clustercrc !=
 		CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters ))
 	{
 		//AAS_Error("route cache dump cluster CRC incorrect\n");
+		botimport.FS_FCloseFile(fp);
 		return qfalse;
 	} //end if
-	//read all the portal cache
-	for (i = 0; i < routecacheheader.numportalcache; i++)
+	//written by a build with another structure layout
+	if (routecacheheader.cachestructsize != sizeof(aas_routingcache_t) || routecacheheader.datasize <= 0
+		|| routecacheheader.numportalcache < 0 || routecacheheader.numareacache < 0)
 	{
-		cache = AAS_ReadCache(fp);
-		cache->next = aasworld.portalcache[cache->areanum];
-		cache->prev = NULL;
-		if (aasworld.portalcache[cache->areanum])
-			aasworld.portalcache[cache->areanum]->prev = cache;
-		aasworld.portalcache[cache->areanum] = cache;
-	} //end for
-	//read all the cluster area cache
-	for (i = 0; i < routecacheheader.numareacache; i++)
-	{
-		cache = AAS_ReadCache(fp);
-		clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
-		cache->next = aasworld.clusterareacache[cache->cluster][clusterareanum];
-		cache->prev = NULL;
-		if (aasworld.clusterareacache[cache->cluster][clusterareanum])
-			aasworld.clusterareacache[cache->cluster][clusterareanum]->prev = cache;
-		aasworld.clusterareacache[cache->cluster][clusterareanum] = cache;
-	} //end for
-	// read the visareas
-	/*
-	aasworld.areavisibility = (byte **) GetClearedMemory(aasworld.numareas * sizeof(byte *));
-	aasworld.decompressedvis = (byte *) GetClearedMemory(aasworld.numareas * sizeof(byte));
-	for (i = 0; i < aasworld.numareas; i++)
+		botimport.FS_FCloseFile(fp);
+		return qfalse;
+	} //end if
+	//read all the cache data at once, it is used in place
+	data = (byte *) GetMemory(routecacheheader.datasize);
+	if (botimport.FS_Read(data, routecacheheader.datasize, fp) != routecacheheader.datasize)
 	{
-		botimport.FS_Read(&size, sizeof(size), fp );
-		if (size) {
-			aasworld.areavisibility[i] = (byte *) GetMemory(size);
-			botimport.FS_Read(aasworld.areavisibility[i], size, fp );
-		}
-	}
-	*/
-	//
+		FreeMemory(data);
+		botimport.FS_FCloseFile(fp);
+		return qfalse;
+	} //end if
 	botimport.FS_FCloseFile(fp);
+	//validate all the caches before linking any of them
+	for (pass = 0; pass < 2; pass++)
+	{
+		offset = 0;
+		for (i = 0; i < routecacheheader.numportalcache + routecacheheader.numareacache; i++)
+		{
+			cache = AAS_CheckCache(data, routecacheheader.datasize, offset,
+							i < routecacheheader.numportalcache ? CACHETYPE_PORTAL : CACHETYPE_AREA);
+			if (!cache)
+			{
+				botimport.Print(PRT_WARNING, "%s is damaged\n", filename);
+				FreeMemory(data);
+				return qfalse;
+			} //end if
+			offset += ROUTECACHE_PAD(cache->size);
+			if (!pass) continue;
+			//restore pointers
+			numtraveltimes = (cache->size - sizeof(aas_routingcache_t)) / (sizeof(unsigned short int) + sizeof(unsigned char));
+			cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t)
+										+ numtraveltimes * sizeof(unsigned short int);
+			cache->resident = qtrue;
+			cache->slab = NULL;
+			cache->time_prev = NULL;
+			cache->time_next = NULL;
+			cache->prev = NULL;
+			if (cache->type == CACHETYPE_PORTAL)
+			{
+				cache->next = aasworld.portalcache[cache->areanum];
+				if (cache->next) cache->next->prev = cache;
+				aasworld.portalcache[cache->areanum] = cache;
+			} //end if
+			else
+			{
+				clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
+				cache->next = aasworld.clusterareacache[cache->cluster][clusterareanum];
+				if (cache->next) cache->next->prev = cache;
+				aasworld.clusterareacache[cache->cluster][clusterareanum] = cache;
+			} //end else
+		} //end for
+		if (offset != routecacheheader.datasize)
+		{
+			botimport.Print(PRT_WARNING, "%s is damaged\n", filename);
+			FreeMemory(data);
+			return qfalse;
+		} //end if
+	} //end for
+	aasworld.residentcache = data;
+	aasworld.residentcachesize = routecacheheader.datasize;
 	return qtrue;
 } //end of the function AAS_ReadRouteCache
 //===========================================================================
@@ -1219,6 +1699,8 @@ void AAS_InitReachabilityAreas(void)
 //===========================================================================
 void AAS_InitRouting(void)
 {
+	int precompute;
+
 	AAS_InitTravelFlagFromType();
 	//
 	AAS_InitAreaContentsTravelFlags();
@@ -1243,9 +1725,25 @@ void AAS_InitRouting(void)
 #endif //ROUTING_DEBUG
 	//
 	routingcachesize = 0;
-	max_routingcachesize = 1024 * (int) LibVarValue("max_routingcache", "4096");
+	max_routingcachesize = 1024 * (int) LibVarValue("max_routingcache", "12288");
+	AAS_InitSizeClasses();
+	cachepool.cachebytes = 0;
+	cachepool.numcaches = 0;
+	cachepool.peakbytes = 0;
+	cachepool.hits = 0;
+	cachepool.misses = 0;
+	cachepool.evictions = 0;
 	// read any routing cache if available
-	AAS_ReadRouteCache();
+	if (!AAS_ReadRouteCache())
+	{
+		// 1 = precompute the routing cache, 2 = also save it for the next start
+		precompute = (int) LibVarValue("precomputeroutingcache", "0");
+		if (precompute)
+		{
+			AAS_CreateAllRoutingCache();
+			if (precompute > 1) AAS_WriteRouteCache();
+		} //end if
+	} //end if
 } //end of the function AAS_InitRouting
 //===========================================================================
 //
@@ -1259,6 +1757,12 @@ void AAS_FreeRoutingCaches(void)
 	AAS_FreeAllClusterAreaCache();
 	// free all the existing portal cache
 	AAS_FreeAllPortalCache();
+	// free the precomputed or loaded cache the lists pointed into
+	if (aasworld.residentcache) FreeMemory(aasworld.residentcache);
+	aasworld.residentcache = NULL;
+	aasworld.residentcachesize = 0;
+	// all dynamic caches are freed now
+	AAS_FreeCacheSlabs();
 	// free cached travel times within areas
 	if (aasworld.areatraveltimes) FreeMemory(aasworld.areatraveltimes);
 	aasworld.areatraveltimes = NULL;
@@ -1290,7 +1794,7 @@ void AAS_FreeRoutingCaches(void)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+static void AAS_UpdateAreaRoutingCacheWith(aas_routingcache_t *areacache, aas_routingupdate_t *areaupdate)
 {
 	int i, nextareanum, cluster, badtravelflags, clusterareanum, linknum;
 	int numreachabilityareas;
@@ -1300,13 +1804,8 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 	const aas_reversedreachability_t *revreach;
 	const aas_reversedlink_t *revlink;
 
-#ifdef ROUTING_DEBUG
-	numareacacheupdates++;
-#endif //ROUTING_DEBUG
 	//number of reachability areas within this cluster
 	numreachabilityareas = aasworld.clusters[areacache->cluster].numreachabilityareas;
-	//
-	aasworld.frameroutingupdates++;
 	//clear the routing update fields
 //	Com_Memset(aasworld.areaupdate, 0, aasworld.numareas * sizeof(aas_routingupdate_t));
 	//
@@ -1317,7 +1816,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 	//
 	Com_Memset(startareatraveltimes, 0, sizeof(startareatraveltimes));
 	//
-	curupdate = &aasworld.areaupdate[clusterareanum];
+	curupdate = &areaupdate[clusterareanum];
 	curupdate->areanum = areacache->areanum;
 	//VectorCopy(areacache->origin, curupdate->start);
 	curupdate->areatraveltimes = startareatraveltimes;
@@ -1373,7 +1872,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			{
 				areacache->traveltimes[clusterareanum] = t;
 				areacache->reachabilities[clusterareanum] = linknum - aasworld.areasettings[nextareanum].firstreachablearea;
-				nextupdate = &aasworld.areaupdate[clusterareanum];
+				nextupdate = &areaupdate[clusterareanum];
 				nextupdate->areanum = nextareanum;
 				nextupdate->tmptraveltime = t;
 				//VectorCopy(reach->start, nextupdate->start);
@@ -1394,6 +1893,23 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			} //end if
 		} //end for
 	} //end while
+} //end of the function AAS_UpdateAreaRoutingCacheWith
+//===========================================================================
+// update the given routing cache
+//
+// Parameter:			areacache		: routing cache to update
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+{
+#ifdef ROUTING_DEBUG
+	numareacacheupdates++;
+#endif //ROUTING_DEBUG
+	//
+	aasworld.frameroutingupdates++;
+	//
+	AAS_UpdateAreaRoutingCacheWith(areacache, aasworld.areaupdate);
 } //end of the function AAS_UpdateAreaRoutingCache
 //===========================================================================
 //
@@ -1401,6 +1917,22 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+static aas_routingcache_t *AAS_FindAreaRoutingCache(int clusternum, int areanum, int travelflags)
+{
+	aas_routingcache_t *cache;
+
+	for (cache = aasworld.clusterareacache[clusternum][AAS_ClusterAreaNum(clusternum, areanum)]; cache; cache = cache->next)
+	{
+		if (cache->travelflags == travelflags) break;
+	} //end for
+	return cache;
+} //end of the function AAS_FindAreaRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int travelflags)
 {
 	int clusterareanum;
@@ -1430,14 +1962,20 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 		if (clustercache) clustercache->prev = cache;
 		aasworld.clusterareacache[clusternum][clusterareanum] = cache;
 		AAS_UpdateAreaRoutingCache(cache);
+		cachepool.misses++;
+		cache->type = CACHETYPE_AREA;
+		//area cache leading towards a portal is never evicted
+		if (aasworld.areasettings[areanum].cluster < 0) return cache;
 	} //end if
 	else
 	{
+		cachepool.hits++;
+		//precomputed or pinned cache
+		if (cache->resident || aasworld.areasettings[areanum].cluster < 0) return cache;
 		AAS_UnlinkCache(cache);
 	} //end else
 	//the cache has been accessed
 	cache->time = AAS_RoutingTime();
-	cache->type = CACHETYPE_AREA;
 	AAS_LinkCache(cache);
 	return cache;
 } //end of the function AAS_GetAreaRoutingCache
@@ -1447,7 +1985,7 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
+static void AAS_UpdatePortalRoutingCacheWith(aas_routingcache_t *portalcache, aas_routingupdate_t *portalupdate, qboolean precomputed)
 {
 	int i, portalnum, clusterareanum, clusternum;
 	unsigned short int t;
@@ -1456,13 +1994,10 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 	aas_routingcache_t *cache;
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
 
-#ifdef ROUTING_DEBUG
-	numportalcacheupdates++;
-#endif //ROUTING_DEBUG
 	//clear the routing update fields
-//	Com_Memset(aasworld.portalupdate, 0, (aasworld.numportals+1) * sizeof(aas_routingupdate_t));
+//	Com_Memset(portalupdate, 0, (aasworld.numportals+1) * sizeof(aas_routingupdate_t));
 	//
-	curupdate = &aasworld.portalupdate[aasworld.numportals];
+	curupdate = &portalupdate[aasworld.numportals];
 	curupdate->cluster = portalcache->cluster;
 	curupdate->areanum = portalcache->areanum;
 	curupdate->tmptraveltime = portalcache->starttraveltime;
@@ -1490,8 +2025,18 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 		//
 		cluster = &aasworld.clusters[curupdate->cluster];
 		//
-		cache = AAS_GetAreaRoutingCache(curupdate->cluster,
+		if (precomputed)
+		{
+			//all area caches exist already and may not be relinked from a job
+			cache = AAS_FindAreaRoutingCache(curupdate->cluster,
 								curupdate->areanum, portalcache->travelflags);
+			if (!cache) continue;
+		} //end if
+		else
+		{
+			cache = AAS_GetAreaRoutingCache(curupdate->cluster,
+								curupdate->areanum, portalcache->travelflags);
+		} //end else
 		//take all portals of the cluster
 		for (i = 0; i < cluster->numportals; i++)
 		{
@@ -1511,7 +2056,7 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 					portalcache->traveltimes[portalnum] > t)
 			{
 				portalcache->traveltimes[portalnum] = t;
-				nextupdate = &aasworld.portalupdate[portalnum];
+				nextupdate = &portalupdate[portalnum];
 				if (portal->frontcluster == curupdate->cluster)
 				{
 					nextupdate->cluster = portal->backcluster;
@@ -1538,6 +2083,19 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 			} //end if
 		} //end for
 	} //end while
+} //end of the function AAS_UpdatePortalRoutingCacheWith
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
+{
+#ifdef ROUTING_DEBUG
+	numportalcacheupdates++;
+#endif //ROUTING_DEBUG
+	AAS_UpdatePortalRoutingCacheWith(portalcache, aasworld.portalupdate, qfalse);
 } //end of the function AAS_UpdatePortalRoutingCache
 //===========================================================================
 //
@@ -1570,14 +2128,18 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 		aasworld.portalcache[areanum] = cache;
 		//update the cache
 		AAS_UpdatePortalRoutingCache(cache);
+		cachepool.misses++;
+		cache->type = CACHETYPE_PORTAL;
 	} //end if
 	else
 	{
+		cachepool.hits++;
+		//precomputed cache is never evicted
+		if (cache->resident) return cache;
 		AAS_UnlinkCache(cache);
 	} //end else
 	//the cache has been accessed
 	cache->time = AAS_RoutingTime();
-	cache->type = CACHETYPE_PORTAL;
 	AAS_LinkCache(cache);
 	return cache;
 } //end of the function AAS_GetPortalRoutingCache
@@ -1587,7 +2149,44 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum)
+static aas_routingcache_t *AAS_FindPortalRoutingCache(int areanum, int travelflags)
+{
+	aas_routingcache_t *cache;
+
+	for (cache = aasworld.portalcache[areanum]; cache; cache = cache->next)
+	{
+		if (cache->travelflags == travelflags) break;
+	} //end for
+	return cache;
+} //end of the function AAS_FindPortalRoutingCache
+//===========================================================================
+// moves a cache that was used without AAS_Get*RoutingCache to the
+// newest end of the time list
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_TouchRoutingCache(aas_routingcache_t *cache)
+{
+	if (!cache || cache->resident) return;
+	//pinned caches are not in the time list
+	if (!cache->time_prev && !cache->time_next && aasworld.oldestcache != cache) return;
+	cachepool.hits++;
+	AAS_UnlinkCache(cache);
+	cache->time = AAS_RoutingTime();
+	AAS_LinkCache(cache);
+} //end of the function AAS_TouchRoutingCache
+//===========================================================================
+// with cached set only existing routing caches are read and the function
+// returns -1 instead of creating a missing cache, nothing is written then
+// so it is safe to call from several threads at once
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static int AAS_RouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum, qboolean cached)
 {
 	int clusternum, goalclusternum, portalnum, i, clusterareanum, bestreachnum;
 	unsigned short int t, besttime;
@@ -1607,7 +2206,7 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 	//check !AAS_AreaReachability(areanum) with custom developer-only debug message
 	if (areanum <= 0 || areanum >= aasworld.numareas)
 	{
-		if (botDeveloper)
+		if (botDeveloper && !cached)
 		{
 			botimport.Print(PRT_ERROR, "AAS_AreaTravelTimeToGoalArea: areanum %d out of range\n", areanum);
 		} //end if
@@ -1615,7 +2214,7 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 	} //end if
 	if (goalareanum <= 0 || goalareanum >= aasworld.numareas)
 	{
-		if (botDeveloper)
+		if (botDeveloper && !cached)
 		{
 			botimport.Print(PRT_ERROR, "AAS_AreaTravelTimeToGoalArea: goalareanum %d out of range\n", goalareanum);
 		} //end if
@@ -1627,7 +2226,7 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 	} //end if
 
 	// make sure the routing cache doesn't grow to large
-	while ( routingcachesize > 12 * 1024 * 1024 ) {
+	while ( !cached && routingcachesize > max_routingcachesize ) {
 		if ( !AAS_FreeOldestCache() ) {
 			break;
 		}
@@ -1676,7 +2275,15 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 	if (clusternum > 0 && goalclusternum > 0 && clusternum == goalclusternum)
 	{
 		//
-		areacache = AAS_GetAreaRoutingCache(clusternum, goalareanum, travelflags);
+		if (cached)
+		{
+			areacache = AAS_FindAreaRoutingCache(clusternum, goalareanum, travelflags);
+			if (!areacache) return -1;
+		} //end if
+		else
+		{
+			areacache = AAS_GetAreaRoutingCache(clusternum, goalareanum, travelflags);
+		} //end else
 		//the number of the area in the cluster
 		clusterareanum = AAS_ClusterAreaNum(clusternum, areanum);
 		//the cluster the area is in
@@ -1710,7 +2317,15 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 		goalclusternum = portal->frontcluster;
 	} //end if
 	//get the portal routing cache
-	portalcache = AAS_GetPortalRoutingCache(goalclusternum, goalareanum, travelflags);
+	if (cached)
+	{
+		portalcache = AAS_FindPortalRoutingCache(goalareanum, travelflags);
+		if (!portalcache) return -1;
+	} //end if
+	else
+	{
+		portalcache = AAS_GetPortalRoutingCache(goalclusternum, goalareanum, travelflags);
+	} //end else
 	//if the area is a cluster portal, read directly from the portal cache
 	if (clusternum < 0)
 	{
@@ -1733,7 +2348,15 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 		//
 		portal = &aasworld.portals[portalnum];
 		//get the cache of the portal area
-		areacache = AAS_GetAreaRoutingCache(clusternum, portal->areanum, travelflags);
+		if (cached)
+		{
+			areacache = AAS_FindAreaRoutingCache(clusternum, portal->areanum, travelflags);
+			if (!areacache) return -1;
+		} //end if
+		else
+		{
+			areacache = AAS_GetAreaRoutingCache(clusternum, portal->areanum, travelflags);
+		} //end else
 		//current area inside the current cluster
 		clusterareanum = AAS_ClusterAreaNum(clusternum, areanum);
 		//if the area is NOT a reachability area
@@ -1770,8 +2393,57 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 	*reachnum = bestreachnum;
 	*traveltime = besttime;
 	return qtrue;
+} //end of the function AAS_RouteToGoalArea
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum)
+{
+	return AAS_RouteToGoalArea(areanum, origin, goalareanum, travelflags, traveltime, reachnum, qfalse);
 } //end of the function AAS_AreaRouteToGoalArea
 //===========================================================================
+// thread safe route lookup through the existing routing caches only,
+// returns -1 when a cache is missing and AAS_AreaRouteToGoalArea is needed
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+int AAS_CachedRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum)
+{
+	return AAS_RouteToGoalArea(areanum, origin, goalareanum, travelflags, traveltime, reachnum, qtrue);
+} //end of the function AAS_CachedRouteToGoalArea
+//===========================================================================
+// marks the goal cache of a route found with AAS_CachedRouteToGoalArea as
+// used so it ages like a cache accessed through AAS_AreaRouteToGoalArea
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_TouchRouteToGoalArea(int areanum, int goalareanum, int travelflags)
+{
+	int clusternum, goalclusternum;
+
+	if (!aasworld.initialized) return;
+	if (areanum <= 0 || areanum >= aasworld.numareas) return;
+	if (goalareanum <= 0 || goalareanum >= aasworld.numareas) return;
+	if (AAS_AreaDoNotEnter(areanum) || AAS_AreaDoNotEnter(goalareanum))
+	{
+		travelflags |= TFL_DONOTENTER;
+	} //end if
+	clusternum = aasworld.areasettings[areanum].cluster;
+	goalclusternum = aasworld.areasettings[goalareanum].cluster;
+	if (clusternum > 0 && clusternum == goalclusternum)
+	{
+		AAS_TouchRoutingCache(AAS_FindAreaRoutingCache(clusternum, goalareanum, travelflags));
+	} //end if
+	AAS_TouchRoutingCache(AAS_FindPortalRoutingCache(goalareanum, travelflags));
+} //end of the function AAS_TouchRouteToGoalArea
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -41,8 +41,16 @@ void AAS_CreateAllRoutingCache(void);
 void AAS_WriteRouteCache(void);
 //
 void AAS_RoutingInfo(void);
+//returns the travel time and first reachability from the area to the goal area
+int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum);
+//route lookup through existing routing caches only, returns -1 when a cache is missing
+int AAS_CachedRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum);
+//marks the caches used by AAS_CachedRouteToGoalArea as accessed
+void AAS_TouchRouteToGoalArea(int areanum, int goalareanum, int travelflags);
 #endif //AASINTERN
 
+//prints routing cache usage and hit statistics
+void AAS_RoutingCacheStats(void);
 //returns the travel flag for the given travel type
 int AAS_TravelFlagForType(int traveltype);
 //return the travel flag(s) for traveling through this area
@@ -111,6 +111,7 @@ typedef struct bot_synonym_s
 {
 	char *string;
 	float weight;
+	int pattern;							//compiled match string, 0 when not compiled
 	struct bot_synonym_s *next;
 } bot_synonym_t;
 //list with synonyms
@@ -126,6 +127,7 @@ typedef struct bot_synonymlist_s
 typedef struct bot_matchstring_s
 {
 	char *string;
+	int pattern;							//compiled match string, 0 when not compiled
 	struct bot_matchstring_s *next;
 } bot_matchstring_t;
 
@@ -152,6 +154,7 @@ typedef struct bot_replychatkey_s
 {
 	int flags;
 	char *string;
+	int pattern;							//compiled match string, 0 when not compiled
 	bot_matchpiece_t *match;
 	struct bot_replychatkey_s *next;
 } bot_replychatkey_t;
@@ -210,6 +213,33 @@ bot_randomlist_t *randomstrings = NULL;
 //reply chats
 bot_replychat_t *replychats = NULL;
 
+//node of the compiled match strings automaton
+typedef struct bot_matchnode_s
+{
+	int child;								//first child node
+	int sibling;							//next child of the parent node
+	int fail;								//node of the longest proper suffix in the trie
+	int output;								//next node on the suffix chain that ends a string
+	int pattern;							//string ending at this node, 0 if none
+	int c;									//lower case character leading to this node
+} bot_matchnode_t;
+
+//all fixed strings of the match templates, synonyms and reply chat keys
+//compiled into one Aho-Corasick automaton, a message is scanned once to
+//find every string it contains and only the match templates, synonyms and
+//reply keys with all their strings present are tested for real
+static struct
+{
+	bot_matchnode_t *nodes;
+	int numnodes;
+	int rootchild[256];
+	int numpatterns;
+	int *seen;								//scan in which a string was last found
+	int scan;
+	char lasttext[MAX_MESSAGE_SIZE];		//text of the last scan
+	qboolean disabled;						//test all strings the old way
+} chatmatch;
+
 //========================================================================
 //
 // Parameter:				-
@@ -542,15 +572,16 @@ static const char *StringContainsWord( const char *str1, const char *str2 )
 }
 
 
-static void StringReplaceWords( char *string, int size, const char *synonym, const char *replacement )
+static int StringReplaceWords( char *string, int size, const char *synonym, const char *replacement )
 {
 	char *str;
 	const char *str2, *endp;
-	int replen, synlen;
+	int replen, synlen, numreplaced;
 
 	synlen = (int) strlen( synonym );
 	replen = (int) strlen( replacement );
 	endp = string + size;
+	numreplaced = 0;
 
 	//find the synonym in the string
 	str = (char *) StringContainsWord( string, synonym );
@@ -573,11 +604,269 @@ static void StringReplaceWords( char *string, int size, const char *synonym, con
 			memmove( str + replen, str + synlen, strlen( str + synlen ) + 1 );
 			//append the synonum replacement
 			Com_Memcpy( str, replacement, replen );
+			numreplaced++;
 		}
 
 		//find the next synonym in the string
 		str = (char *) StringContainsWord( str + replen, synonym );
 	}
+
+	return numreplaced;
+}
+
+
+//===========================================================================
+// returns the child of the node for the given lower case character
+//===========================================================================
+static ID_INLINE int BotMatchNodeChild( int node, int c )
+{
+	if ( node == 0 )
+		return chatmatch.rootchild[c];
+
+	for ( node = chatmatch.nodes[node].child; node; node = chatmatch.nodes[node].sibling )
+	{
+		if ( chatmatch.nodes[node].c == c )
+			return node;
+	}
+
+	return 0;
+}
+
+
+//===========================================================================
+// adds the string to the trie and stores its pattern number, returns the
+// string length, with nodes not yet allocated only the length is returned
+//===========================================================================
+static int BotAddMatchString( const char *string, int *pattern )
+{
+	bot_matchnode_t *n;
+	const char *s;
+	int node, child, c;
+
+	if ( !chatmatch.nodes || string[0] == '\0' )
+		return (int) strlen( string );
+
+	node = 0;
+	for ( s = string; *s != '\0'; s++ )
+	{
+		c = locase[(byte) *s];
+		child = BotMatchNodeChild( node, c );
+		if ( !child )
+		{
+			child = chatmatch.numnodes++;
+			n = &chatmatch.nodes[child];
+			n->c = c;
+			if ( node == 0 )
+			{
+				chatmatch.rootchild[c] = child;
+			}
+			else
+			{
+				n->sibling = chatmatch.nodes[node].child;
+				chatmatch.nodes[node].child = child;
+			}
+		}
+		node = child;
+	}
+
+	n = &chatmatch.nodes[node];
+	if ( !n->pattern )
+		n->pattern = ++chatmatch.numpatterns;
+	*pattern = n->pattern;
+
+	return (int) ( s - string );
+}
+
+
+//===========================================================================
+// assigns pattern numbers to all fixed strings, returns the total length
+//===========================================================================
+static int BotAddAllMatchStrings( void )
+{
+	bot_matchtemplate_t *mt;
+	bot_matchpiece_t *mp;
+	bot_matchstring_t *ms;
+	bot_synonymlist_t *syn;
+	bot_synonym_t *synonym;
+	bot_replychat_t *rchat;
+	bot_replychatkey_t *key;
+	int length;
+
+	length = 0;
+	for ( mt = matchtemplates; mt; mt = mt->next )
+	{
+		for ( mp = mt->first; mp; mp = mp->next )
+		{
+			if ( mp->type != MT_STRING )
+				continue;
+			for ( ms = mp->firststring; ms; ms = ms->next )
+				length += BotAddMatchString( ms->string, &ms->pattern );
+		}
+	}
+
+	for ( syn = synonyms; syn; syn = syn->next )
+	{
+		for ( synonym = syn->firstsynonym; synonym; synonym = synonym->next )
+			length += BotAddMatchString( synonym->string, &synonym->pattern );
+	}
+
+	for ( rchat = replychats; rchat; rchat = rchat->next )
+	{
+		for ( key = rchat->keys; key; key = key->next )
+		{
+			if ( ( key->flags & RCKFL_STRING ) && key->string )
+				length += BotAddMatchString( key->string, &key->pattern );
+		}
+	}
+
+	return length;
+}
+
+
+//===========================================================================
+// builds the automaton from the loaded match templates, synonyms and reply chats
+//===========================================================================
+static void BotCompileMatchStrings( void )
+{
+	bot_matchnode_t *n;
+	int *queue, head, tail, maxnodes;
+	int node, child, fail;
+
+	//first pass only counts
+	maxnodes = BotAddAllMatchStrings() + 1;
+	if ( maxnodes <= 1 )
+		return;
+
+	chatmatch.nodes = (bot_matchnode_t *) GetClearedMemory( maxnodes * sizeof( bot_matchnode_t ) );
+	chatmatch.numnodes = 1;
+	chatmatch.numpatterns = 0;
+	Com_Memset( chatmatch.rootchild, 0, sizeof( chatmatch.rootchild ) );
+	BotAddAllMatchStrings();
+
+	//breadth first so the fail node is always done before the node itself
+	queue = (int *) GetMemory( chatmatch.numnodes * sizeof( int ) );
+	head = tail = 0;
+	for ( node = 0; node < 256; node++ )
+	{
+		if ( chatmatch.rootchild[node] )
+			queue[tail++] = chatmatch.rootchild[node];
+	}
+	while ( head < tail )
+	{
+		node = queue[head++];
+		for ( child = chatmatch.nodes[node].child; child; child = chatmatch.nodes[child].sibling )
+		{
+			n = &chatmatch.nodes[child];
+			for ( fail = chatmatch.nodes[node].fail; fail; fail = chatmatch.nodes[fail].fail )
+			{
+				if ( BotMatchNodeChild( fail, n->c ) )
+					break;
+			}
+			n->fail = BotMatchNodeChild( fail, n->c );
+			if ( chatmatch.nodes[n->fail].pattern )
+				n->output = n->fail;
+			else
+				n->output = chatmatch.nodes[n->fail].output;
+			queue[tail++] = child;
+		}
+	}
+	FreeMemory( queue );
+
+	chatmatch.seen = (int *) GetClearedMemory( ( chatmatch.numpatterns + 1 ) * sizeof( int ) );
+	chatmatch.scan = 0;
+	chatmatch.lasttext[0] = '\0';
+
+	botimport.Print( PRT_MESSAGE, "compiled %d chat match strings into %d nodes\n", chatmatch.numpatterns, chatmatch.numnodes );
+}
+
+
+//===========================================================================
+//
+//===========================================================================
+static void BotFreeMatchStrings( void )
+{
+	if ( chatmatch.nodes )
+		FreeMemory( chatmatch.nodes );
+	if ( chatmatch.seen )
+		FreeMemory( chatmatch.seen );
+	Com_Memset( &chatmatch, 0, sizeof( chatmatch ) );
+}
+
+
+//===========================================================================
+// finds all compiled strings contained in the text, nothing is done when
+// the text is the same as in the previous scan, which is the common case
+// with all bots checking the same console message
+//===========================================================================
+static void BotScanMatchStrings( const char *text )
+{
+	bot_matchnode_t *n;
+	int node, next, c, p;
+
+	if ( !chatmatch.nodes || chatmatch.disabled )
+		return;
+
+	if ( chatmatch.scan && !strcmp( text, chatmatch.lasttext ) )
+		return;
+
+	if ( ++chatmatch.scan <= 0 )
+	{
+		Com_Memset( chatmatch.seen, 0, ( chatmatch.numpatterns + 1 ) * sizeof( int ) );
+		chatmatch.scan = 1;
+	}
+
+	//longer texts are never reused
+	if ( strlen( text ) < sizeof( chatmatch.lasttext ) )
+		strcpy( chatmatch.lasttext, text );
+	else
+		chatmatch.lasttext[0] = '\0';
+
+	node = 0;
+	for ( ; *text != '\0'; text++ )
+	{
+		c = locase[(byte) *text];
+		while ( ( next = BotMatchNodeChild( node, c ) ) == 0 && node )
+			node = chatmatch.nodes[node].fail;
+		node = next;
+		n = &chatmatch.nodes[node];
+		for ( p = n->pattern ? node : n->output; p; p = chatmatch.nodes[p].output )
+			chatmatch.seen[chatmatch.nodes[p].pattern] = chatmatch.scan;
+	}
+}
+
+
+//===========================================================================
+// returns qfalse only when the string is certainly not in the scanned text
+//===========================================================================
+static ID_INLINE qboolean BotMatchStringSeen( int pattern )
+{
+	if ( !pattern || !chatmatch.nodes || chatmatch.disabled )
+		return qtrue;
+	return chatmatch.seen[pattern] == chatmatch.scan;
+}
+
+
+//===========================================================================
+// returns qfalse when a fixed piece of the template is not in the scanned text
+//===========================================================================
+static qboolean BotMatchPiecesPossible( const bot_matchpiece_t *pieces )
+{
+	const bot_matchstring_t *ms;
+
+	for ( ; pieces; pieces = pieces->next )
+	{
+		if ( pieces->type != MT_STRING )
+			continue;
+		for ( ms = pieces->firststring; ms; ms = ms->next )
+		{
+			if ( BotMatchStringSeen( ms->pattern ) )
+				break;
+		}
+		if ( !ms )
+			return qfalse;
+	}
+
+	return qtrue;
 }
 
 
@@ -783,6 +1072,8 @@ void BotReplaceSynonyms( char *string, int size, unsigned long int context )
 	const bot_synonymlist_t *syn;
 	const bot_synonym_t *synonym;
 
+	BotScanMatchStrings( string );
+
 	for ( syn = synonyms; syn; syn = syn->next )
 	{
 		if ( (syn->context & context) == 0 )
@@ -790,7 +1081,10 @@ void BotReplaceSynonyms( char *string, int size, unsigned long int context )
 
 		for ( synonym = syn->firstsynonym->next; synonym; synonym = synonym->next )
 		{
-			StringReplaceWords( string, size, synonym->string, syn->firstsynonym->string );
+			if ( !BotMatchStringSeen( synonym->pattern ) )
+				continue;
+			if ( StringReplaceWords( string, size, synonym->string, syn->firstsynonym->string ) )
+				BotScanMatchStrings( string );
 		}
 	}
 }
@@ -802,6 +1096,8 @@ static void BotReplaceWeightedSynonyms( char *string, int size, unsigned long in
 	bot_synonym_t *synonym, *replacement;
 	float weight, curweight;
 
+	BotScanMatchStrings( string );
+
 	for ( syn = synonyms; syn; syn = syn->next )
 	{
 		if ( ( syn->context & context ) == 0 )
@@ -825,9 +1121,10 @@ static void BotReplaceWeightedSynonyms( char *string, int size, unsigned long in
 		//replace all synonyms with the replacement
 		for ( synonym = syn->firstsynonym; synonym; synonym = synonym->next )
 		{
-			if ( synonym == replacement )
+			if ( synonym == replacement || !BotMatchStringSeen( synonym->pattern ) )
 				continue;
-			StringReplaceWords( string, size, synonym->string, replacement->string );
+			if ( StringReplaceWords( string, size, synonym->string, replacement->string ) )
+				BotScanMatchStrings( string );
 		}
 	}
 }
@@ -843,6 +1140,8 @@ static void BotReplaceReplySynonyms( char *string, int size, unsigned long int c
 
 	endp = string + size;
 
+	BotScanMatchStrings( string );
+
 	for ( str1 = string; *str1 != '\0'; )
 	{
 		//go to the start of the next word
@@ -858,6 +1157,9 @@ static void BotReplaceReplySynonyms( char *string, int size, unsigned long int c
 
 			for ( synonym = syn->firstsynonym->next; synonym; synonym = synonym->next )
 			{
+				if ( !BotMatchStringSeen( synonym->pattern ) )
+					continue;
+
 				//if the synonym is not at the front of the string continue
 				str2 = StringContainsWord( str1, synonym->string );
 				if ( !str2 || str2 != str1 )
@@ -876,6 +1178,7 @@ static void BotReplaceReplySynonyms( char *string, int size, unsigned long int c
 				memmove( str1 + replen, str1 + strlen( synonym->string ), strlen( str1 + strlen( synonym->string ) ) + 1 );
 				//append the synonum replacement
 				Com_Memcpy( str1, replacement, replen );
+				BotScanMatchStrings( string );
 				break;
 			}
 
@@ -1498,12 +1801,16 @@ int BotFindMatch(char *str, bot_match_t *match, unsigned long int context)
 	{
 		match->string[strlen(match->string)-1] = '\0';
 	} //end while
+	//find all fixed match strings in the message at once
+	BotScanMatchStrings(match->string);
 	//compare the string with all the match strings
 	for (ms = matchtemplates; ms; ms = ms->next)
 	{
 		if (!(ms->context & context)) continue;
 		//reset the match variable offsets
 		for (i = 0; i < MAX_MATCHVARIABLES; i++) match->variables[i].offset = -1;
+		//skip templates with a fixed piece that isn't in the message
+		if (!BotMatchPiecesPossible(ms->first)) continue;
 		//
 		if (StringsMatch(ms->first, match))
 		{
@@ -2709,6 +3016,8 @@ int BotReplyChat(int chatstate, char *message, int mcontext, int vcontext, const
 	bestpriority = -1;
 	bestchatmessage = NULL;
 	bestrchat = NULL;
+	//find all reply key strings in the message at once
+	BotScanMatchStrings(message);
 	//go through all the reply chats
 	for (rchat = replychats; rchat; rchat = rchat->next)
 	{
@@ -2723,7 +3032,7 @@ int BotReplyChat(int chatstate, char *message, int mcontext, int vcontext, const
 			else if (key->flags & RCKFL_GENDERMALE) res = (cs->gender == CHAT_GENDERMALE);
 			else if (key->flags & RCKFL_GENDERLESS) res = (cs->gender == CHAT_GENDERLESS);
 			else if (key->flags & RCKFL_VARIABLES) res = StringsMatch(key->match, &match);
-			else if (key->flags & RCKFL_STRING) res = (StringContainsWord(message, key->string) != NULL);
+			else if (key->flags & RCKFL_STRING) res = (BotMatchStringSeen(key->pattern) && StringContainsWord(message, key->string) != NULL);
 			//if the key must be present
 			if (key->flags & RCKFL_AND)
 			{
@@ -3047,6 +3356,95 @@ void BotFreeChatState(int handle)
 	botchatstates[handle] = NULL;
 } //end of the function BotFreeChatState
 //===========================================================================
+// runs every line of a recorded chat log through the match templates and
+// synonyms as many bots would, once testing all strings the old way and
+// once with the compiled match strings, and compares the results
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+#define CHATBENCH_BOTS		16
+
+void BotChatMatchBench(const char *filename)
+{
+	fileHandle_t fp;
+	char *buf, *line, *ptr, temp[MAX_MESSAGE_SIZE];
+	unsigned int *results, hash;
+	int len, i, bot, pass, numlines, nummatched, numdiffs, times[2];
+	bot_match_t match;
+
+	if (!matchtemplates && !synonyms)
+	{
+		botimport.Print(PRT_MESSAGE, "chat AI is not set up\n");
+		return;
+	} //end if
+	len = botimport.FS_FOpenFile(filename, &fp, FS_READ);
+	if (!fp || len <= 0)
+	{
+		if (fp) botimport.FS_FCloseFile(fp);
+		botimport.Print(PRT_ERROR, "couldn't load %s\n", filename);
+		return;
+	} //end if
+	buf = (char *) GetMemory(len + 1);
+	botimport.FS_Read(buf, len, fp);
+	botimport.FS_FCloseFile(fp);
+	buf[len] = '\0';
+	//one message per line
+	numlines = 0;
+	for (ptr = buf; *ptr; ptr++)
+	{
+		if (*ptr == '\n' || *ptr == '\r')
+		{
+			*ptr = '\0';
+			continue;
+		} //end if
+		if (ptr == buf || ptr[-1] == '\0') numlines++;
+	} //end for
+	if (!numlines)
+	{
+		FreeMemory(buf);
+		botimport.Print(PRT_MESSAGE, "%s has no chat lines\n", filename);
+		return;
+	} //end if
+	results = (unsigned int *) GetClearedMemory(numlines * 2 * sizeof(unsigned int));
+	nummatched = 0;
+	for (pass = 0; pass < 2; pass++)
+	{
+		chatmatch.disabled = !pass;
+		times[pass] = botimport.Sys_Milliseconds();
+		for (line = buf, i = 0; line < buf + len; line += strlen(line) + 1)
+		{
+			if (!*line) continue;
+			hash = 0;
+			for (bot = 0; bot < CHATBENCH_BOTS; bot++)
+			{
+				if (BotFindMatch(line, &match, 0xFFFFFFFF))
+				{
+					hash = (match.type << 16) ^ (match.subtype + 1);
+				} //end if
+				Q_strncpyz(temp, line, sizeof(temp));
+				BotReplaceSynonyms(temp, sizeof(temp), 0xFFFFFFFF);
+			} //end for
+			if (!pass && hash) nummatched++;
+			for (ptr = temp; *ptr; ptr++) hash = hash * 31 + (byte) *ptr;
+			results[i * 2 + pass] = hash;
+			i++;
+		} //end for
+		times[pass] = botimport.Sys_Milliseconds() - times[pass];
+	} //end for
+	chatmatch.disabled = qfalse;
+	numdiffs = 0;
+	for (i = 0; i < numlines; i++)
+	{
+		if (results[i * 2] != results[i * 2 + 1]) numdiffs++;
+	} //end for
+	botimport.Print(PRT_MESSAGE, "%d chat lines x %d bots, %d matched, %d msec plain, %d msec compiled, %d different results\n",
+					numlines, CHATBENCH_BOTS, nummatched, times[0], times[1], numdiffs);
+	FreeMemory(results);
+	FreeMemory(buf);
+} //end of the function BotChatMatchBench
+//===========================================================================
 //
 // Parameter:				-
 // Returns:					-
@@ -3072,6 +3470,7 @@ int BotSetupChatAI(void)
 		file = LibVarString("rchatfile", "rchat.c");
 		replychats = BotLoadReplyChat(file);
 	} //end if
+	BotCompileMatchStrings();
 
 	InitConsoleMessageHeap();
 
@@ -3118,4 +3517,5 @@ void BotShutdownChatAI(void)
 	synonyms = NULL;
 	if (replychats) BotFreeReplyChat(replychats);
 	replychats = NULL;
+	BotFreeMatchStrings();
 } //end of the function BotShutdownChatAI
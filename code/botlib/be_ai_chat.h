@@ -98,6 +98,8 @@ void BotGetChatMessage(int chatstate, char *buf, int size);
 int StringContains(const char *str1, const char *str2, int casesensitive);
 //finds a match for the given string using the match templates
 int BotFindMatch(char *str, bot_match_t *match, unsigned long int context);
+//benchmarks the match templates and synonyms over a chat log with one message per line
+void BotChatMatchBench(const char *filename);
 //returns a variable from a match
 void BotMatchVariable(bot_match_t *match, int variable, char *buf, int size);
 //unify all the white spaces in the string
@@ -651,6 +651,7 @@ static void Init_AAS_Export( aas_export_t *aas ) {
 	aas->AAS_Initialized = AAS_Initialized;
 	aas->AAS_PresenceTypeBoundingBox = AAS_PresenceTypeBoundingBox;
 	aas->AAS_Time = AAS_Time;
+	aas->AAS_QueryBatch = AAS_QueryBatch;
 	//--------------------------------------------
 	// be_aas_sample.c
 	//--------------------------------------------
@@ -863,6 +864,8 @@ botlib_export_t *GetBotLibAPI(int apiVersion, botlib_import_t *import) {
 	be_botlib_export.BotLibStartFrame = Export_BotLibStartFrame;
 	be_botlib_export.BotLibLoadMap = Export_BotLibLoadMap;
 	be_botlib_export.BotLibUpdateEntity = Export_BotLibUpdateEntity;
+	be_botlib_export.BotLibRoutingStats = AAS_RoutingCacheStats;
+	be_botlib_export.BotLibChatBench = BotChatMatchBench;
 	be_botlib_export.Test = BotExportTest;
 
 	return &be_botlib_export;
@@ -36,6 +36,7 @@ struct aas_entityinfo_s;
 struct aas_areainfo_s;
 struct aas_altroutegoal_s;
 struct aas_predictroute_s;
+struct aas_query_s;
 struct bot_consolemessage_s;
 struct bot_match_s;
 struct bot_goal_s;
@@ -205,6 +206,9 @@ typedef struct botlib_import_s
 	void		(*DebugPolygonDelete)(int id);
 
 	int			(*Sys_Milliseconds)(void);
+	//parallel jobs, job functions must not use any of the imports above
+	int			(*NumJobThreads)(void);
+	void		(*RunJobs)(void (*func)(void *arg, int index), void *arg, int count);
 } botlib_import_t;
 
 typedef struct aas_export_s
@@ -219,6 +223,7 @@ typedef struct aas_export_s
 	int			(*AAS_Initialized)(void);
 	void		(*AAS_PresenceTypeBoundingBox)(int presencetype, vec3_t mins, vec3_t maxs);
 	float		(*AAS_Time)(void);
+	int			(*AAS_QueryBatch)(struct aas_query_s *queries, int numqueries);
 	//--------------------------------------------
 	// be_aas_sample.c
 	//--------------------------------------------
@@ -428,6 +433,10 @@ typedef struct botlib_export_s
 	int (*BotLibLoadMap)(const char *mapname);
 	//entity updates
 	int (*BotLibUpdateEntity)(int ent, bot_entitystate_t *state);
+	//print routing cache statistics
+	void (*BotLibRoutingStats)(void);
+	//benchmark chat matching over a chat log
+	void (*BotLibChatBench)(const char *filename);
 	//just for testing
 	int (*Test)(int parm0, char *parm1, vec3_t parm2, vec3_t parm3);
 } botlib_export_t;
@@ -485,7 +494,8 @@ name:						default:			module(s):			description:
 "rs_maxjumpfallheight"		"450"				be_aas_move.c
 
 "max_aaslinks"				"4096"				be_aas_sample.c		maximum links in the AAS
-"max_routingcache"			"4096"				be_aas_route.c		maximum routing cache size in KB
+"max_routingcache"			"12288"				be_aas_route.c		maximum routing cache size in KB
+"precomputeroutingcache"	"0"					be_aas_route.c		precompute routing cache at map load, 2 also saves it
 "forceclustering"			"0"					be_aas_main.c		force recalculation of clusters
 "forcereachability"			"0"					be_aas_main.c		force recalculation of reachabilities
 "forcewrite"				"0"					be_aas_main.c		force writing of aas file
@@ -76,6 +76,11 @@ static aviFileData_t afd;
 static byte buffer[ MAX_AVI_BUFFER ];
 static int  bufIndex;
 
+#define PCM_BUFFER_SIZE 44100
+
+static byte pcmCaptureBuffer[ PCM_BUFFER_SIZE ];
+static int  bytesInBuffer = 0;
+
 
 /*
 ===============
@@ -89,6 +94,307 @@ static ID_INLINE void SafeFS_Write( const void *buf, int len, fileHandle_t f )
 }
 
 
+/*
+===============================================================================
+
+Writer thread
+
+Chunks are copied into a preallocated ring and written out by a separate
+thread, so a slow disk or encoder pipe doesn't stall the frame loop.
+All file offsets and index entries are computed on the main thread.
+
+===============================================================================
+*/
+
+#define MAX_AVI_QUEUE 64
+
+typedef struct aviChunk_s
+{
+  byte          header[ 8 ];
+  byte          index[ 16 ];
+  qboolean      hasIndex;
+  byte          *data;
+  int           size;
+  int64_t       queueTime;
+} aviChunk_t;
+
+typedef struct aviWriter_s
+{
+  void          *thread;
+  void          *mutex;
+  void          *freeSlots;
+  void          *usedSlots;
+
+  aviChunk_t    chunks[ MAX_AVI_QUEUE ];
+  int           numChunks;
+  int           chunkSize;
+  int           head;           // next slot to fill, main thread only
+  int           tail;           // next slot to write, writer thread only
+
+  // guarded by mutex
+  int           queued;
+  qboolean      failed;
+  qboolean      exit;
+  int           maxQueued;
+  int           written;
+  int64_t       totalLatency;
+  int64_t       maxLatency;
+
+  // main thread only
+  int           dropped;
+  int           stalls;
+  int64_t       stallTime;
+} aviWriter_t;
+
+static aviWriter_t aviw;
+
+static const byte aviPadding[ 4 ] = { 0 };
+
+
+/*
+===============
+CL_WriteAVIChunkData
+
+Header + payload + padding go in a single call, may run on the writer thread
+===============
+*/
+static qboolean CL_WriteAVIChunkData( const aviChunk_t *chunk, const byte *data )
+{
+  fsIOVec_t vec[ 3 ];
+  int len;
+
+  vec[ 0 ].data = chunk->header;
+  vec[ 0 ].len = 8;
+  vec[ 1 ].data = data;
+  vec[ 1 ].len = chunk->size;
+  vec[ 2 ].data = aviPadding;
+  vec[ 2 ].len = PADLEN( chunk->size, 2 );
+
+  len = vec[ 0 ].len + vec[ 1 ].len + vec[ 2 ].len;
+  if ( FS_WriteVec( vec, 3, afd.f ) != len )
+    return qfalse;
+
+  if ( chunk->hasIndex )
+  {
+    vec[ 0 ].data = chunk->index;
+    vec[ 0 ].len = 16;
+    if ( FS_WriteVec( vec, 1, afd.idxF ) != 16 )
+      return qfalse;
+  }
+
+  return qtrue;
+}
+
+
+/*
+===============
+CL_AVIWriterThread
+===============
+*/
+static void CL_AVIWriterThread( void *arg )
+{
+  aviChunk_t *chunk;
+  qboolean failed, ok;
+  int64_t latency;
+
+  while ( 1 )
+  {
+    Sys_SemaphoreWait( aviw.usedSlots );
+
+    Sys_MutexLock( aviw.mutex );
+    failed = aviw.failed;
+    if ( aviw.queued == 0 && aviw.exit )
+    {
+      Sys_MutexUnlock( aviw.mutex );
+      break;
+    }
+    Sys_MutexUnlock( aviw.mutex );
+
+    chunk = &aviw.chunks[ aviw.tail ];
+
+    // keep draining after a failure so the main thread never blocks
+    ok = failed || CL_WriteAVIChunkData( chunk, chunk->data );
+
+    latency = Sys_Microseconds() - chunk->queueTime;
+    aviw.tail = ( aviw.tail + 1 ) % aviw.numChunks;
+
+    Sys_MutexLock( aviw.mutex );
+    aviw.queued--;
+    aviw.written++;
+    aviw.totalLatency += latency;
+    if ( latency > aviw.maxLatency )
+      aviw.maxLatency = latency;
+    if ( !ok )
+      aviw.failed = qtrue;
+    Sys_MutexUnlock( aviw.mutex );
+
+    Sys_SemaphorePost( aviw.freeSlots );
+  }
+}
+
+
+/*
+===============
+CL_StopAVIWriter
+
+Waits until all queued chunks are written and releases the queue
+===============
+*/
+static void CL_StopAVIWriter( void )
+{
+  int i;
+
+  if ( aviw.thread )
+  {
+    Sys_MutexLock( aviw.mutex );
+    aviw.exit = qtrue;
+    Sys_MutexUnlock( aviw.mutex );
+    Sys_SemaphorePost( aviw.usedSlots );
+    Sys_JoinThread( aviw.thread );
+
+    if ( aviw.failed )
+      Com_Printf( S_COLOR_YELLOW "WARNING: failed to write %s\n", afd.fileName );
+
+    if ( aviw.written )
+    {
+      Com_Printf( "AVI writer: %i chunks, queue %i/%i, latency avg %.1f max %.1f msec, "
+        "%i waits for %.1f msec, %i frames dropped\n",
+        aviw.written, aviw.maxQueued, aviw.numChunks,
+        (double)aviw.totalLatency / aviw.written / 1000.0, aviw.maxLatency / 1000.0,
+        aviw.stalls, aviw.stallTime / 1000.0, aviw.dropped );
+    }
+  }
+
+  for ( i = 0; i < aviw.numChunks; i++ )
+  {
+    if ( aviw.chunks[ i ].data )
+      Z_Free( aviw.chunks[ i ].data );
+  }
+
+  Sys_DestroySemaphore( aviw.usedSlots );
+  Sys_DestroySemaphore( aviw.freeSlots );
+  Sys_DestroyMutex( aviw.mutex );
+
+  Com_Memset( &aviw, 0, sizeof( aviw ) );
+}
+
+
+/*
+===============
+CL_StartAVIWriter
+
+Falls back to writing on the main thread if the queue is disabled
+or the thread cannot be started
+===============
+*/
+static void CL_StartAVIWriter( int chunkSize )
+{
+  int i;
+
+  Com_Memset( &aviw, 0, sizeof( aviw ) );
+
+  if ( cl_aviQueueFrames->integer <= 0 )
+    return;
+
+  aviw.numChunks = MIN( cl_aviQueueFrames->integer, MAX_AVI_QUEUE );
+  aviw.chunkSize = chunkSize;
+
+  aviw.mutex = Sys_CreateMutex();
+  aviw.freeSlots = Sys_CreateSemaphore( aviw.numChunks );
+  aviw.usedSlots = Sys_CreateSemaphore( 0 );
+  if ( !aviw.mutex || !aviw.freeSlots || !aviw.usedSlots )
+  {
+    CL_StopAVIWriter();
+    return;
+  }
+
+  for ( i = 0; i < aviw.numChunks; i++ )
+    aviw.chunks[ i ].data = Z_Malloc( chunkSize );
+
+  aviw.thread = Sys_CreateThread( CL_AVIWriterThread, NULL, "avi writer" );
+  if ( !aviw.thread )
+    CL_StopAVIWriter();
+}
+
+
+/*
+===============
+CL_WriteAVIChunk
+
+Returns qfalse if a droppable chunk was skipped because the queue is full
+===============
+*/
+static qboolean CL_WriteAVIChunk( aviChunk_t *chunk, const byte *data, qboolean canDrop )
+{
+  aviChunk_t *slot;
+  qboolean full, failed;
+  int64_t start;
+  int i;
+
+  if ( !aviw.thread || chunk->size > aviw.chunkSize )
+  {
+    if ( aviw.thread )
+    {
+      // should never happen, wait until the queue is empty to keep the order
+      for ( i = 0; i < aviw.numChunks; i++ )
+        Sys_SemaphoreWait( aviw.freeSlots );
+      for ( i = 0; i < aviw.numChunks; i++ )
+        Sys_SemaphorePost( aviw.freeSlots );
+    }
+    if ( !CL_WriteAVIChunkData( chunk, data ) )
+      Com_Error( ERR_DROP, "Failed to write avi file" );
+    return qtrue;
+  }
+
+  Sys_MutexLock( aviw.mutex );
+  full = ( aviw.queued >= aviw.numChunks );
+  failed = aviw.failed;
+  Sys_MutexUnlock( aviw.mutex );
+
+  if ( failed )
+  {
+    CL_StopAVIWriter();
+    Com_Error( ERR_DROP, "Failed to write avi file" );
+  }
+
+  if ( full )
+  {
+    if ( canDrop && cl_aviQueueDrop->integer )
+    {
+      aviw.dropped++;
+      return qfalse;
+    }
+    start = Sys_Microseconds();
+    Sys_SemaphoreWait( aviw.freeSlots );
+    aviw.stallTime += Sys_Microseconds() - start;
+    aviw.stalls++;
+  }
+  else
+  {
+    Sys_SemaphoreWait( aviw.freeSlots );
+  }
+
+  slot = &aviw.chunks[ aviw.head ];
+  Com_Memcpy( slot->header, chunk->header, sizeof( slot->header ) );
+  Com_Memcpy( slot->index, chunk->index, sizeof( slot->index ) );
+  slot->hasIndex = chunk->hasIndex;
+  slot->size = chunk->size;
+  Com_Memcpy( slot->data, data, chunk->size );
+  slot->queueTime = Sys_Microseconds();
+  aviw.head = ( aviw.head + 1 ) % aviw.numChunks;
+
+  Sys_MutexLock( aviw.mutex );
+  aviw.queued++;
+  if ( aviw.queued > aviw.maxQueued )
+    aviw.maxQueued = aviw.queued;
+  Sys_MutexUnlock( aviw.mutex );
+
+  Sys_SemaphorePost( aviw.usedSlots );
+
+  return qtrue;
+}
+
+
 /*
 ===============
 WRITE_STRING
@@ -450,6 +756,8 @@ qboolean CL_OpenAVIForWriting( const char *fileName, qboolean pipe )
   }
   afd.fileOpen = qtrue;
 
+  CL_StartAVIWriter( MAX( PAD( afd.width * 3, AVI_LINE_PADDING ) * afd.height, PCM_BUFFER_SIZE ) );
+
   return qtrue;
 }
 
@@ -502,7 +810,7 @@ void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
   unsigned int chunkOffset = afd.fileSize - afd.moviOffset - 8;
   int   chunkSize = 8 + size;
   int   paddingSize = PADLEN(size, 2);
-  byte  padding[ 4 ] = { 0 };
+  aviChunk_t chunk;
 
   if( !afd.fileOpen )
     return;
@@ -514,11 +822,26 @@ void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
   bufIndex = 0;
   WRITE_STRING( "00dc" );
   WRITE_4BYTES( size );
-  afd.numVideoFrames++;
+  Com_Memcpy( chunk.header, buffer, 8 );
+  chunk.size = size;
+  chunk.hasIndex = !afd.pipe;
 
-  SafeFS_Write( buffer, 8, afd.f );
-  SafeFS_Write( imageBuffer, size, afd.f );
-  SafeFS_Write( padding, paddingSize, afd.f );
+  if ( chunk.hasIndex )
+  {
+    // Index
+    bufIndex = 0;
+    WRITE_STRING( "00dc" );           //dwIdentifier
+    WRITE_4BYTES( 0x00000010 );       //dwFlags (all frames are KeyFrames)
+    WRITE_4BYTES( chunkOffset );      //dwOffset
+    WRITE_4BYTES( size );             //dwLength
+    Com_Memcpy( chunk.index, buffer, 16 );
+  }
+
+  // video frames may be dropped if the writer can't keep up
+  if ( !CL_WriteAVIChunk( &chunk, imageBuffer, qtrue ) )
+    return;
+
+  afd.numVideoFrames++;
 
   if ( afd.pipe )
     return;
@@ -529,23 +852,10 @@ void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
   if ( size > afd.maxRecordSize )
     afd.maxRecordSize = size;
 
-  // Index
-  bufIndex = 0;
-  WRITE_STRING( "00dc" );           //dwIdentifier
-  WRITE_4BYTES( 0x00000010 );       //dwFlags (all frames are KeyFrames)
-  WRITE_4BYTES( chunkOffset );      //dwOffset
-  WRITE_4BYTES( size );             //dwLength
-  SafeFS_Write( buffer, 16, afd.idxF );
-
   afd.numIndices++;
 }
 
 
-#define PCM_BUFFER_SIZE 44100
-
-static byte pcmCaptureBuffer[ PCM_BUFFER_SIZE ];
-static int  bytesInBuffer = 0;
-
 /*
 ===============
 CL_FlushAudioBuffer
@@ -556,7 +866,7 @@ static void CL_FlushCaptureBuffer( void )
     unsigned int chunkOffset = afd.fileSize - afd.moviOffset - 8;
     int   chunkSize = 8 + bytesInBuffer;
     int   paddingSize = PADLEN( bytesInBuffer, 2 );
-    byte  padding[ 4 ] = { 0 };
+    aviChunk_t chunk;
 
     if ( !bytesInBuffer )
         return;
@@ -564,12 +874,11 @@ static void CL_FlushCaptureBuffer( void )
     bufIndex = 0;
     WRITE_STRING( "01wb" );
     WRITE_4BYTES( bytesInBuffer );
+    Com_Memcpy( chunk.header, buffer, 8 );
+    chunk.size = bytesInBuffer;
+    chunk.hasIndex = !afd.pipe;
     afd.numAudioFrames++;
 
-    SafeFS_Write( buffer, 8, afd.f );
-    SafeFS_Write( pcmCaptureBuffer, bytesInBuffer, afd.f );
-    SafeFS_Write( padding, paddingSize, afd.f );
-
     if ( !afd.pipe )
     {
         afd.fileSize += ( chunkSize + paddingSize );
@@ -581,10 +890,13 @@ static void CL_FlushCaptureBuffer( void )
         WRITE_4BYTES( 0 );                //dwFlags
         WRITE_4BYTES( chunkOffset );      //dwOffset
         WRITE_4BYTES( bytesInBuffer );    //dwLength
-        SafeFS_Write( buffer, 16, afd.idxF );
+        Com_Memcpy( chunk.index, buffer, 16 );
         afd.numIndices++;
     }
 
+    // audio is never dropped
+    CL_WriteAVIChunk( &chunk, pcmCaptureBuffer, qfalse );
+
     bytesInBuffer = 0;
 }
 
@@ -661,8 +973,16 @@ qboolean CL_CloseAVI( void )
 		return qfalse;
 	}
 
+	// renderer may still be reading back last frames
+	if ( re.SyncRender ) {
+		re.SyncRender();
+	}
+
 	CL_FlushCaptureBuffer();
 
+	// everything queued must be on disk before the index is appended
+	CL_StopAVIWriter();
+
 	Z_Free( afd.cBuffer );
 	Z_Free( afd.eBuffer );
 
@@ -105,8 +105,8 @@ CL_GetParsedEntityIndexByID
 static int CL_GetParsedEntityIndexByID( const clSnapshot_t *clSnap, int entityID, int startIndex, int *parsedIndex ) {
     int index, n;
     for ( index = startIndex; index < clSnap->numEntities; ++index ) {
-        n = ( clSnap->parseEntitiesNum + index ) & (MAX_PARSE_ENTITIES-1);
-        if ( cl.parseEntities[ n ].number == entityID ) {
+        n = clSnap->parseEntitiesNum + index;
+        if ( CL_PARSE_ENTITY( n )->number == entityID ) {
             *parsedIndex = n;
             return index;
         }
@@ -115,6 +115,73 @@ static int CL_GetParsedEntityIndexByID( const clSnapshot_t *clSnap, int entityID
 }
 #endif // USE_MV
 
+/*
+====================
+CL_GetCgameSnapshot
+
+Returns the record of entity states last written to the given cgame snapshot buffer
+====================
+*/
+static cgameSnapshot_t *CL_GetCgameSnapshot( const snapshot_t *snapshot ) {
+	cgameSnapshot_t *cs, *oldest;
+	int i;
+
+	oldest = &cl.cgameSnapshots[0];
+	for ( i = 0, cs = cl.cgameSnapshots; i < MAX_CGAME_SNAPSHOTS; i++, cs++ ) {
+		if ( cs->snapshot == snapshot ) {
+			cs->lastUsed = ++cl.cgameSnapshotCount;
+			return cs;
+		}
+		if ( cs->lastUsed < oldest->lastUsed ) {
+			oldest = cs;
+		}
+	}
+
+	oldest->snapshot = snapshot;
+	oldest->numStates = 0;
+	oldest->lastUsed = ++cl.cgameSnapshotCount;
+
+	return oldest;
+}
+
+
+/*
+====================
+CL_CopySnapshotEntity
+
+Copies a parsed entity to the cgame snapshot unless that slot
+already holds the same entity state, returns qtrue if it was copied
+====================
+*/
+static qboolean CL_CopySnapshotEntity( cgameSnapshot_t *cs, snapshot_t *snapshot, int index, int parseEntity ) {
+	int state;
+
+	state = cl.parseEntities[ parseEntity & (MAX_PARSE_ENTITIES-1) ];
+
+	if ( index < cs->numStates && cs->states[ index ] == state ) {
+		return qfalse;
+	}
+
+	cs->states[ index ] = state;
+	snapshot->entities[ index ] = cl.parseStates[ state & (MAX_PARSE_STATES-1) ];
+
+	return qtrue;
+}
+
+
+/*
+====================
+CL_ShowSnapshotCopy
+====================
+*/
+static void CL_ShowSnapshotCopy( const clSnapshot_t *clSnap, int count, int copied ) {
+	Com_Printf( "snapshot %i: parsed %i/%i entities (%i bytes), cgame %i/%i entities (%i bytes)\n",
+		clSnap->messageNum, clSnap->numParsedStates, clSnap->numEntities,
+		clSnap->numParsedStates * (int)sizeof( entityState_t ),
+		copied, count, copied * (int)sizeof( entityState_t ) );
+}
+
+
 /*
 ====================
 CL_GetSnapshot
@@ -122,7 +189,8 @@ CL_GetSnapshot
 */
 static qboolean CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot ) {
 	clSnapshot_t	*clSnap;
-	int				i, count;
+	cgameSnapshot_t	*cs;
+	int				i, count, copied;
 
 	if ( cl.snap.messageNum - snapshotNumber < 0 ) {
 		Com_Error( ERR_DROP, "CL_GetSnapshot: snapshotNumber (%i) > cl.snapshot.messageNum (%i)", snapshotNumber, cl.snap.messageNum );
@@ -145,6 +213,13 @@ static qboolean CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot ) {
 		return qfalse;
 	}
 
+	// entities already in the cgame buffer are not copied again
+	cs = CL_GetCgameSnapshot( snapshot );
+	if ( !cl_snapshotReuse->integer ) {
+		cs->numStates = 0;
+	}
+	copied = 0;
+
 	// write the snapshot
 	snapshot->snapFlags = clSnap->snapFlags;
 	snapshot->serverCommandSequence = clSnap->serverCommandNum;
@@ -200,7 +275,8 @@ static qboolean CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot ) {
                             Com_Error( ERR_DROP, "snapshot entities count overflow for %i", clc.clientView );
                             break;
                         }
-                        snapshot->entities[ count++ ] = cl.parseEntities[ parsedIndex ];
+                        copied += CL_CopySnapshotEntity( cs, snapshot, count, parsedIndex );
+                        count++;
                     } else {
                         Com_Error( ERR_DROP, "packet entity not found in snapshot: %i", entityNum );
                         break;
@@ -210,6 +286,11 @@ static qboolean CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot ) {
         }
 
         snapshot->numEntities = count;
+        cs->numStates = count;
+
+        if ( cl_showSnapshotCopy->integer ) {
+            CL_ShowSnapshotCopy( clSnap, count, copied );
+        }
         return qtrue;
     }
 #endif // USE_MV
@@ -223,8 +304,12 @@ static qboolean CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot ) {
 	}
 	snapshot->numEntities = count;
 	for ( i = 0 ; i < count ; i++ ) {
-		snapshot->entities[i] =
-			cl.parseEntities[ ( clSnap->parseEntitiesNum + i ) & (MAX_PARSE_ENTITIES-1) ];
+		copied += CL_CopySnapshotEntity( cs, snapshot, i, clSnap->parseEntitiesNum + i );
+	}
+	cs->numStates = count;
+
+	if ( cl_showSnapshotCopy->integer ) {
+		CL_ShowSnapshotCopy( clSnap, count, copied );
 	}
 
 	// FIXME: configstring changes and server commands!!!
@@ -928,6 +1013,9 @@ void CL_InitCGame( void ) {
 	// put away the console
 	Con_Close();
 
+	// new cgame buffers hold nothing yet
+	Com_Memset( cl.cgameSnapshots, 0, sizeof( cl.cgameSnapshots ) );
+
 	// find the current mapname
 	info = cl.gameState.stringData + cl.gameState.stringOffsets[ CS_SERVERINFO ];
 	mapname = Info_ValueForKey( info, "mapname" );
@@ -1007,7 +1095,15 @@ CL_CGameRendering
 =====================
 */
 void CL_CGameRendering( stereoFrame_t stereo ) {
-	VM_Call( cgvm, 3, CG_DRAW_ACTIVE_FRAME, cl.serverTime, stereo, clc.demoplaying );
+	int64_t start;
+
+	if ( com_timedemo->integer && clc.demoplaying ) {
+		start = Sys_Microseconds();
+		VM_Call( cgvm, 3, CG_DRAW_ACTIVE_FRAME, cl.serverTime, stereo, clc.demoplaying );
+		clc.timeDemoCGameUsec += (int)( Sys_Microseconds() - start );
+	} else {
+		VM_Call( cgvm, 3, CG_DRAW_ACTIVE_FRAME, cl.serverTime, stereo, clc.demoplaying );
+	}
 #ifdef DEBUG
 	VM_Debug( 0 );
 #endif
@@ -1279,6 +1375,7 @@ void CL_SetCGameTime( void ) {
 			clc.timeDemoStart = Sys_Milliseconds();
 		}
 		clc.timeDemoFrames++;
+		CL_TimeDemoFrame();
 		cl.serverTime = clc.timeDemoBaseTime + clc.timeDemoFrames * 50;
 	}
 
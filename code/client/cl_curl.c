@@ -612,69 +612,276 @@ qboolean Com_DL_Init( download_t *dl )
 }
 
 
+#define DL_MAX_RETRIES	3
+
+// dlChecksum_t states
+enum {
+	DL_CRC_PARSE,
+	DL_CRC_DONE,
+	DL_CRC_INVALID
+};
+
+#define DL_ZIP_SHORT( p ) ( (unsigned int)(p)[0] | ( (unsigned int)(p)[1] << 8 ) )
+#define DL_ZIP_LONG( p ) ( DL_ZIP_SHORT( p ) | ( DL_ZIP_SHORT( (p) + 2 ) << 16 ) )
+
+
 /*
 =================
-Com_DL_Cleanup
+Com_DL_ChecksumInit
 =================
 */
-qboolean Com_DL_InProgress( const download_t *dl )
+static void Com_DL_ChecksumInit( dlChecksum_t *c )
 {
-	if ( dl->cURL && dl->URL[0] )
-		return qtrue;
-	else
-		return qfalse;
+	if ( c->crcs )
+		Z_Free( c->crcs );
+
+	Com_Memset( c, 0, sizeof( *c ) );
+
+	c->maxCRCs = 256;
+	c->crcs = Z_Malloc( c->maxCRCs * sizeof( c->crcs[0] ) );
 }
 
 
 /*
 =================
-Com_DL_Cleanup
+Com_DL_ChecksumFree
 =================
 */
-void Com_DL_Cleanup( download_t *dl )
+static void Com_DL_ChecksumFree( dlChecksum_t *c )
+{
+	if ( c->crcs )
+		Z_Free( c->crcs );
+
+	Com_Memset( c, 0, sizeof( *c ) );
+}
+
+
+/*
+=================
+Com_DL_ChecksumRecord
+
+Handles the fixed part of a zip record
+=================
+*/
+static void Com_DL_ChecksumRecord( dlChecksum_t *c )
 {
-	if( dl->cURLM )
+	const byte *h = c->header;
+	unsigned int method, size;
+	int *crcs;
+
+	switch ( c->headerSize )
 	{
-		if ( dl->cURL )
+	case 30: // local file header, skip name, extra field and file data
+		size = DL_ZIP_LONG( h + 18 );
+		if ( ( DL_ZIP_SHORT( h + 6 ) & 8 ) || size == 0xFFFFFFFF )
 		{
-			dl->func.multi_remove_handle( dl->cURLM, dl->cURL );
-			dl->func.easy_cleanup( dl->cURL );
+			// sizes are stored in a data descriptor or zip64 extra field
+			c->state = DL_CRC_INVALID;
+			return;
 		}
-		dl->func.multi_cleanup( dl->cURLM );
-		dl->cURLM = NULL;
-		dl->cURL = NULL;
+		c->skip = DL_ZIP_SHORT( h + 26 ) + DL_ZIP_SHORT( h + 28 ) + size;
+		break;
+
+	case 46: // central directory entry, same rules as FS_LoadZipFile()
+		method = DL_ZIP_SHORT( h + 10 );
+		if ( ( method == 0 || method == 8 /*Z_DEFLATED*/ ) && DL_ZIP_LONG( h + 24 ) > 0 )
+		{
+			if ( c->numCRCs == c->maxCRCs )
+			{
+				c->maxCRCs *= 2;
+				crcs = Z_Malloc( c->maxCRCs * sizeof( crcs[0] ) );
+				Com_Memcpy( crcs, c->crcs, c->numCRCs * sizeof( crcs[0] ) );
+				Z_Free( c->crcs );
+				c->crcs = crcs;
+			}
+			c->crcs[ c->numCRCs++ ] = LittleLong( (int)DL_ZIP_LONG( h + 16 ) );
+		}
+		c->skip = DL_ZIP_SHORT( h + 28 ) + DL_ZIP_SHORT( h + 30 ) + DL_ZIP_SHORT( h + 32 );
+		c->numEntries++;
+		break;
+
+	default: // end of central directory, the zip comment is ignored
+		if ( DL_ZIP_SHORT( h + 10 ) != c->numEntries )
+		{
+			c->state = DL_CRC_INVALID;
+			return;
+		}
+		c->checksum = Com_BlockChecksum( c->crcs, c->numCRCs * sizeof( c->crcs[0] ) );
+		c->checksum = LittleLong( c->checksum );
+		c->state = DL_CRC_DONE;
+		break;
 	}
-	else if( dl->cURL )
+}
+
+
+/*
+=================
+Com_DL_ChecksumUpdate
+
+Walks zip records as they are received: local headers and file data are
+skipped, CRCs are collected from the central directory. Archives with
+anything else in the stream are left to FS_GetZipChecksum()
+=================
+*/
+static void Com_DL_ChecksumUpdate( dlChecksum_t *c, const byte *data, int len )
+{
+	const byte *h = c->header;
+	int n;
+
+	while ( len > 0 && c->state == DL_CRC_PARSE )
 	{
-		dl->func.easy_cleanup( dl->cURL );
-		dl->cURL = NULL;
+		if ( c->skip )
+		{
+			n = ( c->skip < (unsigned int)len ) ? (int)c->skip : len;
+			c->skip -= n;
+			data += n;
+			len -= n;
+			continue;
+		}
+
+		n = ( c->headerSize ? c->headerSize : 4 ) - c->headerLen;
+		if ( n > len )
+			n = len;
+
+		Com_Memcpy( c->header + c->headerLen, data, n );
+		c->headerLen += n;
+		data += n;
+		len -= n;
+
+		if ( c->headerSize == 0 )
+		{
+			if ( c->headerLen < 4 )
+				continue;
+			if ( memcmp( h, "\x50\x4b\x03\x04", 4 ) == 0 && c->numEntries == 0 )
+				c->headerSize = 30;
+			else if ( memcmp( h, "\x50\x4b\x01\x02", 4 ) == 0 )
+				c->headerSize = 46;
+			else if ( memcmp( h, "\x50\x4b\x05\x06", 4 ) == 0 )
+				c->headerSize = 22;
+			else
+				c->state = DL_CRC_INVALID;
+			continue;
+		}
+
+		if ( c->headerLen < c->headerSize )
+			continue;
+
+		Com_DL_ChecksumRecord( c );
+
+		c->headerLen = 0;
+		c->headerSize = 0;
 	}
-	if ( dl->fHandle != FS_INVALID_HANDLE )
+}
+
+
+/*
+=================
+Com_DL_RemoveFile
+=================
+*/
+static void Com_DL_RemoveFile( const char *name )
+{
+	FS_Remove( FS_BuildOSPath( Cvar_VariableString( "fs_homepath" ), name, NULL ) );
+}
+
+
+/*
+=================
+Com_DL_InProgress
+=================
+*/
+qboolean Com_DL_InProgress( const download_t *dl )
+{
+	int i;
+
+	for ( i = 0; i < DL_MAX_FILES; i++ )
 	{
-		FS_FCloseFile( dl->fHandle );
-		dl->fHandle = FS_INVALID_HANDLE;
+		if ( dl->files[i].cURL && dl->files[i].URL[0] )
+			return qtrue;
 	}
 
-	if ( dl->mapAutoDownload )
+	return qfalse;
+}
+
+
+/*
+=================
+Com_DL_ResetCvars
+=================
+*/
+static void Com_DL_ResetCvars( void )
+{
+	Cvar_Set( "cl_downloadName", "" );
+	Cvar_Set( "cl_downloadSize", "0" );
+	Cvar_Set( "cl_downloadCount", "0" );
+	Cvar_Set( "cl_downloadTime", "0" );
+}
+
+
+/*
+=================
+Com_DL_FreeFile
+
+Partial files are kept so the download can be resumed later
+=================
+*/
+static void Com_DL_FreeFile( download_t *dl, dlTransfer_t *f, qboolean keepPartial )
+{
+	if ( f->cURL )
 	{
-		Cvar_Set( "cl_downloadName", "" );
-		Cvar_Set( "cl_downloadSize", "0" );
-		Cvar_Set( "cl_downloadCount", "0" );
-		Cvar_Set( "cl_downloadTime", "0" );
+		if ( f->running )
+			dl->func.multi_remove_handle( dl->cURLM, f->cURL );
+		dl->func.easy_cleanup( f->cURL );
+	}
+
+	if ( f->fHandle != FS_INVALID_HANDLE )
+	{
+		FS_FCloseFile( f->fHandle );
+	}
+
+	if ( !keepPartial && f->TempName[0] )
+	{
+		Com_DL_RemoveFile( f->TempName );
+	}
+
+	Com_DL_ChecksumFree( &f->crc );
+
+	Com_Memset( f, 0, sizeof( *f ) );
+	f->fHandle = FS_INVALID_HANDLE;
+}
+
+
+/*
+=================
+Com_DL_Cleanup
+=================
+*/
+void Com_DL_Cleanup( download_t *dl )
+{
+	dlTransfer_t *f;
+	int i;
+
+	for ( i = 0; i < DL_MAX_FILES; i++ )
+	{
+		f = &dl->files[i];
+		if ( f->cURL )
+		{
+			Com_DL_FreeFile( dl, f, f->offset > 0 && f->crc.state != DL_CRC_INVALID );
+		}
 	}
 
-	dl->Size = 0;
-	dl->Count = 0;
+	if ( dl->cURLM )
+	{
+		dl->func.multi_cleanup( dl->cURLM );
+		dl->cURLM = NULL;
+	}
 
-	dl->URL[0] = '\0';
-	dl->Name[0] = '\0';
-	if ( dl->TempName[0] )
+	if ( dl->mapAutoDownload )
 	{
-		FS_Remove( dl->TempName );
+		Com_DL_ResetCvars();
 	}
-	dl->TempName[0] = '\0';
-	dl->progress[0] = '\0';
-	dl->headerCheck = qfalse;
+
+	dl->numDone = 0;
 	dl->mapAutoDownload = qfalse;
 
 	Com_DL_Done( dl );
@@ -703,31 +910,32 @@ Com_DL_CallbackProgress
 static int Com_DL_CallbackProgress( void *data, double dltotal, double dlnow, double ultotal, double ulnow )
 {
 	double percentage, speed;
-	download_t *dl = (download_t *)data;
+	dlTransfer_t *f = (dlTransfer_t *)data;
 
-	dl->Size = (int)dltotal;
-	dl->Count = (int)dlnow;
+	// resumed transfers only report the requested range
+	f->Size = dltotal > 0.0 ? (int)dltotal + f->resumeFrom : 0;
+	f->Count = (int)dlnow + f->resumeFrom;
 
-	if ( dl->mapAutoDownload && cls.state == CA_CONNECTED )
+	if ( f->autoDownload && cls.state == CA_CONNECTED )
 	{
 		if ( Key_IsDown( K_ESCAPE ) )
 		{
-			Com_Printf( "%s: aborted\n", dl->Name );
+			Com_Printf( "%s: aborted\n", f->Name );
 			return -1;
 		}
-		Cvar_Set( "cl_downloadSize", va( "%i", dl->Size ) );
-		Cvar_Set( "cl_downloadCount", va( "%i", dl->Count ) );
+		Cvar_Set( "cl_downloadSize", va( "%i", f->Size ) );
+		Cvar_Set( "cl_downloadCount", va( "%i", f->Count ) );
 	}
 
-	if ( dl->Size ) {
-		percentage = ( dlnow / dltotal ) * 100.0;
-		sprintf( dl->progress, " downloading %s: %s (%i%%)", dl->Name, sizeToString( dl->Count ), (int)percentage );
+	if ( f->Size ) {
+		percentage = ( (double)f->Count / f->Size ) * 100.0;
+		sprintf( f->progress, " downloading %s: %s (%i%%)", f->Name, sizeToString( f->Count ), (int)percentage );
 	} else {
-		sprintf( dl->progress, " downloading %s: %s", dl->Name, sizeToString( dl->Count ) );
+		sprintf( f->progress, " downloading %s: %s", f->Name, sizeToString( f->Count ) );
 	}
 
-	if ( dl->func.easy_getinfo( dl->cURL, CURLINFO_SPEED_DOWNLOAD, &speed ) == CURLE_OK ) {
-		Q_strcat( dl->progress, sizeof( dl->progress ), va( " %s/s", sizeToString( (int)speed ) ) );
+	if ( f->dl->func.easy_getinfo( f->cURL, CURLINFO_SPEED_DOWNLOAD, &speed ) == CURLE_OK ) {
+		Q_strcat( f->progress, sizeof( f->progress ), va( " %s/s", sizeToString( (int)speed ) ) );
 	}
 
 	return 0;
@@ -741,27 +949,49 @@ Com_DL_CallbackWrite
 */
 static size_t Com_DL_CallbackWrite( void *ptr, size_t size, size_t nmemb, void *userdata )
 {
-	download_t *dl;
+	dlTransfer_t *f;
+	int len;
 
-	dl = (download_t *)userdata;
+	f = (dlTransfer_t *)userdata;
+	len = (int)( size * nmemb );
 
-	if ( dl->fHandle == FS_INVALID_HANDLE )
+	if ( f->fHandle == FS_INVALID_HANDLE )
 	{
-		if ( !CL_ValidPakSignature( ptr, size*nmemb ) ) 
+		if ( f->resumeFrom )
 		{
-			Com_Printf( S_COLOR_YELLOW "Com_DL_CallbackWrite(): invalid pak signature for %s.\n",
-				dl->Name );
-			return (size_t)-1;
+			// replies ignoring the range fail with CURLE_RANGE_ERROR before
+			// any data arrives, Com_DL_FileDone() restarts those
+			f->fHandle = FS_SV_FOpenFileAppend( f->TempName );
+			if ( f->fHandle == FS_INVALID_HANDLE )
+			{
+				return (size_t)-1;
+			}
+			f->resumed = qtrue;
 		}
-
-		dl->fHandle = FS_SV_FOpenFileWrite( dl->TempName );
-		if ( dl->fHandle == FS_INVALID_HANDLE ) 
+		else
 		{
-			return (size_t)-1;
+			if ( !CL_ValidPakSignature( ptr, len ) )
+			{
+				Com_Printf( S_COLOR_YELLOW "Com_DL_CallbackWrite(): invalid pak signature for %s.\n",
+					f->Name );
+				return (size_t)-1;
+			}
+
+			f->fHandle = FS_SV_FOpenFileWrite( f->TempName );
+			if ( f->fHandle == FS_INVALID_HANDLE )
+			{
+				return (size_t)-1;
+			}
 		}
 	}
 
-	FS_Write( ptr, size*nmemb, dl->fHandle );
+	if ( FS_Write( ptr, len, f->fHandle ) != len )
+	{
+		return (size_t)-1;
+	}
+
+	Com_DL_ChecksumUpdate( &f->crc, (const byte *)ptr, len );
+	f->offset += len;
 
 	return (size * nmemb);
 }
@@ -795,7 +1025,7 @@ static size_t Com_DL_HeaderCallback( void *ptr, size_t size, size_t nmemb, void
 {
 	char name[MAX_OSPATH];
 	char header[1024], *s, quote, *d;
-	download_t *dl;
+	dlTransfer_t *f;
 	int len;
 
 	if ( size*nmemb >= sizeof( header ) )
@@ -804,22 +1034,22 @@ static size_t Com_DL_HeaderCallback( void *ptr, size_t size, size_t nmemb, void
 		return (size_t)-1;
 	}
 
-	dl = (download_t *)userdata;
-	
+	f = (dlTransfer_t *)userdata;
+
 	memcpy( header, ptr, size*nmemb+1 );
 	header[ size*nmemb ] = '\0';
 
 	//Com_Printf( "h: %s\n--------------------------\n", header );
 
 	s = (char*)stristr( header, "content-disposition:" );
-	if ( s ) 
+	if ( s )
 	{
 		s += 20; // strlen( "content-disposition:" )
 		s = (char*)stristr( s, "filename=" );
-		if ( s ) 
+		if ( s )
 		{
 			s += 9; // strlen( "filename=" )
-			
+
 			d = name;
 			replace1( '\r', '\0', s );
 			replace1( '\n', '\0', s );
@@ -834,7 +1064,7 @@ static size_t Com_DL_HeaderCallback( void *ptr, size_t size, size_t nmemb, void
 				quote = '\0';
 
 			// copy filename
-			while ( *s != '\0' && *s != quote ) 
+			while ( *s != '\0' && *s != quote )
 				*d++ = *s++;
 			len = d - name;
 			*d++ = '\0';
@@ -850,7 +1080,7 @@ static size_t Com_DL_HeaderCallback( void *ptr, size_t size, size_t nmemb, void
 			FS_StripExt( name, ".pk3" );
 
 			// store in
-			strcpy( dl->Name, name );
+			strcpy( f->Name, name );
 		}
 	}
 
@@ -862,150 +1092,420 @@ static size_t Com_DL_HeaderCallback( void *ptr, size_t size, size_t nmemb, void
 ===============================================================
 Com_DL_Begin()
 
-Start downloading file from remoteURL and save it under fs_game/localName
+Queue downloading file from remoteURL and save it under fs_game/localName,
+up to cl_dlParallel files are fetched at the same time
 ==============================================================
 */
 qboolean Com_DL_Begin( download_t *dl, const char *localName, const char *remoteURL, qboolean autoDownload )
 {
+	char name[MAX_OSPATH];
+	byte buf[16384];
+	dlTransfer_t *f;
+	fileHandle_t h;
 	char *s;
+	int i, len, n;
 
-	if ( Com_DL_InProgress( dl ) )
+	// try to extract game path from localName
+	// f->Name should contain only pak name without game dir and extension
+	s = strrchr( localName, '/' );
+	if ( s )
+		Q_strncpyz( name, s+1, sizeof( name ) );
+	else
+		Q_strncpyz( name, localName, sizeof( name ) );
+
+	FS_StripExt( name, ".pk3" );
+	if ( !name[0] )
 	{
-		Com_Printf( S_COLOR_YELLOW " already downloading %s\n", dl->Name );
+		Com_Printf( S_COLOR_YELLOW " empty filename after extension strip.\n" );
 		return qfalse;
 	}
 
-	Com_DL_Cleanup( dl );
+	f = NULL;
+	for ( i = 0; i < DL_MAX_FILES; i++ )
+	{
+		if ( !dl->files[i].cURL )
+		{
+			if ( !f )
+				f = &dl->files[i];
+		}
+		else if ( !Q_stricmp( dl->files[i].Name, name ) )
+		{
+			Com_Printf( S_COLOR_YELLOW " already downloading %s\n", name );
+			return qfalse;
+		}
+	}
 
-	if ( !Com_DL_Init( dl ) ) 
+	if ( !f )
 	{
-		Com_Printf( S_COLOR_YELLOW "Error initializing cURL library\n" );
+		Com_Printf( S_COLOR_YELLOW " too many downloads queued, %s skipped\n", name );
 		return qfalse;
 	}
 
-	dl->cURL = dl->func.easy_init();
-	if ( !dl->cURL ) 
+	if ( !dl->cURLM )
 	{
-		Com_Printf( S_COLOR_RED "Com_DL_Begin: easy_init() failed\n" );
 		Com_DL_Cleanup( dl );
+
+		if ( !Com_DL_Init( dl ) )
+		{
+			Com_Printf( S_COLOR_YELLOW "Error initializing cURL library\n" );
+			return qfalse;
+		}
+
+		dl->cURLM = dl->func.multi_init();
+		if ( !dl->cURLM )
+		{
+			Com_DL_Cleanup( dl );
+			Com_Printf( S_COLOR_RED "Com_DL_Begin: multi_init() failed\n" );
+			return qfalse;
+		}
+
+		if ( cl_dlDirectory->integer ) {
+			Q_strncpyz( dl->gameDir, FS_GetBaseGameDir(), sizeof( dl->gameDir ) );
+		} else {
+			Q_strncpyz( dl->gameDir, FS_GetCurrentGameDir(), sizeof( dl->gameDir ) );
+		}
+
+		Com_sprintf(dl->gameDir, MAX_STRING_CHARS, "%s/download", COM_SkipPath(CopyString(dl->gameDir)));
+	}
+
+	f->dl = dl;
+	f->fHandle = FS_INVALID_HANDLE;
+	Q_strncpyz( f->Name, name, sizeof( f->Name ) );
+
+	f->cURL = dl->func.easy_init();
+	if ( !f->cURL )
+	{
+		Com_Printf( S_COLOR_RED "Com_DL_Begin: easy_init() failed\n" );
+		Com_DL_FreeFile( dl, f, qfalse );
 		return qfalse;
 	}
 
 	{
-		char *escapedName = dl->func.easy_escape( dl->cURL, localName, 0 );
+		char *escapedName = dl->func.easy_escape( f->cURL, localName, 0 );
 		if ( !escapedName )
 		{
 			Com_Printf( S_COLOR_RED "Com_DL_Begin: easy_escape() failed\n" );
-			Com_DL_Cleanup( dl );
+			Com_DL_FreeFile( dl, f, qfalse );
 			return qfalse;
 		}
 
-		Q_strncpyz( dl->URL, remoteURL, sizeof( dl->URL ) );
+		Q_strncpyz( f->URL, remoteURL, sizeof( f->URL ) );
 
-		if ( !Q_replace( "%1", escapedName, dl->URL, sizeof( dl->URL ) ) )
+		if ( !Q_replace( "%1", escapedName, f->URL, sizeof( f->URL ) ) )
 		{
-			if ( dl->URL[strlen(dl->URL)] != '/' )
-				Q_strcat( dl->URL, sizeof( dl->URL ), "/" );
-			Q_strcat( dl->URL, sizeof( dl->URL ), escapedName );
-			dl->headerCheck = qfalse;
+			if ( f->URL[strlen(f->URL)] != '/' )
+				Q_strcat( f->URL, sizeof( f->URL ), "/" );
+			Q_strcat( f->URL, sizeof( f->URL ), escapedName );
+			f->headerCheck = qfalse;
 		}
 		else
 		{
-			dl->headerCheck = qtrue;
+			f->headerCheck = qtrue;
 		}
 		dl->func.free( escapedName );
 	}
 
-	Com_Printf( "URL: %s\n", dl->URL );
+	Com_Printf( "URL: %s\n", f->URL );
 
-	if ( cl_dlDirectory->integer ) {
-		Q_strncpyz( dl->gameDir, FS_GetBaseGameDir(), sizeof( dl->gameDir ) );
-	} else {
-		Q_strncpyz( dl->gameDir, FS_GetCurrentGameDir(), sizeof( dl->gameDir ) );
-	}
+	// fixed name so an interrupted download can be resumed
+	Com_sprintf( f->TempName, sizeof( f->TempName ),
+		"%s%c%s.tmp", dl->gameDir, PATH_SEP, f->Name );
 
-	Com_sprintf(dl->gameDir, MAX_STRING_CHARS, "%s/download", COM_SkipPath(CopyString(dl->gameDir)));
+	Com_DL_ChecksumInit( &f->crc );
 
-	// try to extract game path from localName
-	// dl->Name should contain only pak name without game dir and extension
-	s = strrchr( localName, '/' );
-	if ( s ) 
-		Q_strncpyz( dl->Name, s+1, sizeof( dl->Name ) );
-	else
-		Q_strncpyz( dl->Name, localName, sizeof( dl->Name ) );
+	// pick up what is already there
+	len = FS_SV_FOpenFileRead( f->TempName, &h );
+	if ( h != FS_INVALID_HANDLE )
+	{
+		for ( i = 0; i < len && f->crc.state != DL_CRC_INVALID; i += n )
+		{
+			n = MIN( len - i, (int)sizeof( buf ) );
+			if ( FS_Read( buf, n, h ) != n || ( i == 0 && !CL_ValidPakSignature( buf, n ) ) )
+				break;
+			Com_DL_ChecksumUpdate( &f->crc, buf, n );
+		}
+		FS_FCloseFile( h );
 
-	FS_StripExt( dl->Name, ".pk3" );
-	if ( !dl->Name[0] )
+		if ( i == len && len > 0 && f->crc.state != DL_CRC_INVALID )
+		{
+			Com_Printf( "resuming %s at %s\n", f->Name, sizeToString( len ) );
+			f->offset = len;
+		}
+		else
+		{
+			Com_DL_ChecksumInit( &f->crc );
+		}
+	}
+
+	if ( com_developer->integer )
+		dl->func.easy_setopt( f->cURL, CURLOPT_VERBOSE, 1 );
+
+	dl->func.easy_setopt( f->cURL, CURLOPT_URL, f->URL );
+	dl->func.easy_setopt( f->cURL, CURLOPT_TRANSFERTEXT, 0 );
+	//dl->func.easy_setopt( f->cURL, CURLOPT_REFERER, "q3a://127.0.0.1" );
+	dl->func.easy_setopt( f->cURL, CURLOPT_REFERER, f->URL );
+	dl->func.easy_setopt( f->cURL, CURLOPT_USERAGENT, Q3_VERSION );
+	dl->func.easy_setopt( f->cURL, CURLOPT_WRITEFUNCTION, Com_DL_CallbackWrite );
+	dl->func.easy_setopt( f->cURL, CURLOPT_WRITEDATA, f );
+	if ( f->headerCheck )
 	{
-		Com_Printf( S_COLOR_YELLOW " empty filename after extension strip.\n" );
-		return qfalse;
+		dl->func.easy_setopt( f->cURL, CURLOPT_HEADERFUNCTION, Com_DL_HeaderCallback );
+		dl->func.easy_setopt( f->cURL, CURLOPT_HEADERDATA, f );
+	}
+	dl->func.easy_setopt( f->cURL, CURLOPT_NOPROGRESS, 0 );
+	dl->func.easy_setopt( f->cURL, CURLOPT_PROGRESSFUNCTION, Com_DL_CallbackProgress );
+	dl->func.easy_setopt( f->cURL, CURLOPT_PROGRESSDATA, f );
+	dl->func.easy_setopt( f->cURL, CURLOPT_FAILONERROR, 1 );
+	dl->func.easy_setopt( f->cURL, CURLOPT_FOLLOWLOCATION, 1 );
+	dl->func.easy_setopt( f->cURL, CURLOPT_MAXREDIRS, 5 );
+	dl->func.easy_setopt( f->cURL, CURLOPT_PROTOCOLS, ALLOWED_PROTOCOLS );
+	// stalled transfers are resumed on a new connection
+	dl->func.easy_setopt( f->cURL, CURLOPT_LOW_SPEED_LIMIT, 1L );
+	dl->func.easy_setopt( f->cURL, CURLOPT_LOW_SPEED_TIME, 30L );
+
+	f->autoDownload = autoDownload;
+
+	if ( autoDownload )
+	{
+		dl->mapAutoDownload = qtrue;
+		Cvar_Set( "cl_downloadName", f->Name );
+		Cvar_Set( "cl_downloadSize", "0" );
+		Cvar_Set( "cl_downloadCount", "0" );
+		Cvar_Set( "cl_downloadTime", va( "%i", cls.realtime ) );
 	}
 
-	Com_sprintf( dl->TempName, sizeof( dl->TempName ), 
-		"%s%c%s.%08x.tmp", dl->gameDir, PATH_SEP, dl->Name, rand() | (rand() << 16) );
+	return qtrue;
+}
 
-	if ( com_developer->integer )
-		dl->func.easy_setopt( dl->cURL, CURLOPT_VERBOSE, 1 );
-
-	dl->func.easy_setopt( dl->cURL, CURLOPT_URL, dl->URL );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_TRANSFERTEXT, 0 );
-	//dl->func.easy_setopt( dl->cURL, CURLOPT_REFERER, "q3a://127.0.0.1" );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_REFERER, dl->URL );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_USERAGENT, Q3_VERSION );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_WRITEFUNCTION, Com_DL_CallbackWrite );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_WRITEDATA, dl );
-	if ( dl->headerCheck )
+
+/*
+=================
+Com_DL_StartFiles
+
+Adds queued files to the multi handle, up to cl_dlParallel at once
+=================
+*/
+static void Com_DL_StartFiles( download_t *dl )
+{
+	dlTransfer_t *f;
+	int i, running;
+
+	running = 0;
+	for ( i = 0; i < DL_MAX_FILES; i++ )
 	{
-		dl->func.easy_setopt( dl->cURL, CURLOPT_HEADERFUNCTION, Com_DL_HeaderCallback );
-		dl->func.easy_setopt( dl->cURL, CURLOPT_HEADERDATA, dl );
+		if ( dl->files[i].running )
+			running++;
 	}
-	dl->func.easy_setopt( dl->cURL, CURLOPT_NOPROGRESS, 0 );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_PROGRESSFUNCTION, Com_DL_CallbackProgress );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_PROGRESSDATA, dl );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_FAILONERROR, 1 );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_FOLLOWLOCATION, 1 );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_MAXREDIRS, 5 );
-	dl->func.easy_setopt( dl->cURL, CURLOPT_PROTOCOLS, ALLOWED_PROTOCOLS );
 
-	dl->cURLM = dl->func.multi_init();
+	for ( i = 0; i < DL_MAX_FILES && running < cl_dlParallel->integer; i++ )
+	{
+		f = &dl->files[i];
+		if ( !f->cURL || f->running )
+			continue;
 
-	if ( !dl->cURLM )
+		f->resumeFrom = f->offset;
+		dl->func.easy_setopt( f->cURL, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)f->offset );
+
+		if ( dl->func.multi_add_handle( dl->cURLM, f->cURL ) != CURLM_OK )
+		{
+			Com_Printf( S_COLOR_RED "Com_DL_StartFiles: multi_add_handle() failed for %s\n", f->Name );
+			Com_DL_FreeFile( dl, f, qtrue );
+			continue;
+		}
+
+		f->running = qtrue;
+		running++;
+	}
+}
+
+
+/*
+=================
+Com_DL_Resumable
+=================
+*/
+static qboolean Com_DL_Resumable( CURLcode result )
+{
+	switch ( result )
 	{
-		Com_DL_Cleanup( dl );
-		Com_Printf( S_COLOR_RED "Com_DL_Begin: multi_init() failed\n" );
+	case CURLE_COULDNT_CONNECT:
+	case CURLE_PARTIAL_FILE:
+	case CURLE_OPERATION_TIMEDOUT:
+	case CURLE_GOT_NOTHING:
+	case CURLE_SEND_ERROR:
+	case CURLE_RECV_ERROR:
+		return qtrue;
+	default:
 		return qfalse;
 	}
+}
 
-	if ( dl->func.multi_add_handle( dl->cURLM, dl->cURL ) != CURLM_OK ) 
-	{
-		Com_DL_Cleanup( dl );
-		Com_Printf( S_COLOR_RED "Com_DL_Begin: multi_add_handle() failed\n" );
+
+/*
+=================
+Com_DL_Restart
+
+Drops the partial file, the transfer starts over on the next frame
+=================
+*/
+static qboolean Com_DL_Restart( dlTransfer_t *f )
+{
+	if ( f->retries >= DL_MAX_RETRIES )
 		return qfalse;
+
+	Com_DL_RemoveFile( f->TempName );
+	Com_DL_ChecksumInit( &f->crc );
+	f->offset = 0;
+	f->resumed = qfalse;
+	f->retries++;
+
+	return qtrue;
+}
+
+
+/*
+=================
+Com_DL_FinishFile
+
+Moves a completed download in place, returns qfalse if it is not a valid pk3
+=================
+*/
+static qboolean Com_DL_FinishFile( download_t *dl, dlTransfer_t *f )
+{
+	char name[ sizeof( f->TempName ) ];
+	int checksum;
+
+	if ( f->crc.state == DL_CRC_DONE )
+	{
+		checksum = f->crc.checksum;
+	}
+	else
+	{
+		// not walked by Com_DL_ChecksumUpdate(), read it back
+		checksum = FS_GetZipChecksum( FS_BuildOSPath( Cvar_VariableString( "fs_homepath" ), f->TempName, NULL ) );
+		if ( checksum == -1 )
+		{
+			return qfalse;
+		}
 	}
 
-	dl->mapAutoDownload = autoDownload;
+	Com_sprintf( name, sizeof( name ), "%s%c%s.pk3", dl->gameDir, PATH_SEP, f->Name );
 
-	if ( dl->mapAutoDownload )
+	if ( FS_SV_FileExists( name ) )
 	{
-		Cvar_Set( "cl_downloadName", dl->Name );
-		Cvar_Set( "cl_downloadSize", "0" );
-		Cvar_Set( "cl_downloadCount", "0" );
-		Cvar_Set( "cl_downloadTime", va( "%i", cls.realtime ) );
+		Com_sprintf( name, sizeof( name ), "%s%c%s.%08x.pk3", dl->gameDir, PATH_SEP, f->Name, checksum );
+
+		if ( FS_SV_FileExists( name ) )
+			Com_DL_RemoveFile( name );
 	}
 
+	FS_SV_Rename( f->TempName, name );
+
+	Com_Printf( S_COLOR_GREEN "%s downloaded\n", name );
+
 	return qtrue;
 }
 
 
+/*
+=================
+Com_DL_FileDone
+=================
+*/
+static void Com_DL_FileDone( download_t *dl, dlTransfer_t *f, CURLcode result )
+{
+	qboolean keepPartial;
+	long code;
+
+	if ( f->running )
+	{
+		dl->func.multi_remove_handle( dl->cURLM, f->cURL );
+		f->running = qfalse;
+	}
+
+	if ( f->fHandle != FS_INVALID_HANDLE )
+	{
+		FS_FCloseFile( f->fHandle );
+		f->fHandle = FS_INVALID_HANDLE;
+	}
+
+	if ( result == CURLE_OK )
+	{
+		if ( Com_DL_FinishFile( dl, f ) )
+		{
+			f->TempName[0] = '\0';
+			Com_DL_FreeFile( dl, f, qtrue );
+			dl->numDone++;
+			return;
+		}
+
+		// a resumed file may have been changed on the server meanwhile
+		if ( f->resumed && Com_DL_Restart( f ) )
+		{
+			Com_Printf( S_COLOR_YELLOW "%s: invalid file after resume, restarting\n", f->Name );
+			return;
+		}
+
+		Com_Printf( S_COLOR_RED "Download Error: %s is not a valid pk3 file\n", f->Name );
+		keepPartial = qfalse;
+	}
+	else
+	{
+		code = 0;
+		dl->func.easy_getinfo( f->cURL, CURLINFO_RESPONSE_CODE, &code );
+
+		if ( ( code == 416 || result == CURLE_RANGE_ERROR ) && f->resumeFrom && Com_DL_Restart( f ) )
+		{
+			// partial file is not a prefix of what the server has now
+			// or the server doesn't support ranges
+			return;
+		}
+
+		if ( Com_DL_Resumable( result ) && f->retries < DL_MAX_RETRIES )
+		{
+			Com_Printf( S_COLOR_YELLOW "%s: %s, retrying\n", f->Name, dl->func.easy_strerror( result ) );
+			f->retries++;
+			return;
+		}
+
+		Com_Printf( S_COLOR_RED "Download Error: %s Code: %ld\n",
+			dl->func.easy_strerror( result ), code );
+		keepPartial = Com_DL_Resumable( result ) && f->offset > 0 && f->crc.state != DL_CRC_INVALID;
+	}
+
+	if ( f->autoDownload )
+	{
+		if ( cls.state == CA_CONNECTED )
+		{
+			Com_DL_FreeFile( dl, f, keepPartial );
+			Com_DL_Cleanup( dl );
+			Com_Error( ERR_DROP, "%s\n", "download error" );
+		}
+		Com_DL_ResetCvars();
+		dl->mapAutoDownload = qfalse;
+	}
+
+	Com_DL_FreeFile( dl, f, keepPartial );
+}
+
+
+/*
+=================
+Com_DL_Perform
+=================
+*/
 qboolean Com_DL_Perform( download_t *dl )
 {
-	char name[ sizeof( dl->TempName ) ];
+	qboolean autoDownload;
 	CURLMcode res;
 	CURLMsg *msg;
-	long code;
+	CURLcode result;
+	CURL *handle;
 	int c, n;
 	int i;
 
+	Com_DL_StartFiles( dl );
+
 	res = dl->func.multi_perform( dl->cURLM, &c );
 
 	n = 128;
@@ -1021,48 +1521,45 @@ qboolean Com_DL_Perform( download_t *dl )
 		return qtrue;
 	}
 
-	msg = dl->func.multi_info_read( dl->cURLM, &c );
-	if( msg == NULL )
-	{
-		return qtrue;
-	}
-
-	if ( dl->fHandle != FS_INVALID_HANDLE )
-	{
-		FS_FCloseFile( dl->fHandle );
-		dl->fHandle = FS_INVALID_HANDLE;
-	}
-
-	if ( msg->msg == CURLMSG_DONE && msg->data.result == CURLE_OK )
+	while ( ( msg = dl->func.multi_info_read( dl->cURLM, &c ) ) != NULL )
 	{
-		qboolean autoDownload = dl->mapAutoDownload;
+		if ( msg->msg != CURLMSG_DONE )
+			continue;
 
-		Com_sprintf( name, sizeof( name ), "%s%c%s.pk3", dl->gameDir, PATH_SEP, dl->Name );
+		// message is not valid after multi_remove_handle()
+		handle = msg->easy_handle;
+		result = msg->data.result;
 
-		if ( !FS_SV_FileExists( name ) )
+		for ( i = 0; i < DL_MAX_FILES; i++ )
 		{
-			FS_SV_Rename( dl->TempName, name );
+			if ( dl->files[i].cURL == handle && dl->files[i].running )
+			{
+				Com_DL_FileDone( dl, &dl->files[i], result );
+				break;
+			}
 		}
-		else
-		{
-			n = FS_GetZipChecksum( name );
-			Com_sprintf( name, sizeof( name ), "%s%c%s.%08x.pk3", dl->gameDir, PATH_SEP, dl->Name, n );
+	}
 
-			if ( FS_SV_FileExists( name ) )
-				FS_Remove( name );
+	if ( Com_DL_InProgress( dl ) )
+	{
+		return qtrue;
+	}
 
-			FS_SV_Rename( dl->TempName, name );
-		}
+	// whole queue is done
+	autoDownload = dl->mapAutoDownload;
+	n = dl->numDone;
 
-		Com_DL_Cleanup( dl );
+	Com_DL_Cleanup( dl );
+
+	if ( n )
+	{
 		FS_Reload(); //clc.downloadRestart = qtrue;
-		Com_Printf( S_COLOR_GREEN "%s downloaded\n", name );
 		if ( autoDownload )
 		{
 			if ( cls.state == CA_CONNECTED && !clc.demoplaying )
 			{
 				CL_AddReliableCommand( "donedl", qfalse ); // get new gamestate info from server
-			} 
+			}
 			else if ( clc.demoplaying )
 			{
 				// FIXME: there might be better solution than vid_restart
@@ -1070,27 +1567,9 @@ qboolean Com_DL_Perform( download_t *dl )
 				Cbuf_ExecuteText( EXEC_APPEND, "vid_restart\n" );
 			}
 		}
-		return qfalse;
-	}
-	else
-	{
-		qboolean autoDownload = dl->mapAutoDownload;
-		dl->func.easy_getinfo( msg->easy_handle, CURLINFO_RESPONSE_CODE, &code );
-		Com_Printf( S_COLOR_RED "Download Error: %s Code: %ld\n",
-			dl->func.easy_strerror( msg->data.result ), code );
-		strcpy( name, dl->TempName );
-		Com_DL_Cleanup( dl );
-		FS_Remove( name );
-		if ( autoDownload )
-		{
-			if ( cls.state == CA_CONNECTED )
-			{
-				Com_Error( ERR_DROP, "%s\n", "download error" );
-			}
-		}
 	}
 
-	return qtrue;
+	return qfalse;
 }
 
 #endif /* USE_CURL */
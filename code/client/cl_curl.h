@@ -100,18 +100,48 @@ void CL_cURL_BeginDownload( const char *localName, const char *remoteURL );
 void CL_cURL_PerformDownload( void );
 void CL_cURL_Cleanup( void );
 
-typedef struct download_s {
+#define DL_MAX_TRANSFERS	8	// upper limit of cl_dlParallel
+#define DL_MAX_FILES		32	// queued and running downloads
+
+// incremental pk3 checksum, computed from the central directory while it is received
+typedef struct {
+	byte		header[46];		// fixed part of the current zip record
+	int			headerLen;
+	int			headerSize;		// 0 while reading the record signature
+	unsigned int skip;			// bytes to skip before the next record
+	int			numEntries;		// central directory entries seen
+	int			*crcs;
+	int			numCRCs;
+	int			maxCRCs;
+	int			state;
+	int			checksum;
+} dlChecksum_t;
+
+typedef struct {
+	struct download_s *dl;
 	char		URL[MAX_OSPATH];
 	char		Name[MAX_OSPATH];
-	char		gameDir[MAX_OSPATH];
-	char		TempName[MAX_OSPATH*2 + 14]; // gameDir + PATH_SEP + Name + ".00000000.tmp"
+	char		TempName[MAX_OSPATH*2 + 14]; // gameDir + PATH_SEP + Name + ".tmp"
 	char		progress[MAX_OSPATH+64];
 	CURL		*cURL;
-	CURLM		*cURLM;
 	fileHandle_t fHandle;
 	int			Size;
 	int			Count;
+	int			offset;			// bytes stored in TempName
+	int			resumeFrom;		// offset the current request started at
+	int			retries;
+	qboolean	running;		// added to the multi handle
+	qboolean	resumed;
 	qboolean	headerCheck;
+	qboolean	autoDownload;
+	dlChecksum_t crc;
+} dlTransfer_t;
+
+typedef struct download_s {
+	char		gameDir[MAX_OSPATH];
+	CURLM		*cURLM;
+	dlTransfer_t files[DL_MAX_FILES];	// used slots have cURL set
+	int			numDone;		// downloads completed since the queue was empty
 	qboolean	mapAutoDownload;
 
 	struct func_s {
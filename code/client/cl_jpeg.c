@@ -268,6 +268,118 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 }
 
 
+static void CL_JPGSilentErrorExit( j_common_ptr cinfo )
+{
+	q_jpeg_error_mgr_t *jerr = (q_jpeg_error_mgr_t *)cinfo->err;
+
+	Q_longjmp( jerr->setjmp_buffer, 1 );
+}
+
+
+static void CL_JPGSilentMessage( j_common_ptr cinfo )
+{
+}
+
+
+/*
+=================
+CL_DecodeJPG
+
+Same as CL_LoadJPG() but decodes a file already in memory, may be called
+from any thread: the image is allocated with malloc() and nothing is printed,
+returns qfalse on errors so the caller can load the file the usual way
+=================
+*/
+qboolean CL_DecodeJPG( const byte *data, int length, unsigned char **pic, int *width, int *height )
+{
+	struct jpeg_decompress_struct cinfo = {NULL};
+	q_jpeg_error_mgr_t jerr;
+	JSAMPARRAY buffer;
+	unsigned int row_stride;
+	unsigned int pixelcount, memcount;
+	unsigned int sindex, dindex;
+	byte * volatile out;
+	byte *buf;
+
+	*pic = NULL;
+	out = NULL;
+
+	cinfo.err = jpeg_std_error( &jerr.pub );
+	cinfo.err->error_exit = CL_JPGSilentErrorExit;
+	cinfo.err->output_message = CL_JPGSilentMessage;
+
+	if ( Q_setjmp( jerr.setjmp_buffer ) )
+	{
+		jpeg_destroy_decompress( &cinfo );
+		free( out );
+		return qfalse;
+	}
+
+	jpeg_create_decompress( &cinfo );
+	jpeg_mem_src( &cinfo, (byte *)data, length );
+	(void) jpeg_read_header( &cinfo, TRUE );
+
+	cinfo.out_color_space = JCS_RGB;
+
+	(void) jpeg_start_decompress( &cinfo );
+
+	pixelcount = cinfo.output_width * cinfo.output_height;
+
+	if ( !cinfo.output_width || !cinfo.output_height
+		|| ((pixelcount * 4) / cinfo.output_width) / 4 != cinfo.output_height
+		|| pixelcount > 0x1FFFFFFF || cinfo.output_components != 3 )
+	{
+		jpeg_destroy_decompress( &cinfo );
+		return qfalse;
+	}
+
+	memcount = pixelcount * 4;
+	row_stride = cinfo.output_width * cinfo.output_components;
+
+	out = malloc( memcount );
+	if ( !out )
+	{
+		jpeg_destroy_decompress( &cinfo );
+		return qfalse;
+	}
+
+	while ( cinfo.output_scanline < cinfo.output_height ) {
+		buf = out + row_stride * cinfo.output_scanline;
+		buffer = &buf;
+		(void) jpeg_read_scanlines( &cinfo, buffer, 1 );
+	}
+
+	// expand from RGB to RGBA
+	buf = out;
+	sindex = pixelcount * cinfo.output_components;
+	dindex = memcount;
+
+	do
+	{
+		buf[--dindex] = 255;
+		buf[--dindex] = buf[--sindex];
+		buf[--dindex] = buf[--sindex];
+		buf[--dindex] = buf[--sindex];
+	} while ( sindex );
+
+	*width = cinfo.output_width;
+	*height = cinfo.output_height;
+
+	jpeg_finish_decompress( &cinfo );
+	jpeg_destroy_decompress( &cinfo );
+
+	// let CL_LoadJPG() report corrupt data
+	if ( jerr.pub.num_warnings ) {
+		free( out );
+		return qfalse;
+	}
+
+	*pic = out;
+
+	return qtrue;
+}
+
+
 /* Expanded data destination object for stdio output */
 
 typedef struct {
@@ -39,14 +39,19 @@ cvar_t	*cl_timeout;
 cvar_t	*cl_autoNudge;
 cvar_t	*cl_timeNudge;
 cvar_t	*cl_showTimeDelta;
+cvar_t	*cl_showSnapshotCopy;
+cvar_t	*cl_snapshotReuse;
 
 cvar_t	*cl_shownet;
 cvar_t	*cl_autoRecordDemo;
+cvar_t	*cl_timedemoLog;
 
 cvar_t	*cl_aviFrameRate;
 cvar_t	*cl_aviMotionJpeg;
 cvar_t	*cl_forceavidemo;
 cvar_t	*cl_aviPipeFormat;
+cvar_t	*cl_aviQueueFrames;
+cvar_t	*cl_aviQueueDrop;
 
 cvar_t	*cl_activeAction;
 
@@ -62,6 +67,7 @@ cvar_t	*cl_inGameVideo;
 cvar_t	*cl_serverStatusResendTime;
 
 cvar_t	*cl_lanForcePackets;
+cvar_t	*cl_pingRate;
 
 cvar_t	*cl_lastServerAddress;
 
@@ -76,6 +82,9 @@ cvar_t  *authl;
 
 cvar_t	*cl_dlURL;
 cvar_t	*cl_dlDirectory;
+#ifdef USE_CURL
+cvar_t	*cl_dlParallel;
+#endif
 
 cvar_t	*cl_reconnectArgs;
 
@@ -453,7 +462,7 @@ static void CL_EmitPacketEntities( clSnapshot_t *from, clSnapshot_t *to, msg_t *
 		if ( newindex >= to->numEntities ) {
 			newnum = MAX_GENTITIES+1;
 		} else {
-			newent = &cl.parseEntities[(to->parseEntitiesNum + newindex) % MAX_PARSE_ENTITIES];
+			newent = CL_PARSE_ENTITY( to->parseEntitiesNum + newindex );
 			newnum = newent->number;
 		}
 
@@ -557,7 +566,7 @@ static void CL_WriteSnapshot( void ) {
 
 	// save last sent state so if there any need - we can skip any further incoming messages
 	for ( i = 0; i < snap->numEntities; i++ )
-		saved_ents[ i ] = cl.parseEntities[ (snap->parseEntitiesNum + i) % MAX_PARSE_ENTITIES ];
+		saved_ents[ i ] = *CL_PARSE_ENTITY( snap->parseEntitiesNum + i );
 
 	saved_snap = *snap;
 	saved_snap.parseEntitiesNum = 0;
@@ -730,6 +739,214 @@ CLIENT SIDE DEMO PLAYBACK
 =======================================================================
 */
 
+#define TIMEDEMO_BUCKET_USEC	250
+#define TIMEDEMO_BUCKETS		400		// 100ms, longer frames go to the last bucket
+
+typedef struct {
+	int		*frameUsec;
+	int		*cgameUsec;
+	int		numFrames;
+	int		maxFrames;
+	int64_t	frameStart;
+} timeDemoLog_t;
+
+static timeDemoLog_t tdLog;
+
+
+/*
+=================
+CL_TimeDemoFrame
+
+Called at the start of every timedemo frame, records timings of the previous one
+=================
+*/
+void CL_TimeDemoFrame( void ) {
+	int64_t now;
+	int *frameUsec, *cgameUsec;
+
+	if ( !cl_timedemoLog->string[0] ) {
+		return;
+	}
+
+	now = Sys_Microseconds();
+
+	if ( clc.timeDemoFrames <= 1 ) {
+		// first frame, nothing to record yet
+		tdLog.numFrames = 0;
+		tdLog.frameStart = now;
+		clc.timeDemoCGameUsec = 0;
+		return;
+	}
+
+	if ( tdLog.numFrames >= tdLog.maxFrames ) {
+		tdLog.maxFrames = tdLog.maxFrames ? tdLog.maxFrames * 2 : 4096;
+		frameUsec = Z_Malloc( tdLog.maxFrames * sizeof( int ) );
+		cgameUsec = Z_Malloc( tdLog.maxFrames * sizeof( int ) );
+		if ( tdLog.numFrames ) {
+			Com_Memcpy( frameUsec, tdLog.frameUsec, tdLog.numFrames * sizeof( int ) );
+			Com_Memcpy( cgameUsec, tdLog.cgameUsec, tdLog.numFrames * sizeof( int ) );
+		}
+		if ( tdLog.frameUsec ) {
+			Z_Free( tdLog.frameUsec );
+			Z_Free( tdLog.cgameUsec );
+		}
+		tdLog.frameUsec = frameUsec;
+		tdLog.cgameUsec = cgameUsec;
+	}
+
+	tdLog.frameUsec[ tdLog.numFrames ] = (int)( now - tdLog.frameStart );
+	tdLog.cgameUsec[ tdLog.numFrames ] = clc.timeDemoCGameUsec;
+	tdLog.numFrames++;
+
+	tdLog.frameStart = now;
+	clc.timeDemoCGameUsec = 0;
+}
+
+
+static int QDECL intcmp( const void *a, const void *b ) {
+	return *(const int *)a - *(const int *)b;
+}
+
+
+/*
+=================
+CL_WriteTimeDemoSeries
+
+Summary and non-empty histogram buckets of a single timing series as JSON object
+=================
+*/
+static void CL_WriteTimeDemoSeries( fileHandle_t f, const char *name, const int *samples, int count, qboolean last ) {
+	int buckets[ TIMEDEMO_BUCKETS ];
+	int64_t total;
+	int *sorted;
+	int i, n;
+	qboolean first;
+
+	sorted = Z_Malloc( count * sizeof( int ) );
+	Com_Memcpy( sorted, samples, count * sizeof( int ) );
+	qsort( sorted, count, sizeof( int ), intcmp );
+
+	Com_Memset( buckets, 0, sizeof( buckets ) );
+	total = 0;
+	for ( i = 0; i < count; i++ ) {
+		total += sorted[i];
+		n = sorted[i] / TIMEDEMO_BUCKET_USEC;
+		if ( n >= TIMEDEMO_BUCKETS )
+			n = TIMEDEMO_BUCKETS - 1;
+		buckets[n]++;
+	}
+
+	FS_Printf( f, "\t\"%s\": {\n", name );
+	FS_Printf( f, "\t\t\"min\": %i,\n", sorted[0] );
+	FS_Printf( f, "\t\t\"avg\": %i,\n", (int)( total / count ) );
+	FS_Printf( f, "\t\t\"p50\": %i,\n", sorted[ count * 50 / 100 ] );
+	FS_Printf( f, "\t\t\"p90\": %i,\n", sorted[ count * 90 / 100 ] );
+	FS_Printf( f, "\t\t\"p99\": %i,\n", sorted[ count * 99 / 100 ] );
+	FS_Printf( f, "\t\t\"max\": %i,\n", sorted[ count - 1 ] );
+	FS_Printf( f, "\t\t\"bucket_usec\": %i,\n", TIMEDEMO_BUCKET_USEC );
+	FS_Printf( f, "\t\t\"histogram\": [" );
+	first = qtrue;
+	for ( i = 0; i < TIMEDEMO_BUCKETS; i++ ) {
+		if ( buckets[i] ) {
+			FS_Printf( f, "%s[%i, %i]", first ? "" : ", ", i * TIMEDEMO_BUCKET_USEC, buckets[i] );
+			first = qfalse;
+		}
+	}
+	FS_Printf( f, "]\n\t}%s\n", last ? "" : "," );
+
+	Z_Free( sorted );
+}
+
+
+/*
+=================
+CL_EscapeJSON
+
+Copies the string escaping quotes, backslashes and control characters
+=================
+*/
+static const char *CL_EscapeJSON( char *buf, int size, const char *s ) {
+	char *o = buf;
+	int len;
+
+	for ( ; *s; s++ ) {
+		if ( *s == '"' || *s == '\\' ) {
+			len = 2;
+		} else if ( (byte)*s < ' ' ) {
+			len = 6;
+		} else {
+			len = 1;
+		}
+		if ( o - buf + len >= size ) {
+			break;
+		}
+		if ( len == 2 ) {
+			*o++ = '\\';
+			*o++ = *s;
+		} else if ( len == 6 ) {
+			Com_sprintf( o, 7, "\\u%04x", (byte)*s );
+			o += 6;
+		} else {
+			*o++ = *s;
+		}
+	}
+	*o = '\0';
+
+	return buf;
+}
+
+
+/*
+=================
+CL_WriteTimeDemoLog
+=================
+*/
+static void CL_WriteTimeDemoLog( int msec ) {
+	char name[ MAX_OSPATH ];
+	char escaped[ MAX_OSPATH * 2 ];
+	fileHandle_t f;
+	int i;
+
+	if ( tdLog.numFrames <= 0 ) {
+		return;
+	}
+
+	Q_strncpyz( name, cl_timedemoLog->string, sizeof( name ) );
+	COM_DefaultExtension( name, sizeof( name ), ".json" );
+
+	f = FS_FOpenFileWrite( name );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( S_COLOR_YELLOW "Couldn't write timedemo log %s\n", name );
+		return;
+	}
+
+	if ( !Q_stricmp( COM_GetExtension( name ), "csv" ) ) {
+		FS_Printf( f, "frame,frame_usec,cgame_usec\n" );
+		for ( i = 0; i < tdLog.numFrames; i++ ) {
+			FS_Printf( f, "%i,%i,%i\n", i, tdLog.frameUsec[i], tdLog.cgameUsec[i] );
+		}
+	} else {
+		FS_Printf( f, "{\n" );
+		FS_Printf( f, "\t\"demo\": \"%s\",\n", CL_EscapeJSON( escaped, sizeof( escaped ), clc.demoName ) );
+#ifdef USE_RENDERER_DLOPEN
+		FS_Printf( f, "\t\"renderer\": \"%s\",\n", CL_EscapeJSON( escaped, sizeof( escaped ), cl_renderer->string ) );
+#endif
+		FS_Printf( f, "\t\"frames\": %i,\n", clc.timeDemoFrames );
+		FS_Printf( f, "\t\"msec\": %i,\n", msec );
+		FS_Printf( f, "\t\"fps\": %.2f,\n", msec > 0 ? clc.timeDemoFrames * 1000.0 / msec : 0.0 );
+		CL_WriteTimeDemoSeries( f, "frame_usec", tdLog.frameUsec, tdLog.numFrames, qfalse );
+		CL_WriteTimeDemoSeries( f, "cgame_usec", tdLog.cgameUsec, tdLog.numFrames, qtrue );
+		FS_Printf( f, "}\n" );
+	}
+
+	FS_FCloseFile( f );
+
+	Com_Printf( "Wrote %i frame timings to %s\n", tdLog.numFrames, name );
+
+	tdLog.numFrames = 0;
+}
+
+
 /*
 =================
 CL_DemoCompleted
@@ -744,6 +961,10 @@ static void CL_DemoCompleted( void ) {
 			Com_Printf( "%i frames, %3.*f seconds: %3.1f fps\n", clc.timeDemoFrames,
 			time > 10000 ? 1 : 2, time/1000.0, clc.timeDemoFrames*1000.0 / time );
 		}
+
+		if ( cl_timedemoLog->string[0] ) {
+			CL_WriteTimeDemoLog( time );
+		}
 	}
 
 	CL_Disconnect( qtrue );
@@ -3236,7 +3457,7 @@ void CL_Frame( int msec, int realMsec ) {
 	float frameDuration;
 
 #ifdef USE_CURL
-	if ( download.cURL ) {
+	if ( download.cURLM ) {
 		Com_DL_Perform( &download );
 	}
 #endif
@@ -3537,6 +3758,19 @@ static void CL_RefFreeAll( void ) {
 }
 
 
+/*
+============
+CL_RefProfileEvent
+
+Event names of the renderer are copied, the module may be
+unloaded while its events are still in the profiler rings
+============
+*/
+static void CL_RefProfileEvent( const char *name, int arg, int64_t start ) {
+	Com_ProfileEvent( Com_ProfileName( name ), arg, start );
+}
+
+
 /*
 ============
 CL_ScaledMilliseconds
@@ -3669,6 +3903,7 @@ static void CL_InitRef( void ) {
 	rimp.FS_FreeFileList = FS_FreeFileList;
 	rimp.FS_ListFiles = FS_ListFiles;
 	//rimp.FS_FileIsInPAK = FS_FileIsInPAK;
+	rimp.FS_FilePakChecksum = FS_FilePakChecksum;
 	rimp.FS_FileExists = FS_FileExists;
 
 	rimp.Cvar_Get = Cvar_Get;
@@ -3694,6 +3929,7 @@ static void CL_InitRef( void ) {
 	rimp.CL_SaveJPGToBuffer = CL_SaveJPGToBuffer;
 	rimp.CL_SaveJPG = CL_SaveJPG;
 	rimp.CL_LoadJPG = CL_LoadJPG;
+	rimp.CL_DecodeJPG = CL_DecodeJPG;
 
 	rimp.CL_IsMinimized = CL_IsMininized;
 	rimp.CL_SetScaling = CL_SetScaling;
@@ -3702,6 +3938,19 @@ static void CL_InitRef( void ) {
 	rimp.Sys_LowPhysicalMemory = Sys_LowPhysicalMemory;
 	rimp.Com_RealTime = Com_RealTime;
 
+	rimp.Sys_CreateThread = Sys_CreateThread;
+	rimp.Sys_JoinThread = Sys_JoinThread;
+	rimp.Sys_CreateSemaphore = Sys_CreateSemaphore;
+	rimp.Sys_DestroySemaphore = Sys_DestroySemaphore;
+	rimp.Sys_SemaphorePost = Sys_SemaphorePost;
+	rimp.Sys_SemaphoreWait = Sys_SemaphoreWait;
+
+	rimp.Com_NumJobThreads = Com_NumJobThreads;
+	rimp.Com_RunJobs = Com_RunJobs;
+
+	rimp.Com_ProfileStart = Com_ProfileStart;
+	rimp.Com_ProfileEvent = CL_RefProfileEvent;
+
 	// OpenGL API
 	rimp.GLimp_Init = GLimp_Init;
 	rimp.GLimp_Shutdown = GLimp_Shutdown;
@@ -4134,6 +4383,13 @@ void CL_Init( void ) {
     cl_showTimeDelta = Cvar_Get ("cl_showTimeDelta", "0", CVAR_TEMP );
     Cvar_SetDescription( cl_showTimeDelta, "Display time delta between server updates\nDefault: 0" );
 
+	cl_showSnapshotCopy = Cvar_Get( "cl_showSnapshotCopy", "0", CVAR_TEMP );
+	Cvar_SetDescription( cl_showSnapshotCopy, "Print entity states written by snapshot parsing and copied to cgame for every snapshot\nDefault: 0" );
+
+	cl_snapshotReuse = Cvar_Get( "cl_snapshotReuse", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( cl_snapshotReuse, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( cl_snapshotReuse, "Only copy entities that changed since cgame last received the same snapshot buffer.\nAssumes cgame never writes to its snapshot_t buffers, which stock cgame does not guarantee, keep at 0 unless the mod is known not to modify snapshot entities.\nDefault: 0" );
+
     rcon_client_password = Cvar_Get ("rconPassword", "", CVAR_TEMP );
     Cvar_SetDescription( rcon_client_password, "Set the rcon password when connecting to a passworded server\nDefault: empty" );
 
@@ -4143,6 +4399,9 @@ void CL_Init( void ) {
     cl_autoRecordDemo = Cvar_Get ("cl_autoRecordDemo", "0", CVAR_ARCHIVE);
     Cvar_SetDescription( cl_autoRecordDemo, "Automatically start a demo recording when the game start\nDefault: 0" );
 
+    cl_timedemoLog = Cvar_Get( "cl_timedemoLog", "", 0 );
+    Cvar_SetDescription( cl_timedemoLog, "Write per-frame timedemo timings to the given file when the demo completes, *.csv for raw frame times, otherwise a JSON summary with histograms\nDefault: empty" );
+
     cl_aviFrameRate = Cvar_Get ("cl_aviFrameRate", "25", CVAR_ARCHIVE);
 	Cvar_CheckRange( cl_aviFrameRate, "1", "1000", CV_INTEGER );
     Cvar_SetDescription( cl_aviFrameRate, "Frame rate for AVI video capture\nDefault: 25" );
@@ -4160,6 +4419,17 @@ void CL_Init( void ) {
 		CVAR_ARCHIVE );
     Cvar_SetDescription(cl_aviPipeFormat, "Extra flags send to the AVI encoding pipeline\nDefault: -preset medium -r:a ...");
 
+    cl_aviQueueFrames = Cvar_Get( "cl_aviQueueFrames", "8", CVAR_ARCHIVE_ND );
+    Cvar_CheckRange( cl_aviQueueFrames, "0", "64", CV_INTEGER );
+    Cvar_SetDescription( cl_aviQueueFrames, "Number of captured frames buffered for the AVI writer thread, 0 writes on the main thread\nDefault: 8" );
+
+    cl_aviQueueDrop = Cvar_Get( "cl_aviQueueDrop", "0", CVAR_ARCHIVE_ND );
+    Cvar_CheckRange( cl_aviQueueDrop, "0", "1", CV_INTEGER );
+    Cvar_SetDescription( cl_aviQueueDrop, "What to do when the AVI writer queue is full:\n"
+        " 0 - wait for the writer, no frames are lost\n"
+        " 1 - drop video frames, keeps the frame rate but loses audio sync\n"
+        "Default: 0" );
+
 	rconAddress = Cvar_Get ("rconAddress", "", 0);
     Cvar_SetDescription(rconAddress, "Set the server address for rcon commands, rcon can be used without being connected to a game\nDefault: empty");
 
@@ -4201,6 +4471,10 @@ void CL_Init( void ) {
 
     Cvar_Get( "cl_maxPing", "800", CVAR_ARCHIVE_ND );
 
+	cl_pingRate = Cvar_Get( "cl_pingRate", "1000", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( cl_pingRate, "50", "10000", CV_INTEGER );
+	Cvar_SetDescription( cl_pingRate, "Maximum number of server browser pings sent per second\nDefault: 1000" );
+
 	cl_lanForcePackets = Cvar_Get( "cl_lanForcePackets", "1", CVAR_ARCHIVE_ND );
     Cvar_SetDescription( cl_lanForcePackets, "Send packets over LAN every frame whether the client state changes or not\nDefault: 1" );
 
@@ -4217,6 +4491,12 @@ void CL_Init( void ) {
         " 1 - fs_basegame (%s) /download directory\n", FS_GetBaseGameDir() );
 	Cvar_SetDescription( cl_dlDirectory, s );
 
+#ifdef USE_CURL
+	cl_dlParallel = Cvar_Get( "cl_dlParallel", "4", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( cl_dlParallel, "1", XSTRING( DL_MAX_TRANSFERS ), CV_INTEGER );
+	Cvar_SetDescription( cl_dlParallel, "Number of files fetched at the same time by \\dlmap and \\download commands\nDefault: 4" );
+#endif
+
 	cl_reconnectArgs = Cvar_Get( "cl_reconnectArgs", "", CVAR_ARCHIVE_ND | CVAR_NOTABCOMPLETE );
 
     #ifdef USE_AUTH
@@ -4491,13 +4771,310 @@ static void CL_SetServerInfoByAddress(const netadr_t *from, const char *info, in
 }
 
 
+/*
+=================================================================================
+
+SERVER BROWSER PINGS
+
+Pings requested by the server browser don't use the MAX_PINGREQUESTS slots of
+cl_pinglist, these are left to the ping command and the ui ping queries. Every
+outstanding browser ping is kept in an address hash to match the reply and in a
+timing wheel bucket of its deadline, so both replies and timeouts cost the same
+regardless of how many pings are in flight. Requests are paced by cl_pingRate
+to not overflow the socket receive buffer with replies.
+
+=================================================================================
+*/
+
+#define MAX_BROWSER_PINGS	2048
+#define PING_HASH_SIZE		4096	// power of two
+#define PING_WHEEL_SLOTS	64		// power of two
+#define PING_WHEEL_USEC		16000	// duration of a wheel tick
+
+typedef struct browserPing_s {
+	netadr_t				adr;
+	serverInfo_t			*server;
+	int64_t					start;		// Sys_Microseconds() of the request
+	int64_t					deadline;	// wheel tick of the timeout
+	struct browserPing_s	*hashNext;
+	struct browserPing_s	**hashPrev;
+	struct browserPing_s	*wheelNext;
+	struct browserPing_s	**wheelPrev;
+} browserPing_t;
+
+static struct {
+	browserPing_t	pings[MAX_BROWSER_PINGS];
+	browserPing_t	*freePings;
+	browserPing_t	*hash[PING_HASH_SIZE];
+	browserPing_t	*wheel[PING_WHEEL_SLOTS];
+	int64_t			tick;			// last processed wheel tick
+	int64_t			sendTime;		// pacing clock, in microseconds
+	int				numPending;
+	qboolean		initialized;
+} cl_browserPings;
+
+
+/*
+===================
+CL_PingNetType
+
+NOTE: make sure these types are in sync with the netnames strings in the UI
+===================
+*/
+static int CL_PingNetType( const netadr_t *from ) {
+	switch ( from->type ) {
+		case NA_BROADCAST:
+		case NA_IP:
+			return 1;
+#ifdef USE_IPV6
+		case NA_IP6:
+			return 2;
+#endif
+		default:
+			return 0;
+	}
+}
+
+
+/*
+===================
+CL_BrowserPingHash
+===================
+*/
+static unsigned int CL_BrowserPingHash( const netadr_t *adr ) {
+	const byte *ip = adr->ipv._4;
+	unsigned int hash;
+	int i, len;
+
+	len = 4;
+#ifdef USE_IPV6
+	if ( adr->type == NA_IP6 ) {
+		len = 16;
+	}
+#endif
+
+	hash = adr->port;
+	for ( i = 0; i < len; i++ ) {
+		hash = hash * 31 + ip[i];
+	}
+
+	return ( hash ^ ( hash >> 12 ) ) & ( PING_HASH_SIZE - 1 );
+}
+
+
+/*
+===================
+CL_InitBrowserPings
+===================
+*/
+static void CL_InitBrowserPings( void ) {
+	int i;
+
+	Com_Memset( &cl_browserPings, 0, sizeof( cl_browserPings ) );
+
+	for ( i = MAX_BROWSER_PINGS - 1; i >= 0; i-- ) {
+		cl_browserPings.pings[i].hashNext = cl_browserPings.freePings;
+		cl_browserPings.freePings = &cl_browserPings.pings[i];
+	}
+
+	cl_browserPings.tick = Sys_Microseconds() / PING_WHEEL_USEC;
+	cl_browserPings.initialized = qtrue;
+}
+
+
+/*
+===================
+CL_FindBrowserPing
+===================
+*/
+static browserPing_t *CL_FindBrowserPing( const netadr_t *adr ) {
+	browserPing_t *ping;
+
+	if ( !cl_browserPings.numPending ) {
+		return NULL;
+	}
+
+	for ( ping = cl_browserPings.hash[ CL_BrowserPingHash( adr ) ]; ping; ping = ping->hashNext ) {
+		if ( NET_CompareAdr( adr, &ping->adr ) ) {
+			return ping;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+===================
+CL_FreeBrowserPing
+===================
+*/
+static void CL_FreeBrowserPing( browserPing_t *ping ) {
+
+	if ( ping->hashNext ) {
+		ping->hashNext->hashPrev = ping->hashPrev;
+	}
+	*ping->hashPrev = ping->hashNext;
+
+	if ( ping->wheelNext ) {
+		ping->wheelNext->wheelPrev = ping->wheelPrev;
+	}
+	*ping->wheelPrev = ping->wheelNext;
+
+	ping->hashNext = cl_browserPings.freePings;
+	cl_browserPings.freePings = ping;
+	cl_browserPings.numPending--;
+}
+
+
+/*
+===================
+CL_SendBrowserPing
+
+Returns qfalse if all ping slots are in use
+===================
+*/
+static qboolean CL_SendBrowserPing( serverInfo_t *server, int64_t now, int maxPing ) {
+	static const char request[] = "\xff\xff\xff\xffgetinfo xxx";
+	browserPing_t *ping, **head;
+
+	ping = cl_browserPings.freePings;
+	if ( !ping ) {
+		return qfalse;
+	}
+	cl_browserPings.freePings = ping->hashNext;
+	cl_browserPings.numPending++;
+
+	ping->adr = server->adr;
+	ping->server = server;
+	ping->start = now;
+	ping->deadline = ( now + maxPing * 1000LL ) / PING_WHEEL_USEC + 1;
+
+	head = &cl_browserPings.hash[ CL_BrowserPingHash( &ping->adr ) ];
+	ping->hashNext = *head;
+	ping->hashPrev = head;
+	if ( *head ) {
+		(*head)->hashPrev = &ping->hashNext;
+	}
+	*head = ping;
+
+	head = &cl_browserPings.wheel[ ping->deadline & ( PING_WHEEL_SLOTS - 1 ) ];
+	ping->wheelNext = *head;
+	ping->wheelPrev = head;
+	if ( *head ) {
+		(*head)->wheelPrev = &ping->wheelNext;
+	}
+	*head = ping;
+
+	// the request is the same for everyone, skip NET_OutOfBandPrint formatting
+	NET_SendPacket( NS_CLIENT, (int)strlen( request ), request, &ping->adr );
+
+	return qtrue;
+}
+
+
+/*
+===================
+CL_BrowserPingServer
+
+Returns the server list entry a reply is for, the list could have been
+refreshed since the request was sent
+===================
+*/
+static serverInfo_t *CL_BrowserPingServer( const browserPing_t *ping ) {
+	if ( ping->server->ping == -1 && NET_CompareAdr( &ping->server->adr, &ping->adr ) ) {
+		return ping->server;
+	}
+	return NULL;
+}
+
+
+/*
+===================
+CL_BrowserPingReply
+===================
+*/
+static qboolean CL_BrowserPingReply( const netadr_t *from, const char *infoString ) {
+	char info[MAX_INFO_STRING];
+	browserPing_t *ping;
+	serverInfo_t *server;
+	int time;
+
+	ping = CL_FindBrowserPing( from );
+	if ( !ping ) {
+		return qfalse;
+	}
+
+	time = (int)( ( Sys_Microseconds() - ping->start + 500 ) / 1000 );
+	if ( time < 1 ) {
+		time = 1;
+	}
+
+	if ( com_developer->integer ) {
+		Com_Printf( "ping time %dms from %s\n", time, NET_AdrToString( from ) );
+	}
+
+	Q_strncpyz( info, infoString, sizeof( info ) );
+	Info_SetValueForKey( info, "nettype", va( "%d", CL_PingNetType( from ) ) );
+
+	server = CL_BrowserPingServer( ping );
+	if ( server ) {
+		CL_SetServerInfo( server, info, time );
+	} else {
+		CL_SetServerInfoByAddress( from, info, time );
+	}
+
+	CL_FreeBrowserPing( ping );
+
+	return qtrue;
+}
+
+
+/*
+===================
+CL_ExpireBrowserPings
+
+Runs the timing wheel up to the current tick, servers that didn't reply
+in cl_maxPing get a zero ping
+===================
+*/
+static void CL_ExpireBrowserPings( int64_t now ) {
+	browserPing_t *ping, *next;
+	serverInfo_t *server;
+	int64_t tick, t;
+	int n;
+
+	tick = now / PING_WHEEL_USEC;
+
+	// a long stall visits every bucket once
+	n = (int)MIN( tick - cl_browserPings.tick, PING_WHEEL_SLOTS );
+
+	for ( t = cl_browserPings.tick + 1; n > 0 && cl_browserPings.numPending; t++, n-- ) {
+		for ( ping = cl_browserPings.wheel[ t & ( PING_WHEEL_SLOTS - 1 ) ]; ping; ping = next ) {
+			next = ping->wheelNext;
+			// deadlines past the wheel horizon stay for another round
+			if ( ping->deadline > tick ) {
+				continue;
+			}
+			server = CL_BrowserPingServer( ping );
+			if ( server ) {
+				CL_SetServerInfo( server, NULL, 0 );
+			}
+			CL_FreeBrowserPing( ping );
+		}
+	}
+
+	cl_browserPings.tick = tick;
+}
+
+
 /*
 ===================
 CL_ServerInfoPacket
 ===================
 */
 static void CL_ServerInfoPacket( const netadr_t *from, msg_t *msg ) {
-	int		i, type, len;
+	int		i, len;
 	char	info[MAX_INFO_STRING];
 	const char *infoString;
 	int		prot;
@@ -4531,30 +5108,17 @@ static void CL_ServerInfoPacket( const netadr_t *from, msg_t *msg ) {
 			Q_strncpyz( cl_pinglist[i].info, infoString, sizeof( cl_pinglist[i].info ) );
 
 			// tack on the net type
-			// NOTE: make sure these types are in sync with the netnames strings in the UI
-			switch (from->type)
-			{
-				case NA_BROADCAST:
-				case NA_IP:
-					type = 1;
-					break;
-#ifdef USE_IPV6
-				case NA_IP6:
-					type = 2;
-					break;
-#endif
-				default:
-					type = 0;
-					break;
-			}
-
-			Info_SetValueForKey( cl_pinglist[i].info, "nettype", va( "%d", type ) );
+			Info_SetValueForKey( cl_pinglist[i].info, "nettype", va( "%d", CL_PingNetType( from ) ) );
 			CL_SetServerInfoByAddress( from, infoString, cl_pinglist[i].time );
 
 			return;
 		}
 	}
 
+	if ( CL_BrowserPingReply( from, infoString ) ) {
+		return;
+	}
+
 	// if not just sent a local broadcast or pinging local servers
 	if (cls.pingUpdateSource != AS_LOCAL) {
 		return;
@@ -5161,6 +5725,10 @@ qboolean CL_UpdateVisiblePings_f(int source) {
 	char		buff[MAX_STRING_CHARS];
 	int			pingTime;
 	int			max;
+	int			maxPing;
+	int			budget;
+	int64_t		now, interval;
+	serverInfo_t *server;
 	qboolean status = qfalse;
 
 	if (source < 0 || source > AS_FAVORITES) {
@@ -5169,75 +5737,79 @@ qboolean CL_UpdateVisiblePings_f(int source) {
 
 	cls.pingUpdateSource = source;
 
-	slots = CL_GetPingQueueCount();
-	if (slots < MAX_PINGREQUESTS) {
-		serverInfo_t *server = NULL;
+	switch (source) {
+		case AS_LOCAL :
+			server = &cls.localServers[0];
+			max = cls.numlocalservers;
+		break;
+		case AS_GLOBAL :
+			server = &cls.globalServers[0];
+			max = cls.numglobalservers;
+		break;
+		case AS_FAVORITES :
+			server = &cls.favoriteServers[0];
+			max = cls.numfavoriteservers;
+		break;
+		default:
+			return qfalse;
+	}
 
-		switch (source) {
-			case AS_LOCAL :
-				server = &cls.localServers[0];
-				max = cls.numlocalservers;
-			break;
-			case AS_GLOBAL :
-				server = &cls.globalServers[0];
-				max = cls.numglobalservers;
-			break;
-			case AS_FAVORITES :
-				server = &cls.favoriteServers[0];
-				max = cls.numfavoriteservers;
-			break;
-			default:
-				return qfalse;
-		}
-		for (i = 0; i < max; i++) {
-			if (server[i].visible) {
-				if (server[i].ping == -1) {
-					int j;
+	if ( !cl_browserPings.initialized ) {
+		CL_InitBrowserPings();
+	}
 
-					if (slots >= MAX_PINGREQUESTS) {
-						break;
-					}
-					for (j = 0; j < MAX_PINGREQUESTS; j++) {
-						if (!cl_pinglist[j].adr.port) {
-							continue;
-						}
-						if (NET_CompareAdr( &cl_pinglist[j].adr, &server[i].adr)) {
-							// already on the list
-							break;
-						}
-					}
-					if (j >= MAX_PINGREQUESTS) {
-						status = qtrue;
-						for (j = 0; j < MAX_PINGREQUESTS; j++) {
-							if (!cl_pinglist[j].adr.port) {
-								memcpy(&cl_pinglist[j].adr, &server[i].adr, sizeof(netadr_t));
-								cl_pinglist[j].start = Sys_Milliseconds();
-								cl_pinglist[j].time = 0;
-								NET_OutOfBandPrint(NS_CLIENT, &cl_pinglist[j].adr, "getinfo xxx");
-								slots++;
-								break;
-							}
-						}
-					}
+	now = Sys_Microseconds();
+	CL_ExpireBrowserPings( now );
+
+	maxPing = Cvar_VariableIntegerValue( "cl_maxPing" );
+	if ( maxPing < 100 ) {
+		maxPing = 100;
+	}
+
+	// pacing clock may lag at most 50ms behind, so an idle browser doesn't burst
+	interval = 1000000 / cl_pingRate->integer;
+	if ( cl_browserPings.sendTime < now - 50000 ) {
+		cl_browserPings.sendTime = now - 50000;
+	}
+	budget = (int)( ( now - cl_browserPings.sendTime ) / interval );
+
+	for (i = 0; i < max; i++) {
+		if (server[i].visible) {
+			if (server[i].ping == -1) {
+				if ( CL_FindBrowserPing( &server[i].adr ) ) {
+					// already on the list
+					status = qtrue;
+					continue;
+				}
+				if ( budget > 0 && CL_SendBrowserPing( &server[i], now, maxPing ) ) {
+					cl_browserPings.sendTime += interval;
+					budget--;
 				}
-				// if the server has a ping higher than cl_maxPing or
-				// the ping packet got lost
-				else if (server[i].ping == 0) {
-					// if we are updating global servers
-					if (source == AS_GLOBAL) {
-						//
-						if ( cls.numGlobalServerAddresses > 0 ) {
-							// overwrite this server with one from the additional global servers
-							cls.numGlobalServerAddresses--;
-							CL_InitServerInfo(&server[i], &cls.globalServerAddresses[cls.numGlobalServerAddresses]);
-							// NOTE: the server[i].visible flag stays untouched
-						}
+				status = qtrue;
+			}
+			// if the server has a ping higher than cl_maxPing or
+			// the ping packet got lost
+			else if (server[i].ping == 0) {
+				// if we are updating global servers
+				if (source == AS_GLOBAL) {
+					//
+					if ( cls.numGlobalServerAddresses > 0 ) {
+						// overwrite this server with one from the additional global servers
+						cls.numGlobalServerAddresses--;
+						CL_InitServerInfo(&server[i], &cls.globalServerAddresses[cls.numGlobalServerAddresses]);
+						// NOTE: the server[i].visible flag stays untouched
+						status = qtrue;
 					}
 				}
 			}
 		}
 	}
 
+	if ( cl_browserPings.numPending ) {
+		status = qtrue;
+	}
+
+	slots = CL_GetPingQueueCount();
 	if (slots) {
 		status = qtrue;
 	}
@@ -5387,9 +5959,11 @@ CL_Download_f
 */
 static void CL_Download_f( void )
 {
+	int i;
+
 	if ( Cmd_Argc() < 2 || *Cmd_Argv( 1 ) == '\0' )
 	{
-		Com_Printf( "usage: %s <mapname>\n", Cmd_Argv( 0 ) );
+		Com_Printf( "usage: %s <mapname> [mapname ...]\n", Cmd_Argv( 0 ) );
 		return;
 	}
 
@@ -5399,7 +5973,10 @@ static void CL_Download_f( void )
 		return;
 	}
 
-	CL_Download( Cmd_Argv( 0 ), Cmd_Argv( 1 ), qfalse );
+	for ( i = 1; i < Cmd_Argc(); i++ )
+	{
+		CL_Download( Cmd_Argv( 0 ), Cmd_Argv( i ), qfalse );
+	}
 }
 #endif // USE_CURL
 
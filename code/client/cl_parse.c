@@ -64,20 +64,49 @@ MESSAGE PARSING
 =========================================================================
 */
 
+/*
+==================
+CL_MergedEntity
+
+Multiview player entities are merged with their playerstate after
+parsing, so they can't share the state of the delta frame
+==================
+*/
+static qboolean CL_MergedEntity( const clSnapshot_t *frame, int num ) {
+#ifdef USE_MV
+	if ( frame->multiview && frame->mergeMask && num < MAX_CLIENTS && frame->clps[ num ].valid ) {
+		return qtrue;
+	}
+#endif
+	return qfalse;
+}
+
+
 /*
 ==================
 CL_DeltaEntity
 
 Parses deltas from the given base and adds the resulting entity
-to the current frame
+to the current frame, oldState is the state index of an unchanged one
 ==================
 */
-static void CL_DeltaEntity( msg_t *msg, clSnapshot_t *frame, int newnum, const entityState_t *old, qboolean unchanged) {
+static void CL_DeltaEntity( msg_t *msg, clSnapshot_t *frame, int newnum, const entityState_t *old, int oldState, qboolean unchanged ) {
 	entityState_t	*state;
+	int				*ent;
+
+	ent = &cl.parseEntities[cl.parseEntitiesNum & (MAX_PARSE_ENTITIES-1)];
+
+	// reference the state of the delta frame if it will outlive this frame
+	if ( unchanged && cl.parseStatesNum - oldState < MAX_PARSE_ENTITIES && !CL_MergedEntity( frame, newnum ) ) {
+		*ent = oldState;
+		cl.parseEntitiesNum++;
+		frame->numEntities++;
+		return;
+	}
 
 	// save the parsed entity state into the big circular buffer so
 	// it can be used as the source for a later delta
-	state = &cl.parseEntities[cl.parseEntitiesNum & (MAX_PARSE_ENTITIES-1)];
+	state = &cl.parseStates[cl.parseStatesNum & (MAX_PARSE_STATES-1)];
 
 	if ( unchanged ) {
 		*state = *old;
@@ -88,8 +117,10 @@ static void CL_DeltaEntity( msg_t *msg, clSnapshot_t *frame, int newnum, const e
 	if ( state->number == (MAX_GENTITIES-1) ) {
 		return;		// entity was delta removed
 	}
+	*ent = cl.parseStatesNum++;
 	cl.parseEntitiesNum++;
 	frame->numEntities++;
+	frame->numParsedStates++;
 }
 
 
@@ -101,22 +132,24 @@ CL_ParsePacketEntities
 static void CL_ParsePacketEntities( msg_t *msg, const clSnapshot_t *oldframe, clSnapshot_t *newframe ) {
 	const entityState_t	*oldstate;
 	int	newnum;
-	int	oldindex, oldnum;
+	int	oldindex, oldnum, oldref;
 
 	newframe->parseEntitiesNum = cl.parseEntitiesNum;
 	newframe->numEntities = 0;
+	newframe->numParsedStates = 0;
 
 	// delta from the entities present in oldframe
 	oldindex = 0;
 	oldstate = NULL;
+	oldref = 0;
 	if ( !oldframe ) {
 		oldnum = MAX_GENTITIES+1;
 	} else {
 		if ( oldindex >= oldframe->numEntities ) {
 			oldnum = MAX_GENTITIES+1;
 		} else {
-			oldstate = &cl.parseEntities[
-				(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+			oldref = cl.parseEntities[(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+			oldstate = &cl.parseStates[oldref & (MAX_PARSE_STATES-1)];
 			oldnum = oldstate->number;
 		}
 	}
@@ -138,15 +171,15 @@ static void CL_ParsePacketEntities( msg_t *msg, const clSnapshot_t *oldframe, cl
 			if ( cl_shownet->integer == 3 ) {
 				Com_Printf ("%3i:  unchanged: %i\n", msg->readcount, oldnum);
 			}
-			CL_DeltaEntity( msg, newframe, oldnum, oldstate, qtrue );
+			CL_DeltaEntity( msg, newframe, oldnum, oldstate, oldref, qtrue );
 
 			oldindex++;
 
 			if ( oldindex >= oldframe->numEntities ) {
 				oldnum = MAX_GENTITIES+1;
 			} else {
-				oldstate = &cl.parseEntities[
-					(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+				oldref = cl.parseEntities[(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+				oldstate = &cl.parseStates[oldref & (MAX_PARSE_STATES-1)];
 				oldnum = oldstate->number;
 			}
 		}
@@ -155,15 +188,15 @@ static void CL_ParsePacketEntities( msg_t *msg, const clSnapshot_t *oldframe, cl
 			if ( cl_shownet->integer == 3 ) {
 				Com_Printf ("%3i:  delta: %i\n", msg->readcount, newnum);
 			}
-			CL_DeltaEntity( msg, newframe, newnum, oldstate, qfalse );
+			CL_DeltaEntity( msg, newframe, newnum, oldstate, oldref, qfalse );
 
 			oldindex++;
 
 			if ( oldindex >= oldframe->numEntities ) {
 				oldnum = MAX_GENTITIES+1;
 			} else {
-				oldstate = &cl.parseEntities[
-					(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+				oldref = cl.parseEntities[(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+				oldstate = &cl.parseStates[oldref & (MAX_PARSE_STATES-1)];
 				oldnum = oldstate->number;
 			}
 			continue;
@@ -174,7 +207,7 @@ static void CL_ParsePacketEntities( msg_t *msg, const clSnapshot_t *oldframe, cl
 			if ( cl_shownet->integer == 3 ) {
 				Com_Printf ("%3i:  baseline: %i\n", msg->readcount, newnum);
 			}
-			CL_DeltaEntity( msg, newframe, newnum, &cl.entityBaselines[newnum], qfalse );
+			CL_DeltaEntity( msg, newframe, newnum, &cl.entityBaselines[newnum], 0, qfalse );
 			continue;
 		}
 
@@ -186,15 +219,15 @@ static void CL_ParsePacketEntities( msg_t *msg, const clSnapshot_t *oldframe, cl
 		if ( cl_shownet->integer == 3 ) {
 			Com_Printf ("%3i:  unchanged: %i\n", msg->readcount, oldnum);
 		}
-		CL_DeltaEntity( msg, newframe, oldnum, oldstate, qtrue );
+		CL_DeltaEntity( msg, newframe, oldnum, oldstate, oldref, qtrue );
 
 		oldindex++;
 
 		if ( oldindex >= oldframe->numEntities ) {
 			oldnum = MAX_GENTITIES+1;
 		} else {
-			oldstate = &cl.parseEntities[
-				(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+			oldref = cl.parseEntities[(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES-1)];
+			oldstate = &cl.parseStates[oldref & (MAX_PARSE_STATES-1)];
 			oldnum = oldstate->number;
 		}
 	}
@@ -402,7 +435,7 @@ static void CL_ParseSnapshot( msg_t *msg, qboolean multiview ) {
 		// apply skipmask to player entities
 		if ( newSnap.mergeMask ) {
 			for ( i = 0; i < newSnap.numEntities; i++ ) {
-				es = &cl.parseEntities [ (newSnap.parseEntitiesNum + i) & (MAX_PARSE_ENTITIES-1)];
+				es = CL_PARSE_ENTITY( newSnap.parseEntitiesNum + i );
 				if ( es->number >= MAX_CLIENTS )
 					break;
 				if ( newSnap.clps[ es->number ].valid )
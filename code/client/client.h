@@ -59,6 +59,7 @@ typedef struct {
 
 	int				numEntities;			// all of the entities that need to be presented
 	int				parseEntitiesNum;		// at the time of this snapshot
+	int				numParsedStates;		// entity states written while parsing, the rest are shared
 
 	int				serverCommandNum;		// execute all commands up to this before
 											// making the snapshot current
@@ -105,6 +106,24 @@ typedef struct {
 #define	MAX_PARSE_ENTITIES	( PACKET_BACKUP * MAX_SNAPSHOT_ENTITIES )
 #endif
 
+// parsed entities only hold an index into the entity state buffer, an entity
+// unchanged from the delta frame shares its state as long as the state is newer
+// than the last MAX_PARSE_ENTITIES ones, so it outlives any frame referencing it
+#define	MAX_PARSE_STATES	( MAX_PARSE_ENTITIES * 2 )
+
+// entity state of a parsed entity, n is not anded off
+#define	CL_PARSE_ENTITY( n )	( &cl.parseStates[ cl.parseEntities[ (n) & (MAX_PARSE_ENTITIES-1) ] & (MAX_PARSE_STATES-1) ] )
+
+// entity states last handed to a cgame snapshot buffer
+typedef struct {
+	const snapshot_t	*snapshot;
+	int					lastUsed;
+	int					numStates;
+	int					states[MAX_ENTITIES_IN_SNAPSHOT];
+} cgameSnapshot_t;
+
+#define	MAX_CGAME_SNAPSHOTS	4
+
 extern int g_console_field_width;
 
 typedef struct {
@@ -126,6 +145,7 @@ typedef struct {
 	char		mapname[MAX_QPATH];	// extracted from CS_SERVERINFO
 
 	int			parseEntitiesNum;	// index (not anded off) into cl_parse_entities[]
+	int			parseStatesNum;		// index (not anded off) into parseStates[]
 
 	int			mouseDx[2], mouseDy[2];	// added to by mouse events
 	int			mouseIndex;
@@ -157,7 +177,11 @@ typedef struct {
 
 	entityState_t	entityBaselines[MAX_GENTITIES];	// for delta compression when not in previous frame
 
-	entityState_t	parseEntities[MAX_PARSE_ENTITIES];
+	int				parseEntities[MAX_PARSE_ENTITIES];	// parseStates index (not anded off)
+	entityState_t	parseStates[MAX_PARSE_STATES];
+
+	cgameSnapshot_t	cgameSnapshots[MAX_CGAME_SNAPSHOTS];
+	int				cgameSnapshotCount;
 
 	byte			baselineUsed[MAX_GENTITIES];
 } clientActive_t;
@@ -258,6 +282,7 @@ typedef struct {
 	int		timeDemoFrames;		// counter of rendered frames
 	int		timeDemoStart;		// cls.realtime before first frame
 	int		timeDemoBaseTime;	// each frame will be at this time + frameNum * 50
+	int		timeDemoCGameUsec;	// time spent in cgame rendering during current frame
 
 	float	aviVideoFrameRemainder;
 	float	aviSoundFrameRemainder;
@@ -429,11 +454,15 @@ extern	cvar_t	*cl_shownet;
 extern	cvar_t	*cl_autoNudge;
 extern	cvar_t	*cl_timeNudge;
 extern	cvar_t	*cl_showTimeDelta;
+extern	cvar_t	*cl_showSnapshotCopy;
+extern	cvar_t	*cl_snapshotReuse;
 
 extern	cvar_t	*com_timedemo;
 extern	cvar_t	*cl_aviFrameRate;
 extern	cvar_t	*cl_aviMotionJpeg;
 extern	cvar_t	*cl_aviPipeFormat;
+extern	cvar_t	*cl_aviQueueFrames;
+extern	cvar_t	*cl_aviQueueDrop;
 
 extern	cvar_t	*cl_activeAction;
 
@@ -441,12 +470,15 @@ extern	cvar_t	*cl_allowDownload;
 #ifdef USE_CURL
 extern	cvar_t	*cl_mapAutoDownload;
 extern	cvar_t	*cl_dlDirectory;
+extern	cvar_t	*cl_dlParallel;
 #endif
 extern	cvar_t	*cl_conXOffset;
 extern	cvar_t	*cl_inGameVideo;
 
 extern	cvar_t	*cl_lanForcePackets;
+extern	cvar_t	*cl_pingRate;
 extern	cvar_t	*cl_autoRecordDemo;
+extern	cvar_t	*cl_timedemoLog;
 
 #ifdef USE_AUTH
 extern  cvar_t	*cl_auth_engine;
@@ -488,6 +520,7 @@ void CL_StartHunkUsers( void );
 
 void CL_Disconnect_f( void );
 void CL_ReadDemoMessage( void );
+void CL_TimeDemoFrame( void );
 void CL_StopRecord_f( void );
 
 void CL_InitDownloads( void );
@@ -679,6 +712,7 @@ qboolean CL_VideoRecording( void );
 size_t	CL_SaveJPGToBuffer( byte *buffer, size_t bufSize, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 void	CL_SaveJPG( const char *filename, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 void	CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height );
+qboolean CL_DecodeJPG( const byte *data, int length, unsigned char **pic, int *width, int *height );
 
 // platform-specific
 void	GLimp_Init( glconfig_t *config );
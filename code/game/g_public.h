@@ -404,6 +404,7 @@ typedef enum {
 #endif
 
 	// engine extensions
+	BOTLIB_AAS_QUERY_BATCH,
 	G_TRAP_GETVALUE = COM_TRAP_GETVALUE
 
 } gameImport_t;
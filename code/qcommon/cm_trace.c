@@ -1363,7 +1363,11 @@ CM_BoxTrace
 void CM_BoxTrace( trace_t *results, const vec3_t start, const vec3_t end,
 						const vec3_t mins, const vec3_t maxs,
 						clipHandle_t model, int brushmask, qboolean capsule ) {
+	int64_t profileStart = PROFILE_START( PROFILE_DETAIL );
+
 	CM_Trace( results, start, end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL );
+
+	PROFILE_END( profileStart, "CM_BoxTrace", -1 );
 }
 
 
@@ -1390,6 +1394,9 @@ void CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t
 	float		halfheight;
 	float		t;
 	sphere_t	sphere;
+	int64_t		profileStart;
+
+	profileStart = PROFILE_START( PROFILE_DETAIL );
 
 	if ( !mins ) {
 		mins = vec3_origin;
@@ -1465,4 +1472,6 @@ void CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t
 	trace.endpos[2] = start[2] + trace.fraction * (end[2] - start[2]);
 
 	*results = trace;
+
+	PROFILE_END( profileStart, "CM_TransformedBoxTrace", -1 );
 }
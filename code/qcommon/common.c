@@ -3620,6 +3620,12 @@ void Com_Init( char *commandLine ) {
 	// done early so bind command exists
 	Com_InitKeyCommands();
 
+	// worker threads are used to scan pk3 files
+	Com_StartupVariable( "com_workerThreads" );
+	Com_InitJobs();
+
+	Com_InitProfile();
+
 	FS_InitFilesystem();
 
 	Com_InitJournaling();
@@ -3786,6 +3792,9 @@ void Com_Init( char *commandLine ) {
 		Sys_SetAffinityMask( com_affinityMask->integer );
 #endif
 
+	// apply worker count from configs
+	Com_InitJobs();
+
 	// Pick a random port value
 	Com_RandomBytes( (byte*)&qport, sizeof( qport ) );
 	Netchan_Init( qport & 0xffff );
@@ -4021,10 +4030,16 @@ void Com_Frame( qboolean noDelay ) {
 	int	timeBeforeClient;
 	int	timeAfter;
 
+	int64_t	profileFrame;
+	int64_t	profileStage;
+
 	if ( Q_setjmp( abortframe ) ) {
 		return;			// an ERR_DROP was thrown
 	}
 
+	Com_ProfileFrame();
+	profileFrame = PROFILE_START( PROFILE_FRAME );
+
 	minMsec = 0; // silent compiler warning
 
 	// bk001204 - init to zero.
@@ -4133,7 +4148,9 @@ void Com_Frame( qboolean noDelay ) {
 		timeBeforeServer = Sys_Milliseconds();
 	}
 
+	profileStage = PROFILE_START( PROFILE_FRAME );
 	SV_Frame( msec );
+	PROFILE_END( profileStage, "SV_Frame", -1 );
 
 	// if "dedicated" has been modified, start up
 	// or shut down the client system.
@@ -4193,7 +4210,9 @@ void Com_Frame( qboolean noDelay ) {
 			timeBeforeClient = Sys_Milliseconds();
 		}
 
+		profileStage = PROFILE_START( PROFILE_FRAME );
 		CL_Frame( msec, realMsec );
+		PROFILE_END( profileStage, "CL_Frame", -1 );
 
 		if ( com_speeds->integer ) {
 			timeAfter = Sys_Milliseconds();
@@ -4236,6 +4255,8 @@ void Com_Frame( qboolean noDelay ) {
 		c_pointcontents = 0;
 	}
 
+	PROFILE_END( profileFrame, "Com_Frame", com_frameNumber );
+
 	com_frameNumber++;
 }
 
@@ -4246,6 +4267,8 @@ Com_Shutdown
 =================
 */
 static void Com_Shutdown( void ) {
+	Com_ShutdownJobs();
+
 	if ( logfile != FS_INVALID_HANDLE ) {
 		FS_FCloseFile( logfile );
 		logfile = FS_INVALID_HANDLE;
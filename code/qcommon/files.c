@@ -221,10 +221,13 @@ static const unsigned pak_checksums[] = {
 
 #define USE_PK3_CACHE
 #define USE_PK3_CACHE_FILE
+#define USE_PK3_SCAN		// requires USE_PK3_CACHE
 
 #define USE_HANDLE_CACHE
 #define MAX_CACHED_HANDLES 384
 
+#define USE_FS_INDEX
+
 #define MAX_ZPATH			256
 #define MAX_FILEHASH_SIZE	4096
 
@@ -288,6 +291,7 @@ typedef struct searchpath_s {
 	pack_t		*pack;		// only one of pack / dir will be non NULL
 	directory_t	*dir;
 	dirPolicy_t	policy;
+	int			order;		// position in the file index search order
 } searchpath_t;
 
 static	char		fs_gamedir[MAX_OSPATH];	// this will be a single file name with no separators
@@ -914,6 +918,55 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 }
 
 
+/*
+===========
+FS_SV_FOpenFileAppend
+===========
+*/
+fileHandle_t FS_SV_FOpenFileAppend( const char *filename ) {
+	char *ospath;
+	fileHandle_t	f;
+	fileHandleData_t *fd;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !*filename ) {
+		return FS_INVALID_HANDLE;
+	}
+
+	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
+
+	f = FS_HandleForFile();
+	fd = &fsh[ f ];
+	FS_InitHandle( fd );
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_SV_FOpenFileAppend: %s\n", ospath );
+	}
+
+	FS_CheckFilenameIsNotAllowed( ospath, __func__, qtrue );
+
+	fd->handleFiles.file.o = Sys_FOpen( ospath, "ab" );
+	if ( !fd->handleFiles.file.o ) {
+		if ( FS_CreatePath( ospath ) ) {
+			return FS_INVALID_HANDLE;
+		}
+		fd->handleFiles.file.o = Sys_FOpen( ospath, "ab" );
+		if ( !fd->handleFiles.file.o ) {
+			return FS_INVALID_HANDLE;
+		}
+	}
+
+	Q_strncpyz( fd->name, filename, sizeof( fd->name ) );
+	fd->handleSync = qfalse;
+	fd->zipFile = qfalse;
+
+	return f;
+}
+
+
 /*
 ===========
 FS_SV_FOpenFileRead
@@ -997,6 +1050,85 @@ int FS_SV_FOpenFileRead( const char *filename, fileHandle_t *fp ) {
 }
 
 
+/*
+===========
+FS_SV_MapFile
+
+Maps a file found by FS_SV_FOpenFileRead read-only into memory,
+returns NULL if it is missing or can't be mapped
+===========
+*/
+const byte *FS_SV_MapFile( const char *filename, int *size ) {
+	static const byte empty[1];
+	const byte *data;
+	fileHandle_t f;
+	int len;
+
+	*size = 0;
+
+	len = FS_SV_FOpenFileRead( filename, &f );
+	if ( f == FS_INVALID_HANDLE ) {
+		return NULL;
+	}
+
+	if ( len > 0 ) {
+		data = Sys_MapFile( fsh[ f ].handleFiles.file.o, len );
+	} else {
+		data = empty;
+	}
+
+	// the mapping stays valid after the file is closed
+	FS_FCloseFile( f );
+
+	if ( data ) {
+		*size = len;
+	}
+
+	return data;
+}
+
+
+/*
+===========
+FS_SV_FileStats
+
+Size and modification time of the file FS_SV_FOpenFileRead would open
+===========
+*/
+qboolean FS_SV_FileStats( const char *filename, fileOffset_t *size, fileTime_t *mtime ) {
+	const char *paths[3];
+	fileTime_t ctime;
+	int i;
+
+	paths[0] = fs_homepath->string;
+	paths[1] = fs_basepath->string;
+	paths[2] = fs_steampath->string;
+
+	for ( i = 0; i < ARRAY_LEN( paths ); i++ ) {
+		if ( paths[i][0] && Sys_GetFileStats( FS_BuildOSPath( paths[i], filename, NULL ), size, mtime, &ctime ) ) {
+			return qtrue;
+		}
+	}
+
+	*size = 0;
+	*mtime = 0;
+
+	return qfalse;
+}
+
+
+/*
+===========
+FS_SV_UnmapFile
+===========
+*/
+void FS_SV_UnmapFile( const byte *data, int size ) {
+	if ( data && size > 0 ) {
+		Sys_UnmapFile( (void *)data, size );
+	}
+}
+
+
 /*
 ===========
 FS_SV_Rename
@@ -1541,1675 +1673,2747 @@ static int FS_OpenFileInPak( fileHandle_t *file, pack_t *pak, fileInPack_t *pakF
 }
 
 
+#ifdef USE_FS_INDEX
 /*
-===========
-FS_FOpenFileRead
+=================================================================================
 
-Finds the file in the search path.
-Returns filesize and an open FILE pointer.
-Used for streaming data out of either a
-separate file or a ZIP file.
-===========
+GLOBAL FILE INDEX
+
+Files of all loaded paks are kept in one hash table, so a lookup doesn't have
+to probe every pak in the search path. Entries are chained in search order and
+the first one passing the caller's pure/exclude check wins, directories are not
+indexed and only probed when they come before that pak. Pak files are also
+linked into a directory tree used by FS_ListFilteredFiles.
+
+Search paths added in front of the list are indexed in place, any other change
+drops the index and it is rebuilt on the next lookup.
+
+=================================================================================
 */
-extern qboolean		com_fullyInitialized;
 
-int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueFILE ) {
-	searchpath_t	*search;
-	char			*netpath;
-	pack_t			*pak;
-	fileInPack_t	*pakFile;
-	directory_t		*dir;
-	long			hash;
-	long			fullHash;
-	FILE			*temp;
-	int				length;
-	fileHandleData_t *f;
+#define FS_INDEX_BLOCK_SIZE 65536
+
+typedef struct fsIndexFile_s {
+	pack_t					*pak;
+	fileInPack_t			*file;
+	int						order;		// search order of the pak, lower is searched first
+	struct fsIndexFile_s	*next;		// next file in the hash chain
+	struct fsIndexFile_s	*nextInDir;	// next file in the same directory
+} fsIndexFile_t;
+
+typedef struct fsIndexDir_s {
+	const char				*name;		// last path component, not terminated
+	int						nameLen;
+	int						depth;		// number of path components
+	fsIndexFile_t			*files;
+	struct fsIndexDir_s		*children;
+	struct fsIndexDir_s		*sibling;
+} fsIndexDir_t;
+
+typedef struct fsIndexBlock_s {
+	struct fsIndexBlock_s	*next;
+	int						used;
+} fsIndexBlock_t;
+
+static struct {
+	qboolean		valid;
+	fsIndexFile_t	**hashTable;
+	int				hashSize;
+	int				numFiles;
+	int				minOrder;
+	searchpath_t	**dirs;				// directories in search order
+	int				numDirs;
+	int				maxDirs;
+	fsIndexDir_t	root;
+	fsIndexBlock_t	*blocks;
+} fs_index;
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
-	}
 
-	if ( !filename ) {
-		Com_Error( ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed\n" );
+/*
+=================
+FS_IndexFree
+=================
+*/
+static void FS_IndexFree( void ) {
+	fsIndexBlock_t *block, *next;
+
+	for ( block = fs_index.blocks; block; block = next ) {
+		next = block->next;
+		Z_Free( block );
 	}
 
-	// qpaths are not supposed to have a leading slash
-	if ( filename[0] == '/' || filename[0] == '\\' ) {
-		filename++;
+	if ( fs_index.hashTable ) {
+		Z_Free( fs_index.hashTable );
 	}
 
-	// make absolutely sure that it can't back up the path.
-	// The searchpaths do guarantee that something will always
-	// be prepended, so we don't need to worry about "c:" or "//limbo"
-	if ( FS_CheckDirTraversal( filename ) ) {
-		*file = FS_INVALID_HANDLE;
-		return -1;
+	if ( fs_index.dirs ) {
+		Z_Free( fs_index.dirs );
 	}
 
-	// we will calculate full hash only once then just mask it by current pack->hashSize
-	// we can do that as long as we know properties of our hash function
-	fullHash = FS_HashFileName( filename, 0U );
+	Com_Memset( &fs_index, 0, sizeof( fs_index ) );
+}
 
-	if ( file == NULL ) {
-		// just wants to see if file is there
-		for ( search = fs_searchpaths ; search ; search = search->next ) {
-			// is the element a pak file?
-			if ( search->pack && search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
-				// skip non-pure files
-				if ( !FS_PakIsPure( search->pack ) )
-					continue;
-				// look through all the pak file elements
-				pak = search->pack;
-				pakFile = pak->hashTable[hash];
-				do {
-					// case and separator insensitive comparisons
-					if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-						// found it!
-						return pakFile->size; 
-					}
-					pakFile = pakFile->next;
-				} while ( pakFile != NULL );
-			} else if ( search->dir && search->policy != DIR_DENY ) {
-				dir = search->dir;
-				netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
-				temp = Sys_FOpen( netpath, "rb" );
-				if ( temp ) {
-					length = FS_FileLength( temp );
-					fclose( temp );
-					return length;
-				}
-			}
-		}
-		return -1;
-	}
 
-	// make sure the q3key file is only readable by the quake3.exe at initialization
-	// any other time the key should only be accessed in memory using the provided functions
-	if ( com_fullyInitialized && strstr( filename, "q3key" ) ) {
-		*file = FS_INVALID_HANDLE;
-		return -1;
+/*
+=================
+FS_IndexAlloc
+=================
+*/
+static void *FS_IndexAlloc( int size ) {
+	fsIndexBlock_t *block;
+	byte *ptr;
+
+	size = PAD( size, sizeof( void * ) );
+	block = fs_index.blocks;
+
+	if ( !block || block->used + size > FS_INDEX_BLOCK_SIZE ) {
+		block = Z_Malloc( sizeof( *block ) + FS_INDEX_BLOCK_SIZE );
+		block->next = fs_index.blocks;
+		block->used = 0;
+		fs_index.blocks = block;
 	}
 
-	//
-	// search through the path, one element at a time
-	//
-	for ( search = fs_searchpaths ; search ; search = search->next ) {
-		// is the element a pak file?
-		if ( search->pack && search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
-			// disregard if it doesn't match one of the allowed pure pak files
-			if ( !FS_PakIsPure( search->pack ) ) {
-				continue;
-			}
-			// look through all the pak file elements
-			pak = search->pack;
-			pakFile = pak->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					// found it!
-					return FS_OpenFileInPak( file, pak, pakFile, uniqueFILE );
-				}
-				pakFile = pakFile->next;
-			} while ( pakFile != NULL );
-		} else if ( search->dir && search->policy != DIR_DENY ) {
-			// check a file in the directory tree
-			dir = search->dir;
+	ptr = (byte *)( block + 1 ) + block->used;
+	block->used += size;
 
-			netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
+	return ptr;
+}
 
-			temp = Sys_FOpen( netpath, "rb" );
-			if ( temp == NULL ) {
-				continue;
-			}
 
-			*file = FS_HandleForFile();
-			f = &fsh[ *file ];
-			FS_InitHandle( f );
+/*
+=================
+FS_IndexDirForFile
 
-			f->handleFiles.file.o = temp;
-			Q_strncpyz( f->name, filename, sizeof( f->name ) );
-			f->zipFile = qfalse;
+Returns the directory node of a (converted) pak file name
+=================
+*/
+static fsIndexDir_t *FS_IndexDirForFile( const char *name ) {
+	fsIndexDir_t *dir, *child;
+	const char *sep;
+	int len;
 
-			if ( fs_debug->integer ) {
-				Com_Printf( "FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
-					dir->path, dir->gamedir );
-			}
+	dir = &fs_index.root;
 
-			return FS_FileLength( f->handleFiles.file.o );
+	while ( ( sep = strchr( name, '/' ) ) != NULL ) {
+		len = (int)( sep - name );
+		for ( child = dir->children; child; child = child->sibling ) {
+			if ( child->nameLen == len && !memcmp( child->name, name, len ) ) {
+				break;
+			}
 		}
+		if ( !child ) {
+			child = FS_IndexAlloc( sizeof( *child ) );
+			Com_Memset( child, 0, sizeof( *child ) );
+			child->name = name;
+			child->nameLen = len;
+			child->depth = dir->depth + 1;
+			child->sibling = dir->children;
+			dir->children = child;
+		}
+		dir = child;
+		name = sep + 1;
 	}
 
-#ifdef FS_MISSING
-	if ( missingFiles ) {
-		fprintf( missingFiles, "%s\n", filename );
-	}
-#endif
-
-	*file = FS_INVALID_HANDLE;
-	return -1;
+	return dir;
 }
 
 
 /*
-===========
-FS_TouchFileInPak
-===========
+=================
+FS_IndexAddPak
+=================
 */
-void FS_TouchFileInPak( const char *filename ) {
-	const searchpath_t *search;
-	long			fullHash, hash;
-	pack_t			*pak;
-	fileInPack_t	*pakFile;
+static void FS_IndexAddPak( searchpath_t *search ) {
+	pack_t *pak = search->pack;
+	fsIndexFile_t *files, *f;
+	fsIndexDir_t *dir;
+	long hash;
+	int i;
 
-	fullHash = FS_HashFileName( filename, 0U );
+	files = FS_IndexAlloc( pak->numfiles * sizeof( *files ) );
 
-	for ( search = fs_searchpaths ; search ; search = search->next ) {
-		
-		// is the element a pak file?
-		if ( !search->pack )
-			continue;
-		
-		if ( search->pack->exclude ) // skip paks in \fs_excludeReference list
-			continue;
+	// same order as the pak hash chains, later duplicates first
+	for ( i = 0; i < pak->numfiles; i++ ) {
+		f = &files[i];
+		f->pak = pak;
+		f->file = &pak->buildBuffer[i];
+		f->order = search->order;
+		hash = FS_HashFileName( f->file->name, fs_index.hashSize );
+		f->next = fs_index.hashTable[ hash ];
+		fs_index.hashTable[ hash ] = f;
+	}
 
-		if ( search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
-			pak = search->pack;
-			pakFile = pak->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					// found it!
-					if ( !( pak->referenced & FS_GENERAL_REF ) && FS_GeneralRef( filename ) ) {
-						pak->referenced |= FS_GENERAL_REF;
-					}
-					if ( !( pak->referenced & FS_CGAME_REF ) && !strcmp( filename, "vm/cgame.qvm" ) ) {
-						pak->referenced |= FS_CGAME_REF;
-					}
-					if ( !( pak->referenced & FS_UI_REF ) && !strcmp( filename, "vm/ui.qvm" ) ) {
-						pak->referenced |= FS_UI_REF;
-					}
-					return;
-				}
-				pakFile = pakFile->next;
-			} while ( pakFile != NULL );
-		}
+	// directory lists keep the pak order for listings
+	for ( i = pak->numfiles - 1; i >= 0; i-- ) {
+		f = &files[i];
+		dir = FS_IndexDirForFile( f->file->name );
+		f->nextInDir = dir->files;
+		dir->files = f;
 	}
+
+	fs_index.numFiles += pak->numfiles;
 }
 
 
 /*
-===========
-FS_Home_FOpenFileRead
-===========
+=================
+FS_IndexAddDir
+=================
 */
-int FS_Home_FOpenFileRead( const char *filename, fileHandle_t *file ) 
-{
-	char path[ MAX_OSPATH*3 + 1 ];
-	fileHandleData_t *fd;
-	fileHandle_t f;	
-
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
-	}
-
-	// should never happen but for safe
-	if ( !file ) { 
-		return -1;
-	}
-
-	// allocate new file handle
-	f = FS_HandleForFile(); 
-	fd = &fsh[ f ];
-	FS_InitHandle( fd );
-
-	Com_sprintf( path, sizeof( path ), "%s%c%s%c%s", fs_homepath->string,
-		PATH_SEP, fs_gamedir, PATH_SEP, filename );
-
-	if ( fs_debug->integer ) {
-		Com_Printf( "%s: %s\n", __func__, path );
-	}
-
-	fd->handleFiles.file.o = Sys_FOpen( path, "rb" );
-	if ( fd->handleFiles.file.o != NULL ) {
-		Q_strncpyz( fd->name, filename, sizeof( fd->name ) );
-		fd->handleSync = qfalse;
-		fd->zipFile = qfalse;
-		*file = f;
-		return FS_FileLength( fd->handleFiles.file.o );
+static void FS_IndexAddDir( searchpath_t *search ) {
+	searchpath_t **dirs;
+
+	if ( fs_index.numDirs == fs_index.maxDirs ) {
+		fs_index.maxDirs = fs_index.maxDirs ? fs_index.maxDirs * 2 : 16;
+		dirs = Z_Malloc( fs_index.maxDirs * sizeof( dirs[0] ) );
+		if ( fs_index.dirs ) {
+			Com_Memcpy( dirs, fs_index.dirs, fs_index.numDirs * sizeof( dirs[0] ) );
+			Z_Free( fs_index.dirs );
+		}
+		fs_index.dirs = dirs;
 	}
 
-	*file = FS_INVALID_HANDLE;
-	return -1;
+	memmove( fs_index.dirs + 1, fs_index.dirs, fs_index.numDirs * sizeof( fs_index.dirs[0] ) );
+	fs_index.dirs[0] = search;
+	fs_index.numDirs++;
 }
 
+
 /*
 =================
-FS_Home_ListFilteredFiles
+FS_IndexBuild
 =================
 */
-char **FS_Home_ListFilteredFiles( const char *path, const char *extension, const char *filter, int *numfiles ) {
+static void FS_IndexBuild( void ) {
+	searchpath_t *search, **list;
+	int i, count, start;
 
-    const char *netpath;
+	start = Sys_Milliseconds();
 
-    if ( !fs_searchpaths ) {
-        Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
-    }
+	FS_IndexFree();
 
-    if ( !path ) {
-        *numfiles = 0;
-        return NULL;
-    }
+	count = 0;
+	for ( search = fs_searchpaths; search; search = search->next ) {
+		count++;
+	}
 
-    if ( !extension ) {
-        extension = "";
-    }
+	for ( fs_index.hashSize = 64; fs_index.hashSize < fs_packFiles; fs_index.hashSize <<= 1 )
+		;
 
-    netpath = FS_BuildOSPath( fs_homepath->string, fs_gamedir, path );
+	fs_index.hashTable = Z_Malloc( fs_index.hashSize * sizeof( fs_index.hashTable[0] ) );
+	list = Z_Malloc( ( count + 1 ) * sizeof( list[0] ) );
 
-    return Sys_ListFiles( netpath, extension, filter, numfiles, qfalse );
+	for ( i = 0, search = fs_searchpaths; search; search = search->next, i++ ) {
+		search->order = i;
+		list[i] = search;
+	}
+
+	// everything is prepended, so go from the end
+	for ( i = count - 1; i >= 0; i-- ) {
+		if ( list[i]->pack ) {
+			FS_IndexAddPak( list[i] );
+		} else if ( list[i]->dir ) {
+			FS_IndexAddDir( list[i] );
+		}
+	}
+
+	Z_Free( list );
+
+	fs_index.minOrder = 0;
+	fs_index.valid = qtrue;
+
+	if ( fs_debug && fs_debug->integer ) {
+		Com_Printf( "file index: %i files, %i directories, %i msec\n",
+			fs_index.numFiles, fs_index.numDirs, Sys_Milliseconds() - start );
+	}
 }
 
 
 /*
 =================
-FS_Home_FileSize
+FS_IndexAddSearchPath
+
+Called for every search path added in front of fs_searchpaths
 =================
 */
-int FS_Home_FileSize( const char *name ) {
+static void FS_IndexAddSearchPath( searchpath_t *search ) {
 
-    const char *ospath;
-    int length;
-    FILE *f;
-
-    if ( !fs_searchpaths ) {
-        Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
-    }
+	if ( !fs_index.valid ) {
+		return;
+	}
 
-    ospath = FS_BuildOSPath( fs_homepath->string, fs_gamedir, name );
+	// rebuild with a larger hash table
+	if ( search->pack && fs_index.numFiles + search->pack->numfiles > fs_index.hashSize * 2 ) {
+		FS_IndexFree();
+		return;
+	}
 
-    f = Sys_FOpen( ospath, "rb" );
-    if ( f ) {
-        length = FS_FileLength( f );
-        fclose( f );
-    } else {
-        length = -1;
-    }
+	search->order = --fs_index.minOrder;
 
-    return length;
+	if ( search->pack ) {
+		FS_IndexAddPak( search );
+	} else if ( search->dir ) {
+		FS_IndexAddDir( search );
+	}
 }
 
+
 /*
 =================
-FS_Read
+FS_IndexFind
 
-Properly handles partial reads
+Returns the next indexed pak file with the given name after prev
 =================
 */
-int FS_Read( void *buffer, int len, fileHandle_t f ) {
-	int		block, remaining;
-	int		read;
-	byte	*buf;
-	int		tries;
+static const fsIndexFile_t *FS_IndexFind( const char *filename, long fullHash, const fsIndexFile_t *prev ) {
+	const fsIndexFile_t *f;
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	if ( prev ) {
+		f = prev->next;
+	} else {
+		if ( !fs_index.valid ) {
+			FS_IndexBuild();
+		}
+		f = fs_index.hashTable[ fullHash & ( fs_index.hashSize - 1 ) ];
 	}
 
-	if ( f <= 0 || f >= MAX_FILE_HANDLES ) {
-		return 0;
+	for ( ; f; f = f->next ) {
+		// case and separator insensitive comparisons
+		if ( !FS_FilenameCompare( f->file->name, filename ) ) {
+			return f;
+		}
 	}
 
-	buf = (byte *)buffer;
-	fs_readCount += len;
+	return NULL;
+}
 
-	if ( !fsh[f].zipFile ) {
-		remaining = len;
-		tries = 0;
-		while (remaining) {
-			block = remaining;
-			read = fread( buf, 1, block, fsh[f].handleFiles.file.o );
-			if (read == 0) {
-				// we might have been trying to read from a CD, which
-				// sometimes returns a 0 read on windows
-				if (!tries) {
-					tries = 1;
-				} else {
-					return len-remaining;	//Com_Error (ERR_FATAL, "FS_Read: 0 bytes read");
-				}
-			}
 
-			if (read == -1) {
-				Com_Error (ERR_FATAL, "FS_Read: -1 bytes read");
-			}
+/*
+=================
+FS_IndexFindPure
 
-			remaining -= read;
-			buf += read;
+Returns the pak file FS_FOpenFileRead would use and the search order of it
+=================
+*/
+static const fsIndexFile_t *FS_IndexFindPure( const char *filename, long fullHash, int *order ) {
+	const fsIndexFile_t *f;
+
+	for ( f = FS_IndexFind( filename, fullHash, NULL ); f; f = FS_IndexFind( filename, fullHash, f ) ) {
+		// disregard if it doesn't match one of the allowed pure pak files
+		if ( FS_PakIsPure( f->pak ) ) {
+			break;
 		}
-		return len;
-	} else {
-		return unzReadCurrentFile( fsh[f].handleFiles.file.z, buffer, len );
 	}
+
+	*order = f ? f->order : INT_MAX;
+
+	return f;
 }
 
 
 /*
 =================
-FS_Write
-
-Properly handles partial writes
+FS_IndexCollectFiles
 =================
 */
-int FS_Write( const void *buffer, int len, fileHandle_t h ) {
-	int		block, remaining;
-	int		written;
-	byte	*buf;
-	int		tries;
-	FILE	*f;
+static void FS_IndexCollectFiles( const fsIndexDir_t *dir, int maxDepth, const fsIndexFile_t ***list, int *count, int *size ) {
+	const fsIndexFile_t *f, **newList;
+	const fsIndexDir_t *child;
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	if ( dir->depth > maxDepth ) {
+		return;
 	}
 
-	//if ( h <= 0 || h >= MAX_FILE_HANDLES ) {
-	//	return 0;
-	//}
-
-	f = FS_FileForHandle(h);
-	buf = (byte *)buffer;
-
-	remaining = len;
-	tries = 0;
-	while (remaining) {
-		block = remaining;
-		written = fwrite (buf, 1, block, f);
-		if (written == 0) {
-			if (!tries) {
-				tries = 1;
-			} else {
-				Com_Printf( "FS_Write: 0 bytes written\n" );
-				return 0;
+	for ( f = dir->files; f; f = f->nextInDir ) {
+		if ( *count == *size ) {
+			*size = *size ? *size * 2 : 1024;
+			newList = Z_Malloc( *size * sizeof( newList[0] ) );
+			if ( *list ) {
+				Com_Memcpy( newList, *list, *count * sizeof( newList[0] ) );
+				Z_Free( (void *)*list );
 			}
+			*list = newList;
 		}
-
-		if (written == -1) {
-			Com_Printf( "FS_Write: -1 bytes written\n" );
-			return 0;
-		}
-
-		remaining -= written;
-		buf += written;
+		(*list)[ (*count)++ ] = f;
 	}
-	if ( fsh[h].handleSync ) {
-		fflush( f );
+
+	for ( child = dir->children; child; child = child->sibling ) {
+		FS_IndexCollectFiles( child, maxDepth, list, count, size );
 	}
-	return len;
 }
 
-void QDECL FS_Printf( fileHandle_t h, const char *fmt, ... ) {
-	va_list		argptr;
-	char		msg[MAXPRINTMSG];
 
-	va_start (argptr,fmt);
-	Q_vsnprintf (msg, sizeof(msg), fmt, argptr);
-	va_end (argptr);
+static int QDECL FS_IndexCompareFiles( const void *a, const void *b ) {
+	const fsIndexFile_t *f1 = *(const fsIndexFile_t **)a;
+	const fsIndexFile_t *f2 = *(const fsIndexFile_t **)b;
 
-	FS_Write(msg, strlen(msg), h);
+	if ( f1->order != f2->order ) {
+		return f1->order - f2->order;
+	}
+
+	return (int)( f1->file - f2->file );
 }
 
-#define PK3_SEEK_BUFFER_SIZE 65536
 
 /*
 =================
-FS_Seek
+FS_IndexListFiles
 
+Returns pak files from all directories whose path starts with the given one,
+at most maxDepth levels deep, in search order. The caller frees the list.
 =================
 */
-int FS_Seek( fileHandle_t f, long offset, fsOrigin_t origin ) {
-	int		_origin;
+static int FS_IndexListFiles( const char *path, int pathLength, int maxDepth, const fsIndexFile_t ***list ) {
+	const fsIndexDir_t *dir, *child;
+	const char *end, *sep;
+	int len, count, size;
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
-		return -1;
-	}
+	*list = NULL;
+	count = size = 0;
 
-	if ( fsh[f].zipFile == qtrue ) {
-		//FIXME: this is really, really crappy
-		//(but better than what was here before)
-		byte	buffer[PK3_SEEK_BUFFER_SIZE];
-		int		remainder;
-		int		currentPosition = FS_FTell( f );
+	if ( !fs_index.valid ) {
+		FS_IndexBuild();
+	}
 
-		// change negative offsets into FS_SEEK_SET
-		if ( offset < 0 ) {
-			switch( origin ) {
-				case FS_SEEK_END:
-					remainder = fsh[f].zipFileLen + offset;
-					break;
+	dir = &fs_index.root;
+	end = path + pathLength;
 
-				case FS_SEEK_CUR:
-					remainder = currentPosition + offset;
+	if ( pathLength == 0 ) {
+		FS_IndexCollectFiles( dir, maxDepth, list, &count, &size );
+	} else {
+		for ( ;; ) {
+			for ( sep = path; sep < end && *sep != '/' && *sep != '\\'; sep++ )
+				;
+			len = (int)( sep - path );
+			if ( sep == end ) {
+				// last component is matched as a prefix
+				for ( child = dir->children; child; child = child->sibling ) {
+					if ( child->nameLen >= len && !Q_stricmpn( child->name, path, len ) ) {
+						FS_IndexCollectFiles( child, maxDepth, list, &count, &size );
+					}
+				}
+				break;
+			}
+			for ( child = dir->children; child; child = child->sibling ) {
+				if ( child->nameLen == len && !Q_stricmpn( child->name, path, len ) ) {
 					break;
-
-				case FS_SEEK_SET:
-				default:
-					remainder = 0;
-					break;
-			}
-
-			if ( remainder < 0 ) {
-				remainder = 0;
+				}
 			}
-
-			origin = FS_SEEK_SET;
-		} else {
-			if ( origin == FS_SEEK_END ) {
-				remainder = fsh[f].zipFileLen - currentPosition + offset;
-			} else {
-				remainder = offset;
+			if ( !child ) {
+				break;
 			}
+			dir = child;
+			path = sep + 1;
 		}
+	}
 
-		switch( origin ) {
-			case FS_SEEK_SET:
-				if ( remainder == currentPosition ) {
-					return offset;
-				}
-				unzSetCurrentFileInfoPosition( fsh[f].handleFiles.file.z, fsh[f].zipFilePos );
-				unzOpenCurrentFile( fsh[f].handleFiles.file.z );
-				//fallthrough
-
-			case FS_SEEK_END:
-			case FS_SEEK_CUR:
-				while( remainder > PK3_SEEK_BUFFER_SIZE ) {
-					FS_Read( buffer, PK3_SEEK_BUFFER_SIZE, f );
-					remainder -= PK3_SEEK_BUFFER_SIZE;
-				}
-				FS_Read( buffer, remainder, f );
-				return offset;
-
-			default:
-				Com_Error( ERR_FATAL, "Bad origin in FS_Seek" );
-				return -1;
-		}
-	} else {
-		FILE *file;
-		file = FS_FileForHandle( f );
-		switch( origin ) {
-		case FS_SEEK_CUR:
-			_origin = SEEK_CUR;
-			break;
-		case FS_SEEK_END:
-			_origin = SEEK_END;
-			break;
-		case FS_SEEK_SET:
-			_origin = SEEK_SET;
-			break;
-		default:
-			Com_Error( ERR_FATAL, "Bad origin in FS_Seek" );
-			return -1;
-		}
-
-		return fseek( file, offset, _origin );
+	if ( count > 1 ) {
+		qsort( (void *)*list, count, sizeof( (*list)[0] ), FS_IndexCompareFiles );
 	}
+
+	return count;
 }
+#endif // USE_FS_INDEX
 
 
 /*
-======================================================================================
-
-CONVENIENCE FUNCTIONS FOR ENTIRE FILES
+===========
+FS_FOpenFileRead
 
-======================================================================================
+Finds the file in the search path.
+Returns filesize and an open FILE pointer.
+Used for streaming data out of either a
+separate file or a ZIP file.
+===========
 */
+extern qboolean		com_fullyInitialized;
 
-qboolean FS_FileIsInPAK( const char *filename, int *pChecksum, char *pakName ) {
-	const searchpath_t	*search;
-	const pack_t		*pak;
-	const fileInPack_t	*pakFile;
+int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueFILE ) {
+	searchpath_t	*search;
+	char			*netpath;
+#ifdef USE_FS_INDEX
+	const fsIndexFile_t *found;
+	int				i, order;
+#else
+	pack_t			*pak;
+	fileInPack_t	*pakFile;
 	long			hash;
+#endif
+	directory_t		*dir;
 	long			fullHash;
+	FILE			*temp;
+	int				length;
+	fileHandleData_t *f;
 
 	if ( !fs_searchpaths ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
 
 	if ( !filename ) {
-		Com_Error( ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed" );
+		Com_Error( ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed\n" );
 	}
 
-	// qpaths are not supposed to have a leading slashes
-	while ( filename[0] == '/' || filename[0] == '\\' )
+	// qpaths are not supposed to have a leading slash
+	if ( filename[0] == '/' || filename[0] == '\\' ) {
 		filename++;
+	}
 
 	// make absolutely sure that it can't back up the path.
 	// The searchpaths do guarantee that something will always
-	// be prepended, so we don't need to worry about "c:" or "//limbo" 
+	// be prepended, so we don't need to worry about "c:" or "//limbo"
 	if ( FS_CheckDirTraversal( filename ) ) {
-		return qfalse;
+		*file = FS_INVALID_HANDLE;
+		return -1;
 	}
 
+	// we will calculate full hash only once then just mask it by current pack->hashSize
+	// we can do that as long as we know properties of our hash function
 	fullHash = FS_HashFileName( filename, 0U );
 
+#ifdef USE_FS_INDEX
+	// only directories before the first matching pure pak need to be checked
+	found = FS_IndexFindPure( filename, fullHash, &order );
+
+	if ( file == NULL ) {
+		// just wants to see if file is there
+		for ( i = 0 ; i < fs_index.numDirs && fs_index.dirs[i]->order < order ; i++ ) {
+			search = fs_index.dirs[i];
+			if ( search->policy == DIR_DENY )
+				continue;
+			dir = search->dir;
+			netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
+			temp = Sys_FOpen( netpath, "rb" );
+			if ( temp ) {
+				length = FS_FileLength( temp );
+				fclose( temp );
+				return length;
+			}
+		}
+		if ( found ) {
+			return found->file->size;
+		}
+		return -1;
+	}
+#else
+	if ( file == NULL ) {
+		// just wants to see if file is there
+		for ( search = fs_searchpaths ; search ; search = search->next ) {
+			// is the element a pak file?
+			if ( search->pack && search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
+				// skip non-pure files
+				if ( !FS_PakIsPure( search->pack ) )
+					continue;
+				// look through all the pak file elements
+				pak = search->pack;
+				pakFile = pak->hashTable[hash];
+				do {
+					// case and separator insensitive comparisons
+					if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
+						// found it!
+						return pakFile->size; 
+					}
+					pakFile = pakFile->next;
+				} while ( pakFile != NULL );
+			} else if ( search->dir && search->policy != DIR_DENY ) {
+				dir = search->dir;
+				netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
+				temp = Sys_FOpen( netpath, "rb" );
+				if ( temp ) {
+					length = FS_FileLength( temp );
+					fclose( temp );
+					return length;
+				}
+			}
+		}
+		return -1;
+	}
+#endif
+
+	// make sure the q3key file is only readable by the quake3.exe at initialization
+	// any other time the key should only be accessed in memory using the provided functions
+	if ( com_fullyInitialized && strstr( filename, "q3key" ) ) {
+		*file = FS_INVALID_HANDLE;
+		return -1;
+	}
+
+#ifdef USE_FS_INDEX
+	for ( i = 0 ; i < fs_index.numDirs && fs_index.dirs[i]->order < order ; i++ ) {
+		search = fs_index.dirs[i];
+		if ( search->policy == DIR_DENY ) {
+			continue;
+		}
+		// check a file in the directory tree
+		dir = search->dir;
+
+		netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
+
+		temp = Sys_FOpen( netpath, "rb" );
+		if ( temp == NULL ) {
+			continue;
+		}
+
+		*file = FS_HandleForFile();
+		f = &fsh[ *file ];
+		FS_InitHandle( f );
+
+		f->handleFiles.file.o = temp;
+		Q_strncpyz( f->name, filename, sizeof( f->name ) );
+		f->zipFile = qfalse;
+
+		if ( fs_debug->integer ) {
+			Com_Printf( "FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
+				dir->path, dir->gamedir );
+		}
+
+		return FS_FileLength( f->handleFiles.file.o );
+	}
+
+	if ( found ) {
+		return FS_OpenFileInPak( file, found->pak, found->file, uniqueFILE );
+	}
+#else
 	//
 	// search through the path, one element at a time
 	//
 	for ( search = fs_searchpaths ; search ; search = search->next ) {
-
 		// is the element a pak file?
 		if ( search->pack && search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
 			// disregard if it doesn't match one of the allowed pure pak files
-			//if ( !FS_PakIsPure( search->pack ) ) {
-			//	continue;
-			//}
-			//
-			if ( search->pack->exclude ) {
+			if ( !FS_PakIsPure( search->pack ) ) {
 				continue;
 			}
-
 			// look through all the pak file elements
 			pak = search->pack;
 			pakFile = pak->hashTable[hash];
 			do {
 				// case and separator insensitive comparisons
 				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					if ( pChecksum ) {
-						*pChecksum = pak->pure_checksum;
-					}
-					if ( pakName ) {
-						Com_sprintf( pakName, MAX_OSPATH, "%s/%s", pak->pakGamename, pak->pakBasename );
-					}
-					return qtrue;
+					// found it!
+					return FS_OpenFileInPak( file, pak, pakFile, uniqueFILE );
 				}
 				pakFile = pakFile->next;
 			} while ( pakFile != NULL );
-		}
-	}
-	return qfalse;
-}
+		} else if ( search->dir && search->policy != DIR_DENY ) {
+			// check a file in the directory tree
+			dir = search->dir;
 
+			netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
 
-/*
-============
-FS_ReadFile
+			temp = Sys_FOpen( netpath, "rb" );
+			if ( temp == NULL ) {
+				continue;
+			}
 
-Filename are relative to the quake search path
-a null buffer will just return the file length without loading
-============
-*/
-int FS_ReadFile( const char *qpath, void **buffer ) {
-	fileHandle_t	h;
-	byte*			buf;
-	qboolean		isConfig;
-	long			len;
+			*file = FS_HandleForFile();
+			f = &fsh[ *file ];
+			FS_InitHandle( f );
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+			f->handleFiles.file.o = temp;
+			Q_strncpyz( f->name, filename, sizeof( f->name ) );
+			f->zipFile = qfalse;
+
+			if ( fs_debug->integer ) {
+				Com_Printf( "FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
+					dir->path, dir->gamedir );
+			}
+
+			return FS_FileLength( f->handleFiles.file.o );
+		}
 	}
+#endif
 
-	if ( !qpath || !qpath[0] ) {
-		Com_Error( ERR_FATAL, "FS_ReadFile with empty name" );
+#ifdef FS_MISSING
+	if ( missingFiles ) {
+		fprintf( missingFiles, "%s\n", filename );
 	}
+#endif
 
-	buf = NULL;	// quiet compiler warning
-	isConfig = qfalse;
+	*file = FS_INVALID_HANDLE;
+	return -1;
+}
 
-	// if this is a .cfg file and we are playing back a journal, read
-	// it from the journal file
-	if ( com_journalDataFile != FS_INVALID_HANDLE && strstr( qpath, ".cfg" ) ) {
-		if ( com_journal->integer == 2 ) {
-			int		r;
 
-			Com_DPrintf( "Loading %s from journal file.\n", qpath );
-			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
-			if ( r != sizeof( len ) ) {
-				if (buffer != NULL) *buffer = NULL;
-				return -1;
-			}
-			// if the file didn't exist when the journal was created
-			if (!len) {
-				if (buffer == NULL) {
-					return 1;			// hack for old journal files
-				}
-				*buffer = NULL;
-				return -1;
-			}
-			if (buffer == NULL) {
-				return len;
-			}
-
-			buf = Hunk_AllocateTempMemory(len+1);
-			*buffer = buf;
-
-			r = FS_Read( buf, len, com_journalDataFile );
-			if ( r != len ) {
-				Com_Error( ERR_FATAL, "Read from journalDataFile failed" );
-			}
-
-			fs_loadCount++;
-			fs_loadStack++;
+/*
+===========
+FS_TouchFileInPak
+===========
+*/
+void FS_TouchFileInPak( const char *filename ) {
+#ifdef USE_FS_INDEX
+	const fsIndexFile_t *found;
+#else
+	const searchpath_t *search;
+	long			hash;
+	fileInPack_t	*pakFile;
+#endif
+	long			fullHash;
+	pack_t			*pak;
 
-			// guarantee that it will have a trailing 0 for string operations
-			buf[len] = '\0';
+	fullHash = FS_HashFileName( filename, 0U );
 
-			return len;
-		} else if ( com_journal->integer == 1 ) {
-			isConfig = qtrue;
+#ifdef USE_FS_INDEX
+	for ( found = FS_IndexFind( filename, fullHash, NULL ); found; found = FS_IndexFind( filename, fullHash, found ) ) {
+		pak = found->pak;
+		if ( pak->exclude ) // skip paks in \fs_excludeReference list
+			continue;
+		// found it!
+		if ( !( pak->referenced & FS_GENERAL_REF ) && FS_GeneralRef( filename ) ) {
+			pak->referenced |= FS_GENERAL_REF;
 		}
-	}
-
-	// look for it in the filesystem or pack files
-	len = FS_FOpenFileRead( qpath, &h, qfalse );
-	if ( h == FS_INVALID_HANDLE ) {
-		if ( buffer ) {
-			*buffer = NULL;
+		if ( !( pak->referenced & FS_CGAME_REF ) && !strcmp( filename, "vm/cgame.qvm" ) ) {
+			pak->referenced |= FS_CGAME_REF;
 		}
-		// if we are journalling and it is a config file, write a zero to the journal file
-		if ( isConfig ) {
-			Com_DPrintf( "Writing zero for %s to journal file.\n", qpath );
-			len = 0;
-			FS_Write( &len, sizeof( len ), com_journalDataFile );
-			FS_Flush( com_journalDataFile );
+		if ( !( pak->referenced & FS_UI_REF ) && !strcmp( filename, "vm/ui.qvm" ) ) {
+			pak->referenced |= FS_UI_REF;
 		}
-		return -1;
+		return;
 	}
+#else
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		
+		// is the element a pak file?
+		if ( !search->pack )
+			continue;
+		
+		if ( search->pack->exclude ) // skip paks in \fs_excludeReference list
+			continue;
 
-	if ( !buffer ) {
-		if ( isConfig ) {
-			Com_DPrintf( "Writing len for %s to journal file.\n", qpath );
-			FS_Write( &len, sizeof( len ), com_journalDataFile );
-			FS_Flush( com_journalDataFile );
+		if ( search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
+			pak = search->pack;
+			pakFile = pak->hashTable[hash];
+			do {
+				// case and separator insensitive comparisons
+				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
+					// found it!
+					if ( !( pak->referenced & FS_GENERAL_REF ) && FS_GeneralRef( filename ) ) {
+						pak->referenced |= FS_GENERAL_REF;
+					}
+					if ( !( pak->referenced & FS_CGAME_REF ) && !strcmp( filename, "vm/cgame.qvm" ) ) {
+						pak->referenced |= FS_CGAME_REF;
+					}
+					if ( !( pak->referenced & FS_UI_REF ) && !strcmp( filename, "vm/ui.qvm" ) ) {
+						pak->referenced |= FS_UI_REF;
+					}
+					return;
+				}
+				pakFile = pakFile->next;
+			} while ( pakFile != NULL );
 		}
-		FS_FCloseFile( h );
-		return len;
-	}
-
-	buf = Hunk_AllocateTempMemory( len + 1 );
-	*buffer = buf;
-
-	FS_Read( buf, len, h );
-
-	fs_loadCount++;
-	fs_loadStack++;
-
-	// guarantee that it will have a trailing 0 for string operations
-	buf[ len ] = '\0';
-	FS_FCloseFile( h );
-
-	// if we are journalling and it is a config file, write it to the journal file
-	if ( isConfig ) {
-		Com_DPrintf( "Writing %s to journal file.\n", qpath );
-		FS_Write( &len, sizeof( len ), com_journalDataFile );
-		FS_Write( buf, len, com_journalDataFile );
-		FS_Flush( com_journalDataFile );
 	}
-	return len;
+#endif
 }
 
 
 /*
-=============
-FS_FreeFile
-=============
+===========
+FS_Home_FOpenFileRead
+===========
 */
-void FS_FreeFile( void *buffer ) {
+int FS_Home_FOpenFileRead( const char *filename, fileHandle_t *file ) 
+{
+	char path[ MAX_OSPATH*3 + 1 ];
+	fileHandleData_t *fd;
+	fileHandle_t f;	
+
 	if ( !fs_searchpaths ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
-	if ( !buffer ) {
-		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
-	}
-	fs_loadStack--;
-
-	Hunk_FreeTempMemory( buffer );
 
-	// if all of our temp files are free, clear all of our space
-	if ( fs_loadStack == 0 ) {
-		Hunk_ClearTempMemory();
+	// should never happen but for safe
+	if ( !file ) { 
+		return -1;
 	}
-}
 
+	// allocate new file handle
+	f = FS_HandleForFile(); 
+	fd = &fsh[ f ];
+	FS_InitHandle( fd );
 
-/*
-============
-FS_WriteFile
-
-Filename are relative to the quake search path
-============
-*/
-void FS_WriteFile( const char *qpath, const void *buffer, int size ) {
-	fileHandle_t f;
-
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
-	}
+	Com_sprintf( path, sizeof( path ), "%s%c%s%c%s", fs_homepath->string,
+		PATH_SEP, fs_gamedir, PATH_SEP, filename );
 
-	if ( !qpath || !buffer ) {
-		Com_Error( ERR_FATAL, "FS_WriteFile: NULL parameter" );
+	if ( fs_debug->integer ) {
+		Com_Printf( "%s: %s\n", __func__, path );
 	}
 
-	f = FS_FOpenFileWrite( qpath );
-	if ( f == FS_INVALID_HANDLE ) {
-		Com_Printf( "Failed to open %s\n", qpath );
-		return;
+	fd->handleFiles.file.o = Sys_FOpen( path, "rb" );
+	if ( fd->handleFiles.file.o != NULL ) {
+		Q_strncpyz( fd->name, filename, sizeof( fd->name ) );
+		fd->handleSync = qfalse;
+		fd->zipFile = qfalse;
+		*file = f;
+		return FS_FileLength( fd->handleFiles.file.o );
 	}
 
-	FS_Write( buffer, size, f );
-
-	FS_FCloseFile( f );
+	*file = FS_INVALID_HANDLE;
+	return -1;
 }
 
-
-
 /*
-==========================================================================
-
-ZIP FILE LOADING
-
-==========================================================================
+=================
+FS_Home_ListFilteredFiles
+=================
 */
-static int FS_PakHashSize( const int filecount )
-{
-	int hashSize;
+char **FS_Home_ListFilteredFiles( const char *path, const char *extension, const char *filter, int *numfiles ) {
 
-	for ( hashSize = 2; hashSize < MAX_FILEHASH_SIZE; hashSize <<= 1 ) {
-		if ( hashSize >= filecount ) {
-			break;
-		}
-	}
+    const char *netpath;
 
-	return hashSize;
-}
+    if ( !fs_searchpaths ) {
+        Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+    }
 
+    if ( !path ) {
+        *numfiles = 0;
+        return NULL;
+    }
 
-/*
-============
-FS_BannedPakFile
+    if ( !extension ) {
+        extension = "";
+    }
 
-Check if file should NOT be added to hash search table
-============
-*/
-static qboolean FS_BannedPakFile( const char *filename )
-{
-	if ( !strcmp( filename, "autoexec.cfg" ) || !strcmp( filename, Q3CONFIG_CFG ) )
-		return qtrue;
-	else
-		return qfalse;
+    netpath = FS_BuildOSPath( fs_homepath->string, fs_gamedir, path );
+
+    return Sys_ListFiles( netpath, extension, filter, numfiles, qfalse );
 }
 
 
 /*
 =================
-FS_ConvertFilename
-
-lower case and replace '\\' ':' with '/'
+FS_Home_FileSize
 =================
 */
-static void FS_ConvertFilename( char *name )
-{
-	int c;
-	while ( (c = *name) != '\0' ) {
-		if ( c <= 'Z' && c >= 'A' ) {
-			*name = c - 'A' + 'a';
-		} else if ( c == '\\' || c == ':' ) {
-			*name = '/';
-		}
-		name++;
-	}
-}
+int FS_Home_FileSize( const char *name ) {
 
+    const char *ospath;
+    int length;
+    FILE *f;
 
-#ifdef USE_PK3_CACHE
+    if ( !fs_searchpaths ) {
+        Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+    }
 
-#define PK3_HASH_SIZE 512
+    ospath = FS_BuildOSPath( fs_homepath->string, fs_gamedir, name );
 
-static void FS_FreePak( pack_t *pak );
+    f = Sys_FOpen( ospath, "rb" );
+    if ( f ) {
+        length = FS_FileLength( f );
+        fclose( f );
+    } else {
+        length = -1;
+    }
+
+    return length;
+}
+
+/*
+=================
+FS_Read
+
+Properly handles partial reads
+=================
+*/
+int FS_Read( void *buffer, int len, fileHandle_t f ) {
+	int		block, remaining;
+	int		read;
+	byte	*buf;
+	int		tries;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( f <= 0 || f >= MAX_FILE_HANDLES ) {
+		return 0;
+	}
+
+	buf = (byte *)buffer;
+	fs_readCount += len;
+
+	if ( !fsh[f].zipFile ) {
+		remaining = len;
+		tries = 0;
+		while (remaining) {
+			block = remaining;
+			read = fread( buf, 1, block, fsh[f].handleFiles.file.o );
+			if (read == 0) {
+				// we might have been trying to read from a CD, which
+				// sometimes returns a 0 read on windows
+				if (!tries) {
+					tries = 1;
+				} else {
+					return len-remaining;	//Com_Error (ERR_FATAL, "FS_Read: 0 bytes read");
+				}
+			}
+
+			if (read == -1) {
+				Com_Error (ERR_FATAL, "FS_Read: -1 bytes read");
+			}
+
+			remaining -= read;
+			buf += read;
+		}
+		return len;
+	} else {
+		return unzReadCurrentFile( fsh[f].handleFiles.file.z, buffer, len );
+	}
+}
+
+
+/*
+=================
+FS_Write
+
+Properly handles partial writes
+=================
+*/
+int FS_Write( const void *buffer, int len, fileHandle_t h ) {
+	int		block, remaining;
+	int		written;
+	byte	*buf;
+	int		tries;
+	FILE	*f;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	//if ( h <= 0 || h >= MAX_FILE_HANDLES ) {
+	//	return 0;
+	//}
+
+	f = FS_FileForHandle(h);
+	buf = (byte *)buffer;
+
+	remaining = len;
+	tries = 0;
+	while (remaining) {
+		block = remaining;
+		written = fwrite (buf, 1, block, f);
+		if (written == 0) {
+			if (!tries) {
+				tries = 1;
+			} else {
+				Com_Printf( "FS_Write: 0 bytes written\n" );
+				return 0;
+			}
+		}
+
+		if (written == -1) {
+			Com_Printf( "FS_Write: -1 bytes written\n" );
+			return 0;
+		}
+
+		remaining -= written;
+		buf += written;
+	}
+	if ( fsh[h].handleSync ) {
+		fflush( f );
+	}
+	return len;
+}
+
+/*
+=================
+FS_WriteVec
+
+Writes a list of buffers under a single stream lock, safe to use
+from a thread other than the main one while the handle stays open
+=================
+*/
+int FS_WriteVec( const fsIOVec_t *vec, int count, fileHandle_t h ) {
+	FILE	*f;
+	int		i, total;
+
+	if ( h <= 0 || h >= MAX_FILE_HANDLES || fsh[h].zipFile ) {
+		return -1;
+	}
+
+	f = fsh[h].handleFiles.file.o;
+	if ( f == NULL ) {
+		return -1;
+	}
+
+	total = 0;
+#ifdef _WIN32
+	_lock_file( f );
+#else
+	flockfile( f );
+#endif
+	for ( i = 0; i < count; i++ ) {
+		if ( vec[i].len <= 0 ) {
+			continue;
+		}
+		if ( fwrite( vec[i].data, 1, vec[i].len, f ) != (size_t)vec[i].len ) {
+			total = -1;
+			break;
+		}
+		total += vec[i].len;
+	}
+#ifdef _WIN32
+	_unlock_file( f );
+#else
+	funlockfile( f );
+#endif
+
+	if ( total >= 0 && fsh[h].handleSync ) {
+		fflush( f );
+	}
+
+	return total;
+}
+
+
+void QDECL FS_Printf( fileHandle_t h, const char *fmt, ... ) {
+	va_list		argptr;
+	char		msg[MAXPRINTMSG];
+
+	va_start (argptr,fmt);
+	Q_vsnprintf (msg, sizeof(msg), fmt, argptr);
+	va_end (argptr);
+
+	FS_Write(msg, strlen(msg), h);
+}
+
+#define PK3_SEEK_BUFFER_SIZE 65536
+
+/*
+=================
+FS_Seek
+
+=================
+*/
+int FS_Seek( fileHandle_t f, long offset, fsOrigin_t origin ) {
+	int		_origin;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+		return -1;
+	}
+
+	if ( fsh[f].zipFile == qtrue ) {
+		//FIXME: this is really, really crappy
+		//(but better than what was here before)
+		byte	buffer[PK3_SEEK_BUFFER_SIZE];
+		int		remainder;
+		int		currentPosition = FS_FTell( f );
+
+		// change negative offsets into FS_SEEK_SET
+		if ( offset < 0 ) {
+			switch( origin ) {
+				case FS_SEEK_END:
+					remainder = fsh[f].zipFileLen + offset;
+					break;
+
+				case FS_SEEK_CUR:
+					remainder = currentPosition + offset;
+					break;
+
+				case FS_SEEK_SET:
+				default:
+					remainder = 0;
+					break;
+			}
+
+			if ( remainder < 0 ) {
+				remainder = 0;
+			}
+
+			origin = FS_SEEK_SET;
+		} else {
+			if ( origin == FS_SEEK_END ) {
+				remainder = fsh[f].zipFileLen - currentPosition + offset;
+			} else {
+				remainder = offset;
+			}
+		}
+
+		switch( origin ) {
+			case FS_SEEK_SET:
+				if ( remainder == currentPosition ) {
+					return offset;
+				}
+				unzSetCurrentFileInfoPosition( fsh[f].handleFiles.file.z, fsh[f].zipFilePos );
+				unzOpenCurrentFile( fsh[f].handleFiles.file.z );
+				//fallthrough
+
+			case FS_SEEK_END:
+			case FS_SEEK_CUR:
+				while( remainder > PK3_SEEK_BUFFER_SIZE ) {
+					FS_Read( buffer, PK3_SEEK_BUFFER_SIZE, f );
+					remainder -= PK3_SEEK_BUFFER_SIZE;
+				}
+				FS_Read( buffer, remainder, f );
+				return offset;
+
+			default:
+				Com_Error( ERR_FATAL, "Bad origin in FS_Seek" );
+				return -1;
+		}
+	} else {
+		FILE *file;
+		file = FS_FileForHandle( f );
+		switch( origin ) {
+		case FS_SEEK_CUR:
+			_origin = SEEK_CUR;
+			break;
+		case FS_SEEK_END:
+			_origin = SEEK_END;
+			break;
+		case FS_SEEK_SET:
+			_origin = SEEK_SET;
+			break;
+		default:
+			Com_Error( ERR_FATAL, "Bad origin in FS_Seek" );
+			return -1;
+		}
+
+		return fseek( file, offset, _origin );
+	}
+}
+
+
+/*
+======================================================================================
+
+CONVENIENCE FUNCTIONS FOR ENTIRE FILES
+
+======================================================================================
+*/
+
+qboolean FS_FileIsInPAK( const char *filename, int *pChecksum, char *pakName ) {
+#ifdef USE_FS_INDEX
+	const fsIndexFile_t	*found;
+#else
+	const searchpath_t	*search;
+	const fileInPack_t	*pakFile;
+	long			hash;
+#endif
+	const pack_t		*pak;
+	long			fullHash;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !filename ) {
+		Com_Error( ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed" );
+	}
+
+	// qpaths are not supposed to have a leading slashes
+	while ( filename[0] == '/' || filename[0] == '\\' )
+		filename++;
+
+	// make absolutely sure that it can't back up the path.
+	// The searchpaths do guarantee that something will always
+	// be prepended, so we don't need to worry about "c:" or "//limbo" 
+	if ( FS_CheckDirTraversal( filename ) ) {
+		return qfalse;
+	}
+
+	fullHash = FS_HashFileName( filename, 0U );
+
+#ifdef USE_FS_INDEX
+	for ( found = FS_IndexFind( filename, fullHash, NULL ); found; found = FS_IndexFind( filename, fullHash, found ) ) {
+		pak = found->pak;
+		if ( pak->exclude ) {
+			continue;
+		}
+		if ( pChecksum ) {
+			*pChecksum = pak->pure_checksum;
+		}
+		if ( pakName ) {
+			Com_sprintf( pakName, MAX_OSPATH, "%s/%s", pak->pakGamename, pak->pakBasename );
+		}
+		return qtrue;
+	}
+#else
+	//
+	// search through the path, one element at a time
+	//
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+
+		// is the element a pak file?
+		if ( search->pack && search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
+			// disregard if it doesn't match one of the allowed pure pak files
+			//if ( !FS_PakIsPure( search->pack ) ) {
+			//	continue;
+			//}
+			//
+			if ( search->pack->exclude ) {
+				continue;
+			}
+
+			// look through all the pak file elements
+			pak = search->pack;
+			pakFile = pak->hashTable[hash];
+			do {
+				// case and separator insensitive comparisons
+				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
+					if ( pChecksum ) {
+						*pChecksum = pak->pure_checksum;
+					}
+					if ( pakName ) {
+						Com_sprintf( pakName, MAX_OSPATH, "%s/%s", pak->pakGamename, pak->pakBasename );
+					}
+					return qtrue;
+				}
+				pakFile = pakFile->next;
+			} while ( pakFile != NULL );
+		}
+	}
+#endif
+	return qfalse;
+}
+
+
+/*
+============
+FS_FilePakChecksum
+
+Opens the file the same way FS_ReadFile() does, so pak reference flags
+are updated as well, and returns checksum of the pk3 it will be read from.
+Returns qfalse if the file doesn't exist or comes from a directory.
+============
+*/
+qboolean FS_FilePakChecksum( const char *filename, int *pChecksum ) {
+	fileHandle_t	f;
+	qboolean		inPak;
+
+	if ( FS_FOpenFileRead( filename, &f, qfalse ) < 0 || f == FS_INVALID_HANDLE ) {
+		return qfalse;
+	}
+
+	inPak = ( fsh[ f ].zipFile && fsh[ f ].pak );
+	if ( inPak && pChecksum ) {
+		*pChecksum = fsh[ f ].pak->checksum;
+	}
+
+	FS_FCloseFile( f );
+
+	return inPak;
+}
+
+
+/*
+============
+FS_ReadFile
+
+Filename are relative to the quake search path
+a null buffer will just return the file length without loading
+============
+*/
+int FS_ReadFile( const char *qpath, void **buffer ) {
+	fileHandle_t	h;
+	byte*			buf;
+	qboolean		isConfig;
+	long			len;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFile with empty name" );
+	}
+
+	buf = NULL;	// quiet compiler warning
+	isConfig = qfalse;
+
+	// if this is a .cfg file and we are playing back a journal, read
+	// it from the journal file
+	if ( com_journalDataFile != FS_INVALID_HANDLE && strstr( qpath, ".cfg" ) ) {
+		if ( com_journal->integer == 2 ) {
+			int		r;
+
+			Com_DPrintf( "Loading %s from journal file.\n", qpath );
+			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
+			if ( r != sizeof( len ) ) {
+				if (buffer != NULL) *buffer = NULL;
+				return -1;
+			}
+			// if the file didn't exist when the journal was created
+			if (!len) {
+				if (buffer == NULL) {
+					return 1;			// hack for old journal files
+				}
+				*buffer = NULL;
+				return -1;
+			}
+			if (buffer == NULL) {
+				return len;
+			}
+
+			buf = Hunk_AllocateTempMemory(len+1);
+			*buffer = buf;
+
+			r = FS_Read( buf, len, com_journalDataFile );
+			if ( r != len ) {
+				Com_Error( ERR_FATAL, "Read from journalDataFile failed" );
+			}
+
+			fs_loadCount++;
+			fs_loadStack++;
+
+			// guarantee that it will have a trailing 0 for string operations
+			buf[len] = '\0';
+
+			return len;
+		} else if ( com_journal->integer == 1 ) {
+			isConfig = qtrue;
+		}
+	}
+
+	// look for it in the filesystem or pack files
+	len = FS_FOpenFileRead( qpath, &h, qfalse );
+	if ( h == FS_INVALID_HANDLE ) {
+		if ( buffer ) {
+			*buffer = NULL;
+		}
+		// if we are journalling and it is a config file, write a zero to the journal file
+		if ( isConfig ) {
+			Com_DPrintf( "Writing zero for %s to journal file.\n", qpath );
+			len = 0;
+			FS_Write( &len, sizeof( len ), com_journalDataFile );
+			FS_Flush( com_journalDataFile );
+		}
+		return -1;
+	}
+
+	if ( !buffer ) {
+		if ( isConfig ) {
+			Com_DPrintf( "Writing len for %s to journal file.\n", qpath );
+			FS_Write( &len, sizeof( len ), com_journalDataFile );
+			FS_Flush( com_journalDataFile );
+		}
+		FS_FCloseFile( h );
+		return len;
+	}
+
+	buf = Hunk_AllocateTempMemory( len + 1 );
+	*buffer = buf;
+
+	FS_Read( buf, len, h );
+
+	fs_loadCount++;
+	fs_loadStack++;
+
+	// guarantee that it will have a trailing 0 for string operations
+	buf[ len ] = '\0';
+	FS_FCloseFile( h );
+
+	// if we are journalling and it is a config file, write it to the journal file
+	if ( isConfig ) {
+		Com_DPrintf( "Writing %s to journal file.\n", qpath );
+		FS_Write( &len, sizeof( len ), com_journalDataFile );
+		FS_Write( buf, len, com_journalDataFile );
+		FS_Flush( com_journalDataFile );
+	}
+	return len;
+}
+
+
+/*
+=============
+FS_FreeFile
+=============
+*/
+void FS_FreeFile( void *buffer ) {
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+	if ( !buffer ) {
+		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
+	}
+	fs_loadStack--;
+
+	Hunk_FreeTempMemory( buffer );
+
+	// if all of our temp files are free, clear all of our space
+	if ( fs_loadStack == 0 ) {
+		Hunk_ClearTempMemory();
+	}
+}
+
+
+/*
+============
+FS_WriteFile
+
+Filename are relative to the quake search path
+============
+*/
+void FS_WriteFile( const char *qpath, const void *buffer, int size ) {
+	fileHandle_t f;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !buffer ) {
+		Com_Error( ERR_FATAL, "FS_WriteFile: NULL parameter" );
+	}
+
+	f = FS_FOpenFileWrite( qpath );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( "Failed to open %s\n", qpath );
+		return;
+	}
+
+	FS_Write( buffer, size, f );
+
+	FS_FCloseFile( f );
+}
+
+
+
+/*
+==========================================================================
+
+ZIP FILE LOADING
+
+==========================================================================
+*/
+static int FS_PakHashSize( const int filecount )
+{
+	int hashSize;
+
+	for ( hashSize = 2; hashSize < MAX_FILEHASH_SIZE; hashSize <<= 1 ) {
+		if ( hashSize >= filecount ) {
+			break;
+		}
+	}
+
+	return hashSize;
+}
+
+
+/*
+============
+FS_BannedPakFile
+
+Check if file should NOT be added to hash search table
+============
+*/
+static qboolean FS_BannedPakFile( const char *filename )
+{
+	if ( !strcmp( filename, "autoexec.cfg" ) || !strcmp( filename, Q3CONFIG_CFG ) )
+		return qtrue;
+	else
+		return qfalse;
+}
+
+
+/*
+=================
+FS_ConvertFilename
+
+lower case and replace '\\' ':' with '/'
+=================
+*/
+static void FS_ConvertFilename( char *name )
+{
+	int c;
+	while ( (c = *name) != '\0' ) {
+		if ( c <= 'Z' && c >= 'A' ) {
+			*name = c - 'A' + 'a';
+		} else if ( c == '\\' || c == ':' ) {
+			*name = '/';
+		}
+		name++;
+	}
+}
+
+
+#ifdef USE_PK3_CACHE
+
+#define PK3_HASH_SIZE 512
+
+static void FS_FreePak( pack_t *pak );
 
 static pack_t *pakHashTable[ PK3_HASH_SIZE ];
 
-#ifdef USE_PK3_CACHE_FILE
+#ifdef USE_PK3_CACHE_FILE
+
+#define CACHE_FILE_NAME "pk3cache.dat"
+
+#define CACHE_SYNC_CONDITION ( fs_paksReaded - fs_paksAppended + fs_paksSkipped + fs_paksReleased >= 8 )
+
+static int fs_paksCached;	// readed from cache file
+static int fs_paksSkipped;	// outdated/non-existent cache file pk3 entries
+
+static int fs_paksReaded;	// actually readed from the disk
+static int fs_paksAppended;	// scanned paks already appended to the cache file
+static int fs_paksReleased;	// unreferenced paks since last FS restart
+
+static qboolean fs_cacheLoaded = qfalse;
+static qboolean fs_cacheSynced = qtrue;
+
+#pragma pack( push, 1 )
+
+// platform-specific 4-byte signature:
+// 0: [version] anything following depends from it
+// 1: [endianess] 0 - LSB, 1 - MSB
+// 2: [path separation] '/' or '\\'
+// 3: [size of file offset and file time]
+// non-matching header will cause whole file being ignored
+static const byte cache_header[ 4 ] = {
+	0, //version
+#ifdef Q3_LITTLE_ENDIAN
+	0x0,
+#else
+	0x1,
+#endif
+	PATH_SEP,
+	( ( sizeof( fileOffset_t ) - 1 ) << 4 ) | ( sizeof( fileTime_t ) - 1 )
+};
+
+typedef struct pk3cacheHeader_s {
+	int pakNameLen;		// full path
+	int namesLen;
+	int numFiles;
+	int numHeaderLongs; // including first uninitialized
+	int contentLen;
+	fileTime_t ctime;	// creation/status change time
+	fileTime_t mtime;	// modification time
+	fileOffset_t size;	// zip file size
+} pk3cacheHeader_t;
+
+typedef struct pk3cacheFileItem_s {
+	unsigned long name; // offset in namebuffer
+	unsigned long size;
+	unsigned long pos;	// info position in pk3 file
+} pk3cacheFileItem_t;
+
+#pragma pack( pop )
+
+#endif // USE_PK3_CACHE_FILE
+
+
+static int FS_HashPK3( const char *name )
+{
+	unsigned int c, hash = 0;
+	while ( (c = *name++) != '\0' )
+	{
+		hash = hash * 101 + c;
+	}
+	hash = hash ^ (hash >> 16);
+	return hash & (PK3_HASH_SIZE-1);
+}
+
+
+static pack_t *FS_FindInCache( const char *zipfile )
+{
+	pack_t *pack;
+	unsigned int hash;
+
+	hash = FS_HashPK3( zipfile );
+	pack = pakHashTable[ hash ];
+	while ( pack )
+	{
+		if ( !strcmp( zipfile, pack->pakFilename ) )
+		{
+			return pack;
+		}
+		pack = pack->next;
+	}
+
+	return NULL;
+}
+
+
+static void FS_AddToCache( pack_t *pack )
+{
+	pack->namehash = FS_HashPK3( pack->pakFilename );
+	pack->next = pakHashTable[ pack->namehash ];
+	pack->prev = NULL;
+	if ( pakHashTable[ pack->namehash ] )
+		pakHashTable[ pack->namehash ]->prev = pack;
+	pakHashTable[ pack->namehash ] = pack;
+}
+
+
+static void FS_RemoveFromCache( pack_t *pack )
+{
+	if ( !pack->next && !pack->prev && pakHashTable[ pack->namehash ] != pack )
+	{
+		Com_Error( ERR_FATAL, "Invalid pak link" );
+	} 
+
+	if ( pack->prev != NULL )
+		pack->prev->next = pack->next;
+	else
+		pakHashTable[ pack->namehash ] = pack->next;
+
+	if ( pack->next != NULL )
+		pack->next->prev = pack->prev;
+}
+
+
+static pack_t *FS_LoadCachedPK3( const char *zipfile )
+{
+	fileOffset_t size;
+	fileTime_t mtime;
+	fileTime_t ctime;
+	pack_t *pak;
+
+	pak = FS_FindInCache( zipfile );
+	if ( pak == NULL )
+		return NULL;
+	
+	if ( !Sys_GetFileStats( zipfile, &size, &mtime, &ctime ) )
+	{
+		FS_RemoveFromCache( pak );
+		FS_FreePak( pak );
+		return NULL;
+	}
+
+	if ( pak->size != size || pak->mtime != mtime || pak->ctime != ctime )
+	{
+		// release outdated information
+		FS_RemoveFromCache( pak );
+		FS_FreePak( pak );
+		return NULL;
+	}
+
+	return pak;
+}
+
+
+static void FS_InsertPK3ToCache( pack_t *pak )
+{
+	if ( Sys_GetFileStats( pak->pakFilename, &pak->size, &pak->mtime, &pak->ctime ) )
+	{
+		FS_AddToCache( pak );
+		pak->touched = qtrue;
+	}
+}
+
+
+static void FS_ResetCacheReferences( void )
+{
+	pack_t *pak;
+	int i;
+	for ( i = 0; i < ARRAY_LEN( pakHashTable ); i++ )
+	{
+		pak = pakHashTable[ i ];
+		while ( pak )
+		{
+			pak->touched = qfalse;
+			pak->referenced = 0;
+			pak = pak->next;
+		}
+	}
+}
+
+
+static void FS_FreeUnusedCache( void )
+{
+	pack_t *next, *pak;
+	int i;
+
+	for ( i = 0; i < ARRAY_LEN( pakHashTable ); i++ )
+	{
+		pak = pakHashTable[ i ];
+		while ( pak ) 
+		{
+			next = pak->next;
+			if ( !pak->touched )
+			{
+				FS_RemoveFromCache( pak );
+				FS_FreePak( pak );
+#ifdef USE_PK3_CACHE_FILE
+				fs_paksReleased++;
+#endif
+			}
+			pak = next;
+		}
+	}
+}
+
+#ifdef USE_PK3_CACHE_FILE
+
+static void FS_WriteCacheHeader( FILE *f )
+{
+	fwrite( cache_header, sizeof( cache_header ), 1, f );
+}
+
 
-#define CACHE_FILE_NAME "pk3cache.dat"
+static qboolean FS_ValidateCacheHeader( FILE *f )
+{
+	byte buf[ sizeof(cache_header) ];
 
-#define CACHE_SYNC_CONDITION ( fs_paksReaded + fs_paksSkipped + fs_paksReleased >= 8 )
+	if ( fread( buf, sizeof( buf ), 1, f ) != 1 )
+		return qfalse;
 
-static int fs_paksCached;	// readed from cache file
-static int fs_paksSkipped;	// outdated/non-existent cache file pk3 entries
+	if ( memcmp( buf, cache_header, sizeof( buf ) ) != 0 )
+		return qfalse;
 
-static int fs_paksReaded;	// actually readed from the disk
-static int fs_paksReleased;	// unreferenced paks since last FS restart
+	return qtrue;
+}
 
-static qboolean fs_cacheLoaded = qfalse;
-static qboolean fs_cacheSynced = qtrue;
 
-#pragma pack( push, 1 )
+static qboolean FS_SavePackToFile( const pack_t *pak, FILE *f )
+{
+	const char *namePtr;
+	const char *pakName;
+	int i, pakNameLen;
+	pk3cacheHeader_t pk;
+	pk3cacheFileItem_t it;
+	int namesLen, contentLen;
+	
+	namePtr = (char*)(pak->buildBuffer + pak->numfiles);
 
-// platform-specific 4-byte signature:
-// 0: [version] anything following depends from it
-// 1: [endianess] 0 - LSB, 1 - MSB
-// 2: [path separation] '/' or '\\'
-// 3: [size of file offset and file time]
-// non-matching header will cause whole file being ignored
-static const byte cache_header[ 4 ] = {
-	0, //version
-#ifdef Q3_LITTLE_ENDIAN
-	0x0,
-#else
-	0x1,
+	pakName = pak->pakFilename;
+	pakNameLen = (int) strlen( pakName ) + 1;
+	pakNameLen = PAD( pakNameLen, sizeof( int ) );
+
+	namesLen = pakName - namePtr;
+
+	// file content length
+	contentLen = 0;
+#if 0
+	for ( i = 0; i < pak->numfiles; i++ )
+	{
+		if ( pak->buildBuffer[ i ].data && pak->buildBuffer[ i ].size ) 
+		{
+			contentLen += sizeof( int ) + PAD( pak->buildBuffer[ i ].size, sizeof( int ) );
+		}
+	}
 #endif
-	PATH_SEP,
-	( ( sizeof( fileOffset_t ) - 1 ) << 4 ) | ( sizeof( fileTime_t ) - 1 )
-};
 
-typedef struct pk3cacheHeader_s {
-	int pakNameLen;		// full path
-	int namesLen;
-	int numFiles;
-	int numHeaderLongs; // including first uninitialized
-	int contentLen;
-	fileTime_t ctime;	// creation/status change time
-	fileTime_t mtime;	// modification time
-	fileOffset_t size;	// zip file size
-} pk3cacheHeader_t;
+	// pak filename length
+	pk.pakNameLen = pakNameLen;
+	// filenames length
+	pk.namesLen = namesLen;
+	// number of files
+	pk.numFiles = pak->numfiles;
+	// number of checksums
+	pk.numHeaderLongs = pak->numHeaderLongs;
+	// content of some files
+	pk.contentLen = contentLen;
+	// creation/status change time
+	pk.ctime = pak->ctime;
+	// modification time
+	pk.mtime = pak->mtime;
+	// pak file size
+	pk.size = pak->size;
 
-typedef struct pk3cacheFileItem_s {
-	unsigned long name; // offset in namebuffer
-	unsigned long size;
-	unsigned long pos;	// info position in pk3 file
-} pk3cacheFileItem_t;
+	// dump header
+	fwrite( &pk, sizeof( pk ), 1, f );
 
-#pragma pack( pop )
+	// pak filename
+	fwrite( pakName, pakNameLen, 1, f );
 
-#endif // USE_PK3_CACHE_FILE
+	// filenames
+	fwrite( namePtr, namesLen, 1, f );
 
+	// file entries
+	for ( i = 0; i < pak->numfiles; i++ )
+	{
+		it.name = (unsigned long)(pak->buildBuffer[i].name - namePtr);
+		it.size = pak->buildBuffer[i].size;
+		it.pos = pak->buildBuffer[i].pos;
+		fwrite( &it, sizeof( it ), 1, f );
+	}
 
-static int FS_HashPK3( const char *name )
-{
-	unsigned int c, hash = 0;
-	while ( (c = *name++) != '\0' )
+	// pure checksums, excluding first uninitialized
+	fwrite( pak->headerLongs + 1, (pak->numHeaderLongs - 1) * sizeof( pak->headerLongs[0] ), 1, f );
+
+#if 0
+	if ( contentLen )
 	{
-		hash = hash * 101 + c;
+		const fileInPack_t *currFile = pak->buildBuffer;
+		for ( i = 0; i < pak->numfiles; i++, currFile++ )
+		{
+			if ( currFile->data && currFile->size ) {
+				// file index
+				fwrite( &i, sizeof( i ), 1, f );
+				// file data
+				fwrite( currFile->data, PAD( currFile->size, sizeof( int ) ), 1, f );
+			}
+		}
 	}
-	hash = hash ^ (hash >> 16);
-	return hash & (PK3_HASH_SIZE-1);
+#endif
+
+	return qtrue;
 }
 
 
-static pack_t *FS_FindInCache( const char *zipfile )
+static qboolean FS_LoadPakFromFile( FILE *f )
 {
+	fileTime_t ctime, mtime;
+	fileOffset_t fsize;
+	fileInPack_t *curFile;
+	char pakName[ PAD( MAX_OSPATH*3+1, sizeof( int ) ) ];
+	char pakBase[ PAD( MAX_OSPATH, sizeof( int ) ) ], *basename;
+	char *filename_inzip;
+	pk3cacheHeader_t pk;
+	pk3cacheFileItem_t it;
 	pack_t *pack;
-	unsigned int hash;
+	char *namePtr;
+	int size, i;
+	int pakBaseLen;
+	int hashSize;
+	long hash;
 
-	hash = FS_HashPK3( zipfile );
-	pack = pakHashTable[ hash ];
-	while ( pack )
+	if ( fread( &pk, sizeof( pk ), 1, f ) != 1 )
+		return qfalse; // probably EOF
+
+	/// validate header data
+
+	if ( pk.pakNameLen > sizeof( pakName ) || pk.pakNameLen & 3 || pk.pakNameLen == 0 )
 	{
-		if ( !strcmp( zipfile, pack->pakFilename ) )
+		//Com_Printf( "bad pakNameLen: %08X\n", pk.pakNameLen );
+		return qfalse;
+	}
+
+	if ( pk.namesLen & 3 || pk.namesLen < pk.numFiles )
+	{
+		//Com_Printf( "bad namesLen: %i\n", pk.namesLen );
+		return qfalse;
+	}
+
+	if ( pk.numHeaderLongs == 0 || pk.numHeaderLongs > pk.numFiles + 1 )
+	{
+		//Com_Printf( "bad numHeaderLongs: %i\n", pk.numHeaderLongs );
+		return qfalse;
+	}
+
+	if ( pk.contentLen & 3 || pk.contentLen < 0 )
+	{
+		//Com_Printf( "bad contentLen: %i\n", pk.contentLen );
+		return qfalse;
+	}
+
+	// load filename
+	if ( fread( pakName, pk.pakNameLen, 1, f ) != 1 )
+	{
+		//Com_Printf( "error reading pakname\n" );
+		return qfalse;
+	}
+
+	// pakName must be zero-terminated
+	if ( pakName[ pk.pakNameLen - 1 ] != '\0' )
+	{
+		//Com_Printf( "pakname is not zero-terminated!\n" );
+		return qfalse;
+	}
+
+	if ( !Sys_GetFileStats( pakName, &fsize, &mtime, &ctime ) || fsize != pk.size || mtime != pk.mtime || ctime != pk.ctime )
+	{
+		const int seek_len = pk.namesLen + pk.numFiles * sizeof( it ) + (pk.numHeaderLongs-1) * sizeof( pack->headerLongs[0] ) + pk.contentLen;
+		if ( fseek( f, seek_len, SEEK_CUR ) != 0 )
 		{
-			return pack;
+			return qfalse;
+		}
+		else
+		{
+			fs_paksSkipped++;
+			return qtrue; // just outdated info, we can continue
 		}
-		pack = pack->next;
 	}
 
-	return NULL;
-}
+	// extract basename from zip path
+	basename = strrchr( pakName, PATH_SEP );
+	if ( basename == NULL )
+		basename = pakName;
+	else
+		basename++;
 
+	Q_strncpyz( pakBase, basename, sizeof( pakBase ) );
+	FS_StripExt( pakBase, ".pk3" );
+	pakBaseLen = (int) strlen( pakBase ) + 1;
+	pakBaseLen = PAD( pakBaseLen, sizeof( int ) );
 
-static void FS_AddToCache( pack_t *pack )
-{
-	pack->namehash = FS_HashPK3( pack->pakFilename );
-	pack->next = pakHashTable[ pack->namehash ];
-	pack->prev = NULL;
-	if ( pakHashTable[ pack->namehash ] )
-		pakHashTable[ pack->namehash ]->prev = pack;
-	pakHashTable[ pack->namehash ] = pack;
-}
+	hashSize = FS_PakHashSize( pk.numFiles );
 
+	size = sizeof( *pack ) + pk.namesLen + pk.numFiles * sizeof( pack->buildBuffer[0] );
+	size += hashSize * sizeof( pack->hashTable[0] );
+	size += pk.pakNameLen;
+	size += pakBaseLen;
+	size += pk.numHeaderLongs * sizeof( pack->headerLongs[0] );
 
-static void FS_RemoveFromCache( pack_t *pack )
-{
-	if ( !pack->next && !pack->prev && pakHashTable[ pack->namehash ] != pack )
-	{
-		Com_Error( ERR_FATAL, "Invalid pak link" );
-	} 
+	pack = Z_TagMalloc( size, TAG_PACK );
+	Com_Memset( pack, 0, size );
+
+	pack->mtime = pk.mtime;
+	pack->ctime = pk.ctime;
+	pack->size = pk.size;
+
+//	pack->handle = uf;
+	pack->numfiles = pk.numFiles;
+	pack->numHeaderLongs = pk.numHeaderLongs;
+
+	// setup memory layout
+	pack->hashSize = hashSize;
+	pack->hashTable = (fileInPack_t **)( pack + 1 );
 
-	if ( pack->prev != NULL )
-		pack->prev->next = pack->next;
-	else
-		pakHashTable[ pack->namehash ] = pack->next;
+	pack->buildBuffer = (fileInPack_t*)( pack->hashTable + pack->hashSize );
 
-	if ( pack->next != NULL )
-		pack->next->prev = pack->prev;
-}
+	namePtr = (char*)( pack->buildBuffer + pack->numfiles );
 
+	pack->pakFilename = (char*)( namePtr + pk.namesLen );
+	pack->pakBasename = (char*)( pack->pakFilename + pk.pakNameLen );
+	pack->headerLongs = (int*)( pack->pakBasename + pakBaseLen );
 
-static pack_t *FS_LoadCachedPK3( const char *zipfile )
-{
-	fileOffset_t size;
-	fileTime_t mtime;
-	fileTime_t ctime;
-	pack_t *pak;
+	strcpy( pack->pakFilename, pakName );
+	strcpy( pack->pakBasename, pakBase );
 
-	pak = FS_FindInCache( zipfile );
-	if ( pak == NULL )
-		return NULL;
-	
-	if ( !Sys_GetFileStats( zipfile, &size, &mtime, &ctime ) )
+	if ( fread( namePtr, pk.namesLen, 1, f ) != 1 )
 	{
-		FS_RemoveFromCache( pak );
-		FS_FreePak( pak );
-		return NULL;
+		//Com_Printf( "error reading pak filenames\n" );
+		goto __error;
 	}
 
-	if ( pak->size != size || pak->mtime != mtime || pak->ctime != ctime )
+	// filenames buffer must be zero-terminated
+	if ( namePtr[ pk.namesLen - 1 ] != '\0' )
 	{
-		// release outdated information
-		FS_RemoveFromCache( pak );
-		FS_FreePak( pak );
-		return NULL;
+		//Com_Printf( "not zero terminated filenames\n" );
+		goto __error;
 	}
 
-	return pak;
-}
+	curFile = pack->buildBuffer;
+	for ( i = 0; i < pk.numFiles; i++ )
+	{
+		if ( fread( &it, sizeof( it ), 1, f ) != 1 )
+		{
+			//Com_Printf( "error reading file item[%i]\n", i );
+			goto __error;
+		}
+		if ( it.name >= pk.namesLen )
+		{
+			//Com_Printf( "bad name offset: %i (expecting less than %i)\n", it.name, pk.namesLen );
+			goto __error;
+		}
 
+		filename_inzip = namePtr + it.name;
+		FS_ConvertFilename( filename_inzip );
+		if ( !FS_BannedPakFile( filename_inzip ) ) {
+			// store the file position in the zip
+			curFile->name = filename_inzip;
+			curFile->size = it.size;
+			curFile->pos = it.pos;
 
-static void FS_InsertPK3ToCache( pack_t *pak )
-{
-	if ( Sys_GetFileStats( pak->pakFilename, &pak->size, &pak->mtime, &pak->ctime ) )
-	{
-		FS_AddToCache( pak );
-		pak->touched = qtrue;
+			// update hash table
+			hash = FS_HashFileName( filename_inzip, pack->hashSize );
+			curFile->next = pack->hashTable[ hash ];
+			pack->hashTable[ hash ] = curFile;
+			curFile++;
+		} else {
+			pack->numfiles--;
+		}
 	}
-}
-
 
-static void FS_ResetCacheReferences( void )
-{
-	pack_t *pak;
-	int i;
-	for ( i = 0; i < ARRAY_LEN( pakHashTable ); i++ )
+	// paks with empty files only have no checksums
+	if ( pack->numHeaderLongs > 1 && fread( pack->headerLongs + 1, ( pack->numHeaderLongs - 1 ) * sizeof( pack->headerLongs[0] ), 1, f ) != 1 )
 	{
-		pak = pakHashTable[ i ];
-		while ( pak )
-		{
-			pak->touched = qfalse;
-			pak->referenced = 0;
-			pak = pak->next;
-		}
+		//Com_Printf( "error reading headerLongs\n" );
+		goto __error;
 	}
-}
 
+	pack->checksumFeed = fs_checksumFeed;
+	pack->headerLongs[ 0 ] = LittleLong( fs_checksumFeed );
 
-static void FS_FreeUnusedCache( void )
-{
-	pack_t *next, *pak;
-	int i;
+	pack->checksum = Com_BlockChecksum( pack->headerLongs + 1, sizeof( pack->headerLongs[0] ) * ( pack->numHeaderLongs - 1 ) );
+	pack->checksum = LittleLong( pack->checksum );
 
-	for ( i = 0; i < ARRAY_LEN( pakHashTable ); i++ )
+	pack->pure_checksum = Com_BlockChecksum( pack->headerLongs, sizeof( pack->headerLongs[0] ) * pack->numHeaderLongs );
+	pack->pure_checksum = LittleLong( pack->pure_checksum );
+
+	// seek through unused content
+	if ( pk.contentLen > 0 )
 	{
-		pak = pakHashTable[ i ];
-		while ( pak ) 
-		{
-			next = pak->next;
-			if ( !pak->touched )
-			{
-				FS_RemoveFromCache( pak );
-				FS_FreePak( pak );
-#ifdef USE_PK3_CACHE_FILE
-				fs_paksReleased++;
-#endif
-			}
-			pak = next;
-		}
+		if ( fseek( f, pk.contentLen, SEEK_CUR ) != 0 )
+			goto __error;
+	}
+	else if ( pk.contentLen < 0 )
+	{
+		goto __error;
 	}
-}
 
-#ifdef USE_PK3_CACHE_FILE
+	fs_paksCached++;
 
-static void FS_WriteCacheHeader( FILE *f )
-{
-	fwrite( cache_header, sizeof( cache_header ), 1, f );
+	FS_InsertPK3ToCache( pack );
+
+	return qtrue;
+
+__error:
+	FS_FreePak( pack );
+	return qfalse;
 }
 
 
-static qboolean FS_ValidateCacheHeader( FILE *f )
+/*
+============
+FS_SaveCache
+
+Called at th end of FS_Startup() after releasing unused paks
+============
+*/
+static qboolean FS_SaveCache( void )
 {
-	byte buf[ sizeof(cache_header) ];
+	const char *filename = CACHE_FILE_NAME;
+	const char *ospath;
+	const searchpath_t *sp;
+	FILE *f;
 
-	if ( fread( buf, sizeof( buf ), 1, f ) != 1 )
+	if ( !fs_searchpaths )
 		return qfalse;
 
-	if ( memcmp( buf, cache_header, sizeof( buf ) ) != 0 )
-		return qfalse;
+	if ( !fs_cacheLoaded )
+	{
+		Com_DPrintf( "synced FS cache on startup\n" );
+		fs_cacheSynced = qfalse;
+		fs_cacheLoaded = qtrue;
+	}
+	else if ( CACHE_SYNC_CONDITION )
+	{
+		Com_DPrintf( "synced FS cache on readed=%i, released=%i, skipped=%i\n",
+			fs_paksReaded, fs_paksReleased, fs_paksSkipped );
+		fs_cacheSynced = qfalse;
+	}
 
-	return qtrue;
-}
+	if ( fs_cacheSynced )
+		return qtrue;
 
+	sp = fs_searchpaths;
 
-static qboolean FS_SavePackToFile( const pack_t *pak, FILE *f )
-{
-	const char *namePtr;
-	const char *pakName;
-	int i, pakNameLen;
-	pk3cacheHeader_t pk;
-	pk3cacheFileItem_t it;
-	int namesLen, contentLen;
-	
-	namePtr = (char*)(pak->buildBuffer + pak->numfiles);
+	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
 
-	pakName = pak->pakFilename;
-	pakNameLen = (int) strlen( pakName ) + 1;
-	pakNameLen = PAD( pakNameLen, sizeof( int ) );
+	f = Sys_FOpen( ospath, "wb" );
+	if ( f == NULL )
+		return qfalse;
 
-	namesLen = pakName - namePtr;
+	FS_WriteCacheHeader( f );
 
-	// file content length
-	contentLen = 0;
-#if 0
-	for ( i = 0; i < pak->numfiles; i++ )
+	while ( sp != NULL )
 	{
-		if ( pak->buildBuffer[ i ].data && pak->buildBuffer[ i ].size ) 
+		if ( sp->pack )
 		{
-			contentLen += sizeof( int ) + PAD( pak->buildBuffer[ i ].size, sizeof( int ) );
+			FS_SavePackToFile( sp->pack, f );
 		}
+		sp = sp->next;
 	}
-#endif
 
-	// pak filename length
-	pk.pakNameLen = pakNameLen;
-	// filenames length
-	pk.namesLen = namesLen;
-	// number of files
-	pk.numFiles = pak->numfiles;
-	// number of checksums
-	pk.numHeaderLongs = pak->numHeaderLongs;
-	// content of some files
-	pk.contentLen = contentLen;
-	// creation/status change time
-	pk.ctime = pak->ctime;
-	// modification time
-	pk.mtime = pak->mtime;
-	// pak file size
-	pk.size = pak->size;
+	fclose( f );
 
-	// dump header
-	fwrite( &pk, sizeof( pk ), 1, f );
+	fs_paksReleased = 0;
+	fs_paksSkipped = 0;
+	fs_paksReaded = 0;
+	fs_paksAppended = 0;
 
-	// pak filename
-	fwrite( pakName, pakNameLen, 1, f );
+	fs_cacheSynced = qtrue;
+
+	return qtrue;
+}
+
+
+/*
+============
+FS_LoadCache
+
+Called at FS_Startup() before loading any pk3 file
+============
+*/
+static void FS_LoadCache( void )
+{
+	const char *filename = CACHE_FILE_NAME;
+	const char *ospath;
+	FILE *f;
+
+	fs_paksReaded = 0;
+	fs_paksAppended = 0;
+	fs_paksReleased = 0;
+
+	if ( fs_cacheLoaded )
+		return;
+
+	fs_paksCached = 0;
+	fs_paksSkipped = 0;
 
-	// filenames
-	fwrite( namePtr, namesLen, 1, f );
+	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
 
-	// file entries
-	for ( i = 0; i < pak->numfiles; i++ )
+	f = Sys_FOpen( ospath, "rb" );
+	if ( f == NULL )
+		return;
+
+	if ( !FS_ValidateCacheHeader( f ) )
 	{
-		it.name = (unsigned long)(pak->buildBuffer[i].name - namePtr);
-		it.size = pak->buildBuffer[i].size;
-		it.pos = pak->buildBuffer[i].pos;
-		fwrite( &it, sizeof( it ), 1, f );
+		fclose( f );
+		return;
 	}
 
-	// pure checksums, excluding first uninitialized
-	fwrite( pak->headerLongs + 1, (pak->numHeaderLongs - 1) * sizeof( pak->headerLongs[0] ), 1, f );
+	while ( FS_LoadPakFromFile( f ) )
+		;
 
-#if 0
-	if ( contentLen )
-	{
-		const fileInPack_t *currFile = pak->buildBuffer;
-		for ( i = 0; i < pak->numfiles; i++, currFile++ )
-		{
-			if ( currFile->data && currFile->size ) {
-				// file index
-				fwrite( &i, sizeof( i ), 1, f );
-				// file data
-				fwrite( currFile->data, PAD( currFile->size, sizeof( int ) ), 1, f );
-			}
-		}
-	}
-#endif
+	fclose( f );
 
-	return qtrue;
+	fs_cacheLoaded = qtrue;
+
+	Com_Printf( "...found %i cached paks\n", fs_paksCached );
 }
 
+#endif // USE_PK3_CACHE_FILE
 
-static qboolean FS_LoadPakFromFile( FILE *f )
-{
-	fileTime_t ctime, mtime;
-	fileOffset_t fsize;
-	fileInPack_t *curFile;
-	char pakName[ PAD( MAX_OSPATH*3+1, sizeof( int ) ) ];
-	char pakBase[ PAD( MAX_OSPATH, sizeof( int ) ) ], *basename;
-	char *filename_inzip;
-	pk3cacheHeader_t pk;
-	pk3cacheFileItem_t it;
-	pack_t *pack;
-	char *namePtr;
-	int size, i;
-	int pakBaseLen;
-	int hashSize;
-	long hash;
+#endif // USE_PK3_CACHE
 
-	if ( fread( &pk, sizeof( pk ), 1, f ) != 1 )
-		return qfalse; // probably EOF
 
-	/// validate header data
+/*
+=================
+FS_LoadZipFile
 
-	if ( pk.pakNameLen > sizeof( pakName ) || pk.pakNameLen & 3 || pk.pakNameLen == 0 )
-	{
-		//Com_Printf( "bad pakNameLen: %08X\n", pk.pakNameLen );
-		return qfalse;
-	}
+Creates a new pak_t in the search chain for the contents
+of a zip file.
+=================
+*/
+static pack_t *FS_LoadZipFile( const char *zipfile )
+{
+	fileInPack_t	*curFile;
+	pack_t			*pack;
+	unzFile			uf;
+	int				err;
+	unz_global_info gi;
+	char			filename_inzip[MAX_ZPATH];
+	unz_file_info	file_info;
+	unsigned int	i, namelen, hashSize, size;
+	long			hash;
+	int				fs_numHeaderLongs;
+	int				*fs_headerLongs;
+	int				filecount;
+	char			*namePtr;
+	const char		*basename;
+	int				fileNameLen;
+	int				baseNameLen;
 
-	if ( pk.namesLen & 3 || pk.namesLen < pk.numFiles )
+#ifdef USE_PK3_CACHE
+	pack = FS_LoadCachedPK3( zipfile );
+	if ( pack )
 	{
-		//Com_Printf( "bad namesLen: %i\n", pk.namesLen );
-		return qfalse;
-	}
+		// update pure checksum
+		if ( pack->checksumFeed != fs_checksumFeed )
+		{
+			pack->headerLongs[ 0 ] = LittleLong( fs_checksumFeed );
+			pack->pure_checksum = Com_BlockChecksum( pack->headerLongs, sizeof( pack->headerLongs[0] ) * pack->numHeaderLongs );
+			pack->pure_checksum = LittleLong( pack->pure_checksum );
+			pack->checksumFeed = fs_checksumFeed;
+		}
 
-	if ( pk.numHeaderLongs == 0 || pk.numHeaderLongs > pk.numFiles + 1 )
-	{
-		//Com_Printf( "bad numHeaderLongs: %i\n", pk.numHeaderLongs );
-		return qfalse;
+		pack->touched = qtrue;
+		return pack; // loaded from cache
 	}
+#endif
 
-	if ( pk.contentLen & 3 || pk.contentLen < 0 )
-	{
-		//Com_Printf( "bad contentLen: %i\n", pk.contentLen );
-		return qfalse;
+	// extract basename from zip path
+	basename = strrchr( zipfile, PATH_SEP );
+	if ( basename == NULL ) {
+		basename = zipfile;
+	} else {
+		basename++;
 	}
 
-	// load filename
-	if ( fread( pakName, pk.pakNameLen, 1, f ) != 1 )
-	{
-		//Com_Printf( "error reading pakname\n" );
-		return qfalse;
-	}
+	fileNameLen = (int) strlen( zipfile ) + 1;
+	baseNameLen = (int) strlen( basename ) + 1;
 
-	// pakName must be zero-terminated
-	if ( pakName[ pk.pakNameLen - 1 ] != '\0' )
-	{
-		//Com_Printf( "pakname is not zero-terminated!\n" );
-		return qfalse;
+	uf = unzOpen( zipfile );
+	err = unzGetGlobalInfo( uf, &gi );
+
+	if ( err != UNZ_OK ) {
+		return NULL;
 	}
 
-	if ( !Sys_GetFileStats( pakName, &fsize, &mtime, &ctime ) || fsize != pk.size || mtime != pk.mtime || ctime != pk.ctime )
+	namelen = 0;
+	filecount = 0;
+	unzGoToFirstFile( uf );
+	for (i = 0; i < gi.number_entry; i++)
 	{
-		const int seek_len = pk.namesLen + pk.numFiles * sizeof( it ) + (pk.numHeaderLongs-1) * sizeof( pack->headerLongs[0] ) + pk.contentLen;
-		if ( fseek( f, seek_len, SEEK_CUR ) != 0 )
-		{
-			return qfalse;
-		}
-		else
-		{
-			fs_paksSkipped++;
-			return qtrue; // just outdated info, we can continue
+		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
+		filename_inzip[sizeof(filename_inzip)-1] = '\0';
+		if (err != UNZ_OK) {
+			break;
 		}
+		if ( file_info.compression_method != 0 && file_info.compression_method != 8 /*Z_DEFLATED*/ ) {
+			Com_Printf( S_COLOR_YELLOW "%s|%s: unsupported compression method %i\n", basename, filename_inzip, (int)file_info.compression_method );
+			unzGoToNextFile( uf );
+			continue;
+		} 
+		namelen += strlen( filename_inzip ) + 1;
+		unzGoToNextFile( uf );
+		filecount++;
 	}
 
-	// extract basename from zip path
-	basename = strrchr( pakName, PATH_SEP );
-	if ( basename == NULL )
-		basename = pakName;
-	else
-		basename++;
-
-	Q_strncpyz( pakBase, basename, sizeof( pakBase ) );
-	FS_StripExt( pakBase, ".pk3" );
-	pakBaseLen = (int) strlen( pakBase ) + 1;
-	pakBaseLen = PAD( pakBaseLen, sizeof( int ) );
-
-	hashSize = FS_PakHashSize( pk.numFiles );
+	if ( filecount == 0 ) {
+		unzClose( uf );
+		return NULL;
+	}
 
-	size = sizeof( *pack ) + pk.namesLen + pk.numFiles * sizeof( pack->buildBuffer[0] );
-	size += hashSize * sizeof( pack->hashTable[0] );
-	size += pk.pakNameLen;
-	size += pakBaseLen;
-	size += pk.numHeaderLongs * sizeof( pack->headerLongs[0] );
+	// get the hash table size from the number of files in the zip
+	// because lots of custom pk3 files have less than 32 or 64 files
+	hashSize = FS_PakHashSize( filecount );
 
+	namelen = PAD( namelen, sizeof( int ) );
+	size = sizeof( *pack ) + hashSize * sizeof( pack->hashTable[0] ) + filecount * sizeof( pack->buildBuffer[0] ) + namelen;
+	size += PAD( fileNameLen, sizeof( int ) );
+	size += PAD( baseNameLen, sizeof( int ) );
+#ifdef USE_PK3_CACHE
+	size += ( filecount + 1 ) * sizeof( fs_headerLongs[0] );
+#endif
 	pack = Z_TagMalloc( size, TAG_PACK );
 	Com_Memset( pack, 0, size );
 
-	pack->mtime = pk.mtime;
-	pack->ctime = pk.ctime;
-	pack->size = pk.size;
-
-//	pack->handle = uf;
-	pack->numfiles = pk.numFiles;
-	pack->numHeaderLongs = pk.numHeaderLongs;
-
-	// setup memory layout
+	pack->handle = uf;
+	pack->numfiles = filecount;
 	pack->hashSize = hashSize;
 	pack->hashTable = (fileInPack_t **)( pack + 1 );
 
 	pack->buildBuffer = (fileInPack_t*)( pack->hashTable + pack->hashSize );
+	namePtr = (char*)( pack->buildBuffer + filecount );
 
-	namePtr = (char*)( pack->buildBuffer + pack->numfiles );
+	pack->pakFilename = (char*)( namePtr + namelen );
+	pack->pakBasename = (char*)( pack->pakFilename + PAD( fileNameLen, sizeof( int ) ) );
 
-	pack->pakFilename = (char*)( namePtr + pk.namesLen );
-	pack->pakBasename = (char*)( pack->pakFilename + pk.pakNameLen );
-	pack->headerLongs = (int*)( pack->pakBasename + pakBaseLen );
+#ifdef USE_PK3_CACHE
+	fs_headerLongs = (int*)( pack->pakBasename + PAD( baseNameLen, sizeof( int ) ) );
+#else
+	fs_headerLongs = Z_Malloc( ( filecount + 1 ) * sizeof( fs_headerLongs[0] ) );
+#endif
 
-	strcpy( pack->pakFilename, pakName );
-	strcpy( pack->pakBasename, pakBase );
+	fs_numHeaderLongs = 0;
+	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
 
-	if ( fread( namePtr, pk.namesLen, 1, f ) != 1 )
-	{
-		//Com_Printf( "error reading pak filenames\n" );
-		goto __error;
-	}
+	Com_Memcpy( pack->pakFilename, zipfile, fileNameLen );
+	Com_Memcpy( pack->pakBasename, basename, baseNameLen );
 
-	// filenames buffer must be zero-terminated
-	if ( namePtr[ pk.namesLen - 1 ] != '\0' )
-	{
-		//Com_Printf( "not zero terminated filenames\n" );
-		goto __error;
-	}
+	// strip .pk3 if needed
+	FS_StripExt( pack->pakBasename, ".pk3" );
 
+	unzGoToFirstFile( uf );
 	curFile = pack->buildBuffer;
-	for ( i = 0; i < pk.numFiles; i++ )
+	for ( i = 0; i < gi.number_entry; i++ )
 	{
-		if ( fread( &it, sizeof( it ), 1, f ) != 1 )
-		{
-			//Com_Printf( "error reading file item[%i]\n", i );
-			goto __error;
+		err = unzGetCurrentFileInfo( uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0 );
+		filename_inzip[sizeof(filename_inzip)-1] = '\0';
+		if (err != UNZ_OK) {
+			break;
 		}
-		if ( it.name >= pk.namesLen )
-		{
-			//Com_Printf( "bad name offset: %i (expecting less than %i)\n", it.name, pk.namesLen );
-			goto __error;
+		if ( file_info.compression_method != 0 && file_info.compression_method != 8 /*Z_DEFLATED*/ ) {
+			unzGoToNextFile( uf );
+			continue;
+		} 
+		if ( file_info.uncompressed_size > 0 ) {
+			fs_headerLongs[fs_numHeaderLongs++] = LittleLong( file_info.crc );
 		}
 
-		filename_inzip = namePtr + it.name;
 		FS_ConvertFilename( filename_inzip );
 		if ( !FS_BannedPakFile( filename_inzip ) ) {
 			// store the file position in the zip
-			curFile->name = filename_inzip;
-			curFile->size = it.size;
-			curFile->pos = it.pos;
+			unzGetCurrentFileInfoPosition( uf, &curFile->pos );
+			curFile->size = file_info.uncompressed_size;
+			curFile->name = namePtr;
+			strcpy( curFile->name, filename_inzip );
+			namePtr += strlen( filename_inzip ) + 1;
 
 			// update hash table
 			hash = FS_HashFileName( filename_inzip, pack->hashSize );
 			curFile->next = pack->hashTable[ hash ];
-			pack->hashTable[ hash ] = curFile;
+			pack->hashTable[ hash ] = curFile; 
 			curFile++;
 		} else {
 			pack->numfiles--;
 		}
-	}
 
-	if ( fread( pack->headerLongs + 1, ( pack->numHeaderLongs - 1 ) * sizeof( pack->headerLongs[0] ), 1, f ) != 1 )
-	{
-		//Com_Printf( "error reading headerLongs\n" );
-		goto __error;
+		unzGoToNextFile( uf );
 	}
 
-	pack->checksumFeed = fs_checksumFeed;
-	pack->headerLongs[ 0 ] = LittleLong( fs_checksumFeed );
-
-	pack->checksum = Com_BlockChecksum( pack->headerLongs + 1, sizeof( pack->headerLongs[0] ) * ( pack->numHeaderLongs - 1 ) );
+	pack->checksum = Com_BlockChecksum( fs_headerLongs + 1, sizeof( fs_headerLongs[0] ) * ( fs_numHeaderLongs - 1 ) );
 	pack->checksum = LittleLong( pack->checksum );
 
-	pack->pure_checksum = Com_BlockChecksum( pack->headerLongs, sizeof( pack->headerLongs[0] ) * pack->numHeaderLongs );
+	pack->pure_checksum = Com_BlockChecksum( fs_headerLongs, sizeof( fs_headerLongs[0] ) * fs_numHeaderLongs );
 	pack->pure_checksum = LittleLong( pack->pure_checksum );
 
-	// seek through unused content
-	if ( pk.contentLen > 0 )
-	{
-		if ( fseek( f, pk.contentLen, SEEK_CUR ) != 0 )
-			goto __error;
-	}
-	else if ( pk.contentLen < 0 )
+#ifdef USE_PK3_CACHE
+	pack->headerLongs = fs_headerLongs;
+	pack->numHeaderLongs = fs_numHeaderLongs;
+	pack->checksumFeed = fs_checksumFeed;
+#else
+	Z_Free( fs_headerLongs );
+#endif
+
+#ifdef USE_HANDLE_CACHE
+	FS_AddToHandleList( pack );
+#else
+	if ( fs_locked->integer == 0 )
 	{
-		goto __error;
+		unzClose( pack->handle );
+		pack->handle = NULL;
 	}
+#endif
 
-	fs_paksCached++;
-
+#ifdef USE_PK3_CACHE
 	FS_InsertPK3ToCache( pack );
+#ifdef USE_PK3_CACHE_FILE
+	fs_paksReaded++;
+#endif
+#endif
 
-	return qtrue;
-
-__error:
-	FS_FreePak( pack );
-	return qfalse;
+	return pack;
 }
 
 
 /*
-============
-FS_SaveCache
+=================
+FS_FreePak
 
-Called at th end of FS_Startup() after releasing unused paks
-============
+Frees a pak structure and releases all associated resources
+=================
 */
-static qboolean FS_SaveCache( void )
+static void FS_FreePak( pack_t *pak )
 {
-	const char *filename = CACHE_FILE_NAME;
-	const char *ospath;
-	const searchpath_t *sp;
-	FILE *f;
-
-	if ( !fs_searchpaths )
-		return qfalse;
-
-	if ( !fs_cacheLoaded )
-	{
-		Com_DPrintf( "synced FS cache on startup\n" );
-		fs_cacheSynced = qfalse;
-		fs_cacheLoaded = qtrue;
-	}
-	else if ( CACHE_SYNC_CONDITION )
+	if ( pak->handle )
 	{
-		Com_DPrintf( "synced FS cache on readed=%i, released=%i, skipped=%i\n",
-			fs_paksReaded, fs_paksReleased, fs_paksSkipped );
-		fs_cacheSynced = qfalse;
+#ifdef USE_HANDLE_CACHE
+		if ( pak->next_h )
+			FS_RemoveFromHandleList( pak );
+#endif
+		unzClose( pak->handle );
+		pak->handle = NULL;
 	}
 
-	if ( fs_cacheSynced )
-		return qtrue;
+	Z_Free( pak );
+}
 
-	sp = fs_searchpaths;
 
-	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
+#ifdef USE_PK3_SCAN
+/*
+=================================================================================
 
-	f = Sys_FOpen( ospath, "wb" );
-	if ( f == NULL )
-		return qfalse;
+PARALLEL PK3 SCANNING
 
-	FS_WriteCacheHeader( f );
+New or changed pk3 files are scanned in batches before FS_AddGameDirectory()
+loads them. Worker threads locate the central directory, read it with a single
+call, collect file checksums and compute pak checksums, then the main thread
+builds pack_t structures in the same layout as FS_LoadZipFile() and inserts them
+into the pak cache, so following FS_LoadZipFile() calls just pick them up.
+Such paks have no zip handle opened, the same as ones loaded from the cache file.
 
-	while ( sp != NULL )
-	{
-		if ( sp->pack )
-		{
-			FS_SavePackToFile( sp->pack, f );
-		}
-		sp = sp->next;
-	}
+=================================================================================
+*/
 
-	fclose( f );
+#define PK3_SCAN_BATCH		64
 
-	fs_paksReleased = 0;
-	fs_paksSkipped = 0;
-	fs_paksReaded = 0;
+#define ZIP_END_SIZE		22	// end of central directory record
+#define ZIP_ENTRY_SIZE		46	// central directory file header
 
-	fs_cacheSynced = qtrue;
+typedef struct {
+	char			*zipfile;
+	// end of central directory record
+	unsigned long	centralPos;
+	unsigned long	cdirOffset;		// central directory offset stored in the zip, base of file positions
+	unsigned long	cdirSize;
+	int				numEntries;
+	// central directory followed by header longs, allocated by the main thread
+	byte			*cdir;
+	int				*headerLongs;
+	int				numHeaderLongs;
+	int				numParsed;		// valid central directory entries
+	int				numFiles;		// entries with supported compression
+	int				namesLen;
+	int				checksum;
+	int				pure_checksum;
+	qboolean		valid;
+} pk3scan_t;
 
-	return qtrue;
+static struct {
+	int		paks;
+	int		batches;
+	int		locateMsec;
+	int		readMsec;
+	int		buildMsec;
+	int		appendMsec;
+} fs_scanStats;
+
+
+static unsigned int FS_ZipShort( const byte *p ) {
+	return p[0] | ( p[1] << 8 );
+}
+
+
+static unsigned long FS_ZipLong( const byte *p ) {
+	return (unsigned long)p[0] | ( (unsigned long)p[1] << 8 ) | ( (unsigned long)p[2] << 16 ) | ( (unsigned long)p[3] << 24 );
 }
 
 
 /*
-============
-FS_LoadCache
+=================
+FS_ZipNameLength
 
-Called at FS_Startup() before loading any pk3 file
-============
+Returns length of a central directory file name as unzGetCurrentFileInfo() would return it
+=================
 */
-static void FS_LoadCache( void )
-{
-	const char *filename = CACHE_FILE_NAME;
-	const char *ospath;
-	FILE *f;
+static int FS_ZipNameLength( const byte *name, unsigned int size ) {
+	unsigned int len;
 
-	fs_paksReaded = 0;
-	fs_paksReleased = 0;
+	if ( size > MAX_ZPATH - 1 ) {
+		size = MAX_ZPATH - 1;
+	}
 
-	if ( fs_cacheLoaded )
-		return;
+	for ( len = 0; len < size && name[ len ] != '\0'; len++ )
+		;
 
-	fs_paksCached = 0;
-	fs_paksSkipped = 0;
+	return (int)len;
+}
 
-	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
 
-	f = Sys_FOpen( ospath, "rb" );
-	if ( f == NULL )
-		return;
+/*
+=================
+FS_LocatePK3Job
 
-	if ( !FS_ValidateCacheHeader( f ) )
-	{
-		fclose( f );
+Reads the end of central directory record, executed on worker threads
+=================
+*/
+static void FS_LocatePK3Job( void *arg, int index ) {
+	pk3scan_t *s = (pk3scan_t *)arg + index;
+	byte buf[ ZIP_END_SIZE ];
+	FILE *f;
+
+	s->valid = qfalse;
+
+	f = Sys_FOpen( s->zipfile, "rb" );
+	if ( f == NULL ) {
 		return;
 	}
 
-	while ( FS_LoadPakFromFile( f ) )
-		;
+	s->centralPos = unzlocal_SearchCentralDir( f );
+	if ( s->centralPos != 0 && fseek( f, s->centralPos, SEEK_SET ) == 0 && fread( buf, sizeof( buf ), 1, f ) == 1 ) {
+		s->numEntries = FS_ZipShort( buf + 8 );
+		s->cdirSize = FS_ZipLong( buf + 12 );
+		s->cdirOffset = FS_ZipLong( buf + 16 );
+		// spanned archives are not supported
+		if ( FS_ZipShort( buf + 4 ) == 0 && FS_ZipShort( buf + 6 ) == 0 && FS_ZipShort( buf + 10 ) == s->numEntries
+			&& s->centralPos >= s->cdirOffset + s->cdirSize && s->cdirSize >= ZIP_ENTRY_SIZE && s->numEntries > 0 ) {
+			s->valid = qtrue;
+		}
+	}
 
 	fclose( f );
-
-	fs_cacheLoaded = qtrue;
-
-	Com_Printf( "...found %i cached paks\n", fs_paksCached );
 }
 
-#endif // USE_PK3_CACHE_FILE
-
-#endif // USE_PK3_CACHE
-
 
 /*
 =================
-FS_LoadZipFile
+FS_ReadPK3Job
 
-Creates a new pak_t in the search chain for the contents
-of a zip file.
+Reads and parses the central directory, executed on worker threads
 =================
 */
-static pack_t *FS_LoadZipFile( const char *zipfile )
-{
-	fileInPack_t	*curFile;
-	pack_t			*pack;
-	unzFile			uf;
-	int				err;
-	unz_global_info gi;
-	char			filename_inzip[MAX_ZPATH];
-	unz_file_info	file_info;
-	unsigned int	i, namelen, hashSize, size;
-	long			hash;
-	int				fs_numHeaderLongs;
-	int				*fs_headerLongs;
-	int				filecount;
-	char			*namePtr;
-	const char		*basename;
-	int				fileNameLen;
-	int				baseNameLen;
+static void FS_ReadPK3Job( void *arg, int index ) {
+	pk3scan_t *s = (pk3scan_t *)arg + index;
+	unsigned long pos, nameSize;
+	const byte *p;
+	FILE *f;
+	int i, method;
 
-#ifdef USE_PK3_CACHE
-	pack = FS_LoadCachedPK3( zipfile );
-	if ( pack )
-	{
-		// update pure checksum
-		if ( pack->checksumFeed != fs_checksumFeed )
-		{
-			pack->headerLongs[ 0 ] = LittleLong( fs_checksumFeed );
-			pack->pure_checksum = Com_BlockChecksum( pack->headerLongs, sizeof( pack->headerLongs[0] ) * pack->numHeaderLongs );
-			pack->pure_checksum = LittleLong( pack->pure_checksum );
-			pack->checksumFeed = fs_checksumFeed;
-		}
+	if ( !s->valid ) {
+		return;
+	}
 
-		pack->touched = qtrue;
-		return pack; // loaded from cache
+	s->valid = qfalse;
+
+	f = Sys_FOpen( s->zipfile, "rb" );
+	if ( f == NULL ) {
+		return;
 	}
-#endif
 
-	// extract basename from zip path
-	basename = strrchr( zipfile, PATH_SEP );
-	if ( basename == NULL ) {
-		basename = zipfile;
-	} else {
-		basename++;
+	// central directory is right before the end record, data may be prepended to the zip
+	if ( fseek( f, s->centralPos - s->cdirSize, SEEK_SET ) != 0 || fread( s->cdir, s->cdirSize, 1, f ) != 1 ) {
+		fclose( f );
+		return;
 	}
 
-	fileNameLen = (int) strlen( zipfile ) + 1;
-	baseNameLen = (int) strlen( basename ) + 1;
+	fclose( f );
 
-	uf = unzOpen( zipfile );
-	err = unzGetGlobalInfo( uf, &gi );
+	s->numHeaderLongs = 0;
+	s->headerLongs[ s->numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
+
+	// same rules as FS_LoadZipFile()
+	for ( i = 0, pos = 0; i < s->numEntries; i++ ) {
+		p = s->cdir + pos;
+		if ( pos + ZIP_ENTRY_SIZE > s->cdirSize || memcmp( p, "\x50\x4b\x01\x02", 4 ) != 0 ) {
+			break;
+		}
+		nameSize = FS_ZipShort( p + 28 );
+		if ( pos + ZIP_ENTRY_SIZE + nameSize > s->cdirSize ) {
+			break;
+		}
+		method = FS_ZipShort( p + 10 );
+		if ( method == 0 || method == 8 /*Z_DEFLATED*/ ) {
+			if ( FS_ZipLong( p + 24 ) > 0 ) {
+				s->headerLongs[ s->numHeaderLongs++ ] = LittleLong( (int)FS_ZipLong( p + 16 ) );
+			}
+			s->namesLen += FS_ZipNameLength( p + ZIP_ENTRY_SIZE, nameSize ) + 1;
+			s->numFiles++;
+		}
+		pos += ZIP_ENTRY_SIZE + nameSize + FS_ZipShort( p + 30 ) + FS_ZipShort( p + 32 );
+	}
+
+	s->numParsed = i;
+
+	s->checksum = Com_BlockChecksum( s->headerLongs + 1, sizeof( s->headerLongs[0] ) * ( s->numHeaderLongs - 1 ) );
+	s->checksum = LittleLong( s->checksum );
+
+	s->pure_checksum = Com_BlockChecksum( s->headerLongs, sizeof( s->headerLongs[0] ) * s->numHeaderLongs );
+	s->pure_checksum = LittleLong( s->pure_checksum );
+
+	s->valid = qtrue;
+}
+
+
+/*
+=================
+FS_BuildScannedPK3
+
+Creates a pak structure from the scanned central directory
+=================
+*/
+static pack_t *FS_BuildScannedPK3( const pk3scan_t *s ) {
+	char			filename_inzip[MAX_ZPATH];
+	fileInPack_t	*curFile;
+	pack_t			*pack;
+	const byte		*p;
+	const char		*basename;
+	char			*namePtr;
+	unsigned long	pos, nameSize;
+	unsigned int	hashSize, namelen, size;
+	int				fileNameLen, baseNameLen;
+	int				i, len, method;
+	long			hash;
 
-	if ( err != UNZ_OK ) {
+	if ( !s->valid || s->numFiles == 0 ) {
 		return NULL;
 	}
 
-	namelen = 0;
-	filecount = 0;
-	unzGoToFirstFile( uf );
-	for (i = 0; i < gi.number_entry; i++)
-	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		filename_inzip[sizeof(filename_inzip)-1] = '\0';
-		if (err != UNZ_OK) {
-			break;
-		}
-		if ( file_info.compression_method != 0 && file_info.compression_method != 8 /*Z_DEFLATED*/ ) {
-			Com_Printf( S_COLOR_YELLOW "%s|%s: unsupported compression method %i\n", basename, filename_inzip, (int)file_info.compression_method );
-			unzGoToNextFile( uf );
-			continue;
-		} 
-		namelen += strlen( filename_inzip ) + 1;
-		unzGoToNextFile( uf );
-		filecount++;
+	// extract basename from zip path
+	basename = strrchr( s->zipfile, PATH_SEP );
+	if ( basename == NULL ) {
+		basename = s->zipfile;
+	} else {
+		basename++;
 	}
 
-	if ( filecount == 0 ) {
-		unzClose( uf );
-		return NULL;
-	}
+	fileNameLen = (int) strlen( s->zipfile ) + 1;
+	baseNameLen = (int) strlen( basename ) + 1;
 
-	// get the hash table size from the number of files in the zip
-	// because lots of custom pk3 files have less than 32 or 64 files
-	hashSize = FS_PakHashSize( filecount );
+	hashSize = FS_PakHashSize( s->numFiles );
 
-	namelen = PAD( namelen, sizeof( int ) );
-	size = sizeof( *pack ) + hashSize * sizeof( pack->hashTable[0] ) + filecount * sizeof( pack->buildBuffer[0] ) + namelen;
+	namelen = PAD( s->namesLen, sizeof( int ) );
+	size = sizeof( *pack ) + hashSize * sizeof( pack->hashTable[0] ) + s->numFiles * sizeof( pack->buildBuffer[0] ) + namelen;
 	size += PAD( fileNameLen, sizeof( int ) );
 	size += PAD( baseNameLen, sizeof( int ) );
-#ifdef USE_PK3_CACHE
-	size += ( filecount + 1 ) * sizeof( fs_headerLongs[0] );
-#endif
+	size += ( s->numFiles + 1 ) * sizeof( pack->headerLongs[0] );
+
 	pack = Z_TagMalloc( size, TAG_PACK );
 	Com_Memset( pack, 0, size );
 
-	pack->handle = uf;
-	pack->numfiles = filecount;
+	pack->numfiles = s->numFiles;
 	pack->hashSize = hashSize;
 	pack->hashTable = (fileInPack_t **)( pack + 1 );
 
 	pack->buildBuffer = (fileInPack_t*)( pack->hashTable + pack->hashSize );
-	namePtr = (char*)( pack->buildBuffer + filecount );
+	namePtr = (char*)( pack->buildBuffer + s->numFiles );
 
 	pack->pakFilename = (char*)( namePtr + namelen );
 	pack->pakBasename = (char*)( pack->pakFilename + PAD( fileNameLen, sizeof( int ) ) );
+	pack->headerLongs = (int*)( pack->pakBasename + PAD( baseNameLen, sizeof( int ) ) );
 
-#ifdef USE_PK3_CACHE
-	fs_headerLongs = (int*)( pack->pakBasename + PAD( baseNameLen, sizeof( int ) ) );
-#else
-	fs_headerLongs = Z_Malloc( ( filecount + 1 ) * sizeof( fs_headerLongs[0] ) );
-#endif
-
-	fs_numHeaderLongs = 0;
-	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
-
-	Com_Memcpy( pack->pakFilename, zipfile, fileNameLen );
+	Com_Memcpy( pack->pakFilename, s->zipfile, fileNameLen );
 	Com_Memcpy( pack->pakBasename, basename, baseNameLen );
 
 	// strip .pk3 if needed
 	FS_StripExt( pack->pakBasename, ".pk3" );
 
-	unzGoToFirstFile( uf );
 	curFile = pack->buildBuffer;
-	for ( i = 0; i < gi.number_entry; i++ )
-	{
-		err = unzGetCurrentFileInfo( uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0 );
-		filename_inzip[sizeof(filename_inzip)-1] = '\0';
-		if (err != UNZ_OK) {
-			break;
-		}
-		if ( file_info.compression_method != 0 && file_info.compression_method != 8 /*Z_DEFLATED*/ ) {
-			unzGoToNextFile( uf );
-			continue;
-		} 
-		if ( file_info.uncompressed_size > 0 ) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong( file_info.crc );
+	for ( i = 0, pos = 0; i < s->numParsed; i++ ) {
+		p = s->cdir + pos;
+		nameSize = FS_ZipShort( p + 28 );
+		len = FS_ZipNameLength( p + ZIP_ENTRY_SIZE, nameSize );
+		Com_Memcpy( filename_inzip, p + ZIP_ENTRY_SIZE, len );
+		filename_inzip[ len ] = '\0';
+		method = FS_ZipShort( p + 10 );
+		if ( method != 0 && method != 8 /*Z_DEFLATED*/ ) {
+			Com_Printf( S_COLOR_YELLOW "%s|%s: unsupported compression method %i\n", basename, filename_inzip, method );
+		} else {
+			FS_ConvertFilename( filename_inzip );
+			if ( !FS_BannedPakFile( filename_inzip ) ) {
+				// store the file position in the zip
+				curFile->pos = s->cdirOffset + pos;
+				curFile->size = FS_ZipLong( p + 24 );
+				curFile->name = namePtr;
+				strcpy( curFile->name, filename_inzip );
+				namePtr += strlen( filename_inzip ) + 1;
+
+				// update hash table
+				hash = FS_HashFileName( filename_inzip, pack->hashSize );
+				curFile->next = pack->hashTable[ hash ];
+				pack->hashTable[ hash ] = curFile;
+				curFile++;
+			} else {
+				pack->numfiles--;
+			}
 		}
+		pos += ZIP_ENTRY_SIZE + nameSize + FS_ZipShort( p + 30 ) + FS_ZipShort( p + 32 );
+	}
 
-		FS_ConvertFilename( filename_inzip );
-		if ( !FS_BannedPakFile( filename_inzip ) ) {
-			// store the file position in the zip
-			unzGetCurrentFileInfoPosition( uf, &curFile->pos );
-			curFile->size = file_info.uncompressed_size;
-			curFile->name = namePtr;
-			strcpy( curFile->name, filename_inzip );
-			namePtr += strlen( filename_inzip ) + 1;
+	Com_Memcpy( pack->headerLongs, s->headerLongs, s->numHeaderLongs * sizeof( pack->headerLongs[0] ) );
+	pack->numHeaderLongs = s->numHeaderLongs;
+	pack->checksumFeed = fs_checksumFeed;
 
-			// update hash table
-			hash = FS_HashFileName( filename_inzip, pack->hashSize );
-			curFile->next = pack->hashTable[ hash ];
-			pack->hashTable[ hash ] = curFile; 
-			curFile++;
-		} else {
-			pack->numfiles--;
-		}
+	pack->checksum = s->checksum;
+	pack->pure_checksum = s->pure_checksum;
 
-		unzGoToNextFile( uf );
-	}
+	return pack;
+}
 
-	pack->checksum = Com_BlockChecksum( fs_headerLongs + 1, sizeof( fs_headerLongs[0] ) * ( fs_numHeaderLongs - 1 ) );
-	pack->checksum = LittleLong( pack->checksum );
 
-	pack->pure_checksum = Com_BlockChecksum( fs_headerLongs, sizeof( fs_headerLongs[0] ) * fs_numHeaderLongs );
-	pack->pure_checksum = LittleLong( pack->pure_checksum );
+#ifdef USE_PK3_CACHE_FILE
+/*
+=================
+FS_AppendCache
 
-#ifdef USE_PK3_CACHE
-	pack->headerLongs = fs_headerLongs;
-	pack->numHeaderLongs = fs_numHeaderLongs;
-	pack->checksumFeed = fs_checksumFeed;
-#else
-	Z_Free( fs_headerLongs );
-#endif
+Adds freshly scanned paks to the cache file, so the work is not lost
+if startup is interrupted and the file doesn't need a full rewrite
+=================
+*/
+static void FS_AppendCache( pack_t **paks, int count ) {
+	const char *ospath;
+	FILE *f;
+	int i;
 
-#ifdef USE_HANDLE_CACHE
-	FS_AddToHandleList( pack );
-#else
-	if ( fs_locked->integer == 0 )
-	{
-		unzClose( pack->handle );
-		pack->handle = NULL;
+	ospath = FS_BuildOSPath( fs_homepath->string, CACHE_FILE_NAME, NULL );
+
+	f = Sys_FOpen( ospath, "ab" );
+	if ( f == NULL )
+		return;
+
+	fseek( f, 0, SEEK_END );
+	if ( ftell( f ) == 0 ) {
+		FS_WriteCacheHeader( f );
+	}
+
+	for ( i = 0; i < count; i++ ) {
+		FS_SavePackToFile( paks[i], f );
+		fs_paksAppended++;
 	}
+
+	fclose( f );
+}
 #endif
 
-#ifdef USE_PK3_CACHE
-	FS_InsertPK3ToCache( pack );
+
+/*
+=================
+FS_ScanPK3Batch
+=================
+*/
+static void FS_ScanPK3Batch( pk3scan_t *scan, int count ) {
+	pack_t *paks[ PK3_SCAN_BATCH ];
+	int i, numPaks, start, end;
+
+	start = Sys_Milliseconds();
+
+	Com_RunJobs( FS_LocatePK3Job, scan, count );
+
+	end = Sys_Milliseconds();
+	fs_scanStats.locateMsec += end - start;
+	start = end;
+
+	for ( i = 0; i < count; i++ ) {
+		if ( scan[i].valid ) {
+			scan[i].cdir = Z_Malloc( PAD( scan[i].cdirSize, sizeof( int ) ) + ( scan[i].numEntries + 1 ) * sizeof( int ) );
+			scan[i].headerLongs = (int *)( scan[i].cdir + PAD( scan[i].cdirSize, sizeof( int ) ) );
+		}
+	}
+
+	Com_RunJobs( FS_ReadPK3Job, scan, count );
+
+	end = Sys_Milliseconds();
+	fs_scanStats.readMsec += end - start;
+	start = end;
+
+	numPaks = 0;
+	for ( i = 0; i < count; i++ ) {
+		pack_t *pak = FS_BuildScannedPK3( &scan[i] );
+		if ( scan[i].cdir ) {
+			Z_Free( scan[i].cdir );
+			scan[i].cdir = NULL;
+		}
+		if ( pak == NULL ) {
+			// let FS_LoadZipFile() handle it
+			continue;
+		}
+		FS_InsertPK3ToCache( pak );
+		if ( !pak->touched ) {
+			FS_FreePak( pak );
+			continue;
+		}
 #ifdef USE_PK3_CACHE_FILE
-	fs_paksReaded++;
+		fs_paksReaded++;
 #endif
+		paks[ numPaks++ ] = pak;
+	}
+
+	end = Sys_Milliseconds();
+	fs_scanStats.buildMsec += end - start;
+	start = end;
+
+#ifdef USE_PK3_CACHE_FILE
+	if ( numPaks ) {
+		FS_AppendCache( paks, numPaks );
+	}
 #endif
 
-	return pack;
+	fs_scanStats.appendMsec += Sys_Milliseconds() - start;
+	fs_scanStats.paks += numPaks;
+	fs_scanStats.batches++;
 }
 
 
 /*
 =================
-FS_FreePak
+FS_ScanPK3Files
 
-Frees a pak structure and releases all associated resources
+Scans pk3 files of the game directory that are not in the pak cache yet
 =================
 */
-static void FS_FreePak( pack_t *pak )
-{
-	if ( pak->handle )
-	{
-#ifdef USE_HANDLE_CACHE
-		if ( pak->next_h )
-			FS_RemoveFromHandleList( pak );
-#endif
-		unzClose( pak->handle );
-		pak->handle = NULL;
+static void FS_ScanPK3Files( const char *path, const char *dir, char **pakfiles, int numfiles ) {
+	pk3scan_t *scan;
+	const char *pakfile;
+	int i, count, len;
+
+	scan = Z_Malloc( numfiles * sizeof( scan[0] ) );
+	count = 0;
+
+	for ( i = 0; i < numfiles; i++ ) {
+		len = strlen( pakfiles[i] );
+		if ( !FS_IsExt( pakfiles[i], ".pk3", len ) ) {
+			continue;
+		}
+		pakfile = FS_BuildOSPath( path, dir, pakfiles[i] );
+		if ( FS_LoadCachedPK3( pakfile ) ) {
+			continue;
+		}
+		scan[ count++ ].zipfile = FS_CopyString( pakfile );
 	}
 
-	Z_Free( pak );
+	for ( i = 0; i < count; i += PK3_SCAN_BATCH ) {
+		FS_ScanPK3Batch( scan + i, MIN( count - i, PK3_SCAN_BATCH ) );
+	}
+
+	for ( i = 0; i < count; i++ ) {
+		Z_Free( scan[i].zipfile );
+	}
+
+	Z_Free( scan );
 }
+#endif // USE_PK3_SCAN
 
 
 /*
@@ -3362,6 +4566,53 @@ void FS_SetFilenameCallback( fnamecallback_f func )
 }
 
 
+/*
+===============
+FS_PakNameMatches
+
+Checks if a pak file name is within the listed directory and matches the extension
+===============
+*/
+static qboolean FS_PakNameMatches( const char *name, const char *path, int pathLength, int pathDepth, const char *extension, int extLen, qboolean hasPatterns ) {
+	char		zpath[MAX_ZPATH];
+	int			zpathLen, depth;
+	int			length;
+	const char	*x;
+
+	zpathLen = FS_ReturnPath( name, zpath, &depth );
+
+	if ( (depth-pathDepth)>2 || pathLength > zpathLen || Q_stricmpn( name, path, pathLength ) ) {
+		return qfalse;
+	}
+
+	// check for extension match
+	length = (int)strlen( name );
+
+	if ( fnamecallback ) {
+		// use custom filter
+		if ( !fnamecallback( name, length ) )
+			return qfalse;
+	} else {
+		if ( length < extLen )
+			return qfalse;
+		if ( *extension ) {
+			if ( hasPatterns ) {
+				x = strrchr( name, '.' );
+				if ( !x || !Com_FilterExt( extension, x+1 ) ) {
+					return qfalse;
+				}
+			} else {
+				if ( Q_stricmp( name + length - extLen, extension ) ) {
+					return qfalse;
+				}
+			}
+		}
+	}
+
+	return qtrue;
+}
+
+
 /*
 ===============
 FS_ListFilteredFiles
@@ -3383,7 +4634,10 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 	fileInPack_t	*buildBuffer;
 	char			zpath[MAX_ZPATH];
 	qboolean		hasPatterns;
-	const char		*x;
+#ifdef USE_FS_INDEX
+	const fsIndexFile_t **indexList;
+	int				indexCount, indexPos;
+#endif
 
 	if ( !fs_searchpaths ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
@@ -3417,6 +4671,15 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 	nfiles = 0;
 	FS_ReturnPath(path, zpath, &pathDepth);
 
+#ifdef USE_FS_INDEX
+	// get candidates from the directory tree instead of scanning every pak file
+	indexList = NULL;
+	indexCount = indexPos = 0;
+	if ( !filter && ( flags & FS_MATCH_PK3s ) ) {
+		indexCount = FS_IndexListFiles( path, pathLength, pathDepth + 2, &indexList );
+	}
+#endif
+
 	//
 	// search through the path, one element at a time, adding to list
 	//
@@ -3430,12 +4693,31 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 				continue;
 			}
 
+#ifdef USE_FS_INDEX
+			if ( !filter ) {
+				// candidates are sorted in search order
+				while ( indexPos < indexCount && indexList[ indexPos ]->order < search->order ) {
+					indexPos++;
+				}
+				for ( ; indexPos < indexCount && indexList[ indexPos ]->pak == search->pack; indexPos++ ) {
+					const char *name = indexList[ indexPos ]->file->name;
+					if ( FS_PakNameMatches( name, path, pathLength, pathDepth, extension, extLen, hasPatterns ) ) {
+						temp = pathLength;
+						if (pathLength) {
+							temp++;		// include the '/'
+						}
+						nfiles = FS_AddFileToList( name + temp, list, nfiles );
+					}
+				}
+				continue;
+			}
+#endif
+
 			// look through all the pak file elements
 			pak = search->pack;
 			buildBuffer = pak->buildBuffer;
 			for (i = 0; i < pak->numfiles; i++) {
 				const char *name;
-				int zpathLen, depth;
 
 				// check for directory match
 				name = buildBuffer[i].name;
@@ -3447,39 +4729,8 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 					// unique the match
 					nfiles = FS_AddFileToList( name, list, nfiles );
 				}
-				else {
-
-					zpathLen = FS_ReturnPath(name, zpath, &depth);
-
-					if ( (depth-pathDepth)>2 || pathLength > zpathLen || Q_stricmpn( name, path, pathLength ) ) {
-						continue;
-					}
-
-					// check for extension match
-					length = (int)strlen( name );
-
-					if ( fnamecallback ) {
-						// use custom filter
-						if ( !fnamecallback( name, length ) )
-							continue;
-					} else {
-						if ( length < extLen )
-							continue;
-						if ( *extension ) {
-							if ( hasPatterns ) {
-								x = strrchr( name, '.' );
-								if ( !x || !Com_FilterExt( extension, x+1 ) ) {
-									continue;
-								}
-							} else {
-								if ( Q_stricmp( name + length - extLen, extension ) ) {
-									continue;
-								}
-							}
-						}
-					}
+				else if ( FS_PakNameMatches( name, path, pathLength, pathDepth, extension, extLen, hasPatterns ) ) {
 					// unique the match
-
 					temp = pathLength;
 					if (pathLength) {
 						temp++;		// include the '/'
@@ -3511,6 +4762,12 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 		}		
 	}
 
+#ifdef USE_FS_INDEX
+	if ( indexList ) {
+		Z_Free( (void *)indexList );
+	}
+#endif
+
 	// return a copy of the list
 	*numfiles = nfiles;
 
@@ -4173,6 +5430,9 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 	search->next = fs_searchpaths;
 	fs_searchpaths = search;
+#ifdef USE_FS_INDEX
+	FS_IndexAddSearchPath( search );
+#endif
 	fs_dirCount++;
 
 	// find all pak files in this directory
@@ -4184,6 +5444,11 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 	if ( numfiles >= 2 )
 		FS_SortFileList( pakfiles, numfiles - 1 );
 
+#ifdef USE_PK3_SCAN
+	if ( numfiles > 0 )
+		FS_ScanPK3Files( path, dir, pakfiles, numfiles );
+#endif
+
 	pakfilesi = 0;
 	pakdirsi = 0;
 
@@ -4247,6 +5512,9 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 			search->next = fs_searchpaths;
 			fs_searchpaths = search;
+#ifdef USE_FS_INDEX
+			FS_IndexAddSearchPath( search );
+#endif
 
 			pakfilesi++;
 		} else {
@@ -4279,6 +5547,9 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 			search->next = fs_searchpaths;
 			fs_searchpaths = search;
+#ifdef USE_FS_INDEX
+			FS_IndexAddSearchPath( search );
+#endif
 			fs_pk3dirCount++;
 
 			pakdirsi++;
@@ -4508,6 +5779,10 @@ void FS_Shutdown( qboolean closemfp )
 		Z_Free( p );
 	}
 
+#ifdef USE_FS_INDEX
+	FS_IndexFree();
+#endif
+
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
 	fs_packFiles = 0;
@@ -4565,6 +5840,10 @@ static void FS_ReorderSearchPaths( void ) {
 	list[cnt-1]->next = NULL;
 
 	Z_Free( list );
+
+#ifdef USE_FS_INDEX
+	FS_IndexFree();
+#endif
 }
 
 
@@ -4606,6 +5885,12 @@ static void FS_ReorderPurePaks( void )
 			p_previous = &s->next;
 		}
 	}
+
+#ifdef USE_FS_INDEX
+	if ( fs_reordered ) {
+		FS_IndexFree();
+	}
+#endif
 }
 
 
@@ -4695,6 +5980,7 @@ FS_Startup
 static void FS_Startup( void ) {
 	const char *homePath;
 	int start, end;
+	int cacheLoadTime, dirsTime, cacheSaveTime;
 
 	Com_Printf( "----- FS_Startup -----\n" );
 
@@ -4747,12 +6033,18 @@ static void FS_Startup( void ) {
 
 	start = Sys_Milliseconds();
 
+#ifdef USE_PK3_SCAN
+	Com_Memset( &fs_scanStats, 0, sizeof( fs_scanStats ) );
+#endif
+
 #ifdef USE_PK3_CACHE
 #ifdef USE_PK3_CACHE_FILE
 	FS_LoadCache();
 #endif
 #endif
 
+	cacheLoadTime = Sys_Milliseconds() - start;
+
 	// add search path elements in reverse priority order
 	if ( fs_steampath->string[0] ) {
         FS_AddGameDirectory(va("%s/q3ut4", fs_steampath->string), "download");
@@ -4784,6 +6076,8 @@ static void FS_Startup( void ) {
 		}
 	}
 
+	dirsTime = Sys_Milliseconds() - start - cacheLoadTime;
+
 	// reorder search paths to minimize further changes
 	FS_ReorderSearchPaths();
 
@@ -4844,12 +6138,26 @@ static void FS_Startup( void ) {
 	}
 #endif
 
+	cacheSaveTime = Sys_Milliseconds();
+
 #ifdef USE_PK3_CACHE
 	FS_FreeUnusedCache();
 #ifdef USE_PK3_CACHE_FILE
 	FS_SaveCache();
 #endif
 #endif
+
+	cacheSaveTime = Sys_Milliseconds() - cacheSaveTime;
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_Startup: cache load %i msec, game directories %i msec, search order and checksums %i msec, cache save %i msec\n",
+			cacheLoadTime, dirsTime, end - start - cacheLoadTime - dirsTime, cacheSaveTime );
+#ifdef USE_PK3_SCAN
+		Com_Printf( "FS_Startup: scanned %i new pk3 files in %i batches on %i threads: locate %i msec, read %i msec, build %i msec, cache append %i msec\n",
+			fs_scanStats.paks, fs_scanStats.batches, Com_NumJobThreads(), fs_scanStats.locateMsec,
+			fs_scanStats.readMsec, fs_scanStats.buildMsec, fs_scanStats.appendMsec );
+#endif
+	}
 }
 
 
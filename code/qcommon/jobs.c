@@ -0,0 +1,231 @@
+// parallel jobs - a fixed pool of worker threads executing index ranges
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#define MAX_JOB_THREADS		16
+
+static cvar_t	*com_workerThreads;
+
+static void		*jobThreads[ MAX_JOB_THREADS ];
+static int		numJobThreads;
+
+static void		*jobMutex;
+static void		*jobWakeEvent;
+static void		*jobDoneEvent;
+
+// current batch, guarded by jobMutex
+static void		(*jobFunc)( void *arg, int index );
+static void		*jobArg;
+static int		jobCount;
+static int		jobNext;
+static qboolean	jobsRunning;
+static qboolean	jobsExit;
+
+
+/*
+=================
+Com_TakeJob
+
+Returns next unprocessed index of the current batch or -1
+=================
+*/
+static int Com_TakeJob( void )
+{
+	int index;
+
+	Sys_MutexLock( jobMutex );
+	if ( jobNext < jobCount )
+		index = jobNext++;
+	else
+		index = -1;
+	Sys_MutexUnlock( jobMutex );
+
+	return index;
+}
+
+
+/*
+=================
+Com_JobThread
+=================
+*/
+static void Com_JobThread( void *arg )
+{
+	int index;
+
+	while ( 1 ) {
+		Sys_SemaphoreWait( jobWakeEvent );
+		if ( jobsExit )
+			break;
+		while ( ( index = Com_TakeJob() ) >= 0 ) {
+			jobFunc( jobArg, index );
+		}
+		Sys_SemaphorePost( jobDoneEvent );
+	}
+}
+
+
+/*
+=================
+Com_RunJobs
+
+Calls func( arg, index ) for every index in [0..count-1] using the worker
+pool and the calling thread, returns when all of them are completed.
+Job functions must not use engine services that are not thread-safe,
+i.e. memory allocators, filesystem, console output or Com_Error().
+Index 0 is always executed by the calling thread.
+Nested or concurrent batches are executed serially by the caller.
+=================
+*/
+void Com_RunJobs( void (*func)( void *arg, int index ), void *arg, int count )
+{
+	int i, numWorkers, index;
+
+	if ( count <= 0 )
+		return;
+
+	numWorkers = 0;
+	if ( numJobThreads > 0 && count > 1 ) {
+		Sys_MutexLock( jobMutex );
+		if ( !jobsRunning ) {
+			jobsRunning = qtrue;
+			jobFunc = func;
+			jobArg = arg;
+			jobCount = count;
+			jobNext = 1; // reserved for the caller
+			numWorkers = MIN( numJobThreads, count - 1 );
+		}
+		Sys_MutexUnlock( jobMutex );
+	}
+
+	if ( numWorkers == 0 ) {
+		for ( i = 0; i < count; i++ ) {
+			func( arg, i );
+		}
+		return;
+	}
+
+	for ( i = 0; i < numWorkers; i++ ) {
+		Sys_SemaphorePost( jobWakeEvent );
+	}
+
+	func( arg, 0 );
+
+	while ( ( index = Com_TakeJob() ) >= 0 ) {
+		func( arg, index );
+	}
+
+	for ( i = 0; i < numWorkers; i++ ) {
+		Sys_SemaphoreWait( jobDoneEvent );
+	}
+
+	Sys_MutexLock( jobMutex );
+	jobsRunning = qfalse;
+	Sys_MutexUnlock( jobMutex );
+}
+
+
+/*
+=================
+Com_NumJobThreads
+
+Returns number of threads that may execute a batch, including the caller
+=================
+*/
+int Com_NumJobThreads( void )
+{
+	return numJobThreads + 1;
+}
+
+
+/*
+=================
+Com_InitJobs
+
+May be called again once configs are executed,
+the pool is only recreated if the number of workers changes
+=================
+*/
+void Com_InitJobs( void )
+{
+	int i, n;
+
+	// latched only from the second call on, so configs executed
+	// in between set the value without a restart notice
+	com_workerThreads = Cvar_Get( "com_workerThreads", "0", CVAR_ARCHIVE_ND | ( com_workerThreads ? CVAR_LATCH : 0 ) );
+	Cvar_CheckRange( com_workerThreads, "-1", XSTRING( MAX_JOB_THREADS ), CV_INTEGER );
+	Cvar_SetDescription( com_workerThreads, "Number of worker threads used for parallel jobs like texture processing:\n"
+		" -1 - disabled, everything runs on the main thread\n"
+		"  0 - number of CPU cores minus one\n"
+		"Default: 0" );
+
+	n = com_workerThreads->integer;
+	if ( n == 0 ) {
+		n = Sys_CPUCount() - 1;
+	}
+	if ( n > MAX_JOB_THREADS ) {
+		n = MAX_JOB_THREADS;
+	}
+	if ( n < 0 ) {
+		n = 0;
+	}
+
+	if ( n == numJobThreads ) {
+		return;
+	}
+
+	if ( jobMutex ) {
+		Com_ShutdownJobs();
+	}
+
+	if ( n == 0 ) {
+		return;
+	}
+
+	jobMutex = Sys_CreateMutex();
+	jobWakeEvent = Sys_CreateSemaphore( 0 );
+	jobDoneEvent = Sys_CreateSemaphore( 0 );
+	if ( !jobMutex || !jobWakeEvent || !jobDoneEvent ) {
+		Com_ShutdownJobs();
+		return;
+	}
+
+	jobsExit = qfalse;
+	for ( i = 0; i < n; i++ ) {
+		jobThreads[ i ] = Sys_CreateThread( Com_JobThread, NULL, va( "worker%i", i ) );
+		if ( !jobThreads[ i ] )
+			break;
+		numJobThreads++;
+	}
+
+	Com_Printf( "...using %i worker threads\n", numJobThreads );
+}
+
+
+/*
+=================
+Com_ShutdownJobs
+=================
+*/
+void Com_ShutdownJobs( void )
+{
+	int i;
+
+	jobsExit = qtrue;
+	for ( i = 0; i < numJobThreads; i++ ) {
+		Sys_SemaphorePost( jobWakeEvent );
+	}
+	for ( i = 0; i < numJobThreads; i++ ) {
+		Sys_JoinThread( jobThreads[ i ] );
+		jobThreads[ i ] = NULL;
+	}
+	numJobThreads = 0;
+
+	Sys_DestroySemaphore( jobDoneEvent );
+	Sys_DestroySemaphore( jobWakeEvent );
+	Sys_DestroyMutex( jobMutex );
+	jobDoneEvent = NULL;
+	jobWakeEvent = NULL;
+	jobMutex = NULL;
+}
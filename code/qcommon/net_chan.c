@@ -139,6 +139,7 @@ void Netchan_TransmitNextFragment( netchan_t *chan ) {
 
 	// send the datagram
 	NET_SendPacket( chan->sock, send.cursize, send.data, &chan->remoteAddress );
+	net_stats[ chan->sock ].fragments++;
 
 	// Store send time and size of this packet for rate control
 	chan->lastSentTime = Sys_Milliseconds();
@@ -480,6 +481,8 @@ typedef struct packetQueue_s {
 
 packetQueue_t *packetQueue = NULL;
 
+netStats_t net_stats[ NS_SERVER + 1 ];
+
 static void NET_QueuePacket( int length, const void *data, const netadr_t *to, int offset )
 {
 	packetQueue_t *new, *next = packetQueue;
@@ -544,6 +547,10 @@ void NET_SendPacket( netsrc_t sock, int length, const void *data, const netadr_t
 	if ( to->type == NA_BAD ) {
 		return;
 	}
+
+	net_stats[ sock ].packets++;
+	net_stats[ sock ].bytes += length;
+
 #ifndef DEDICATED
 	if ( sock == NS_CLIENT && cl_packetdelay->integer > 0 ) {
 		NET_QueuePacket( length, data, to, cl_packetdelay->integer );
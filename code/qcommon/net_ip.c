@@ -1777,6 +1777,356 @@ static void NET_Config( qboolean enableNetworking ) {
 }
 
 
+/*
+=============================================================================
+
+LOCAL TCP LISTENERS
+
+Plain request/response connections for local tools such as the server
+metrics endpoint. Sockets are non-blocking and serviced from NET_Sleep,
+a connection is closed once its response is sent or when it times out.
+
+=============================================================================
+*/
+
+#define MAX_TCP_LISTENERS		4
+#define MAX_TCP_CONNECTIONS		4		// per listener
+#define TCP_REQUEST_SIZE		2048
+#define TCP_RESPONSE_SIZE		65536
+#define TCP_TIMEOUT				3000	// msec
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL			0
+#endif
+
+typedef struct {
+	SOCKET		socket;
+	int			startTime;
+	int			requestLength;
+	char		request[ TCP_REQUEST_SIZE ];
+	char		*response;		// allocated once the request is complete
+	int			responseLength;
+	int			responseSent;
+} tcpConnection_t;
+
+struct tcpListener_s {
+	SOCKET				socket;
+	tcpResponseFunc_t	respond;
+	tcpConnection_t		connections[ MAX_TCP_CONNECTIONS ];
+};
+
+static tcpListener_t *tcpListeners[ MAX_TCP_LISTENERS ];
+
+
+/*
+====================
+NET_TCPListen
+
+Opens a listening IPv4 socket, returns NULL on failure
+====================
+*/
+tcpListener_t *NET_TCPListen( const char *address, int port, tcpResponseFunc_t respond ) {
+	struct sockaddr_in	addr;
+	tcpListener_t		*listener;
+	ioctlarg_t			_true = 1;
+	SOCKET				s;
+	int					i, slot;
+
+	for ( slot = 0; slot < MAX_TCP_LISTENERS; slot++ ) {
+		if ( !tcpListeners[ slot ] ) {
+			break;
+		}
+	}
+
+	if ( slot == MAX_TCP_LISTENERS ) {
+		Com_Printf( "WARNING: NET_TCPListen: too many listeners\n" );
+		return NULL;
+	}
+
+	if ( !address || !*address ) {
+		memset( &addr, 0, sizeof( addr ) );
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = INADDR_ANY;
+	} else if ( !Sys_StringToSockaddr( address, (sockaddr_t *)&addr, sizeof( addr ), AF_INET ) ) {
+		Com_Printf( "WARNING: NET_TCPListen: can't resolve %s\n", address );
+		return NULL;
+	}
+
+	addr.sin_port = htons( (unsigned short)port );
+
+	if ( ( s = socket( PF_INET, SOCK_STREAM, IPPROTO_TCP ) ) == INVALID_SOCKET ) {
+		Com_Printf( "WARNING: NET_TCPListen: socket: %s\n", NET_ErrorString() );
+		return NULL;
+	}
+
+#ifndef _WIN32
+	// allow quick restarts, on windows this would allow port stealing instead
+	i = 1;
+	setsockopt( s, SOL_SOCKET, SO_REUSEADDR, (char *)&i, sizeof( i ) );
+#endif
+
+	if ( ioctlsocket( s, FIONBIO, &_true ) == SOCKET_ERROR
+		|| bind( s, (void *)&addr, sizeof( addr ) ) == SOCKET_ERROR
+		|| listen( s, MAX_TCP_CONNECTIONS ) == SOCKET_ERROR ) {
+		Com_Printf( "WARNING: NET_TCPListen: %s:%i: %s\n", address, port, NET_ErrorString() );
+		closesocket( s );
+		return NULL;
+	}
+
+	listener = Z_Malloc( sizeof( *listener ) );
+	listener->socket = s;
+	listener->respond = respond;
+	for ( i = 0; i < MAX_TCP_CONNECTIONS; i++ ) {
+		listener->connections[ i ].socket = INVALID_SOCKET;
+	}
+
+	tcpListeners[ slot ] = listener;
+
+	Com_Printf( "Opening TCP listener: %s:%i\n", ( address && *address ) ? address : "0.0.0.0", port );
+
+	return listener;
+}
+
+
+/*
+====================
+NET_TCPCloseConnection
+====================
+*/
+static void NET_TCPCloseConnection( tcpConnection_t *conn ) {
+
+	closesocket( conn->socket );
+	conn->socket = INVALID_SOCKET;
+
+	if ( conn->response ) {
+		Z_Free( conn->response );
+		conn->response = NULL;
+	}
+
+	conn->requestLength = 0;
+	conn->responseLength = 0;
+	conn->responseSent = 0;
+}
+
+
+/*
+====================
+NET_TCPClose
+====================
+*/
+void NET_TCPClose( tcpListener_t *listener ) {
+	int i;
+
+	if ( !listener ) {
+		return;
+	}
+
+	for ( i = 0; i < MAX_TCP_CONNECTIONS; i++ ) {
+		if ( listener->connections[ i ].socket != INVALID_SOCKET ) {
+			NET_TCPCloseConnection( &listener->connections[ i ] );
+		}
+	}
+
+	for ( i = 0; i < MAX_TCP_LISTENERS; i++ ) {
+		if ( tcpListeners[ i ] == listener ) {
+			tcpListeners[ i ] = NULL;
+		}
+	}
+
+	closesocket( listener->socket );
+	Z_Free( listener );
+}
+
+
+/*
+====================
+NET_TCPAccept
+====================
+*/
+static void NET_TCPAccept( tcpListener_t *listener, int now ) {
+	tcpConnection_t	*conn;
+	ioctlarg_t		_true = 1;
+	SOCKET			s;
+	int				i;
+
+	for ( i = 0; i < MAX_TCP_CONNECTIONS; i++ ) {
+		conn = &listener->connections[ i ];
+		if ( conn->socket != INVALID_SOCKET ) {
+			continue;
+		}
+
+		// extra connections are left in the backlog
+		s = accept( listener->socket, NULL, NULL );
+		if ( s == INVALID_SOCKET ) {
+			break;
+		}
+
+		if ( ioctlsocket( s, FIONBIO, &_true ) == SOCKET_ERROR ) {
+			closesocket( s );
+			continue;
+		}
+
+#ifdef SO_NOSIGPIPE
+		setsockopt( s, SOL_SOCKET, SO_NOSIGPIPE, (char *)&_true, sizeof( _true ) );
+#endif
+
+		conn->socket = s;
+		conn->startTime = now;
+	}
+}
+
+
+/*
+====================
+NET_TCPRead
+
+Returns qfalse if the connection should be closed
+====================
+*/
+static qboolean NET_TCPRead( tcpListener_t *listener, tcpConnection_t *conn ) {
+	int ret;
+
+	while ( conn->requestLength < TCP_REQUEST_SIZE - 1 ) {
+		ret = recv( conn->socket, conn->request + conn->requestLength, TCP_REQUEST_SIZE - 1 - conn->requestLength, 0 );
+		if ( ret == 0 ) {
+			return qfalse;
+		}
+		if ( ret == SOCKET_ERROR ) {
+			return ( socketError == EAGAIN ) ? qtrue : qfalse;
+		}
+
+		conn->requestLength += ret;
+		conn->request[ conn->requestLength ] = '\0';
+
+		// only headers are expected
+		if ( strstr( conn->request, "\r\n\r\n" ) || strstr( conn->request, "\n\n" ) ) {
+			break;
+		}
+	}
+
+	conn->response = Z_Malloc( TCP_RESPONSE_SIZE );
+	conn->responseLength = listener->respond( conn->request, conn->requestLength, conn->response, TCP_RESPONSE_SIZE );
+	conn->responseSent = 0;
+
+	return ( conn->responseLength > 0 ) ? qtrue : qfalse;
+}
+
+
+/*
+====================
+NET_TCPWrite
+
+Returns qfalse once the response is sent or on error
+====================
+*/
+static qboolean NET_TCPWrite( tcpConnection_t *conn ) {
+	int ret;
+
+	while ( conn->responseSent < conn->responseLength ) {
+		ret = send( conn->socket, conn->response + conn->responseSent, conn->responseLength - conn->responseSent, MSG_NOSIGNAL );
+		if ( ret == SOCKET_ERROR ) {
+			return ( socketError == EAGAIN ) ? qtrue : qfalse;
+		}
+		conn->responseSent += ret;
+	}
+
+	return qfalse;
+}
+
+
+/*
+====================
+NET_TCPSetFds
+
+Adds listening sockets and pending connections to the select() sets
+====================
+*/
+static SOCKET NET_TCPSetFds( fd_set *fdr, fd_set *fdw, SOCKET highestfd ) {
+	const tcpListener_t *listener;
+	const tcpConnection_t *conn;
+	qboolean full;
+	int i, j;
+
+	for ( i = 0; i < MAX_TCP_LISTENERS; i++ ) {
+		listener = tcpListeners[ i ];
+		if ( !listener ) {
+			continue;
+		}
+
+		full = qtrue;
+		for ( j = 0; j < MAX_TCP_CONNECTIONS; j++ ) {
+			conn = &listener->connections[ j ];
+			if ( conn->socket == INVALID_SOCKET ) {
+				full = qfalse;
+				continue;
+			}
+			if ( conn->response ) {
+				FD_SET( conn->socket, fdw );
+			} else {
+				FD_SET( conn->socket, fdr );
+			}
+			if ( highestfd == INVALID_SOCKET || conn->socket > highestfd )
+				highestfd = conn->socket;
+		}
+
+		// pending connections wait in the backlog until a slot is free
+		if ( !full ) {
+			FD_SET( listener->socket, fdr );
+			if ( highestfd == INVALID_SOCKET || listener->socket > highestfd )
+				highestfd = listener->socket;
+		}
+	}
+
+	return highestfd;
+}
+
+
+/*
+====================
+NET_TCPService
+
+Never blocks, called after every select() in NET_Sleep
+====================
+*/
+static void NET_TCPService( void ) {
+	tcpListener_t *listener;
+	tcpConnection_t *conn;
+	qboolean keep;
+	int i, j, now;
+
+	now = Sys_Milliseconds();
+
+	for ( i = 0; i < MAX_TCP_LISTENERS; i++ ) {
+		listener = tcpListeners[ i ];
+		if ( !listener ) {
+			continue;
+		}
+
+		NET_TCPAccept( listener, now );
+
+		for ( j = 0; j < MAX_TCP_CONNECTIONS; j++ ) {
+			conn = &listener->connections[ j ];
+			if ( conn->socket == INVALID_SOCKET ) {
+				continue;
+			}
+
+			if ( !conn->response ) {
+				keep = NET_TCPRead( listener, conn );
+				if ( keep && conn->response ) {
+					keep = NET_TCPWrite( conn );
+				}
+			} else {
+				keep = NET_TCPWrite( conn );
+			}
+
+			if ( !keep || now - conn->startTime > TCP_TIMEOUT ) {
+				NET_TCPCloseConnection( conn );
+			}
+		}
+	}
+}
+
+
 /*
 ====================
 NET_Init
@@ -1834,7 +2184,10 @@ static void NET_Event( const fd_set *fdr )
 	byte bufData[ MAX_MSGLEN_BUF ];
 	netadr_t from;
 	msg_t netmsg;
-	
+	int64_t profileStart;
+
+	profileStart = PROFILE_START( PROFILE_FRAME );
+
 	while( 1 )
 	{
 		MSG_Init( &netmsg, bufData, MAX_MSGLEN );
@@ -1860,6 +2213,8 @@ static void NET_Event( const fd_set *fdr )
 		else
 			break;
 	}
+
+	PROFILE_END( profileStart, "NET_Event", -1 );
 }
 
 
@@ -1875,14 +2230,16 @@ Returns qfalse on network event or qtrue in all other cases
 qboolean NET_Sleep( int timeout )
 {
 	struct timeval tv;
-	fd_set fdr;
+	fd_set fdr, fdw;
 	int retval;
 	SOCKET highestfd = INVALID_SOCKET;
+	qboolean packets;
 
 	if ( timeout < 0 )
 		timeout = 0;
 
 	FD_ZERO( &fdr );
+	FD_ZERO( &fdw );
 
 	if ( ip_socket != INVALID_SOCKET )
 	{
@@ -1901,6 +2258,8 @@ qboolean NET_Sleep( int timeout )
 	}
 #endif
 
+	highestfd = NET_TCPSetFds( &fdr, &fdw, highestfd );
+
 	if ( highestfd == INVALID_SOCKET )
 	{
 #ifdef _WIN32
@@ -1916,11 +2275,21 @@ qboolean NET_Sleep( int timeout )
 	tv.tv_sec = timeout / 1000000;
 	tv.tv_usec = timeout - tv.tv_sec * 1000000;
 
-	retval = select( highestfd + 1, &fdr, NULL, NULL, &tv );
+	retval = select( highestfd + 1, &fdr, &fdw, NULL, &tv );
+
+	NET_TCPService();
 
 	if ( retval > 0 ) {
-		NET_Event( &fdr );
-		return qfalse;
+		packets = ( ip_socket != INVALID_SOCKET && FD_ISSET( ip_socket, &fdr ) ) ? qtrue : qfalse;
+#ifdef USE_IPV6
+		if ( ip6_socket != INVALID_SOCKET && FD_ISSET( ip6_socket, &fdr ) )
+			packets = qtrue;
+#endif
+		// local tcp traffic doesn't wake up the frame
+		if ( packets ) {
+			NET_Event( &fdr );
+			return qfalse;
+		}
 	}
 
 	if ( retval == SOCKET_ERROR ) {
@@ -0,0 +1,353 @@
+// frame profiler - scoped timing events recorded into per-thread rings,
+// written out as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev)
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#define PROFILE_THREAD_LOCAL	__declspec( thread )
+#define PROFILE_BARRIER()		MemoryBarrier()
+#else
+#define PROFILE_THREAD_LOCAL	__thread
+#define PROFILE_BARRIER()		__sync_synchronize()
+#endif
+
+#define MAX_PROFILE_THREADS		32
+#define PROFILE_RING_SIZE		65536	// events per thread, power of two
+#define MAX_PROFILE_NAMES		64		// names copied for dynamically loaded modules
+#define MAX_PROFILE_NAME		64
+
+typedef struct {
+	const char	*name;		// engine-owned string, arg is appended to names ending with ':'
+	int64_t		start;		// Sys_Microseconds()
+	int			duration;
+	int			arg;		// -1 if none
+} profileEvent_t;
+
+typedef struct {
+	profileEvent_t			*events;
+	volatile unsigned int	count;	// events written by the owner thread, wraps
+	const char				*name;
+} profileThread_t;
+
+int com_profileLevel;
+
+static cvar_t			*com_profile;
+
+static void				*profileMutex;
+static profileThread_t	profileThreads[ MAX_PROFILE_THREADS ];
+static int				numProfileThreads;
+static profileThread_t	profileNoThread;	// used when out of rings
+
+static char				profileNames[ MAX_PROFILE_NAMES ][ MAX_PROFILE_NAME ];
+static int				numProfileNames;
+
+static PROFILE_THREAD_LOCAL profileThread_t *profileThread;
+
+
+/*
+=================
+Com_ProfileRegister
+
+Claims a ring for the calling thread, rings are never released
+as their events may be dumped after the thread exited
+=================
+*/
+static profileThread_t *Com_ProfileRegister( const char *name )
+{
+	profileThread_t *t;
+
+	t = &profileNoThread;
+
+	Sys_MutexLock( profileMutex );
+	if ( numProfileThreads < MAX_PROFILE_THREADS ) {
+		// plain malloc, zone and hunk allocators are not thread-safe
+		profileEvent_t *events = malloc( PROFILE_RING_SIZE * sizeof( *events ) );
+		if ( events ) {
+			t = &profileThreads[ numProfileThreads ];
+			t->events = events;
+			t->count = 0;
+			t->name = name;
+			numProfileThreads++;
+		}
+	}
+	Sys_MutexUnlock( profileMutex );
+
+	profileThread = t;
+
+	return t;
+}
+
+
+/*
+=================
+Com_ProfileName
+
+Returns an engine-owned copy of the event name, recorded events outlive
+modules like the renderer which may be unloaded while they are in the rings
+=================
+*/
+const char *Com_ProfileName( const char *name )
+{
+	const char *s;
+	int i;
+
+	Sys_MutexLock( profileMutex );
+
+	for ( i = 0; i < numProfileNames; i++ ) {
+		if ( !strcmp( profileNames[i], name ) ) {
+			break;
+		}
+	}
+
+	if ( i == numProfileNames ) {
+		if ( numProfileNames < MAX_PROFILE_NAMES ) {
+			Q_strncpyz( profileNames[i], name, sizeof( profileNames[i] ) );
+			numProfileNames++;
+		}
+	}
+
+	s = ( i < numProfileNames ) ? profileNames[i] : "unnamed";
+
+	Sys_MutexUnlock( profileMutex );
+
+	return s;
+}
+
+
+/*
+=================
+Com_ProfileStart
+
+Returns start time of a scope or 0 if events of this level are not recorded
+=================
+*/
+int64_t Com_ProfileStart( int level )
+{
+	return PROFILE_START( level );
+}
+
+
+/*
+=================
+Com_ProfileEvent
+
+Records a scope which started at the given time and ends now,
+nested scopes are recorded before their parents
+=================
+*/
+void Com_ProfileEvent( const char *name, int arg, int64_t start )
+{
+	profileThread_t *t;
+	profileEvent_t *ev;
+	int64_t end;
+
+	end = Sys_Microseconds();
+
+	t = profileThread;
+	if ( !t ) {
+		t = Com_ProfileRegister( NULL );
+	}
+
+	if ( !t->events ) {
+		return;
+	}
+
+	ev = &t->events[ t->count & ( PROFILE_RING_SIZE - 1 ) ];
+	ev->name = name;
+	ev->start = start;
+	ev->duration = (int)( end - start );
+	ev->arg = arg;
+
+	// publish the event before the count
+	PROFILE_BARRIER();
+	t->count++;
+}
+
+
+/*
+=================
+Com_ProfileFrame
+
+Called by the main thread at the start of every frame
+=================
+*/
+void Com_ProfileFrame( void )
+{
+	if ( !com_profile->modified ) {
+		return;
+	}
+
+	com_profile->modified = qfalse;
+	com_profileLevel = com_profile->integer;
+
+	if ( com_profileLevel && !profileThread ) {
+		Com_ProfileRegister( "main" );
+	}
+}
+
+
+/*
+=================
+Com_ProfileCopyEvents
+
+Copies all events of a thread that are not being overwritten,
+returns number of them
+=================
+*/
+static int Com_ProfileCopyEvents( const profileThread_t *t, profileEvent_t *out )
+{
+	unsigned int first, last, count, i;
+
+	last = t->count;
+	PROFILE_BARRIER();
+
+	first = last > PROFILE_RING_SIZE ? last - PROFILE_RING_SIZE : 0;
+	for ( i = first; i != last; i++ ) {
+		out[ i - first ] = t->events[ i & ( PROFILE_RING_SIZE - 1 ) ];
+	}
+
+	// drop events the owner wrote over while copying, the slot
+	// of the next event may be written as well
+	PROFILE_BARRIER();
+	count = t->count + 1;
+	if ( count - first > PROFILE_RING_SIZE ) {
+		i = count - PROFILE_RING_SIZE;
+		if ( i - first > last - first ) {
+			i = last;
+		}
+		memmove( out, out + ( i - first ), ( last - i ) * sizeof( out[0] ) );
+		first = i;
+	}
+
+	return (int)( last - first );
+}
+
+
+/*
+=================
+Com_ProfileDump_f
+=================
+*/
+static void Com_ProfileDump_f( void )
+{
+	char name[ MAX_QPATH ], line[ 256 ], eventName[ 64 ], args[ 32 ];
+	profileEvent_t *events;
+	fileHandle_t f;
+	int64_t base;
+	int i, j, n, len, total, threads;
+	const char *sep;
+
+	if ( Cmd_Argc() > 2 ) {
+		Com_Printf( "usage: profiledump [filename]\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() == 2 ) {
+		Q_strncpyz( name, Cmd_Argv( 1 ), sizeof( name ) );
+	} else {
+		Q_strncpyz( name, "profile", sizeof( name ) );
+	}
+	COM_DefaultExtension( name, sizeof( name ), ".json" );
+
+	Sys_MutexLock( profileMutex );
+	threads = numProfileThreads;
+	Sys_MutexUnlock( profileMutex );
+
+	if ( !threads ) {
+		Com_Printf( "No profile events recorded, set com_profile 1 or 2 first.\n" );
+		return;
+	}
+
+	f = FS_FOpenFileWrite( name );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( S_COLOR_YELLOW "Couldn't write %s.\n", name );
+		return;
+	}
+
+	events = malloc( PROFILE_RING_SIZE * sizeof( *events ) );
+	if ( !events ) {
+		FS_FCloseFile( f );
+		Com_Printf( S_COLOR_YELLOW "Out of memory for profile events.\n" );
+		return;
+	}
+
+	// timestamps relative to the oldest event of all threads
+	base = 0;
+	for ( i = 0; i < threads; i++ ) {
+		n = Com_ProfileCopyEvents( &profileThreads[i], events );
+		for ( j = 0; j < n; j++ ) {
+			if ( !base || events[j].start < base ) {
+				base = events[j].start;
+			}
+		}
+	}
+
+	FS_Printf( f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+	sep = "";
+	total = 0;
+	for ( i = 0; i < threads; i++ ) {
+		if ( profileThreads[i].name ) {
+			FS_Printf( f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+				sep, i, profileThreads[i].name );
+		} else {
+			FS_Printf( f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"thread %i\"}}",
+				sep, i, i );
+		}
+		sep = ",\n";
+
+		n = Com_ProfileCopyEvents( &profileThreads[i], events );
+		for ( j = 0; j < n; j++ ) {
+			const profileEvent_t *ev = &events[j];
+			len = (int)strlen( ev->name );
+			if ( len && ev->name[ len - 1 ] == ':' ) {
+				Com_sprintf( eventName, sizeof( eventName ), "%s%i", ev->name, ev->arg );
+				args[0] = '\0';
+			} else {
+				Q_strncpyz( eventName, ev->name, sizeof( eventName ) );
+				if ( ev->arg >= 0 ) {
+					Com_sprintf( args, sizeof( args ), ",\"args\":{\"arg\":%i}", ev->arg );
+				} else {
+					args[0] = '\0';
+				}
+			}
+			Com_sprintf( line, sizeof( line ), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.0f,\"dur\":%i%s}",
+				eventName, i, (double)( ev->start - base ), ev->duration, args );
+			FS_Write( line, (int)strlen( line ), f );
+		}
+		total += n;
+	}
+
+	FS_Printf( f, "\n]}\n" );
+	FS_FCloseFile( f );
+
+	free( events );
+
+	Com_Printf( "Wrote %i events of %i threads to %s\n", total, threads, name );
+}
+
+
+/*
+=================
+Com_InitProfile
+=================
+*/
+void Com_InitProfile( void )
+{
+	com_profile = Cvar_Get( "com_profile", "0", CVAR_TEMP );
+	Cvar_CheckRange( com_profile, "0", "2", CV_INTEGER );
+	Cvar_SetDescription( com_profile, "Record timing events for \\profiledump:\n"
+		" 0 - disabled\n"
+		" 1 - frame stages, vm calls, network events and renderer\n"
+		" 2 - also collision traces and per client snapshots\n"
+		"Default: 0" );
+	com_profile->modified = qtrue;
+
+	if ( !profileMutex ) {
+		profileMutex = Sys_CreateMutex();
+	}
+
+	Cmd_AddCommand( "profiledump", Com_ProfileDump_f );
+}
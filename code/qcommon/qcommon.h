@@ -284,6 +284,23 @@ void		NET_LeaveMulticast6( void );
 #endif
 qboolean	NET_Sleep( int timeout );
 
+// outgoing traffic of NET_SendPacket, indexed by netsrc_t
+typedef struct {
+	int64_t		packets;
+	int64_t		bytes;
+	int64_t		fragments;		// packets of fragmented netchan messages
+} netStats_t;
+
+extern netStats_t	net_stats[ NS_SERVER + 1 ];
+
+// local TCP request/response listener serviced from NET_Sleep,
+// the callback writes a complete response and returns its length
+typedef struct tcpListener_s tcpListener_t;
+typedef int (*tcpResponseFunc_t)( const char *request, int requestLength, char *response, int responseSize );
+
+tcpListener_t *NET_TCPListen( const char *address, int port, tcpResponseFunc_t respond );
+void		NET_TCPClose( tcpListener_t *listener );
+
 #define	MAX_PACKETLEN	1400	// max size of a network packet
 
 #define	MAX_MSGLEN		16384	// max length of a message, which may
@@ -809,7 +826,11 @@ qboolean FS_ResetReadOnlyAttribute( const char *filename );
 qboolean FS_SV_FileExists( const char *file );
 
 fileHandle_t FS_SV_FOpenFileWrite( const char *filename );
+fileHandle_t FS_SV_FOpenFileAppend( const char *filename );
 int		FS_SV_FOpenFileRead( const char *filename, fileHandle_t *fp );
+const byte *FS_SV_MapFile( const char *filename, int *size );
+void	FS_SV_UnmapFile( const byte *data, int size );
+qboolean FS_SV_FileStats( const char *filename, fileOffset_t *size, fileTime_t *mtime );
 void	FS_SV_Rename( const char *from, const char *to );
 int		FS_FOpenFileRead( const char *qpath, fileHandle_t *file, qboolean uniqueFILE );
 // if uniqueFILE is true, then a new FILE will be fopened even if the file
@@ -831,6 +852,9 @@ int FS_Home_FOpenFileRead( const char *filename, fileHandle_t *file );
 qboolean FS_FileIsInPAK( const char *filename, int *pChecksum, char *pakName );
 // returns qtrue if a file is in the PAK file, otherwise qfalse
 
+qboolean FS_FilePakChecksum( const char *filename, int *pChecksum );
+// returns qtrue and checksum of the pk3 file will be actually read from
+
 int		FS_PakIndexForHandle( fileHandle_t f );
 
 // returns pak index or -1 if file is not in pak
@@ -840,6 +864,15 @@ extern qboolean fs_reordered;
 
 int		FS_Write( const void *buffer, int len, fileHandle_t f );
 
+typedef struct {
+	const void	*data;
+	int			len;
+} fsIOVec_t;
+
+int		FS_WriteVec( const fsIOVec_t *vec, int count, fileHandle_t f );
+// writes several buffers in order, returns total length or -1 on failure;
+// doesn't use Com_Error() and may be called from a worker thread that owns the handle
+
 int		FS_Read( void *buffer, int len, fileHandle_t f );
 // properly handles partial reads and reads from other dlls
 
@@ -1388,6 +1421,11 @@ void Sys_FreeFileList( char **list );
 
 qboolean Sys_GetFileStats( const char *filename, fileOffset_t *size, fileTime_t *mtime, fileTime_t *ctime );
 
+// read-only shared mapping of an open file, the mapping outlives the FILE
+void *Sys_MapFile( FILE *f, int size );
+void Sys_UnmapFile( void *data, int size );
+qboolean Sys_ReadMappedFile( void *dst, const void *src, int size );
+
 void Sys_BeginProfiling( void );
 void Sys_EndProfiling( void );
 
@@ -1400,6 +1438,41 @@ void *Sys_LoadFunction( void *handle, const char *name );
 int   Sys_LoadFunctionErrors( void );
 void  Sys_UnloadLibrary( void *handle );
 
+// threading primitives, handles are opaque
+void *Sys_CreateThread( void (*func)( void *arg ), void *arg, const char *name );
+void  Sys_JoinThread( void *thread );
+void *Sys_CreateMutex( void );
+void  Sys_DestroyMutex( void *mutex );
+void  Sys_MutexLock( void *mutex );
+void  Sys_MutexUnlock( void *mutex );
+void *Sys_CreateSemaphore( int initialCount );
+void  Sys_DestroySemaphore( void *sem );
+void  Sys_SemaphorePost( void *sem );
+void  Sys_SemaphoreWait( void *sem );
+int   Sys_CPUCount( void );
+
+// parallel jobs, see jobs.c
+void Com_InitJobs( void );
+void Com_ShutdownJobs( void );
+int  Com_NumJobThreads( void );
+void Com_RunJobs( void (*func)( void *arg, int index ), void *arg, int count );
+
+// frame profiler, see profile.c
+#define PROFILE_FRAME	1	// frame stages, vm calls, network events, renderer
+#define PROFILE_DETAIL	2	// also collision traces and per client snapshots
+
+extern int com_profileLevel;
+
+void	Com_InitProfile( void );
+void	Com_ProfileFrame( void );
+int64_t	Com_ProfileStart( int level );
+void	Com_ProfileEvent( const char *name, int arg, int64_t start );
+const char *Com_ProfileName( const char *name );
+
+// start = PROFILE_START( level ); ... PROFILE_END( start, name, arg );
+#define PROFILE_START( level )	( com_profileLevel >= (level) ? Sys_Microseconds() : 0 )
+#define PROFILE_END( start, name, arg )	do { if ( start ) Com_ProfileEvent( name, arg, start ); } while ( 0 )
+
 // adaptive huffman functions
 void Huff_Compress( msg_t *buf, int offset );
 void Huff_Decompress( msg_t *buf, int offset );
@@ -181,6 +181,12 @@ extern int unzStringFileNameCompare (const char* fileName1, const char* fileName
 extern unzFile unzOpen (const char *path);
 extern unzFile unzReOpen (const char* path, unzFile file);
 
+/*
+  Returns position of the end of central directory record or 0 if not found,
+    doesn't allocate any memory and can be used from worker threads.
+*/
+extern unsigned long unzlocal_SearchCentralDir (FILE *fin);
+
 /*
   Open a Zip file. path contain the full pathname (by example,
      on a Windows NT computer "c:\\zlib\\zlib111.zip" or on an Unix computer
@@ -220,6 +220,13 @@ static const char *vmName[ VM_COUNT ] = {
 	"ui"
 };
 
+// profile event names, the entry point number is appended
+static const char *vmProfileName[ VM_COUNT ] = {
+	"vmMain qagame:",
+	"vmMain cgame:",
+	"vmMain ui:"
+};
+
 static void VM_VmInfo_f( void );
 static void VM_VmProfile_f( void );
 
@@ -1940,6 +1947,7 @@ intptr_t QDECL VM_Call( vm_t *vm, int nargs, int callnum, ... )
 	//vm_t	*oldVM;
 	intptr_t r;
 	int i;
+	int64_t profileStart;
 
 	if ( !vm ) {
 		Com_Error( ERR_FATAL, "VM_Call with NULL vm" );
@@ -1955,6 +1963,8 @@ intptr_t QDECL VM_Call( vm_t *vm, int nargs, int callnum, ... )
 	}
 #endif
 
+	profileStart = PROFILE_START( PROFILE_FRAME );
+
 	++vm->callLevel;
 	// if we have a dll loaded, call it directly
 	if ( vm->entryPoint )
@@ -1998,6 +2008,8 @@ intptr_t QDECL VM_Call( vm_t *vm, int nargs, int callnum, ... )
 	}
 	--vm->callLevel;
 
+	PROFILE_END( profileStart, vmProfileName[ vm->index ], callnum );
+
 	return r;
 }
 
@@ -1581,6 +1581,9 @@ RB_ExecuteRenderCommands
 ====================
 */
 void RB_ExecuteRenderCommands( const void *data ) {
+	int64_t profileStart;
+
+	profileStart = ri.Com_ProfileStart( PROFILE_FRAME );
 
 	backEnd.pc.msec = ri.Milliseconds();
 
@@ -1618,6 +1621,9 @@ void RB_ExecuteRenderCommands( const void *data ) {
 		case RC_END_OF_LIST:
 		default:
 			// stop rendering
+			if ( profileStart ) {
+				ri.Com_ProfileEvent( "RB_ExecuteRenderCommands", -1, profileStart );
+			}
 			return;
 		}
 	}
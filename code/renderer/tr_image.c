@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static byte			 s_intensitytable[256];
 static unsigned char s_gammatable[256];
+static byte			 s_gammaintensitytable[256];
 
 static unsigned char s_gammatable_linear[256];
 
@@ -243,43 +244,10 @@ before or after.
 */
 static void ResampleTexture( unsigned *in, int inwidth, int inheight, unsigned *out,  
 							int outwidth, int outheight ) {
-	int		i, j;
-	unsigned	*inrow, *inrow2;
-	unsigned	frac, fracstep;
-	unsigned	p1[MAX_TEXTURE_SIZE];
-	unsigned	p2[MAX_TEXTURE_SIZE];
-	byte		*pix1, *pix2, *pix3, *pix4;
-
-	if ( outwidth > ARRAY_LEN( p1 ) )
+	if ( outwidth > MAX_TEXTURE_SIZE )
 		ri.Error( ERR_DROP, "ResampleTexture: max width" );
-								
-	fracstep = inwidth * 0x10000 / outwidth;
-
-	frac = fracstep>>2;
-	for ( i=0 ; i<outwidth ; i++ ) {
-		p1[i] = 4*(frac>>16);
-		frac += fracstep;
-	}
-	frac = 3*(fracstep>>2);
-	for ( i=0 ; i<outwidth ; i++ ) {
-		p2[i] = 4*(frac>>16);
-		frac += fracstep;
-	}
-
-	for (i=0 ; i<outheight ; i++, out += outwidth) {
-		inrow = in + inwidth*(int)((i+0.25)*inheight/outheight);
-		inrow2 = in + inwidth*(int)((i+0.75)*inheight/outheight);
-		for (j=0 ; j<outwidth ; j++) {
-			pix1 = (byte *)inrow + p1[j];
-			pix2 = (byte *)inrow + p2[j];
-			pix3 = (byte *)inrow2 + p1[j];
-			pix4 = (byte *)inrow2 + p2[j];
-			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
-			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
-			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
-			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
-		}
-	}
+
+	imageKernels->ResampleTexture( in, inwidth, inheight, out, outwidth, outheight );
 }
 
 
@@ -300,46 +268,18 @@ static void R_LightScaleTexture( byte *in, int inwidth, int inheight, qboolean o
 	{
 		if ( !glConfig.deviceSupportsGamma && !fboEnabled )
 		{
-			int		i, c;
-			byte	*p;
-
-			p = (byte *)in;
-
-			c = inwidth*inheight;
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[p[0]];
-				p[1] = s_gammatable[p[1]];
-				p[2] = s_gammatable[p[2]];
-			}
+			imageKernels->LightScale( in, inwidth * inheight, s_gammatable );
 		}
 	}
 	else
 	{
-		int		i, c;
-		byte	*p;
-
-		p = (byte *)in;
-
-		c = inwidth*inheight;
-
 		if ( glConfig.deviceSupportsGamma || fboEnabled )
 		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_intensitytable[p[0]];
-				p[1] = s_intensitytable[p[1]];
-				p[2] = s_intensitytable[p[2]];
-			}
+			imageKernels->LightScale( in, inwidth * inheight, s_intensitytable );
 		}
 		else
 		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[s_intensitytable[p[0]]];
-				p[1] = s_gammatable[s_intensitytable[p[1]]];
-				p[2] = s_gammatable[s_intensitytable[p[2]]];
-			}
+			imageKernels->LightScale( in, inwidth * inheight, s_gammaintensitytable );
 		}
 	}
 }
@@ -354,57 +294,21 @@ Proper linear filter
 ================
 */
 static void R_MipMap2( unsigned * const out, unsigned * const in, int inWidth, int inHeight ) {
-	int			i, j, k;
-	byte		*outpix;
-	int			inWidthMask, inHeightMask;
-	int			total;
 	int			outWidth, outHeight;
 	unsigned	*temp;
 
+	if ( out != in ) {
+		imageKernels->MipMap2( out, in, inWidth, inHeight );
+		return;
+	}
+
 	outWidth = inWidth >> 1;
 	outHeight = inHeight >> 1;
 
-	if ( out == in )
-		temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
-	else
-		temp = out;
-
-	inWidthMask = inWidth - 1;
-	inHeightMask = inHeight - 1;
-
-	for ( i = 0 ; i < outHeight ; i++ ) {
-		for ( j = 0 ; j < outWidth ; j++ ) {
-			outpix = (byte *) ( temp + i * outWidth + j );
-			for ( k = 0 ; k < 4 ; k++ ) {
-				total = 
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
-				outpix[k] = total / 36;
-			}
-		}
-	}
-
-	if ( out == in ) {
-		Com_Memcpy( out, temp, outWidth * outHeight * 4 );
-		ri.Hunk_FreeTempMemory( temp );
-	}
+	temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
+	imageKernels->MipMap2( temp, in, inWidth, inHeight );
+	Com_Memcpy( out, temp, outWidth * outHeight * 4 );
+	ri.Hunk_FreeTempMemory( temp );
 }
 
 
@@ -475,29 +379,13 @@ static void R_BlendOverTexture( byte *data, int pixelCount, int mipLevel ) {
 		{255,0,255,128}
 	};
 
-	const byte *blend;
-	int		i;
-	int		inverseAlpha;
-	int		premult[3];
-
 	if ( data == NULL )
 		return;
 
 	if ( mipLevel <= 0 )
 		return;
 
-	blend = blendColors[ ( mipLevel - 1 ) % ARRAY_LEN( blendColors ) ];
-
-	inverseAlpha = 255 - blend[3];
-	premult[0] = blend[0] * blend[3];
-	premult[1] = blend[1] * blend[3];
-	premult[2] = blend[2] * blend[3];
-
-	for ( i = 0 ; i < pixelCount ; i++, data+=4 ) {
-		data[0] = ( data[0] * inverseAlpha + premult[0] ) >> 9;
-		data[1] = ( data[1] * inverseAlpha + premult[1] ) >> 9;
-		data[2] = ( data[2] * inverseAlpha + premult[2] ) >> 9;
-	}
+	imageKernels->BlendOverTexture( data, pixelCount, blendColors[ ( mipLevel - 1 ) % ARRAY_LEN( blendColors ) ] );
 }
 
 
@@ -1053,6 +941,37 @@ image_t	*R_FindImageFile( const char *name, imgFlags_t flags )
 }
 
 
+/*
+===============
+R_ImageBench_f
+
+Measures texture processing kernels on the given images
+===============
+*/
+void R_ImageBench_f( void )
+{
+	const char *name;
+	byte *pic;
+	int i, width, height;
+
+	if ( ri.Cmd_Argc() < 2 ) {
+		ri.Printf( PRINT_ALL, "usage: imagebench <image> [image ...]\n" );
+		return;
+	}
+
+	for ( i = 1; i < ri.Cmd_Argc(); i++ ) {
+		name = ri.Cmd_Argv( i );
+		R_LoadImage( name, &pic, &width, &height );
+		if ( pic == NULL ) {
+			ri.Printf( PRINT_WARNING, "imagebench: couldn't load %s\n", name );
+			continue;
+		}
+		R_BenchImageKernels( name, pic, width, height, 10 );
+		ri.Free( pic );
+	}
+}
+
+
 /*
 ================
 R_CreateDlightImage
@@ -1406,6 +1325,10 @@ void R_SetColorMappings( void ) {
 		s_intensitytable[i] = j;
 	}
 
+	for ( i = 0; i < ARRAY_LEN( s_gammaintensitytable ); i++ ) {
+		s_gammaintensitytable[i] = s_gammatable[s_intensitytable[i]];
+	}
+
 	if ( glConfig.deviceSupportsGamma ) {
 		if ( fboEnabled )
 			ri.GLimp_SetGamma( s_gammatable_linear, s_gammatable_linear, s_gammatable_linear );
@@ -1430,6 +1353,8 @@ void R_InitImages( void ) {
 
 	Com_Memset( hashTable, 0, sizeof( hashTable ) );
 
+	R_InitImageKernels();
+
 	// build brightness translation tables
 	R_SetColorMappings();
 
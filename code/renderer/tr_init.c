@@ -53,6 +53,7 @@ cvar_t	*r_zproj;
 cvar_t	*r_stereoSeparation;
 
 cvar_t	*r_skipBackEnd;
+cvar_t	*r_shaderCache;
 
 cvar_t	*r_anaglyphMode;
 
@@ -1449,6 +1450,7 @@ static void R_Register( void )
 	ri.Cmd_AddCommand( "screenshotJPEG", R_ScreenShot_f );
 	ri.Cmd_AddCommand( "screenshotBMP", R_ScreenShot_f );
 	ri.Cmd_AddCommand( "gfxinfo", GfxInfo_f );
+	ri.Cmd_AddCommand( "imagebench", R_ImageBench_f );
 
 	//
 	// temporary latched variables that can only change over a restart
@@ -1595,6 +1597,10 @@ static void R_Register( void )
 
 	r_skipBackEnd = ri.Cvar_Get ("r_skipBackEnd", "0", CVAR_CHEAT);
 
+	r_shaderCache = ri.Cvar_Get( "r_shaderCache", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_shaderCache, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_shaderCache, "Keep scanned shader scripts in shadercache.dat and reuse them while the set of pk3 files stays the same." );
+
 	r_lodscale = ri.Cvar_Get( "r_lodscale", "5", CVAR_CHEAT );
 	r_norefresh = ri.Cvar_Get ("r_norefresh", "0", CVAR_CHEAT);
 	r_drawentities = ri.Cvar_Get ("r_drawentities", "1", CVAR_CHEAT );
@@ -1770,6 +1776,7 @@ static void RE_Shutdown( refShutdownCode_t code ) {
 	ri.Cmd_RemoveCommand( "shaderlist" );
 	ri.Cmd_RemoveCommand( "skinlist" );
 	ri.Cmd_RemoveCommand( "gfxinfo" );
+	ri.Cmd_RemoveCommand( "imagebench" );
 	ri.Cmd_RemoveCommand( "shaderstate" );
 
 	if ( tr.registered ) {
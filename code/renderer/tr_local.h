@@ -1270,6 +1270,7 @@ extern	cvar_t	*r_portalOnly;
 extern	cvar_t	*r_subdivisions;
 extern	cvar_t	*r_lodCurveError;
 extern	cvar_t	*r_skipBackEnd;
+extern	cvar_t	*r_shaderCache;
 
 extern	cvar_t	*r_anaglyphMode;
 
@@ -1408,6 +1409,7 @@ void		R_GammaCorrect( byte *buffer, int bufSize );
 void		R_ColorShiftLightingBytes( const byte in[4], byte out[4] );
 
 void	R_ImageList_f( void );
+void	R_ImageBench_f( void );
 void	R_SkinList_f( void );
 
 void	R_InitFogTable( void );
@@ -379,6 +379,7 @@ to handle mirrors,
 void RE_RenderScene( const refdef_t *fd ) {
 	viewParms_t		parms;
 	int				startTime;
+	int64_t			profileStart;
 
 	if ( !tr.registered ) {
 		return;
@@ -389,6 +390,7 @@ void RE_RenderScene( const refdef_t *fd ) {
 	}
 
 	startTime = ri.Milliseconds();
+	profileStart = ri.Com_ProfileStart( PROFILE_FRAME );
 
 	if (!tr.world && !( fd->rdflags & RDF_NOWORLDMODEL ) ) {
 		ri.Error (ERR_DROP, "R_RenderScene: NULL worldmodel");
@@ -516,4 +518,8 @@ void RE_RenderScene( const refdef_t *fd ) {
 	r_firstScenePoly = r_numpolys;
 
 	tr.frontEndMsec += ri.Milliseconds() - startTime;
+
+	if ( profileStart ) {
+		ri.Com_ProfileEvent( "RE_RenderScene", -1, profileStart );
+	}
 }
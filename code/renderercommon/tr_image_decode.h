@@ -0,0 +1,112 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+#ifndef __TR_IMAGE_DECODE_H
+#define __TR_IMAGE_DECODE_H
+
+// decoding of an image file that is already in memory, decoders don't use the
+// allocator, file system or console of the refimport so they may run on worker
+// threads with their own allocator
+typedef struct {
+	const char	*name;					// used in messages
+	byte		*data;					// file contents, not modified
+	int			length;
+	void		*(*Malloc)( int bytes );	// may return NULL
+	void		(*Free)( void *buf );
+	qboolean	error;					// file rejected, message holds the reason
+	printParm_t	printLevel;				// of a warning in message
+	char		message[ MAX_STRING_CHARS ];	// empty if nothing to report
+} imageDecoder_t;
+
+typedef void (*imageDecodeFunc_t)( imageDecoder_t *dec, byte **pic, int *width, int *height );
+
+static ID_INLINE void QDECL R_ImageDecodeError( imageDecoder_t *dec, const char *fmt, ... ) __attribute__ ((format (printf, 2, 3)));
+static ID_INLINE void QDECL R_ImageDecodeError( imageDecoder_t *dec, const char *fmt, ... )
+{
+	va_list argptr;
+
+	va_start( argptr, fmt );
+	Q_vsnprintf( dec->message, sizeof( dec->message ), fmt, argptr );
+	va_end( argptr );
+
+	dec->error = qtrue;
+}
+
+static ID_INLINE void QDECL R_ImageDecodeWarning( imageDecoder_t *dec, printParm_t level, const char *fmt, ... ) __attribute__ ((format (printf, 3, 4)));
+static ID_INLINE void QDECL R_ImageDecodeWarning( imageDecoder_t *dec, printParm_t level, const char *fmt, ... )
+{
+	va_list argptr;
+
+	va_start( argptr, fmt );
+	Q_vsnprintf( dec->message, sizeof( dec->message ), fmt, argptr );
+	va_end( argptr );
+
+	dec->printLevel = level;
+}
+
+void R_DecodeJPG( imageDecoder_t *dec, byte **pic, int *width, int *height );
+void R_DecodePNG( imageDecoder_t *dec, byte **pic, int *width, int *height );
+void R_DecodeTGA( imageDecoder_t *dec, byte **pic, int *width, int *height );
+
+/*
+=================
+R_LoadImageFile
+
+Reads the file and decodes it with the renderer allocator,
+errors and warnings are reported as the loaders always did
+=================
+*/
+static ID_INLINE void R_LoadImageFile( const char *name, imageDecodeFunc_t decode, byte **pic, int *width, int *height )
+{
+	imageDecoder_t dec;
+	void *buf;
+
+	*pic = NULL;
+
+	if ( width )
+		*width = 0;
+	if ( height )
+		*height = 0;
+
+	dec.length = ri.FS_ReadFile( name, &buf );
+	if ( !buf || dec.length < 0 )
+		return;
+
+	dec.name = name;
+	dec.data = buf;
+	dec.Malloc = ri.Malloc;
+	dec.Free = ri.Free;
+	dec.error = qfalse;
+	dec.printLevel = PRINT_ALL;
+	dec.message[0] = '\0';
+
+	decode( &dec, pic, width, height );
+
+	ri.FS_FreeFile( buf );
+
+	if ( dec.error )
+		ri.Error( ERR_DROP, "%s", dec.message );
+
+	if ( dec.message[0] )
+		ri.Printf( dec.printLevel, "%s", dec.message );
+}
+
+#endif // __TR_IMAGE_DECODE_H
@@ -22,8 +22,29 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../qcommon/q_shared.h"
 #include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_decode.h"
 
 void R_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height )
 {
 	ri.CL_LoadJPG( filename, pic, width, height );
 }
+
+void R_DecodeJPG( imageDecoder_t *dec, unsigned char **pic, int *width, int *height )
+{
+	unsigned char *buf;
+	int size;
+
+	*pic = NULL;
+
+	// CL_DecodeJPG() is silent and allocates with malloc()
+	if ( !ri.CL_DecodeJPG( dec->data, dec->length, &buf, width, height ) )
+		return;
+
+	size = *width * *height * 4;
+
+	*pic = dec->Malloc( size );
+	if ( *pic )
+		Com_Memcpy( *pic, buf, size );
+
+	free( buf );
+}
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "../qcommon/q_shared.h"
 #include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_decode.h"
 #include "../qcommon/puff.h"
 
 // we could limit the png size to a lower value here
@@ -202,6 +203,7 @@ struct PNG_ZlibHeader
 
 struct BufferedFile
 {
+	imageDecoder_t *Decoder;
 	byte *Buffer;
 	int   Length;
 	byte *Ptr;
@@ -209,22 +211,18 @@ struct BufferedFile
 };
 
 /*
- *  Read a file into a buffer.
+ *  Open the file contents of a decoder as a buffer.
  */
 
-static struct BufferedFile *ReadBufferedFile(const char *name)
+static struct BufferedFile *OpenBufferedFile(imageDecoder_t *Decoder)
 {
 	struct BufferedFile *BF;
-	union {
-		byte *b;
-		void *v;
-	} buffer;
 
 	/*
-	 *  input verification
+	 *  Is it big enough?
 	 */
 
-	if(!name)
+	if(!(Decoder->data && (Decoder->length > 0)))
 	{
 		return(NULL);
 	}
@@ -233,7 +231,7 @@ static struct BufferedFile *ReadBufferedFile(const char *name)
 	 *  Allocate control struct.
 	 */
 
-	BF = ri.Malloc(sizeof(struct BufferedFile));
+	BF = Decoder->Malloc(sizeof(struct BufferedFile));
 	if(!BF)
 	{
 		return(NULL);
@@ -243,28 +241,9 @@ static struct BufferedFile *ReadBufferedFile(const char *name)
 	 *  Initialize the structs components.
 	 */
 
-	BF->Length    = 0;
-	BF->Buffer    = NULL;
-	BF->Ptr       = NULL;
-	BF->BytesLeft = 0;
-
-	/*
-	 *  Read the file.
-	 */
-
-	BF->Length = ri.FS_ReadFile((char *) name, &buffer.v);
-	BF->Buffer = buffer.b;
-
-	/*
-	 *  Did we get it? Is it big enough?
-	 */
-
-	if(!(BF->Buffer && (BF->Length > 0)))
-	{
-		ri.Free(BF);
-
-		return(NULL);
-	}
+	BF->Decoder = Decoder;
+	BF->Length  = Decoder->length;
+	BF->Buffer  = Decoder->data;
 
 	/*
 	 *  Set the pointers and counters.
@@ -284,12 +263,7 @@ static void CloseBufferedFile(struct BufferedFile *BF)
 {
 	if(BF)
 	{
-		if(BF->Buffer)
-		{
-			ri.FS_FreeFile(BF->Buffer);
-		}
-
-		ri.Free(BF);
+		BF->Decoder->Free(BF);
 	}
 }
 
@@ -624,7 +598,7 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 
 	BufferedFileRewind(BF, BytesToRewind);
 
-	CompressedData = ri.Malloc(CompressedDataLength);
+	CompressedData = BF->Decoder->Malloc(CompressedDataLength);
 	if(!CompressedData)
 	{
 		return((unsigned)-1);
@@ -645,7 +619,7 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 		CH = BufferedFileRead(BF, PNG_ChunkHeader_Size);
 		if(!CH)
 		{
-			ri.Free(CompressedData); 
+			BF->Decoder->Free(CompressedData); 
 
 			return((unsigned)-1);
 		}
@@ -679,14 +653,14 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 			OrigCompressedData = BufferedFileRead(BF, Length);
 			if(!OrigCompressedData)
 			{
-				ri.Free(CompressedData); 
+				BF->Decoder->Free(CompressedData); 
 
 				return((unsigned)-1);
 			}
 
 			if(!BufferedFileSkip(BF, PNG_ChunkCRC_Size))
 			{
-				ri.Free(CompressedData); 
+				BF->Decoder->Free(CompressedData); 
 
 				return((unsigned)-1);
 			}
@@ -717,7 +691,7 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 	puffResult = puff(puffDest, &puffDestLen, puffSrc, &puffSrcLen);
 	if(!((puffResult == 0) && (puffDestLen > 0)))
 	{
-		ri.Free(CompressedData);
+		BF->Decoder->Free(CompressedData);
 
 		return((unsigned)-1);
 	}
@@ -726,10 +700,10 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 	 *  Allocate the buffer for the uncompressed data.
 	 */
 
-	DecompressedData = ri.Malloc(puffDestLen);
+	DecompressedData = BF->Decoder->Malloc(puffDestLen);
 	if(!DecompressedData)
 	{
-		ri.Free(CompressedData);
+		BF->Decoder->Free(CompressedData);
 
 		return((unsigned)-1);
 	}
@@ -752,7 +726,7 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 	 *  The compressed data is not needed anymore.
 	 */
 
-	ri.Free(CompressedData);
+	BF->Decoder->Free(CompressedData);
 
 	/*
 	 *  Check if the last puff() was successfull.
@@ -760,7 +734,7 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 
 	if(!((puffResult == 0) && (puffDestLen > 0)))
 	{
-		ri.Free(DecompressedData);
+		BF->Decoder->Free(DecompressedData);
 
 		return((unsigned)-1);
 	}
@@ -1901,7 +1875,7 @@ static qboolean DecodeImageInterlaced(struct PNG_Chunk_IHDR *IHDR,
  *  The PNG loader
  */
 
-void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
+void R_DecodePNG(imageDecoder_t *dec, byte **pic, int *width, int *height)
 {
 	struct BufferedFile *ThePNG;
 	byte *OutBuffer;
@@ -1935,7 +1909,7 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	 *  input verification
 	 */
 
-	if(!(name && pic))
+	if(!(dec && pic))
 	{
 		return;
 	}
@@ -1960,7 +1934,7 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	 *  Read the file.
 	 */
 
-	ThePNG = ReadBufferedFile(name);
+	ThePNG = OpenBufferedFile(dec);
 	if(!ThePNG)
 	{
 		return;
@@ -2063,7 +2037,7 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	{
 		CloseBufferedFile(ThePNG);
 
-		ri.Printf( PRINT_WARNING, "%s: invalid image size\n", name );
+		R_ImageDecodeWarning( dec, PRINT_WARNING, "%s: invalid image size\n", dec->name );
 
 		return; 
 	}
@@ -2401,10 +2375,10 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	 *  Allocate output buffer.
 	 */
 
-	OutBuffer = ri.Malloc(IHDR_Width * IHDR_Height * Q3IMAGE_BYTESPERPIXEL); 
+	OutBuffer = dec->Malloc(IHDR_Width * IHDR_Height * Q3IMAGE_BYTESPERPIXEL); 
 	if(!OutBuffer)
 	{
-		ri.Free(DecompressedData); 
+		dec->Free(DecompressedData); 
 		CloseBufferedFile(ThePNG);
 
 		return;  
@@ -2420,8 +2394,8 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 		{
 			if(!DecodeImageNonInterlaced(IHDR, OutBuffer, DecompressedData, DecompressedDataLength, HasTransparentColour, TransparentColour, OutPal))
 			{
-				ri.Free(OutBuffer); 
-				ri.Free(DecompressedData); 
+				dec->Free(OutBuffer); 
+				dec->Free(DecompressedData); 
 				CloseBufferedFile(ThePNG);
 
 				return;
@@ -2434,8 +2408,8 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 		{
 			if(!DecodeImageInterlaced(IHDR, OutBuffer, DecompressedData, DecompressedDataLength, HasTransparentColour, TransparentColour, OutPal))
 			{
-				ri.Free(OutBuffer); 
-				ri.Free(DecompressedData); 
+				dec->Free(OutBuffer); 
+				dec->Free(DecompressedData); 
 				CloseBufferedFile(ThePNG);
 
 				return;
@@ -2446,8 +2420,8 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 
 		default :
 		{
-			ri.Free(OutBuffer); 
-			ri.Free(DecompressedData); 
+			dec->Free(OutBuffer); 
+			dec->Free(DecompressedData); 
 			CloseBufferedFile(ThePNG);
 
 			return;
@@ -2478,7 +2452,7 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	 *  DecompressedData is not needed anymore.
 	 */
 
-	ri.Free(DecompressedData); 
+	dec->Free(DecompressedData); 
 
 	/*
 	 *  We have all data, so close the file.
@@ -2486,3 +2460,8 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 
 	CloseBufferedFile(ThePNG);
 }
+
+void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
+{
+	R_LoadImageFile(name, R_DecodePNG, pic, width, height);
+}
@@ -0,0 +1,724 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// tr_image_simd.c - texture processing kernels used during image upload
+//
+// Every SIMD variant produces exactly the same output as the C reference,
+// "imagebench" console command verifies that and measures all of them.
+
+#include "../qcommon/q_shared.h"
+#include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_simd.h"
+
+#if idx64 || id386
+#define USE_SSE2_KERNELS
+#include <emmintrin.h>
+#if defined( _MSC_VER ) && id386
+#include <intrin.h>
+#endif
+#if defined( __GNUC__ ) && !defined( __SSE2__ )
+#define SSE2_FUNC __attribute__((target("sse2")))
+#else
+#define SSE2_FUNC
+#endif
+#endif
+
+#if arm64 || ( arm32 && defined( __ARM_NEON ) )
+#define USE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+#define MAX_RESAMPLE_WIDTH 4096
+
+const imageKernels_t *imageKernels;
+
+
+/*
+================
+LightScale_C
+
+Replaces RGB of every pixel through the lookup table, alpha is kept
+================
+*/
+static void LightScale_C( byte *data, int pixelCount, const byte *table )
+{
+	int i;
+
+	for ( i = 0; i < pixelCount; i++, data += 4 ) {
+		data[0] = table[data[0]];
+		data[1] = table[data[1]];
+		data[2] = table[data[2]];
+	}
+}
+
+
+/*
+================
+ResampleTexture_C
+
+Used to resample images in a more general than quartering fashion.
+
+This will only be filtered properly if the resampled size
+is greater than half the original size.
+
+If a larger shrinking is needed, use the mipmap function
+before or after.
+================
+*/
+static void ResampleTexture_C( const unsigned *in, int inwidth, int inheight, unsigned *out, int outwidth, int outheight )
+{
+	int		i, j;
+	const unsigned	*inrow, *inrow2;
+	unsigned	frac, fracstep;
+	unsigned	p1[MAX_RESAMPLE_WIDTH];
+	unsigned	p2[MAX_RESAMPLE_WIDTH];
+	const byte	*pix1, *pix2, *pix3, *pix4;
+
+	fracstep = inwidth * 0x10000 / outwidth;
+
+	frac = fracstep>>2;
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p1[i] = 4*(frac>>16);
+		frac += fracstep;
+	}
+	frac = 3*(fracstep>>2);
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p2[i] = 4*(frac>>16);
+		frac += fracstep;
+	}
+
+	for (i=0 ; i<outheight ; i++, out += outwidth) {
+		inrow = in + inwidth*(int)((i+0.25)*inheight/outheight);
+		inrow2 = in + inwidth*(int)((i+0.75)*inheight/outheight);
+		for (j=0 ; j<outwidth ; j++) {
+			pix1 = (const byte *)inrow + p1[j];
+			pix2 = (const byte *)inrow + p2[j];
+			pix3 = (const byte *)inrow2 + p1[j];
+			pix4 = (const byte *)inrow2 + p2[j];
+			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
+			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
+			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
+			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
+		}
+	}
+}
+
+
+/*
+================
+MipMap2_C
+
+Proper linear filter, out must not overlap in
+================
+*/
+static void MipMap2_C( unsigned *out, const unsigned *in, int inWidth, int inHeight )
+{
+	int			i, j, k;
+	byte		*outpix;
+	int			inWidthMask, inHeightMask;
+	int			total;
+	int			outWidth, outHeight;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	inWidthMask = inWidth - 1;
+	inHeightMask = inHeight - 1;
+
+	for ( i = 0 ; i < outHeight ; i++ ) {
+		for ( j = 0 ; j < outWidth ; j++ ) {
+			outpix = (byte *) ( out + i * outWidth + j );
+			for ( k = 0 ; k < 4 ; k++ ) {
+				total =
+					1 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					1 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					2 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					2 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					1 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					1 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
+				outpix[k] = total / 36;
+			}
+		}
+	}
+}
+
+
+/*
+================
+BlendOverTexture_C
+
+Apply a color blend over a set of pixels
+================
+*/
+static void BlendOverTexture_C( byte *data, int pixelCount, const byte *blend )
+{
+	int		i;
+	int		inverseAlpha;
+	int		premult[3];
+
+	inverseAlpha = 255 - blend[3];
+	premult[0] = blend[0] * blend[3];
+	premult[1] = blend[1] * blend[3];
+	premult[2] = blend[2] * blend[3];
+
+	for ( i = 0 ; i < pixelCount ; i++, data+=4 ) {
+		data[0] = ( data[0] * inverseAlpha + premult[0] ) >> 9;
+		data[1] = ( data[1] * inverseAlpha + premult[1] ) >> 9;
+		data[2] = ( data[2] * inverseAlpha + premult[2] ) >> 9;
+	}
+}
+
+
+/*
+================
+MipMapPixel
+
+Single output pixel of MipMap2_C, used at wrapping edges by SIMD variants
+================
+*/
+static unsigned MipMapPixel( const unsigned *row[4], int inWidth, int j )
+{
+	static const int weights[4] = { 1, 2, 2, 1 };
+	const int mask = inWidth - 1;
+	unsigned result;
+	byte *outpix = (byte *)&result;
+	int k, r, c, total;
+
+	for ( k = 0; k < 4; k++ ) {
+		total = 0;
+		for ( r = 0; r < 4; r++ ) {
+			for ( c = 0; c < 4; c++ ) {
+				total += weights[r] * weights[c] * ((const byte *)&row[r][ ( j*2-1+c ) & mask ])[k];
+			}
+		}
+		outpix[k] = total / 36;
+	}
+
+	return result;
+}
+
+
+static const imageKernels_t kernels_C = {
+	"C",
+	ResampleTexture_C,
+	MipMap2_C,
+	BlendOverTexture_C,
+	LightScale_C
+};
+
+
+#ifdef USE_SSE2_KERNELS
+
+/*
+================
+ResampleTexture_SSE2
+
+Gathers four output pixels at once, sums are exact in 16-bit lanes
+================
+*/
+static SSE2_FUNC void ResampleTexture_SSE2( const unsigned *in, int inwidth, int inheight, unsigned *out, int outwidth, int outheight )
+{
+	const __m128i zero = _mm_setzero_si128();
+	int		i, j;
+	const unsigned	*inrow, *inrow2;
+	unsigned	frac, fracstep;
+	unsigned	p1[MAX_RESAMPLE_WIDTH];
+	unsigned	p2[MAX_RESAMPLE_WIDTH];
+	const byte	*pix1, *pix2, *pix3, *pix4;
+	__m128i		a, b, c, d, lo, hi;
+
+	fracstep = inwidth * 0x10000 / outwidth;
+
+	frac = fracstep>>2;
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p1[i] = frac>>16;
+		frac += fracstep;
+	}
+	frac = 3*(fracstep>>2);
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p2[i] = frac>>16;
+		frac += fracstep;
+	}
+
+	for (i=0 ; i<outheight ; i++, out += outwidth) {
+		inrow = in + inwidth*(int)((i+0.25)*inheight/outheight);
+		inrow2 = in + inwidth*(int)((i+0.75)*inheight/outheight);
+		for ( j = 0; j + 4 <= outwidth; j += 4 ) {
+			a = _mm_setr_epi32( inrow[p1[j]], inrow[p1[j+1]], inrow[p1[j+2]], inrow[p1[j+3]] );
+			b = _mm_setr_epi32( inrow[p2[j]], inrow[p2[j+1]], inrow[p2[j+2]], inrow[p2[j+3]] );
+			c = _mm_setr_epi32( inrow2[p1[j]], inrow2[p1[j+1]], inrow2[p1[j+2]], inrow2[p1[j+3]] );
+			d = _mm_setr_epi32( inrow2[p2[j]], inrow2[p2[j+1]], inrow2[p2[j+2]], inrow2[p2[j+3]] );
+			lo = _mm_add_epi16( _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) ),
+				_mm_add_epi16( _mm_unpacklo_epi8( c, zero ), _mm_unpacklo_epi8( d, zero ) ) );
+			hi = _mm_add_epi16( _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) ),
+				_mm_add_epi16( _mm_unpackhi_epi8( c, zero ), _mm_unpackhi_epi8( d, zero ) ) );
+			_mm_storeu_si128( (__m128i *)( out + j ), _mm_packus_epi16( _mm_srli_epi16( lo, 2 ), _mm_srli_epi16( hi, 2 ) ) );
+		}
+		for ( ; j < outwidth; j++ ) {
+			pix1 = (const byte *)( inrow + p1[j] );
+			pix2 = (const byte *)( inrow + p2[j] );
+			pix3 = (const byte *)( inrow2 + p1[j] );
+			pix4 = (const byte *)( inrow2 + p2[j] );
+			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
+			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
+			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
+			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
+		}
+	}
+}
+
+
+/*
+================
+MipRow_SSE2
+
+Horizontal 1-2-2-1 filter of four consecutive pixels, result in low 4 lanes
+================
+*/
+static SSE2_FUNC ID_INLINE __m128i MipRow_SSE2( const unsigned *p )
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i v, s;
+
+	v = _mm_loadu_si128( (const __m128i *)p );
+	// [ p0+p3 | p1+p2 ]
+	s = _mm_add_epi16( _mm_unpacklo_epi8( v, zero ), _mm_shuffle_epi32( _mm_unpackhi_epi8( v, zero ), _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	// p0+p3 + 2*(p1+p2)
+	return _mm_add_epi16( s, _mm_slli_epi16( _mm_shuffle_epi32( s, _MM_SHUFFLE( 1, 0, 3, 2 ) ), 1 ) );
+}
+
+
+/*
+================
+MipMap2_SSE2
+
+Two output pixels per iteration, columns wrap only at the edges so the
+interior is filtered without masking. Sums fit into 16 bits (36*255),
+x/36 is computed as ((x>>2) * 7282) >> 16 which is exact for this range.
+================
+*/
+static SSE2_FUNC void MipMap2_SSE2( unsigned *out, const unsigned *in, int inWidth, int inHeight )
+{
+	const __m128i div9 = _mm_set1_epi16( 7282 );
+	const unsigned *row[4];
+	int outWidth, outHeight;
+	int i, j, k;
+	__m128i t0, t1, t2, t3, sum;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	// wrapping masks are only meaningful for power of two widths
+	if ( outWidth < 4 || ( inWidth & ( inWidth - 1 ) ) ) {
+		MipMap2_C( out, in, inWidth, inHeight );
+		return;
+	}
+
+	for ( i = 0; i < outHeight; i++, out += outWidth ) {
+		for ( k = 0; k < 4; k++ ) {
+			row[k] = in + ( ( i*2-1+k ) & ( inHeight - 1 ) ) * inWidth;
+		}
+
+		out[0] = MipMapPixel( row, inWidth, 0 );
+
+		for ( j = 1; j + 1 < outWidth - 1; j += 2 ) {
+			t0 = _mm_unpacklo_epi64( MipRow_SSE2( row[0] + j*2-1 ), MipRow_SSE2( row[0] + j*2+1 ) );
+			t1 = _mm_unpacklo_epi64( MipRow_SSE2( row[1] + j*2-1 ), MipRow_SSE2( row[1] + j*2+1 ) );
+			t2 = _mm_unpacklo_epi64( MipRow_SSE2( row[2] + j*2-1 ), MipRow_SSE2( row[2] + j*2+1 ) );
+			t3 = _mm_unpacklo_epi64( MipRow_SSE2( row[3] + j*2-1 ), MipRow_SSE2( row[3] + j*2+1 ) );
+			sum = _mm_add_epi16( _mm_add_epi16( t0, t3 ), _mm_slli_epi16( _mm_add_epi16( t1, t2 ), 1 ) );
+			sum = _mm_mulhi_epu16( _mm_srli_epi16( sum, 2 ), div9 );
+			_mm_storel_epi64( (__m128i *)( out + j ), _mm_packus_epi16( sum, sum ) );
+		}
+
+		for ( ; j < outWidth; j++ ) {
+			out[j] = MipMapPixel( row, inWidth, j );
+		}
+	}
+}
+
+
+/*
+================
+BlendOverTexture_SSE2
+================
+*/
+static SSE2_FUNC void BlendOverTexture_SSE2( byte *data, int pixelCount, const byte *blend )
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32( (int)0xFF000000 );
+	__m128i mul, add, v, lo, hi, res;
+	int inverseAlpha;
+	int premult[3];
+	int i;
+
+	inverseAlpha = 255 - blend[3];
+	premult[0] = blend[0] * blend[3];
+	premult[1] = blend[1] * blend[3];
+	premult[2] = blend[2] * blend[3];
+
+	// data * inverseAlpha + premult never exceeds 255*255
+	mul = _mm_setr_epi16( inverseAlpha, inverseAlpha, inverseAlpha, 0, inverseAlpha, inverseAlpha, inverseAlpha, 0 );
+	add = _mm_setr_epi16( (short)premult[0], (short)premult[1], (short)premult[2], 0, (short)premult[0], (short)premult[1], (short)premult[2], 0 );
+
+	for ( i = 0; i + 4 <= pixelCount; i += 4, data += 16 ) {
+		v = _mm_loadu_si128( (const __m128i *)data );
+		lo = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( v, zero ), mul ), add ), 9 );
+		hi = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( v, zero ), mul ), add ), 9 );
+		res = _mm_or_si128( _mm_and_si128( v, amask ), _mm_andnot_si128( amask, _mm_packus_epi16( lo, hi ) ) );
+		_mm_storeu_si128( (__m128i *)data, res );
+	}
+
+	BlendOverTexture_C( data, pixelCount - i, blend );
+}
+
+
+static const imageKernels_t kernels_SSE2 = {
+	"SSE2",
+	ResampleTexture_SSE2,
+	MipMap2_SSE2,
+	BlendOverTexture_SSE2,
+	LightScale_C
+};
+
+
+static qboolean CPU_HasSSE2( void )
+{
+#if idx64
+	return qtrue;
+#elif defined( _MSC_VER )
+	int regs[4];
+	__cpuid( regs, 1 );
+	return ( regs[3] & ( 1 << 26 ) ) ? qtrue : qfalse;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "sse2" ) ? qtrue : qfalse;
+#endif
+}
+
+#endif // USE_SSE2_KERNELS
+
+
+#ifdef USE_NEON_KERNELS
+
+/*
+================
+ResampleTexture_NEON
+================
+*/
+static void ResampleTexture_NEON( const unsigned *in, int inwidth, int inheight, unsigned *out, int outwidth, int outheight )
+{
+	int		i, j;
+	const unsigned	*inrow, *inrow2;
+	unsigned	frac, fracstep;
+	unsigned	p1[MAX_RESAMPLE_WIDTH];
+	unsigned	p2[MAX_RESAMPLE_WIDTH];
+	const byte	*pix1, *pix2, *pix3, *pix4;
+	uint32_t	ga[4], gb[4], gc[4], gd[4];
+	uint8x16_t	a, b, c, d;
+	uint16x8_t	lo, hi;
+
+	fracstep = inwidth * 0x10000 / outwidth;
+
+	frac = fracstep>>2;
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p1[i] = frac>>16;
+		frac += fracstep;
+	}
+	frac = 3*(fracstep>>2);
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p2[i] = frac>>16;
+		frac += fracstep;
+	}
+
+	for (i=0 ; i<outheight ; i++, out += outwidth) {
+		inrow = in + inwidth*(int)((i+0.25)*inheight/outheight);
+		inrow2 = in + inwidth*(int)((i+0.75)*inheight/outheight);
+		for ( j = 0; j + 4 <= outwidth; j += 4 ) {
+			ga[0] = inrow[p1[j]]; ga[1] = inrow[p1[j+1]]; ga[2] = inrow[p1[j+2]]; ga[3] = inrow[p1[j+3]];
+			gb[0] = inrow[p2[j]]; gb[1] = inrow[p2[j+1]]; gb[2] = inrow[p2[j+2]]; gb[3] = inrow[p2[j+3]];
+			gc[0] = inrow2[p1[j]]; gc[1] = inrow2[p1[j+1]]; gc[2] = inrow2[p1[j+2]]; gc[3] = inrow2[p1[j+3]];
+			gd[0] = inrow2[p2[j]]; gd[1] = inrow2[p2[j+1]]; gd[2] = inrow2[p2[j+2]]; gd[3] = inrow2[p2[j+3]];
+			a = vreinterpretq_u8_u32( vld1q_u32( ga ) );
+			b = vreinterpretq_u8_u32( vld1q_u32( gb ) );
+			c = vreinterpretq_u8_u32( vld1q_u32( gc ) );
+			d = vreinterpretq_u8_u32( vld1q_u32( gd ) );
+			lo = vaddq_u16( vaddl_u8( vget_low_u8( a ), vget_low_u8( b ) ), vaddl_u8( vget_low_u8( c ), vget_low_u8( d ) ) );
+			hi = vaddq_u16( vaddl_u8( vget_high_u8( a ), vget_high_u8( b ) ), vaddl_u8( vget_high_u8( c ), vget_high_u8( d ) ) );
+			vst1q_u8( (uint8_t *)( out + j ), vcombine_u8( vshrn_n_u16( lo, 2 ), vshrn_n_u16( hi, 2 ) ) );
+		}
+		for ( ; j < outwidth; j++ ) {
+			pix1 = (const byte *)( inrow + p1[j] );
+			pix2 = (const byte *)( inrow + p2[j] );
+			pix3 = (const byte *)( inrow2 + p1[j] );
+			pix4 = (const byte *)( inrow2 + p2[j] );
+			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
+			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
+			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
+			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
+		}
+	}
+}
+
+
+/*
+================
+MipRow_NEON
+
+Horizontal 1-2-2-1 filter of four consecutive pixels
+================
+*/
+static ID_INLINE uint16x4_t MipRow_NEON( const unsigned *p )
+{
+	uint8x16_t v;
+	uint16x8_t lo, hi, s;
+
+	v = vld1q_u8( (const uint8_t *)p );
+	lo = vmovl_u8( vget_low_u8( v ) );
+	hi = vmovl_u8( vget_high_u8( v ) );
+	// [ p0+p3 | p1+p2 ]
+	s = vaddq_u16( lo, vcombine_u16( vget_high_u16( hi ), vget_low_u16( hi ) ) );
+	// p0+p3 + 2*(p1+p2)
+	return vadd_u16( vget_low_u16( s ), vshl_n_u16( vget_high_u16( s ), 1 ) );
+}
+
+
+/*
+================
+MipMap2_NEON
+
+Same scheme as MipMap2_SSE2
+================
+*/
+static void MipMap2_NEON( unsigned *out, const unsigned *in, int inWidth, int inHeight )
+{
+	const uint16x4_t div9 = vdup_n_u16( 7282 );
+	const unsigned *row[4];
+	int outWidth, outHeight;
+	int i, j, k;
+	uint16x8_t t0, t1, t2, t3, sum;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	// wrapping masks are only meaningful for power of two widths
+	if ( outWidth < 4 || ( inWidth & ( inWidth - 1 ) ) ) {
+		MipMap2_C( out, in, inWidth, inHeight );
+		return;
+	}
+
+	for ( i = 0; i < outHeight; i++, out += outWidth ) {
+		for ( k = 0; k < 4; k++ ) {
+			row[k] = in + ( ( i*2-1+k ) & ( inHeight - 1 ) ) * inWidth;
+		}
+
+		out[0] = MipMapPixel( row, inWidth, 0 );
+
+		for ( j = 1; j + 1 < outWidth - 1; j += 2 ) {
+			t0 = vcombine_u16( MipRow_NEON( row[0] + j*2-1 ), MipRow_NEON( row[0] + j*2+1 ) );
+			t1 = vcombine_u16( MipRow_NEON( row[1] + j*2-1 ), MipRow_NEON( row[1] + j*2+1 ) );
+			t2 = vcombine_u16( MipRow_NEON( row[2] + j*2-1 ), MipRow_NEON( row[2] + j*2+1 ) );
+			t3 = vcombine_u16( MipRow_NEON( row[3] + j*2-1 ), MipRow_NEON( row[3] + j*2+1 ) );
+			sum = vaddq_u16( vaddq_u16( t0, t3 ), vshlq_n_u16( vaddq_u16( t1, t2 ), 1 ) );
+			sum = vshrq_n_u16( sum, 2 );
+			sum = vcombine_u16( vshrn_n_u32( vmull_u16( vget_low_u16( sum ), div9 ), 16 ),
+				vshrn_n_u32( vmull_u16( vget_high_u16( sum ), div9 ), 16 ) );
+			vst1_u8( (uint8_t *)( out + j ), vmovn_u16( sum ) );
+		}
+
+		for ( ; j < outWidth; j++ ) {
+			out[j] = MipMapPixel( row, inWidth, j );
+		}
+	}
+}
+
+
+/*
+================
+BlendOverTexture_NEON
+
+Deinterleaves 16 pixels, alpha lane is stored back untouched
+================
+*/
+static void BlendOverTexture_NEON( byte *data, int pixelCount, const byte *blend )
+{
+	uint8x16x4_t v;
+	uint8x8_t mul;
+	uint16x8_t add;
+	int premult[3];
+	int i, k;
+
+	mul = vdup_n_u8( 255 - blend[3] );
+	premult[0] = blend[0] * blend[3];
+	premult[1] = blend[1] * blend[3];
+	premult[2] = blend[2] * blend[3];
+
+	for ( i = 0; i + 16 <= pixelCount; i += 16, data += 64 ) {
+		v = vld4q_u8( data );
+		for ( k = 0; k < 3; k++ ) {
+			add = vdupq_n_u16( premult[k] );
+			v.val[k] = vcombine_u8(
+				vmovn_u16( vshrq_n_u16( vmlal_u8( add, vget_low_u8( v.val[k] ), mul ), 9 ) ),
+				vmovn_u16( vshrq_n_u16( vmlal_u8( add, vget_high_u8( v.val[k] ), mul ), 9 ) ) );
+		}
+		vst4q_u8( data, v );
+	}
+
+	BlendOverTexture_C( data, pixelCount - i, blend );
+}
+
+
+static const imageKernels_t kernels_NEON = {
+	"NEON",
+	ResampleTexture_NEON,
+	MipMap2_NEON,
+	BlendOverTexture_NEON,
+	LightScale_C
+};
+
+#endif // USE_NEON_KERNELS
+
+
+/*
+================
+R_InitImageKernels
+
+Selects the fastest kernels supported by the CPU
+================
+*/
+void R_InitImageKernels( void )
+{
+	imageKernels = &kernels_C;
+
+#ifdef USE_SSE2_KERNELS
+	if ( CPU_HasSSE2() ) {
+		imageKernels = &kernels_SSE2;
+	}
+#endif
+
+#ifdef USE_NEON_KERNELS
+	imageKernels = &kernels_NEON;
+#endif
+}
+
+
+/*
+================
+R_BenchImageKernels
+
+Runs the reference and the selected kernels over the same picture,
+reports timings and whether results match
+================
+*/
+void R_BenchImageKernels( const char *name, const byte *pic, int width, int height, int iterations )
+{
+	static const byte blend[4] = { 255, 255, 0, 128 };
+	const imageKernels_t *set[2];
+	byte *src, *dst[2];
+	int64_t usec[2][3];
+	int w, h, size, n, i, k;
+	int resampleWidth, resampleHeight;
+	qboolean match[3];
+
+	set[0] = &kernels_C;
+	set[1] = imageKernels;
+
+	// power of two source for the mipmap filter, same as on upload
+	for ( w = 1; w < width; w <<= 1 )
+		;
+	for ( h = 1; h < height; h <<= 1 )
+		;
+	if ( w > MAX_RESAMPLE_WIDTH || h > MAX_RESAMPLE_WIDTH || w < 2 || h < 2 ) {
+		ri.Printf( PRINT_WARNING, "%s: unsupported size %ix%i\n", name, width, height );
+		return;
+	}
+
+	// mipmap pass needs a complete level, resampling is benchmarked at 3/4 scale
+	resampleWidth = MAX( width * 3 / 4, 1 );
+	resampleHeight = MAX( height * 3 / 4, 1 );
+
+	size = w * h * 4;
+	src = ri.Malloc( size );
+	dst[0] = ri.Malloc( size );
+	dst[1] = ri.Malloc( size );
+
+	// fill power of two source by tiling the original picture
+	for ( i = 0; i < h; i++ ) {
+		for ( k = 0; k < w; k++ ) {
+			((unsigned *)src)[ i * w + k ] = ((const unsigned *)pic)[ ( i % height ) * width + ( k % width ) ];
+		}
+	}
+
+	for ( k = 0; k < 2; k++ ) {
+		int64_t start;
+
+		start = ri.Microseconds();
+		for ( n = 0; n < iterations; n++ )
+			set[k]->ResampleTexture( (const unsigned *)pic, width, height, (unsigned *)dst[k], resampleWidth, resampleHeight );
+		usec[k][0] = ri.Microseconds() - start;
+	}
+	match[0] = memcmp( dst[0], dst[1], resampleWidth * resampleHeight * 4 ) == 0 ? qtrue : qfalse;
+
+	for ( k = 0; k < 2; k++ ) {
+		int64_t start;
+
+		start = ri.Microseconds();
+		for ( n = 0; n < iterations; n++ )
+			set[k]->MipMap2( (unsigned *)dst[k], (const unsigned *)src, w, h );
+		usec[k][1] = ri.Microseconds() - start;
+	}
+	match[1] = memcmp( dst[0], dst[1], ( w >> 1 ) * ( h >> 1 ) * 4 ) == 0 ? qtrue : qfalse;
+
+	for ( k = 0; k < 2; k++ ) {
+		int64_t start = 0;
+
+		usec[k][2] = 0;
+		for ( n = 0; n < iterations; n++ ) {
+			Com_Memcpy( dst[k], src, size );
+			start = ri.Microseconds();
+			set[k]->BlendOverTexture( dst[k], w * h, blend );
+			usec[k][2] += ri.Microseconds() - start;
+		}
+	}
+	match[2] = memcmp( dst[0], dst[1], size ) == 0 ? qtrue : qfalse;
+
+	ri.Printf( PRINT_ALL, "%s (%ix%i), %i iterations, C vs %s:\n", name, width, height, iterations, set[1]->name );
+	ri.Printf( PRINT_ALL, "  resample %6.2f / %6.2f msec %s\n", usec[0][0] / 1000.0, usec[1][0] / 1000.0, match[0] ? "" : "MISMATCH" );
+	ri.Printf( PRINT_ALL, "  mipmap   %6.2f / %6.2f msec %s\n", usec[0][1] / 1000.0, usec[1][1] / 1000.0, match[1] ? "" : "MISMATCH" );
+	ri.Printf( PRINT_ALL, "  blend    %6.2f / %6.2f msec %s\n", usec[0][2] / 1000.0, usec[1][2] / 1000.0, match[2] ? "" : "MISMATCH" );
+
+	ri.Free( dst[1] );
+	ri.Free( dst[0] );
+	ri.Free( src );
+}
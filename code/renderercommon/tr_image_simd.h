@@ -0,0 +1,42 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+#ifndef __TR_IMAGE_SIMD_H
+#define __TR_IMAGE_SIMD_H
+
+// texture processing kernels, all of them operate on RGBA pixels
+// and never allocate memory so they may be called from worker threads
+typedef struct {
+	const char *name;
+	// outwidth must not exceed 4096
+	void (*ResampleTexture)( const unsigned *in, int inwidth, int inheight, unsigned *out, int outwidth, int outheight );
+	// out must not overlap in
+	void (*MipMap2)( unsigned *out, const unsigned *in, int inWidth, int inHeight );
+	void (*BlendOverTexture)( byte *data, int pixelCount, const byte *blend );
+	void (*LightScale)( byte *data, int pixelCount, const byte *table );
+} imageKernels_t;
+
+extern const imageKernels_t *imageKernels;
+
+void R_InitImageKernels( void );
+void R_BenchImageKernels( const char *name, const byte *pic, int width, int height, int iterations );
+
+#endif // __TR_IMAGE_SIMD_H
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../qcommon/q_shared.h"
 #include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_decode.h"
 
 /*
 ========================================================================
@@ -39,20 +40,16 @@ typedef struct _TargaHeader {
 	unsigned char	pixel_size, attributes;
 } TargaHeader;
 
-void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
+void R_DecodeTGA( imageDecoder_t *dec, byte **pic, int *width, int *height )
 {
+	const char	*name = dec->name;
 	unsigned	columns, rows, numPixels;
 	byte	*pixbuf;
 	int		row, column;
 	byte	*buf_p;
 	byte	*end;
-	union {
-		byte *b;
-		void *v;
-	} buffer;
 	TargaHeader	targa_header;
-	byte		*targa_rgba;
-	int length;
+	byte		*targa_rgba = NULL;
 
 	*pic = NULL;
 
@@ -61,21 +58,14 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 	if(height)
 		*height = 0;
 
-	//
-	// load the file
-	//
-	length = ri.FS_ReadFile ( ( char * ) name, &buffer.v);
-	if (!buffer.b || length < 0) {
-		return;
-	}
-
-	if(length < 18)
+	if(dec->length < 18)
 	{
-		ri.Error( ERR_DROP, "LoadTGA: header too short (%s)", name );
+		R_ImageDecodeError( dec, "LoadTGA: header too short (%s)", name );
+		return;
 	}
 
-	buf_p = buffer.b;
-	end = buffer.b + length;
+	buf_p = dec->data;
+	end = dec->data + dec->length;
 
 	targa_header.id_length = buf_p[0];
 	targa_header.colormap_type = buf_p[1];
@@ -104,17 +94,20 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 		&& targa_header.image_type!=10
 		&& targa_header.image_type != 3 )
 	{
-		ri.Error (ERR_DROP, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported");
+		R_ImageDecodeError( dec, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported" );
+		return;
 	}
 
 	if ( targa_header.colormap_type != 0 )
 	{
-		ri.Error( ERR_DROP, "LoadTGA: colormaps not supported" );
+		R_ImageDecodeError( dec, "LoadTGA: colormaps not supported" );
+		return;
 	}
 
 	if ( ( targa_header.pixel_size != 32 && targa_header.pixel_size != 24 ) && targa_header.image_type != 3 )
 	{
-		ri.Error (ERR_DROP, "LoadTGA: Only 32 or 24 bit images supported (no colormaps)");
+		R_ImageDecodeError( dec, "LoadTGA: Only 32 or 24 bit images supported (no colormaps)" );
+		return;
 	}
 
 	columns = targa_header.width;
@@ -123,16 +116,25 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 
 	if(!columns || !rows || numPixels > 0x7FFFFFFF || numPixels / columns / 4 != rows)
 	{
-		ri.Error (ERR_DROP, "LoadTGA: %s has an invalid image size", name);
+		R_ImageDecodeError( dec, "LoadTGA: %s has an invalid image size", name );
+		return;
 	}
 
 
-	targa_rgba = ri.Malloc (numPixels);
+	targa_rgba = dec->Malloc (numPixels);
+	if (!targa_rgba)
+	{
+		R_ImageDecodeError( dec, "LoadTGA: out of memory (%s)", name );
+		return;
+	}
 
 	if (targa_header.id_length != 0)
 	{
 		if (buf_p + targa_header.id_length > end)
-			ri.Error( ERR_DROP, "LoadTGA: header too short (%s)", name );
+		{
+			R_ImageDecodeError( dec, "LoadTGA: header too short (%s)", name );
+			goto fail;
+		}
 
 		buf_p += targa_header.id_length;  // skip TARGA image comment
 	}
@@ -141,7 +143,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 	{
 		if ( buf_p + columns * rows * targa_header.pixel_size / 8 > end )
 		{
-			ri.Error( ERR_DROP, "LoadTGA: file truncated (%s)", name );
+			R_ImageDecodeError( dec, "LoadTGA: file truncated (%s)", name );
+			goto fail;
 		}
 		// Uncompressed RGB or gray scale image
 		switch ( targa_header.pixel_size ) {
@@ -190,8 +193,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 				}
 				break;
 			default:
-				ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-				break;
+				R_ImageDecodeError( dec, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+				goto fail;
 		}
 	}
 	else if (targa_header.image_type==10) {   // Runlength encoded RGB images
@@ -201,12 +204,18 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 			pixbuf = targa_rgba + row*columns*4;
 			for(column=0; column<columns; ) {
 				if(buf_p + 1 > end)
-					ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+				{
+					R_ImageDecodeError( dec, "LoadTGA: file truncated (%s)", name );
+					goto fail;
+				}
 				packetHeader= *buf_p++;
 				packetSize = 1 + (packetHeader & 0x7f);
 				if (packetHeader & 0x80) {        // run-length packet
 					if(buf_p + targa_header.pixel_size/8 > end)
-						ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+					{
+						R_ImageDecodeError( dec, "LoadTGA: file truncated (%s)", name );
+						goto fail;
+					}
 					switch (targa_header.pixel_size) {
 						case 24:
 								blue = *buf_p++;
@@ -221,9 +230,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 								alphabyte = *buf_p++;
 								break;
 						default:
-							ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-							red = green = blue = alphabyte = 0; // silence compiler warning
-							break;
+							R_ImageDecodeError( dec, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+							goto fail;
 					}
 
 					for(j=0;j<packetSize;j++) {
@@ -245,7 +253,10 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 				else {                            // non run-length packet
 
 					if(buf_p + targa_header.pixel_size/8*packetSize > end)
-						ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+					{
+						R_ImageDecodeError( dec, "LoadTGA: file truncated (%s)", name );
+						goto fail;
+					}
 					for(j=0;j<packetSize;j++) {
 						switch (targa_header.pixel_size) {
 							case 24:
@@ -268,8 +279,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 									*pixbuf++ = alphabyte;
 									break;
 							default:
-								ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-								break;
+								R_ImageDecodeError( dec, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+								goto fail;
 						}
 						column++;
 						if ((unsigned int)column==columns) { // pixel packet run spans across rows
@@ -307,7 +318,7 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 #endif
   // instead we just print a warning
   if (targa_header.attributes & 0x20) {
-    ri.Printf( PRINT_WARNING, "WARNING: '%s' TGA file header declares top-down image, ignoring\n", name);
+    R_ImageDecodeWarning( dec, PRINT_WARNING, "WARNING: '%s' TGA file header declares top-down image, ignoring\n", name );
   }
 
   if (width)
@@ -316,6 +327,14 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 	  *height = rows;
 
   *pic = targa_rgba;
+  return;
+
+fail:
+  dec->Free (targa_rgba);
+}
 
-  ri.FS_FreeFile (buffer.v);
+
+void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
+{
+	R_LoadImageFile( name, R_DecodeTGA, pic, width, height );
 }
@@ -25,7 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_types.h"
 #include "vulkan/vulkan.h"
 
-#define	REF_API_VERSION		8
+#define	REF_API_VERSION		9
 
 //
 // these are the functions exported by the refresh module
@@ -194,6 +194,7 @@ typedef struct {
 	// a qfalse return means the file does not exist
 	// NULL can be passed for buf to just determine existence
 	//int		(*FS_FileIsInPAK)( const char *name, int *pCheckSum );
+	qboolean (*FS_FilePakChecksum)( const char *name, int *pChecksum );
 	int		(*FS_ReadFile)( const char *name, void **buf );
 	void	(*FS_FreeFile)( void *buf );
 	char **	(*FS_ListFiles)( const char *name, const char *extension, int *numfilesfound );
@@ -211,6 +212,8 @@ typedef struct {
 	size_t	(*CL_SaveJPGToBuffer)( byte *buffer, size_t bufSize, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 	void	(*CL_SaveJPG)( const char *filename, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 	void	(*CL_LoadJPG)( const char *filename, unsigned char **pic, int *width, int *height );
+	// thread-safe, the image is allocated with malloc()
+	qboolean (*CL_DecodeJPG)( const byte *data, int length, unsigned char **pic, int *width, int *height );
 
 	qboolean (*CL_IsMinimized)( void );
 	void	(*CL_SetScaling)( float factor, int captureWidth, int captureHeight );
@@ -220,6 +223,22 @@ typedef struct {
 
 	int		(*Com_RealTime)( qtime_t *qtime );
 
+	// threading
+	void	*(*Sys_CreateThread)( void (*func)( void *arg ), void *arg, const char *name );
+	void	(*Sys_JoinThread)( void *thread );
+	void	*(*Sys_CreateSemaphore)( int initialCount );
+	void	(*Sys_DestroySemaphore)( void *sem );
+	void	(*Sys_SemaphorePost)( void *sem );
+	void	(*Sys_SemaphoreWait)( void *sem );
+
+	// parallel jobs, executed by the engine worker pool
+	int		(*Com_NumJobThreads)( void );
+	void	(*Com_RunJobs)( void (*func)( void *arg, int index ), void *arg, int count );
+
+	// frame profiler, start is 0 when the level is not recorded
+	int64_t	(*Com_ProfileStart)( int level );
+	void	(*Com_ProfileEvent)( const char *name, int arg, int64_t start );
+
 	// platform-dependent functions
 	void	(*GLimp_Init)( glconfig_t *config );
 	void	(*GLimp_Shutdown)( qboolean unloadDLL );
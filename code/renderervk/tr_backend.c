@@ -21,7 +21,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "tr_local.h"
 
-backEndData_t	*backEndData;
+backEndData_t	*backEndData[SMP_FRAMES];
 backEndState_t	backEnd;
 
 #ifndef USE_VULKAN
@@ -1091,6 +1091,8 @@ void RE_UploadCinematic( int w, int h, int cols, int rows, byte *data, int clien
 
 	image_t *image;
 
+	R_SyncRenderThread();
+
 	if ( !tr.scratchImage[ client ] ) {
 		tr.scratchImage[ client ] = R_CreateImage( va( "*scratch%i", client ), NULL, data, cols, rows, IMGFLAG_CLAMPTOEDGE | IMGFLAG_RGB | IMGFLAG_NOSCALE );
 	}
@@ -1480,6 +1482,9 @@ static const void *RB_DrawBuffer( const void *data ) {
 	cmd = (const drawBufferCommand_t *)data;
 
 #ifdef USE_VULKAN
+	// reset here rather than in RE_BeginFrame, the render thread may still run the previous frame
+	backEnd.doneBloom = qfalse;
+
 	vk_begin_frame();
 
 	tess.depthRange = DEPTH_RANGE_NORMAL;
@@ -1729,6 +1734,9 @@ static const void *RB_FinishBloom( const void *data )
 static const void *RB_SwapBuffers( const void *data ) {
 
 	const swapBuffersCommand_t	*cmd;
+#ifdef USE_VULKAN
+	int videoSlot = -1;
+#endif
 
 	// finish any 2D drawing if needed
 	RB_EndSurface();
@@ -1740,9 +1748,11 @@ static const void *RB_SwapBuffers( const void *data ) {
 
 	cmd = (const swapBuffersCommand_t *)data;
 
-	tr.needScreenMap = 0;
-
 #ifdef USE_VULKAN
+	if ( backEnd.screenshotMask & SCREENSHOT_AVI ) {
+		// copy is recorded at the end of the frame and read back few frames later
+		videoSlot = RB_QueueVideoFrame( &backEnd.vcmd );
+	}
 	vk_end_frame();
 #else
 	if ( backEnd.doneSurfaces && !glState.finishCalled ) {
@@ -1774,7 +1784,15 @@ static const void *RB_SwapBuffers( const void *data ) {
 			}
 		}
 		if ( backEnd.screenshotMask & SCREENSHOT_AVI ) {
+#ifdef USE_VULKAN
+			if ( !vk_readback_queued( videoSlot ) ) {
+				// keep frame order
+				RB_FlushVideoFrames( qtrue );
+				RB_TakeVideoFrameCmd( &backEnd.vcmd );
+			}
+#else
 			RB_TakeVideoFrameCmd( &backEnd.vcmd );
+#endif
 		}
 
 		backEnd.screenshotJPG[0] = '\0';
@@ -1804,6 +1822,9 @@ RB_ExecuteRenderCommands
 ====================
 */
 void RB_ExecuteRenderCommands( const void *data ) {
+	int64_t profileStart;
+
+	profileStart = ri.Com_ProfileStart( PROFILE_FRAME );
 
 	backEnd.pc.msec = ri.Milliseconds();
 
@@ -1851,6 +1872,9 @@ void RB_ExecuteRenderCommands( const void *data ) {
 #else
 			backEnd.pc.msec = ri.Milliseconds() - backEnd.pc.msec;
 #endif
+			if ( profileStart ) {
+				ri.Com_ProfileEvent( "RB_ExecuteRenderCommands", -1, profileStart );
+			}
 			return;
 		}
 	}
@@ -1734,13 +1734,16 @@ static void R_LoadSubmodels( const lump_t *l ) {
 R_SetParent
 =================
 */
-static void R_SetParent( mnode_t *node, mnode_t *parent )
+static int R_SetParent( mnode_t *node, mnode_t *parent )
 {
 	node->parent = parent;
-	if ( node->contents != CONTENTS_NODE )
-		return;
-	R_SetParent( node->children[0], node );
-	R_SetParent( node->children[1], node );
+	if ( node->contents != CONTENTS_NODE ) {
+		node->numLeafs = 1;
+		return 1;
+	}
+	node->numLeafs = R_SetParent( node->children[0], node );
+	node->numLeafs += R_SetParent( node->children[1], node );
+	return node->numLeafs;
 }
 
 
@@ -1818,6 +1821,10 @@ static void R_LoadNodesAndLeafs( const lump_t *nodeLump, const lump_t *leafLump
 
 	// chain descendants
 	R_SetParent (s_worldData.nodes, NULL);
+
+	s_worldData.visLeafs = ri.Hunk_Alloc( numLeafs * sizeof( visLeaf_t ), h_low );
+	s_worldData.visSurfs = ri.Hunk_Alloc( s_worldData.numsurfaces * sizeof( visSurf_t ), h_low );
+	s_worldData.visDrawSurfs = ri.Hunk_Alloc( s_worldData.numsurfaces * sizeof( drawSurf_t ), h_low );
 }
 
 //=============================================================================
@@ -1868,6 +1875,8 @@ static void R_LoadShaders( const lump_t *l ) {
 		out[i].surfaceFlags = LittleLong( out[i].surfaceFlags );
 		out[i].contentFlags = LittleLong( out[i].contentFlags );
 	}
+
+	R_PrefetchShaderImages( out, count );
 }
 
 
@@ -2243,6 +2252,8 @@ void RE_LoadWorldMap( const char *name ) {
 		ri.Error( ERR_DROP, "ERROR: attempted to redundantly load world map" );
 	}
 
+	R_SyncRenderThread();
+
 	// set default sun direction to be used if it isn't
 	// overridden by a shader
 	tr.sunDirection[0] = 0.45f;
@@ -2264,6 +2275,13 @@ void RE_LoadWorldMap( const char *name ) {
 
 	tr.mapLoading = qtrue;
 
+	// images referenced by the map shaders are processed in batches
+	R_BeginImageBatch();
+#ifdef USE_VULKAN
+	// and their pipelines are compiled at once in RE_EndRegistration()
+	vk_begin_pipeline_batch();
+#endif
+
 	// clear tr.world so if the level fails to load, the next
 	// try will not look at the partially loaded version
 	tr.world = NULL;
@@ -21,6 +21,13 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "tr_local.h"
 
+static void *renderThread;
+static void *renderCommandsEvent;	// front end -> render thread: new command list
+static void *renderCompletedEvent;	// render thread -> front end: command list done
+static const void *renderCommandsData;
+static qboolean renderThreadActive;	// command list has been handed over but not yet synced
+
+
 /*
 =====================
 R_PerformanceCounters
@@ -64,12 +71,133 @@ static void R_PerformanceCounters( void ) {
 		ri.Printf( PRINT_ALL, "flare adds:%i tests:%i renders:%i\n", 
 			backEnd.pc.c_flareAdds, backEnd.pc.c_flareTests, backEnd.pc.c_flareRenders );
 	}
+	else if (r_speeds->integer == 7 )
+	{
+		ri.Printf( PRINT_ALL, "smp:%i front:%ims back:%.2fms stall:%.2fms\n",
+			renderThread != NULL, tr.frontEndMsec, backEnd.pc.usec / 1000.0f, tr.pc.c_smpWaitUsec / 1000.0f );
+	}
 
 	Com_Memset( &tr.pc, 0, sizeof( tr.pc ) );
 	Com_Memset( &backEnd.pc, 0, sizeof( backEnd.pc ) );
 }
 
 
+#ifndef USE_NULL_RENDERER
+/*
+====================
+RB_RenderThread
+
+Executes command lists handed over by the front end, a NULL list terminates the thread
+====================
+*/
+static void RB_RenderThread( void *arg ) {
+	const void *data;
+	int64_t start;
+
+	while ( 1 ) {
+		ri.Sys_SemaphoreWait( renderCommandsEvent );
+
+		data = renderCommandsData;
+		if ( data == NULL ) {
+			ri.Sys_SemaphorePost( renderCompletedEvent );
+			return;
+		}
+
+		start = ri.Microseconds();
+		RB_ExecuteRenderCommands( data );
+		backEnd.pc.usec = (int)( ri.Microseconds() - start );
+
+		ri.Sys_SemaphorePost( renderCompletedEvent );
+	}
+}
+#endif // !USE_NULL_RENDERER
+
+
+/*
+====================
+R_InitRenderThread
+====================
+*/
+void R_InitRenderThread( void ) {
+
+	// the null renderer never executes render commands
+#ifndef USE_NULL_RENDERER
+	if ( !r_smp->integer || backEndData[1] == NULL ) {
+		return;
+	}
+
+	renderCommandsEvent = ri.Sys_CreateSemaphore( 0 );
+	renderCompletedEvent = ri.Sys_CreateSemaphore( 0 );
+	renderThreadActive = qfalse;
+
+	if ( renderCommandsEvent && renderCompletedEvent ) {
+		renderThread = ri.Sys_CreateThread( RB_RenderThread, NULL, "render" );
+	}
+
+	if ( renderThread == NULL ) {
+		ri.Printf( PRINT_WARNING, "...failed to start render thread, r_smp disabled\n" );
+		ri.Sys_DestroySemaphore( renderCommandsEvent );
+		ri.Sys_DestroySemaphore( renderCompletedEvent );
+		renderCommandsEvent = NULL;
+		renderCompletedEvent = NULL;
+		return;
+	}
+
+	ri.Printf( PRINT_ALL, "...using render thread\n" );
+#endif
+}
+
+
+/*
+====================
+R_ShutdownRenderThread
+====================
+*/
+void R_ShutdownRenderThread( void ) {
+
+	if ( renderThread == NULL ) {
+		return;
+	}
+
+	R_SyncRenderThread();
+
+	renderCommandsData = NULL;
+	ri.Sys_SemaphorePost( renderCommandsEvent );
+	ri.Sys_SemaphoreWait( renderCompletedEvent );
+	ri.Sys_JoinThread( renderThread );
+
+	ri.Sys_DestroySemaphore( renderCommandsEvent );
+	ri.Sys_DestroySemaphore( renderCompletedEvent );
+
+	renderThread = NULL;
+	renderCommandsEvent = NULL;
+	renderCompletedEvent = NULL;
+}
+
+
+/*
+====================
+R_SyncRenderThread
+
+Wait for the render thread to finish the previous command list,
+must be called before the front end touches any state used by the back end
+====================
+*/
+void R_SyncRenderThread( void ) {
+	int64_t start;
+
+	if ( !renderThreadActive ) {
+		return;
+	}
+
+	start = ri.Microseconds();
+	ri.Sys_SemaphoreWait( renderCompletedEvent );
+	tr.pc.c_smpWaitUsec += (int)( ri.Microseconds() - start );
+
+	renderThreadActive = qfalse;
+}
+
+
 /*
 ====================
 R_IssueRenderCommands
@@ -77,8 +205,17 @@ R_IssueRenderCommands
 */
 static void R_IssueRenderCommands( void ) {
 	renderCommandList_t	*cmdList;
+#ifndef USE_NULL_RENDERER
+	int64_t start;
+	int screenshotMask;
+#endif
+
+	R_SyncRenderThread();
+
+	// queued images may be referenced by these commands
+	R_FlushImageBatch();
 
-	cmdList = &backEndData->commands;
+	cmdList = &backEndData[tr.smpFrame]->commands;
 
 	// add an end-of-list command
 	*(int *)(cmdList->cmds + cmdList->used) = RC_END_OF_LIST;
@@ -100,11 +237,34 @@ static void R_IssueRenderCommands( void ) {
 #endif
 	}
 
+	tr.needScreenMap = 0;
+
+#ifdef USE_NULL_RENDERER
+	// front end only, there is no device to submit to
+	backEnd.screenshotMask = 0;
+#else
 	// actually start the commands going
 	if ( !r_skipBackEnd->integer ) {
-		// let it start on the new batch
-		RB_ExecuteRenderCommands( cmdList->cmds );
+		backEnd.smpFrame = tr.smpFrame;
+		if ( renderThread ) {
+			// hand it over to the render thread, screenshots and video frames
+			// are written from the back end so wait for them to complete,
+			// the mask is cleared by the render thread once they are done
+			screenshotMask = backEnd.screenshotMask;
+			renderCommandsData = cmdList->cmds;
+			renderThreadActive = qtrue;
+			ri.Sys_SemaphorePost( renderCommandsEvent );
+			if ( screenshotMask ) {
+				R_SyncRenderThread();
+			}
+		} else {
+			// let it start on the new batch
+			start = ri.Microseconds();
+			RB_ExecuteRenderCommands( cmdList->cmds );
+			backEnd.pc.usec = (int)( ri.Microseconds() - start );
+		}
 	}
+#endif
 }
 
 
@@ -120,6 +280,7 @@ void R_IssuePendingRenderCommands( void ) {
 		return;
 	}
 	R_IssueRenderCommands();
+	R_SyncRenderThread();
 }
 
 
@@ -133,7 +294,7 @@ make sure there is enough command space
 static void *R_GetCommandBufferReserved( int bytes, int reservedBytes ) {
 	renderCommandList_t	*cmdList;
 
-	cmdList = &backEndData->commands;
+	cmdList = &backEndData[tr.smpFrame]->commands;
 	bytes = PAD(bytes, sizeof(void *));
 
 	// always leave room for the end of list command
@@ -316,10 +477,6 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 	glState.finishCalled = qfalse;
 #endif
 
-#ifdef USE_VULKAN
-	backEnd.doneBloom = qfalse;
-#endif
-
 	tr.frameCount++;
 	tr.frameSceneNum = 0;
 
@@ -400,6 +557,7 @@ Returns the number of msec spent in the back end
 void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 
 	swapBuffersCommand_t *cmd;
+	int smpBackEndMsec;
 
 	if ( !tr.registered ) {
 		return;
@@ -411,20 +569,36 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 	}
 	cmd->commandId = RC_SWAP_BUFFERS;
 
+	// back end counters are valid only after the previous frame is done
+	R_SyncRenderThread();
+	smpBackEndMsec = backEnd.pc.msec;
+
 	R_PerformanceCounters();
 
 	R_IssueRenderCommands();
 
+	if ( renderThread ) {
+		// start filling the other command list while this one is executed
+		tr.smpFrame ^= 1;
+	}
+
 	R_InitNextFrame();
 
 	if ( frontEndMsec ) {
 		*frontEndMsec = tr.frontEndMsec;
 	}
 	tr.frontEndMsec = 0;
-	if ( backEndMsec ) {
-		*backEndMsec = backEnd.pc.msec;
+	if ( renderThread ) {
+		// report the last completed frame, current one may still be in progress
+		if ( backEndMsec ) {
+			*backEndMsec = smpBackEndMsec;
+		}
+	} else {
+		if ( backEndMsec ) {
+			*backEndMsec = backEnd.pc.msec;
+		}
+		backEnd.pc.msec = 0;
 	}
-	backEnd.pc.msec = 0;
 	backEnd.throttle = qfalse;
 }
 
@@ -443,6 +617,9 @@ void RE_TakeVideoFrame( int width, int height,
 		return;
 	}
 
+	// backEnd capture state is shared with the render thread
+	R_SyncRenderThread();
+
 	backEnd.screenshotMask |= SCREENSHOT_AVI;
 
 	cmd = &backEnd.vcmd;
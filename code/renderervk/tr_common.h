@@ -26,6 +26,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../qcommon/q_shared.h"
 #include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_simd.h"
+#include "../renderercommon/tr_image_decode.h"
 
 #define MAX_TEXTURE_UNITS 8
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static byte			 s_intensitytable[256];
 static unsigned char s_gammatable[256];
+static byte			 s_gammaintensitytable[256];
 
 #ifdef USE_VULKAN
 static unsigned char s_gammatable_linear[256];
@@ -98,6 +99,7 @@ void GL_TextureMode( const char *string ) {
 	gl_filter_max = mode->maximize;
 
 #ifdef USE_VULKAN
+	R_SyncRenderThread();
 	vk_wait_idle();
 	for ( i = 0 ; i < tr.numImages ; i++ ) {
 		img = tr.images[i];
@@ -276,43 +278,10 @@ before or after.
 */
 static void ResampleTexture( unsigned *in, int inwidth, int inheight, unsigned *out,  
 							int outwidth, int outheight ) {
-	int		i, j;
-	unsigned	*inrow, *inrow2;
-	unsigned	frac, fracstep;
-	unsigned	p1[MAX_TEXTURE_SIZE];
-	unsigned	p2[MAX_TEXTURE_SIZE];
-	byte		*pix1, *pix2, *pix3, *pix4;
-
-	if ( outwidth > ARRAY_LEN( p1 ) )
+	if ( outwidth > MAX_TEXTURE_SIZE )
 		ri.Error( ERR_DROP, "ResampleTexture: max width" );
-								
-	fracstep = inwidth * 0x10000 / outwidth;
-
-	frac = fracstep>>2;
-	for ( i=0 ; i<outwidth ; i++ ) {
-		p1[i] = 4*(frac>>16);
-		frac += fracstep;
-	}
-	frac = 3*(fracstep>>2);
-	for ( i=0 ; i<outwidth ; i++ ) {
-		p2[i] = 4*(frac>>16);
-		frac += fracstep;
-	}
-
-	for (i=0 ; i<outheight ; i++, out += outwidth) {
-		inrow = in + inwidth*(int)((i+0.25)*inheight/outheight);
-		inrow2 = in + inwidth*(int)((i+0.75)*inheight/outheight);
-		for (j=0 ; j<outwidth ; j++) {
-			pix1 = (byte *)inrow + p1[j];
-			pix2 = (byte *)inrow + p2[j];
-			pix3 = (byte *)inrow2 + p1[j];
-			pix4 = (byte *)inrow2 + p2[j];
-			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
-			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
-			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
-			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
-		}
-	}
+
+	imageKernels->ResampleTexture( in, inwidth, inheight, out, outwidth, outheight );
 }
 
 
@@ -337,50 +306,22 @@ static void R_LightScaleTexture( byte *in, int inwidth, int inheight, qboolean o
 		if ( !glConfig.deviceSupportsGamma )
 #endif
 		{
-			int		i, c;
-			byte	*p;
-
-			p = (byte *)in;
-
-			c = inwidth*inheight;
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[p[0]];
-				p[1] = s_gammatable[p[1]];
-				p[2] = s_gammatable[p[2]];
-			}
+			imageKernels->LightScale( in, inwidth * inheight, s_gammatable );
 		}
 	}
 	else
 	{
-		int		i, c;
-		byte	*p;
-
-		p = (byte *)in;
-
-		c = inwidth*inheight;
-
 #ifdef USE_VULKAN
 		if ( glConfig.deviceSupportsGamma || vk.fboActive )
 #else
 		if ( glConfig.deviceSupportsGamma )
 #endif
 		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_intensitytable[p[0]];
-				p[1] = s_intensitytable[p[1]];
-				p[2] = s_intensitytable[p[2]];
-			}
+			imageKernels->LightScale( in, inwidth * inheight, s_intensitytable );
 		}
 		else
 		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[s_intensitytable[p[0]]];
-				p[1] = s_gammatable[s_intensitytable[p[1]]];
-				p[2] = s_gammatable[s_intensitytable[p[2]]];
-			}
+			imageKernels->LightScale( in, inwidth * inheight, s_gammaintensitytable );
 		}
 	}
 }
@@ -395,57 +336,21 @@ Proper linear filter
 ================
 */
 static void R_MipMap2( unsigned * const out, unsigned * const in, int inWidth, int inHeight ) {
-	int			i, j, k;
-	byte		*outpix;
-	int			inWidthMask, inHeightMask;
-	int			total;
 	int			outWidth, outHeight;
 	unsigned	*temp;
 
+	if ( out != in ) {
+		imageKernels->MipMap2( out, in, inWidth, inHeight );
+		return;
+	}
+
 	outWidth = inWidth >> 1;
 	outHeight = inHeight >> 1;
 
-	if ( out == in )
-		temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
-	else
-		temp = out;
-
-	inWidthMask = inWidth - 1;
-	inHeightMask = inHeight - 1;
-
-	for ( i = 0 ; i < outHeight ; i++ ) {
-		for ( j = 0 ; j < outWidth ; j++ ) {
-			outpix = (byte *) ( temp + i * outWidth + j );
-			for ( k = 0 ; k < 4 ; k++ ) {
-				total = 
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
-				outpix[k] = total / 36;
-			}
-		}
-	}
-
-	if ( out == in ) {
-		Com_Memcpy( out, temp, outWidth * outHeight * 4 );
-		ri.Hunk_FreeTempMemory( temp );
-	}
+	temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
+	imageKernels->MipMap2( temp, in, inWidth, inHeight );
+	Com_Memcpy( out, temp, outWidth * outHeight * 4 );
+	ri.Hunk_FreeTempMemory( temp );
 }
 
 
@@ -516,29 +421,13 @@ static void R_BlendOverTexture( byte *data, int pixelCount, int mipLevel ) {
 		{255,0,255,128}
 	};
 
-	const byte *blend;
-	int		i;
-	int		inverseAlpha;
-	int		premult[3];
-
 	if ( data == NULL )
 		return;
 
 	if ( mipLevel <= 0 )
 		return;
 
-	blend = blendColors[ ( mipLevel - 1 ) % ARRAY_LEN( blendColors ) ];
-
-	inverseAlpha = 255 - blend[3];
-	premult[0] = blend[0] * blend[3];
-	premult[1] = blend[1] * blend[3];
-	premult[2] = blend[2] * blend[3];
-
-	for ( i = 0 ; i < pixelCount ; i++, data+=4 ) {
-		data[0] = ( data[0] * inverseAlpha + premult[0] ) >> 9;
-		data[1] = ( data[1] * inverseAlpha + premult[1] ) >> 9;
-		data[2] = ( data[2] * inverseAlpha + premult[2] ) >> 9;
-	}
+	imageKernels->BlendOverTexture( data, pixelCount, blendColors[ ( mipLevel - 1 ) % ARRAY_LEN( blendColors ) ] );
 }
 
 
@@ -570,39 +459,37 @@ typedef struct {
 	int base_level_height;
 } Image_Upload_Data;
 
-static void generate_image_upload_data( image_t *image, byte *data, Image_Upload_Data *upload_data ) {
-	
-	qboolean mipmap = image->flags & IMGFLAG_MIPMAP;
-	qboolean picmip = image->flags & IMGFLAG_PICMIP;
-	byte* resampled_buffer = NULL;
-	int scaled_width, scaled_height;
+/*
+================
+get_image_upload_size
+
+Dimensions of the base level before picmip is applied
+================
+*/
+static void get_image_upload_size( const image_t *image, int *scaled_width, int *scaled_height ) {
 	int width = image->width;
 	int height = image->height;
-	unsigned* scaled_buffer;
-	int mip_level_size;
-	int miplevel;
-
-	Com_Memset( upload_data, 0, sizeof( *upload_data ) );
+	int sw, sh;
 
 	if ( image->flags & IMGFLAG_NOSCALE ) {
 		//
 		// keep original dimensions
 		//
-		scaled_width = width;
-		scaled_height = height;
+		sw = width;
+		sh = height;
 	} else {
 		//
 		// convert to exact power of 2 sizes
 		//
-		for (scaled_width = 1 ; scaled_width < width ; scaled_width<<=1)
+		for (sw = 1 ; sw < width ; sw<<=1)
 			;
-		for (scaled_height = 1 ; scaled_height < height ; scaled_height<<=1)
+		for (sh = 1 ; sh < height ; sh<<=1)
 			;
 
-		if ( r_roundImagesDown->integer && scaled_width > width )
-			scaled_width >>= 1;
-		if ( r_roundImagesDown->integer && scaled_height > height )
-			scaled_height >>= 1;
+		if ( r_roundImagesDown->integer && sw > width )
+			sw >>= 1;
+		if ( r_roundImagesDown->integer && sh > height )
+			sh >>= 1;
 	}
 
 	//
@@ -610,28 +497,79 @@ static void generate_image_upload_data( image_t *image, byte *data, Image_Upload
 	// scale both axis down equally so we don't have to
 	// deal with a half mip resampling
 	//
-	while ( scaled_width > glConfig.maxTextureSize
-		|| scaled_height > glConfig.maxTextureSize ) {
-		scaled_width >>= 1;
-		scaled_height >>= 1;
+	while ( sw > glConfig.maxTextureSize
+		|| sh > glConfig.maxTextureSize ) {
+		sw >>= 1;
+		sh >>= 1;
+	}
+
+	*scaled_width = sw;
+	*scaled_height = sh;
+}
+
+
+static int get_image_picmip( const image_t *image ) {
+	if ( ( image->flags & IMGFLAG_PICMIP ) && ( tr.mapLoading || r_nomip->integer == 0 ) )
+		return r_picmip->integer;
+	else
+		return 0;
+}
+
+
+/*
+================
+mip_image_level
+
+R_MipMap2 leaves the output untouched for 1xN textures, so the
+first pixels of the source level are carried over in that case
+================
+*/
+static void mip_image_level( byte *out, byte *in, int width, int height ) {
+	if ( width == 1 || height == 1 ) {
+		int w = MAX( width >> 1, 1 );
+		int h = MAX( height >> 1, 1 );
+		Com_Memcpy( out, in, w * h * 4 );
 	}
+	R_MipMap( out, in, width, height );
+}
+
+
+/*
+================
+generate_image_upload_data
+
+Fills upload_data->buffer, which must hold at least 8 * scaled_width * scaled_height bytes,
+resample_buffer must hold 4 * scaled_width * scaled_height bytes if the image needs resampling.
+Doesn't allocate any memory, so it may run on worker threads
+================
+*/
+static void generate_image_upload_data( image_t *image, byte *data, int picmip, byte *resample_buffer, Image_Upload_Data *upload_data ) {
+	
+	qboolean mipmap = image->flags & IMGFLAG_MIPMAP;
+	byte *buffer = upload_data->buffer;
+	byte *scratch, *level;
+	int scaled_width, scaled_height;
+	int width = image->width;
+	int height = image->height;
+	int mip_level_size;
+	int miplevel;
+
+	get_image_upload_size( image, &scaled_width, &scaled_height );
 
-	upload_data->buffer = (byte*) ri.Hunk_AllocateTempMemory( 2 * 4 * scaled_width * scaled_height );
 	if ( data == NULL ) {
-		Com_Memset( upload_data->buffer, 0, 2 * 4 * scaled_width * scaled_height );
+		Com_Memset( buffer, 0, 2 * 4 * scaled_width * scaled_height );
 	}
 
 	if ( ( scaled_width != width || scaled_height != height ) && data ) {
-		resampled_buffer = (byte*) ri.Hunk_AllocateTempMemory( scaled_width * scaled_height * 4 );
-		ResampleTexture ((unsigned*)data, width, height, (unsigned*)resampled_buffer, scaled_width, scaled_height);
-		data = resampled_buffer;
+		ResampleTexture ((unsigned*)data, width, height, (unsigned*)resample_buffer, scaled_width, scaled_height);
+		data = resample_buffer;
 	}
 
 	width = scaled_width;
 	height = scaled_height;
 
 	if ( data == NULL ) {
-		data = upload_data->buffer;
+		data = buffer;
 	} else {
 		if ( image->flags & IMGFLAG_COLORSHIFT ) {
 			byte *p = data;
@@ -645,12 +583,8 @@ static void generate_image_upload_data( image_t *image, byte *data, Image_Upload
 	//
 	// perform optional picmip operation
 	//
-	if ( picmip && ( tr.mapLoading || r_nomip->integer == 0 ) ) {
-		scaled_width >>= r_picmip->integer;
-		scaled_height >>= r_picmip->integer;
-		//x >>= r_picmip->integer;
-		//y >>= r_picmip->integer;
-	}
+	scaled_width >>= picmip;
+	scaled_height >>= picmip;
 
 	//
 	// clamp to minimum size
@@ -669,20 +603,22 @@ static void generate_image_upload_data( image_t *image, byte *data, Image_Upload
 		upload_data->mip_levels = 1;
 		upload_data->buffer_size = scaled_width * scaled_height * 4;
 
-		if ( data != NULL ) {
-			Com_Memcpy( upload_data->buffer, data, upload_data->buffer_size );
-		}
-
-		if ( resampled_buffer != NULL ) {
-			ri.Hunk_FreeTempMemory( resampled_buffer );
+		if ( data != buffer ) {
+			Com_Memcpy( buffer, data, upload_data->buffer_size );
 		}
 
 		return;	//return upload_data;
 	}
 
-	// Use the normal mip-mapping to go down from [width, height] to [scaled_width, scaled_height] dimensions.
+	// Use the normal mip-mapping to go down from [width, height] to [scaled_width, scaled_height] dimensions,
+	// ping-pong between source data and upload buffer instead of mipping in place
+	scratch = ( data == buffer ) ? buffer + 4 * width * height : buffer;
 	while (width > scaled_width || height > scaled_height) {
-		R_MipMap(data, data, width, height);
+		mip_image_level( scratch, data, width, height );
+
+		level = data;
+		data = scratch;
+		scratch = level;
 
 		width >>= 1;
 		if (width < 1) width = 1;
@@ -693,22 +629,24 @@ static void generate_image_upload_data( image_t *image, byte *data, Image_Upload
 
 	// At this point width == scaled_width and height == scaled_height.
 
-	scaled_buffer = (unsigned int*) ri.Hunk_AllocateTempMemory( sizeof( unsigned ) * scaled_width * scaled_height );
-	Com_Memcpy(scaled_buffer, data, scaled_width * scaled_height * 4);
+	miplevel = 0;
+	mip_level_size = scaled_width * scaled_height * 4;
 
-	if ( !(image->flags & IMGFLAG_NOLIGHTSCALE ) ) {
-		R_LightScaleTexture( (byte*)scaled_buffer, scaled_width, scaled_height, !mipmap );
+	if ( data != buffer ) {
+		Com_Memcpy( buffer, data, mip_level_size );
 	}
 
-	miplevel = 0;
-	mip_level_size = scaled_width * scaled_height * 4;
+	if ( !(image->flags & IMGFLAG_NOLIGHTSCALE ) ) {
+		R_LightScaleTexture( buffer, scaled_width, scaled_height, !mipmap );
+	}
 
-	Com_Memcpy(upload_data->buffer, scaled_buffer, mip_level_size);
 	upload_data->buffer_size = mip_level_size;
 	
 	if ( mipmap ) {
+		level = buffer;
 		while (scaled_width > 1 || scaled_height > 1) {
-			R_MipMap((byte *)scaled_buffer, (byte *)scaled_buffer, scaled_width, scaled_height);
+			mip_image_level( &buffer[upload_data->buffer_size], level, scaled_width, scaled_height );
+			level = &buffer[upload_data->buffer_size];
 
 			scaled_width >>= 1;
 			if (scaled_width < 1) scaled_width = 1;
@@ -720,20 +658,14 @@ static void generate_image_upload_data( image_t *image, byte *data, Image_Upload
 			mip_level_size = scaled_width * scaled_height * 4;
 
 			if ( r_colorMipLevels->integer ) {
-				R_BlendOverTexture( (byte *)scaled_buffer, scaled_width * scaled_height, miplevel );
+				R_BlendOverTexture( level, scaled_width * scaled_height, miplevel );
 			}
 
-			Com_Memcpy(&upload_data->buffer[upload_data->buffer_size], scaled_buffer, mip_level_size);
 			upload_data->buffer_size += mip_level_size;
 		}
 	}
 
 	upload_data->mip_levels = miplevel + 1;
-
-	ri.Hunk_FreeTempMemory( scaled_buffer );
-
-	if ( resampled_buffer != NULL )
-		ri.Hunk_FreeTempMemory( resampled_buffer );
 }
 
 
@@ -822,6 +754,247 @@ static void upload_vk_image( Image_Upload_Data *upload_data, image_t *image ) {
 	}
 }
 
+
+/*
+============================================================================
+
+IMAGE BATCHES
+
+While a batch is active (i.e. during map load) R_CreateImage() only
+copies decoded pixels, light scaling, resampling and mipmap generation
+are done for the whole batch at once on the worker threads, then the
+results are uploaded from the main thread.
+
+============================================================================
+*/
+
+#define MAX_IMAGE_JOBS		512
+#define MAX_IMAGE_BATCH_SIZE	(96*1024*1024)
+
+typedef struct {
+	image_t		*image;
+	byte		*pic;
+	byte		*resample_buffer;
+	int			picmip;
+	Image_Upload_Data upload_data;
+} imageJob_t;
+
+static struct {
+	qboolean	active;
+	int			numJobs;
+	int			size;
+	imageJob_t	jobs[ MAX_IMAGE_JOBS ];
+	// executed by the main thread next to image jobs
+	void		(*extraFunc)( void *arg );
+	void		*extraArg;
+	// statistics
+	int			numImages;
+	int			numPrefetched;
+	int64_t		prefetchTime;
+	int64_t		decodeTime;
+	int64_t		processTime;
+	int64_t		uploadTime;
+} imageBatch;
+
+static void R_ClearPrefetchedImages( void );
+
+
+static void R_ProcessImageJob( void *arg, int index )
+{
+	imageJob_t *job;
+
+	if ( imageBatch.extraFunc ) {
+		// index 0 is always taken by the calling thread
+		if ( index == 0 ) {
+			imageBatch.extraFunc( imageBatch.extraArg );
+			return;
+		}
+		index--;
+	}
+
+	job = (imageJob_t *)arg + index;
+
+	generate_image_upload_data( job->image, job->pic, job->picmip, job->resample_buffer, &job->upload_data );
+}
+
+
+/*
+================
+R_FlushImageBatch
+
+Processes and uploads all queued images
+================
+*/
+void R_FlushImageBatch( void )
+{
+	imageJob_t *job;
+	int64_t t0, t1, t2;
+	int i;
+
+	if ( imageBatch.numJobs == 0 && !imageBatch.extraFunc )
+		return;
+
+	t0 = ri.Microseconds();
+
+	ri.Com_RunJobs( R_ProcessImageJob, imageBatch.jobs, imageBatch.numJobs + ( imageBatch.extraFunc ? 1 : 0 ) );
+
+	t1 = ri.Microseconds();
+
+	for ( i = 0, job = imageBatch.jobs; i < imageBatch.numJobs; i++, job++ ) {
+		upload_vk_image( &job->upload_data, job->image );
+		ri.Free( job->upload_data.buffer );
+	}
+
+	t2 = ri.Microseconds();
+
+	imageBatch.processTime += t1 - t0;
+	imageBatch.uploadTime += t2 - t1;
+	imageBatch.numImages += imageBatch.numJobs;
+	imageBatch.numJobs = 0;
+	imageBatch.size = 0;
+}
+
+
+/*
+================
+R_RunWithImageBatch
+
+Executes func( arg ) on the calling thread while queued images are processed
+by worker threads, then uploads them. func must not raise errors or touch
+the image batch.
+================
+*/
+void R_RunWithImageBatch( void (*func)( void *arg ), void *arg )
+{
+	if ( !imageBatch.active ) {
+		func( arg );
+		return;
+	}
+
+	imageBatch.extraFunc = func;
+	imageBatch.extraArg = arg;
+
+	R_FlushImageBatch();
+
+	imageBatch.extraFunc = NULL;
+	imageBatch.extraArg = NULL;
+}
+
+
+/*
+================
+R_QueueImage
+
+Copies source pixels into a single work allocation
+================
+*/
+static void R_QueueImage( image_t *image, const byte *pic )
+{
+	imageJob_t *job;
+	int scaled_width, scaled_height;
+	int scaled_size, pic_size, resample_size;
+	byte *buffer;
+
+	get_image_upload_size( image, &scaled_width, &scaled_height );
+
+	scaled_size = scaled_width * scaled_height * 4;
+	pic_size = image->width * image->height * 4;
+	if ( scaled_width != image->width || scaled_height != image->height )
+		resample_size = scaled_size;
+	else
+		resample_size = 0;
+
+	if ( imageBatch.numJobs == MAX_IMAGE_JOBS || imageBatch.size + 2 * scaled_size + resample_size + pic_size > MAX_IMAGE_BATCH_SIZE ) {
+		R_FlushImageBatch();
+	}
+
+	buffer = ri.Malloc( 2 * scaled_size + resample_size + pic_size );
+
+	job = &imageBatch.jobs[ imageBatch.numJobs++ ];
+	job->image = image;
+	job->picmip = get_image_picmip( image );
+	job->upload_data.buffer = buffer;
+	job->resample_buffer = resample_size ? buffer + 2 * scaled_size : NULL;
+	job->pic = buffer + 2 * scaled_size + resample_size;
+	Com_Memcpy( job->pic, pic, pic_size );
+
+	imageBatch.size += 2 * scaled_size + resample_size + pic_size;
+}
+
+
+/*
+================
+R_BeginImageBatch
+================
+*/
+void R_BeginImageBatch( void )
+{
+	// nothing to gain without worker threads
+	if ( ri.Com_NumJobThreads() <= 1 )
+		return;
+
+	R_ClearPrefetchedImages();
+
+	imageBatch.active = qtrue;
+	imageBatch.numJobs = 0;
+	imageBatch.size = 0;
+	imageBatch.numImages = 0;
+	imageBatch.numPrefetched = 0;
+	imageBatch.prefetchTime = 0;
+	imageBatch.decodeTime = 0;
+	imageBatch.processTime = 0;
+	imageBatch.uploadTime = 0;
+}
+
+
+/*
+================
+R_FinishImageBatch
+
+Flushes pending images, must be called before any of them is used for rendering
+================
+*/
+void R_FinishImageBatch( void )
+{
+	if ( !imageBatch.active )
+		return;
+
+	R_FlushImageBatch();
+	R_ClearPrefetchedImages();
+
+	imageBatch.active = qfalse;
+
+	if ( imageBatch.numImages ) {
+		ri.Printf( PRINT_DEVELOPER, "%i images: prefetch %i in %i msec, decode %i msec, process %i msec (%i threads), upload %i msec\n",
+			imageBatch.numImages, imageBatch.numPrefetched, (int)( imageBatch.prefetchTime / 1000 ),
+			(int)( imageBatch.decodeTime / 1000 ), (int)( imageBatch.processTime / 1000 ),
+			ri.Com_NumJobThreads(), (int)( imageBatch.uploadTime / 1000 ) );
+	}
+}
+
+
+/*
+================
+R_ClearImageBatch
+
+Drops queued images without uploading them
+================
+*/
+static void R_ClearImageBatch( void )
+{
+	int i;
+
+	for ( i = 0; i < imageBatch.numJobs; i++ ) {
+		ri.Free( imageBatch.jobs[ i ].upload_data.buffer );
+	}
+
+	R_ClearPrefetchedImages();
+
+	imageBatch.numJobs = 0;
+	imageBatch.size = 0;
+	imageBatch.active = qfalse;
+}
+
 #else // !USE_VULKAN
 
 static GLint RawImage_GetInternalFormat( const byte *scan, int numPixels, qboolean lightMap, qboolean allowCompression )
@@ -1042,6 +1215,14 @@ void R_UploadSubImage( byte *data, int x, int y, int width, int height, image_t
 		Upload32( data, x, y, width, height, image, qtrue ); // subImage = qtrue
 	}
 }
+
+
+void R_BeginImageBatch( void ) { }
+void R_FlushImageBatch( void ) { }
+void R_RunWithImageBatch( void (*func)( void *arg ), void *arg ) { func( arg ); }
+void R_FinishImageBatch( void ) { }
+void R_AddImagePrefetch( const char *name ) { }
+void R_PrefetchImages( void ) { }
 #endif // !USE_VULKAN
 
 
@@ -1058,6 +1239,8 @@ image_t *R_CreateImage( const char *name, const char *name2, byte *pic, int widt
 	long		hash;
 #ifdef USE_VULKAN
 	Image_Upload_Data upload_data;
+	byte		*resample_buffer;
+	int			scaled_width, scaled_height;
 #else
 	GLint		glWrapClampMode;
 	GLuint		currTexture;
@@ -1071,6 +1254,9 @@ image_t *R_CreateImage( const char *name, const char *name2, byte *pic, int widt
 		ri.Error( ERR_DROP, "R_CreateImage: \"%s\" is too long", name );
 	}
 
+	// uploads are not allowed while the render thread is recording commands
+	R_SyncRenderThread();
+
 	if ( name2 && Q_stricmp( name, name2 ) != 0 ) {
 		// leave only file name
 		name2 = ( slash = strrchr( name2, '/' ) ) != NULL ? slash + 1 : name2;
@@ -1117,7 +1303,27 @@ image_t *R_CreateImage( const char *name, const char *name2, byte *pic, int widt
 	else
 		image->wrapClampMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 
-	generate_image_upload_data( image, pic, &upload_data );
+	image->handle = VK_NULL_HANDLE;
+	image->view = VK_NULL_HANDLE;
+	image->descriptor = VK_NULL_HANDLE;
+
+	if ( imageBatch.active && pic != NULL ) {
+		// images without data may receive sub-uploads right after creation
+		R_QueueImage( image, pic );
+		return image;
+	}
+
+	get_image_upload_size( image, &scaled_width, &scaled_height );
+	upload_data.buffer = ri.Hunk_AllocateTempMemory( 2 * 4 * scaled_width * scaled_height );
+	if ( pic && ( scaled_width != width || scaled_height != height ) )
+		resample_buffer = ri.Hunk_AllocateTempMemory( 4 * scaled_width * scaled_height );
+	else
+		resample_buffer = NULL;
+
+	generate_image_upload_data( image, pic, get_image_picmip( image ), resample_buffer, &upload_data );
+
+	if ( resample_buffer )
+		ri.Hunk_FreeTempMemory( resample_buffer );
 
 	upload_vk_image( &upload_data, image );
 
@@ -1191,18 +1397,19 @@ typedef struct
 {
 	const char *ext;
 	void (*ImageLoader)( const char *, unsigned char **, int *, int * );
+	imageDecodeFunc_t ImageDecoder;	// for files already in memory, NULL if none
 } imageExtToLoaderMap_t;
 
 // Note that the ordering indicates the order of preference used
 // when there are multiple images of different formats available
 static const imageExtToLoaderMap_t imageLoaders[] =
 {
-	{ "png",  R_LoadPNG },
-	{ "tga",  R_LoadTGA },
-	{ "jpg",  R_LoadJPG },
-	{ "jpeg", R_LoadJPG },
-	{ "pcx",  R_LoadPCX },
-	{ "bmp",  R_LoadBMP }
+	{ "png",  R_LoadPNG, R_DecodePNG },
+	{ "tga",  R_LoadTGA, R_DecodeTGA },
+	{ "jpg",  R_LoadJPG, R_DecodeJPG },
+	{ "jpeg", R_LoadJPG, R_DecodeJPG },
+	{ "pcx",  R_LoadPCX, NULL },
+	{ "bmp",  R_LoadBMP, NULL }
 };
 
 static const int numImageLoaders = ARRAY_LEN( imageLoaders );
@@ -1292,6 +1499,305 @@ static const char *R_LoadImage( const char *name, byte **pic, int *width, int *h
 }
 
 
+#ifdef USE_VULKAN
+/*
+============================================================================
+
+IMAGE PREFETCH
+
+Images referenced by the map shaders are read on the main thread and decoded
+together on the worker threads before the shaders are parsed, R_FindImageFile()
+then takes the decoded pixels instead of loading the file.
+
+Jobs decode the file data with a private decoder that allocates with malloc(),
+an image with anything to report is dropped and loaded again on the main thread
+so messages and errors stay exactly as before.
+
+============================================================================
+*/
+
+#define MAX_PREFETCH_IMAGES		1024
+#define MAX_PREFETCH_PASS		64
+#define MAX_PREFETCH_SIZE		(128*1024*1024)
+
+typedef struct {
+	char		name[ MAX_QPATH ];		// as passed to R_FindImageFile()
+	char		localName[ MAX_QPATH ];	// file that R_LoadImage() would pick
+	int			hash;
+	int			loader;
+	byte		*data;
+	int			length;
+	byte		*pic;
+	int			width;
+	int			height;
+} prefetchImage_t;
+
+static struct {
+	int				numImages;
+	int				numDecoded;
+	int				size;
+	prefetchImage_t	images[ MAX_PREFETCH_IMAGES ];
+} prefetch;
+
+
+static void *R_PrefetchMalloc( int bytes )
+{
+	if ( bytes < 0 )
+		return NULL;
+
+	return malloc( bytes );
+}
+
+
+static void R_PrefetchImageJob( void *arg, int index )
+{
+	prefetchImage_t *image = (prefetchImage_t *)arg + index;
+	imageDecoder_t dec;
+
+	image->pic = NULL;
+
+	if ( image->loader < 0 )
+		return;
+
+	dec.name = image->localName;
+	dec.data = image->data;
+	dec.length = image->length;
+	dec.Malloc = R_PrefetchMalloc;
+	dec.Free = free;
+	dec.error = qfalse;
+	dec.printLevel = PRINT_ALL;
+	dec.message[0] = '\0';
+
+	imageLoaders[ image->loader ].ImageDecoder( &dec, &image->pic, &image->width, &image->height );
+
+	if ( dec.error || dec.message[0] ) {
+		free( image->pic );
+		image->pic = NULL;
+	}
+}
+
+
+/*
+=================
+R_ReadPrefetchFile
+=================
+*/
+static qboolean R_ReadPrefetchFile( prefetchImage_t *image, const char *name, int loader )
+{
+	void *buf;
+	int len;
+
+	// left to the main thread
+	if ( !imageLoaders[ loader ].ImageDecoder ) {
+		return ri.FS_ReadFile( name, NULL ) >= 0;
+	}
+
+	len = ri.FS_ReadFile( name, &buf );
+	if ( !buf || len < 0 ) {
+		return qfalse;
+	}
+
+	// keep a private copy so temp memory is freed in order
+	image->data = malloc( len + 1 );
+	if ( image->data ) {
+		Com_Memcpy( image->data, buf, len );
+		image->data[ len ] = '\0';
+		image->length = len;
+		image->loader = loader;
+		Q_strncpyz( image->localName, name, sizeof( image->localName ) );
+	}
+
+	ri.FS_FreeFile( buf );
+
+	return qtrue;
+}
+
+
+/*
+=================
+R_ReadPrefetchImage
+
+Reads the file in the same order of preference as R_LoadImage()
+=================
+*/
+static void R_ReadPrefetchImage( prefetchImage_t *image )
+{
+	char localName[ MAX_QPATH ];
+	const char *ext;
+	int orgLoader = -1;
+	int i;
+
+	image->loader = -1;
+	image->data = NULL;
+
+	Q_strncpyz( localName, image->name, sizeof( localName ) );
+
+	ext = COM_GetExtension( localName );
+	if ( *ext ) {
+		for ( i = 0; i < numImageLoaders; i++ ) {
+			if ( !Q_stricmp( ext, imageLoaders[ i ].ext ) ) {
+				break;
+			}
+		}
+		if ( i < numImageLoaders ) {
+			if ( R_ReadPrefetchFile( image, localName, i ) ) {
+				return;
+			}
+			orgLoader = i;
+			COM_StripExtension( image->name, localName, sizeof( localName ) );
+		}
+	}
+
+	for ( i = 0; i < numImageLoaders; i++ ) {
+		if ( i == orgLoader )
+			continue;
+		if ( R_ReadPrefetchFile( image, va( "%s.%s", localName, imageLoaders[ i ].ext ), i ) ) {
+			return;
+		}
+	}
+}
+
+
+/*
+=================
+R_AddImagePrefetch
+
+Queues an image for R_PrefetchImages(), ignored when no image batch is active
+=================
+*/
+void R_AddImagePrefetch( const char *name )
+{
+	char strippedName[ MAX_QPATH ];
+	prefetchImage_t *image;
+	image_t *img;
+	int hash;
+	int i;
+
+	if ( !imageBatch.active || prefetch.numImages == MAX_PREFETCH_IMAGES )
+		return;
+
+	if ( !name[0] || strlen( name ) >= MAX_QPATH )
+		return;
+
+	hash = generateHashValue( name );
+
+	COM_StripExtension( name, strippedName, sizeof( strippedName ) );
+	for ( img = hashTable[ hash ]; img; img = img->next ) {
+		if ( !Q_stricmp( name, img->imgName ) || !Q_stricmp( strippedName, img->imgName ) ) {
+			return;
+		}
+	}
+
+	for ( i = 0, image = prefetch.images; i < prefetch.numImages; i++, image++ ) {
+		if ( image->hash == hash && !Q_stricmp( name, image->name ) ) {
+			return;
+		}
+	}
+
+	image = &prefetch.images[ prefetch.numImages++ ];
+	Com_Memset( image, 0, sizeof( *image ) );
+	Q_strncpyz( image->name, name, sizeof( image->name ) );
+	image->hash = hash;
+	image->loader = -1;
+}
+
+
+/*
+=================
+R_PrefetchImages
+
+Reads queued images and decodes them on the worker threads
+=================
+*/
+void R_PrefetchImages( void )
+{
+	prefetchImage_t *image;
+	int64_t start;
+	int first, count, i;
+
+	if ( prefetch.numDecoded == prefetch.numImages )
+		return;
+
+	start = ri.Microseconds();
+
+	for ( first = prefetch.numDecoded; first < prefetch.numImages && prefetch.size < MAX_PREFETCH_SIZE; first += count ) {
+		count = MIN( prefetch.numImages - first, MAX_PREFETCH_PASS );
+
+		for ( i = 0; i < count; i++ ) {
+			R_ReadPrefetchImage( &prefetch.images[ first + i ] );
+		}
+
+		ri.Com_RunJobs( R_PrefetchImageJob, prefetch.images + first, count );
+
+		for ( i = 0, image = prefetch.images + first; i < count; i++, image++ ) {
+			free( image->data );
+			image->data = NULL;
+			if ( image->pic ) {
+				prefetch.size += image->width * image->height * 4;
+				imageBatch.numPrefetched++;
+			}
+		}
+	}
+
+	// the rest is loaded on demand
+	prefetch.numImages = prefetch.numDecoded = first;
+
+	imageBatch.prefetchTime += ri.Microseconds() - start;
+}
+
+
+/*
+=================
+R_TakePrefetchedImage
+
+Returns the file name and hands over pixels allocated with malloc(),
+NULL if the image was not prefetched
+=================
+*/
+static const char *R_TakePrefetchedImage( const char *name, byte **pic, int *width, int *height )
+{
+	prefetchImage_t *image;
+	int hash;
+	int i;
+
+	hash = generateHashValue( name );
+
+	for ( i = 0, image = prefetch.images; i < prefetch.numDecoded; i++, image++ ) {
+		if ( image->pic && image->hash == hash && !Q_stricmp( name, image->name ) ) {
+			*pic = image->pic;
+			*width = image->width;
+			*height = image->height;
+			image->pic = NULL;
+			prefetch.size -= image->width * image->height * 4;
+			return image->localName;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+=================
+R_ClearPrefetchedImages
+=================
+*/
+static void R_ClearPrefetchedImages( void )
+{
+	int i;
+
+	for ( i = 0; i < prefetch.numImages; i++ ) {
+		free( prefetch.images[ i ].pic );
+		free( prefetch.images[ i ].data );
+	}
+
+	prefetch.numImages = 0;
+	prefetch.numDecoded = 0;
+	prefetch.size = 0;
+}
+#endif // USE_VULKAN
+
+
 /*
 ===============
 R_FindImageFile
@@ -1308,6 +1814,9 @@ image_t	*R_FindImageFile( const char *name, imgFlags_t flags )
 	int		width, height;
 	byte	*pic;
 	int		hash;
+#ifdef USE_VULKAN
+	qboolean prefetched = qfalse;
+#endif
 
 	if ( !name ) {
 		return NULL;
@@ -1348,6 +1857,18 @@ image_t	*R_FindImageFile( const char *name, imgFlags_t flags )
 	//
 	// load the pic from disk
 	//
+#ifdef USE_VULKAN
+	// images not decoded by R_PrefetchImages() are loaded on the main thread
+	if ( imageBatch.active ) {
+		int64_t start = ri.Microseconds();
+		localName = R_TakePrefetchedImage( name, &pic, &width, &height );
+		if ( localName )
+			prefetched = qtrue;
+		else
+			localName = R_LoadImage( name, &pic, &width, &height );
+		imageBatch.decodeTime += ri.Microseconds() - start;
+	} else
+#endif
 	localName = R_LoadImage( name, &pic, &width, &height );
 	if ( pic == NULL ) {
 		return NULL;
@@ -1372,11 +1893,47 @@ image_t	*R_FindImageFile( const char *name, imgFlags_t flags )
 	}
 
 	image = R_CreateImage( name, localName, pic, width, height, flags );
+#ifdef USE_VULKAN
+	if ( prefetched )
+		free( pic );
+	else
+#endif
 	ri.Free( pic );
 	return image;
 }
 
 
+/*
+===============
+R_ImageBench_f
+
+Measures texture processing kernels on the given images
+===============
+*/
+void R_ImageBench_f( void )
+{
+	const char *name;
+	byte *pic;
+	int i, width, height;
+
+	if ( ri.Cmd_Argc() < 2 ) {
+		ri.Printf( PRINT_ALL, "usage: imagebench <image> [image ...]\n" );
+		return;
+	}
+
+	for ( i = 1; i < ri.Cmd_Argc(); i++ ) {
+		name = ri.Cmd_Argv( i );
+		R_LoadImage( name, &pic, &width, &height );
+		if ( pic == NULL ) {
+			ri.Printf( PRINT_WARNING, "imagebench: couldn't load %s\n", name );
+			continue;
+		}
+		R_BenchImageKernels( name, pic, width, height, 10 );
+		ri.Free( pic );
+	}
+}
+
+
 /*
 ================
 R_CreateDlightImage
@@ -1678,6 +2235,8 @@ void R_SetColorMappings( void ) {
 	int		inf;
 	int		shift;
 
+	R_SyncRenderThread();
+
 	// setup the overbright lighting
 	// negative value will force gamma in windowed mode
 	tr.overbrightBits = abs( r_overBrightBits->integer );
@@ -1741,6 +2300,10 @@ void R_SetColorMappings( void ) {
 		s_intensitytable[i] = j;
 	}
 
+	for ( i = 0; i < ARRAY_LEN( s_gammaintensitytable ); i++ ) {
+		s_gammaintensitytable[i] = s_gammatable[s_intensitytable[i]];
+	}
+
 #ifdef USE_VULKAN
 	vk_update_post_process_pipelines();
 	
@@ -1774,6 +2337,8 @@ void R_InitImages( void ) {
 
 	Com_Memset( hashTable, 0, sizeof( hashTable ) );
 
+	R_InitImageKernels();
+
 	// build brightness translation tables
 	R_SetColorMappings();
 
@@ -1793,6 +2358,8 @@ void R_DeleteTextures( void ) {
 	int i;
 
 #ifdef USE_VULKAN
+	R_ClearImageBatch();
+
 	vk_wait_idle();
 
 	for ( i = 0; i < tr.numImages; i++ ) {
@@ -56,6 +56,10 @@ cvar_t	*r_zproj;
 cvar_t	*r_stereoSeparation;
 
 cvar_t	*r_skipBackEnd;
+cvar_t	*r_smp;
+cvar_t	*r_shaderCache;
+cvar_t	*r_pipelineCache;
+cvar_t	*r_parallelCull;
 
 //cvar_t	*r_anaglyphMode;
 
@@ -1060,6 +1064,9 @@ static void R_ScreenShot_f( void ) {
 		return;
 	}
 
+	// backEnd screenshot state is shared with the render thread
+	R_SyncRenderThread();
+
 	if ( !strcmp( ri.Cmd_Argv(1), "levelshot" ) ) {
 		R_LevelShot();
 		return;
@@ -1121,24 +1128,15 @@ static void R_ScreenShot_f( void ) {
 
 /*
 ==================
-RB_TakeVideoFrameCmd
+RB_WriteVideoFrame
+
+Encodes captured RGB pixels and passes them to the AVI writer
 ==================
 */
-const void *RB_TakeVideoFrameCmd( const void *data )
+static void RB_WriteVideoFrame( const videoFrameCommand_t *cmd, byte *cBuf, int packAlign )
 {
-	const videoFrameCommand_t *cmd;
-	byte		*cBuf;
 	size_t		memcount, linelen;
 	int			padwidth, avipadwidth, padlen, avipadlen;
-	int			packAlign;
-
-	cmd = (const videoFrameCommand_t *)data;
-
-#ifdef USE_VULKAN
-	packAlign = 1;
-#else
-	qglGetIntegerv(GL_PACK_ALIGNMENT, &packAlign);
-#endif
 
 	linelen = cmd->width * 3;
 
@@ -1149,14 +1147,6 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 	avipadwidth = PAD(linelen, AVI_LINE_PADDING);
 	avipadlen = avipadwidth - linelen;
 
-	cBuf = PADP(cmd->captureBuffer, packAlign);
-
-#ifdef USE_VULKAN
-	vk_read_pixels(cBuf, cmd->width, cmd->height);
-#else
-	qglReadPixels(0, 0, cmd->width, cmd->height, GL_RGB, GL_UNSIGNED_BYTE, cBuf);
-#endif
-
 	memcount = padwidth * cmd->height;
 
 	// gamma correct
@@ -1199,11 +1189,95 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 
 		ri.CL_WriteAVIVideoFrame(cmd->encodeBuffer, avipadwidth * cmd->height);
 	}
+}
+
+
+/*
+==================
+RB_TakeVideoFrameCmd
+==================
+*/
+const void *RB_TakeVideoFrameCmd( const void *data )
+{
+	const videoFrameCommand_t *cmd;
+	byte		*cBuf;
+	int			packAlign;
+
+	cmd = (const videoFrameCommand_t *)data;
+
+#ifdef USE_VULKAN
+	packAlign = 1;
+#else
+	qglGetIntegerv(GL_PACK_ALIGNMENT, &packAlign);
+#endif
+
+	cBuf = PADP(cmd->captureBuffer, packAlign);
+
+#ifdef USE_VULKAN
+	vk_read_pixels(cBuf, cmd->width, cmd->height);
+#else
+	qglReadPixels(0, 0, cmd->width, cmd->height, GL_RGB, GL_UNSIGNED_BYTE, cBuf);
+#endif
+
+	RB_WriteVideoFrame( cmd, cBuf, packAlign );
 
 	return (const void *)(cmd + 1);
 }
 
 
+#ifdef USE_VULKAN
+static videoFrameCommand_t videoFrames[ VK_READBACK_FRAMES ];
+
+/*
+==================
+RB_FlushVideoFrames
+
+Writes video frames which readback has been completed, in capture order
+==================
+*/
+void RB_FlushVideoFrames( qboolean wait )
+{
+	const videoFrameCommand_t *cmd;
+	int slot;
+
+	while ( ( slot = vk_readback_next( wait ) ) >= 0 ) {
+		cmd = &videoFrames[ slot ];
+		vk_readback_read( slot, cmd->captureBuffer );
+		RB_WriteVideoFrame( cmd, cmd->captureBuffer, 1 );
+	}
+}
+
+
+/*
+==================
+RB_QueueVideoFrame
+
+Requests asynchronous readback of the frame being finished,
+returns readback slot or -1 if the frame must be read synchronously
+==================
+*/
+int RB_QueueVideoFrame( const videoFrameCommand_t *cmd )
+{
+	int slot;
+
+	RB_FlushVideoFrames( qfalse );
+
+	slot = vk_readback_begin( cmd->width, cmd->height );
+	if ( slot < 0 ) {
+		// all buffers are in flight
+		RB_FlushVideoFrames( qtrue );
+		slot = vk_readback_begin( cmd->width, cmd->height );
+	}
+
+	if ( slot >= 0 ) {
+		videoFrames[ slot ] = *cmd;
+	}
+
+	return slot;
+}
+#endif
+
+
 //============================================================================
 
 /*
@@ -1443,6 +1517,11 @@ static void VkInfo_f( void )
 	ri.Printf(PRINT_ALL, "max_push_size: %ib\n", vk.stats.push_size_max );
 
 	ri.Printf(PRINT_ALL, "pipeline handles: %i\n", vk.pipeline_create_count );
+	ri.Printf(PRINT_ALL, "pipeline cache: %i bytes loaded", vk.pipeline_cache_size );
+	if ( vk.creationFeedback )
+		ri.Printf(PRINT_ALL, ", %i hits", vk.pipeline_cache_hits );
+	ri.Printf(PRINT_ALL, "\n" );
+	ri.Printf(PRINT_ALL, "pipeline stalls: %i, %i msec\n", vk.pipeline_stall_count, (int)( vk.pipeline_stall_time / 1000 ) );
 	ri.Printf(PRINT_ALL, "pipeline descriptors: %i, base: %i\n", vk.pipelines_count, vk.pipelines_world_base );
 	ri.Printf(PRINT_ALL, "image chunks: %i\n", vk_world.num_image_chunks );
 }
@@ -1456,9 +1535,13 @@ RE_SyncRender
 */
 static void RE_SyncRender( void )
 {
+	R_SyncRenderThread();
 #ifdef USE_VULKAN
-	if ( vk.device )
+	if ( vk.device ) {
+		// write out pending video frames
+		RB_FlushVideoFrames( qtrue );
 		vk_wait_idle();
+	}
 #else
 	if ( qglFinish && backEnd.doneSurfaces )
 		qglFinish();
@@ -1482,6 +1565,8 @@ static void R_Register( void )
 	ri.Cmd_AddCommand( "screenshotJPEG", R_ScreenShot_f );
 	ri.Cmd_AddCommand( "screenshotBMP", R_ScreenShot_f );
 	ri.Cmd_AddCommand( "gfxinfo", GfxInfo_f );
+	ri.Cmd_AddCommand( "imagebench", R_ImageBench_f );
+	ri.Cmd_AddCommand( "sortbench", R_SortBench_f );
 #ifdef USE_VULKAN
 	ri.Cmd_AddCommand( "vkinfo", VkInfo_f );
 #endif
@@ -1659,6 +1744,22 @@ static void R_Register( void )
 
 	r_skipBackEnd = ri.Cvar_Get ("r_skipBackEnd", "0", CVAR_CHEAT);
 
+	r_smp = ri.Cvar_Get( "r_smp", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_smp, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_smp, "Execute renderer back end on a separate thread, overlapping it with the next frame." );
+
+	r_shaderCache = ri.Cvar_Get( "r_shaderCache", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_shaderCache, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_shaderCache, "Keep scanned shader scripts in shadercache.dat and reuse them while the set of pk3 files stays the same." );
+
+	r_pipelineCache = ri.Cvar_Get( "r_pipelineCache", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_pipelineCache, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_pipelineCache, "Keep compiled Vulkan pipelines in pipelinecache.dat and reuse them on next start with the same GPU and driver." );
+
+	r_parallelCull = ri.Cvar_Get( "r_parallelCull", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_parallelCull, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_parallelCull, "Split world BSP traversal and surface culling across worker threads, see \\com_workerThreads." );
+
 	r_lodscale = ri.Cvar_Get( "r_lodscale", "5", CVAR_CHEAT );
 	r_norefresh = ri.Cvar_Get ("r_norefresh", "0", CVAR_CHEAT);
 	r_drawentities = ri.Cvar_Get ("r_drawentities", "1", CVAR_CHEAT );
@@ -1792,6 +1893,9 @@ void R_Init( void ) {
 
 	ri.Printf( PRINT_ALL, "----- R_Init -----\n" );
 
+	// render thread from the previous initialization must not touch cleared state
+	R_ShutdownRenderThread();
+
 	// clear all our internal state
 	Com_Memset( &tr, 0, sizeof( tr ) );
 	Com_Memset( &backEnd, 0, sizeof( backEnd ) );
@@ -1842,10 +1946,19 @@ void R_Init( void ) {
 	max_polys = r_maxpolys->integer;
 	max_polyverts = r_maxpolyverts->integer;
 
-	ptr = ri.Hunk_Alloc( sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
-	backEndData = (backEndData_t *) ptr;
-	backEndData->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData ));
-	backEndData->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys);
+	for ( i = 0; i < SMP_FRAMES; i++ ) {
+		if ( i > 0 && !r_smp->integer ) {
+			backEndData[i] = NULL;
+			continue;
+		}
+		ptr = ri.Hunk_Alloc( sizeof( *backEndData[i] ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
+		backEndData[i] = (backEndData_t *) ptr;
+		backEndData[i]->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData[i] ));
+		backEndData[i]->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData[i] ) + sizeof(srfPoly_t) * max_polys);
+	}
+
+	tr.smpFrame = 0;
+	backEnd.smpFrame = 0;
 
 	R_InitNextFrame();
 
@@ -1865,6 +1978,8 @@ void R_Init( void ) {
 
 	R_InitFreeType();
 
+	R_InitRenderThread();
+
 #ifndef USE_VULKAN
 	err = qglGetError();
 	if ( err != GL_NO_ERROR )
@@ -1890,6 +2005,14 @@ static void RE_Shutdown( refShutdownCode_t code ) {
 #endif
 	ri.Printf( PRINT_ALL, "RE_Shutdown( %i )\n", code );
 
+	R_ShutdownRenderThread();
+
+#ifdef USE_VULKAN
+	if ( vk.device ) {
+		RB_FlushVideoFrames( qtrue );
+	}
+#endif
+
 	ri.Cmd_RemoveCommand( "modellist" );
 	ri.Cmd_RemoveCommand( "screenshotBMP" );
 	ri.Cmd_RemoveCommand( "screenshotJPEG" );
@@ -1898,6 +2021,8 @@ static void RE_Shutdown( refShutdownCode_t code ) {
 	ri.Cmd_RemoveCommand( "shaderlist" );
 	ri.Cmd_RemoveCommand( "skinlist" );
 	ri.Cmd_RemoveCommand( "gfxinfo" );
+	ri.Cmd_RemoveCommand( "imagebench" );
+	ri.Cmd_RemoveCommand( "sortbench" );
 	ri.Cmd_RemoveCommand( "shaderstate" );
 #ifdef USE_VULKAN
 	ri.Cmd_RemoveCommand( "vkinfo" );
@@ -1956,6 +2081,9 @@ Touch all images to make sure they are resident
 */
 static void RE_EndRegistration( void ) {
 #ifdef USE_VULKAN
+	R_SyncRenderThread();
+	R_FinishImageBatch();
+	vk_finish_pipeline_batch();
 	vk_wait_idle();
 	// command buffer is not in recording state at this stage
 	// so we can't issue RB_ShowImages() there
@@ -1983,6 +2111,14 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 
 	ri = *rimp;
 
+#ifdef USE_NULL_RENDERER
+	// never open a window or touch display gamma
+	ri.VKimp_Init = NullImp_Init;
+	ri.VKimp_Shutdown = NullImp_Shutdown;
+	ri.GLimp_InitGamma = NullImp_InitGamma;
+	ri.GLimp_SetGamma = NullImp_SetGamma;
+#endif
+
 	Com_Memset( &re, 0, sizeof( re ) );
 
 	if ( apiVersion != REF_API_VERSION ) {
@@ -882,8 +882,21 @@ typedef struct mnode_s {
 
 	msurface_t	**firstmarksurface;
 	int			nummarksurfaces;
+
+	int			numLeafs;		// leafs in this subtree, 1 for leafs
 } mnode_t;
 
+// scratch entries of the parallel world traversal, see R_AddWorldSurfaces
+typedef struct {
+	mnode_t		*leaf;
+	unsigned int dlightBits;
+} visLeaf_t;
+
+typedef struct {
+	msurface_t	*surf;
+	unsigned int dlightBits;
+} visSurf_t;
+
 typedef struct {
 	vec3_t		bounds[2];		// for culling
 	msurface_t	*firstSurface;
@@ -932,6 +945,11 @@ typedef struct {
 
 	char		*entityString;
 	const char	*entityParsePoint;
+
+	// traversal scratch, sized for all leafs / surfaces
+	visLeaf_t	*visLeafs;
+	visSurf_t	*visSurfs;
+	drawSurf_t	*visDrawSurfs;
 } world_t;
 
 //======================================================================
@@ -1030,6 +1048,8 @@ typedef struct {
 	int		c_lit_culls;
 	int		c_lit_masks;
 #endif
+
+	int		c_smpWaitUsec;		// front end stalled waiting for the render thread
 } frontEndCounters_t;
 
 #define	FOG_TABLE_SIZE		256
@@ -1070,6 +1090,7 @@ typedef struct {
 	int		c_flareRenders;
 
 	int		msec;			// total msec for backend run
+	int		usec;			// same, render thread wall time with r_smp
 #ifdef USE_PMLIGHT
 	int		c_lit_batches;
 	int		c_lit_vertices;
@@ -1129,6 +1150,8 @@ typedef struct {
 	qboolean screenMapDone;
 	qboolean doneBloom;
 
+	int		smpFrame;		// backEndData[] index being executed
+
 } backEndState_t;
 
 typedef struct drawSurfsCommand_s drawSurfsCommand_t;
@@ -1207,6 +1230,8 @@ typedef struct {
 	frontEndCounters_t		pc;
 	int						frontEndMsec;		// not in pc due to clearing issue
 
+	int						smpFrame;			// backEndData[] index filled by the front end
+
 	//
 	// put large tables at the end, so most elements will be
 	// within the +/32K indexed range on risc processors
@@ -1235,6 +1260,7 @@ typedef struct {
 	float					fogTable[FOG_TABLE_SIZE];
 
 	qboolean				mapLoading;
+	qboolean				sortBench;			// run "sortbench" on the next view
 
 	int						needScreenMap;
 #ifdef USE_VULKAN
@@ -1359,6 +1385,10 @@ extern	cvar_t	*r_portalOnly;
 extern	cvar_t	*r_subdivisions;
 extern	cvar_t	*r_lodCurveError;
 extern	cvar_t	*r_skipBackEnd;
+extern	cvar_t	*r_smp;
+extern	cvar_t	*r_shaderCache;
+extern	cvar_t	*r_pipelineCache;
+extern	cvar_t	*r_parallelCull;
 
 extern	cvar_t	*r_greyscale;
 extern	cvar_t	*r_dither;
@@ -1497,12 +1527,20 @@ void		R_GammaCorrect( byte *buffer, int bufSize );
 void		R_ColorShiftLightingBytes( const byte in[4], byte out[4] );
 
 void	R_ImageList_f( void );
+void	R_ImageBench_f( void );
+void	R_SortBench_f( void );
 void	R_SkinList_f( void );
 
 void	R_InitFogTable( void );
 float	R_FogFactor( float s, float t );
 void	R_InitImages( void );
 void	R_DeleteTextures( void );
+void	R_BeginImageBatch( void );
+void	R_FlushImageBatch( void );
+void	R_RunWithImageBatch( void (*func)( void *arg ), void *arg );
+void	R_FinishImageBatch( void );
+void	R_AddImagePrefetch( const char *name );
+void	R_PrefetchImages( void );
 int		R_SumOfUsedImages( void );
 void	R_InitSkins( void );
 skin_t	*R_GetSkinByHandle( qhandle_t hSkin );
@@ -1510,11 +1548,16 @@ skin_t	*R_GetSkinByHandle( qhandle_t hSkin );
 int R_ComputeLOD( trRefEntity_t *ent );
 
 const void *RB_TakeVideoFrameCmd( const void *data );
+#ifdef USE_VULKAN
+void RB_FlushVideoFrames( qboolean wait );
+int RB_QueueVideoFrame( const videoFrameCommand_t *cmd );
+#endif
 
 //
 // tr_shader.c
 //
 shader_t	*R_FindShader( const char *name, int lightmapIndex, qboolean mipRawImage );
+void		R_PrefetchShaderImages( const dshader_t *shaders, int count );
 shader_t	*R_GetShaderByHandle( qhandle_t hShader );
 shader_t	*R_GetShaderByState( int index, long *cycleTime );
 shader_t	*R_FindShaderByName( const char *name );
@@ -1930,7 +1973,11 @@ typedef struct {
 extern	int		max_polys;
 extern	int		max_polyverts;
 
-extern	backEndData_t	*backEndData;
+// with r_smp the front end fills one frame while the render thread
+// executes the other one
+#define	SMP_FRAMES		2
+
+extern	backEndData_t	*backEndData[SMP_FRAMES];	// the second one may not be allocated
 
 void RB_ExecuteRenderCommands( const void *data );
 void RB_TakeScreenshot( int x, int y, int width, int height, const char *fileName );
@@ -1939,6 +1986,10 @@ void RB_TakeScreenshotBMP( int x, int y, int width, int height, const char *file
 
 void R_IssuePendingRenderCommands( void );
 
+void R_InitRenderThread( void );
+void R_ShutdownRenderThread( void );
+void R_SyncRenderThread( void );
+
 void R_AddDrawSurfCmd( drawSurf_t *drawSurfs, int numDrawSurfs );
 
 void RE_SetColor( const float *rgba );
@@ -1180,7 +1180,7 @@ static qboolean R_MirrorViewBySurface( const drawSurf_t *drawSurf, int entityNum
 
 #ifdef USE_PMLIGHT
 	// create dedicated set for each view
-	if ( r_numdlights + oldParms.num_dlights <= ARRAY_LEN( backEndData->dlights ) ) {
+	if ( r_numdlights + oldParms.num_dlights <= ARRAY_LEN( backEndData[0]->dlights ) ) {
 		int i;
 		newParms.dlights = oldParms.dlights + oldParms.num_dlights;
 		newParms.num_dlights = oldParms.num_dlights;
@@ -1271,6 +1271,8 @@ DRAWSURF SORTING
 /*
 ===============
 R_Radix
+
+Reference byte-wise radix pass, only used by "sortbench" now
 ===============
 */
 static ID_INLINE void R_Radix( int byte, int size, const drawSurf_t *source, drawSurf_t *dest )
@@ -1299,14 +1301,13 @@ static ID_INLINE void R_Radix( int byte, int size, const drawSurf_t *source, dra
 
 /*
 ===============
-R_RadixSort
+R_RadixSortBytes
 
 Radix sort with 4 byte size buckets
 ===============
 */
-static void R_RadixSort( drawSurf_t *source, int size )
+static void R_RadixSortBytes( drawSurf_t *source, drawSurf_t *scratch, int size )
 {
-  static drawSurf_t scratch[ MAX_DRAWSURFS ];
 #ifdef Q3_LITTLE_ENDIAN
   R_Radix( 0, size, source, scratch );
   R_Radix( 1, size, scratch, source );
@@ -1321,6 +1322,217 @@ static void R_RadixSort( drawSurf_t *source, int size )
 }
 
 
+// 11+11+10 bit digits of the 32-bit sort key
+#define RADIX_BITS			11
+#define RADIX_SIZE			( 1 << RADIX_BITS )
+#define RADIX_MASK			( RADIX_SIZE - 1 )
+#define RADIX_PASSES		3
+
+#define MAX_SORT_JOBS		16
+#define MIN_SORT_JOB_SIZE	4096
+
+typedef struct {
+	unsigned int	key;
+	unsigned int	index;
+} sortKey_t;
+
+typedef struct {
+	const drawSurf_t *source;
+	sortKey_t		*keys;
+	int				first;
+	int				count;
+	int				histogram[ RADIX_PASSES ][ RADIX_SIZE ];
+} sortJob_t;
+
+static sortKey_t	sortKeys[ 2 ][ MAX_DRAWSURFS ];
+static drawSurf_t	sortScratch[ MAX_DRAWSURFS ];
+static sortJob_t	sortJobs[ MAX_SORT_JOBS ];
+
+
+/*
+===============
+R_SortHistogramJob
+
+Extracts (key, index) pairs and counts all digits of a range in one pass
+===============
+*/
+static void R_SortHistogramJob( void *arg, int index )
+{
+	sortJob_t *job = &sortJobs[ index ];
+	const drawSurf_t *ds;
+	sortKey_t *k;
+	unsigned int key;
+	int i, n;
+
+	Com_Memset( job->histogram, 0, sizeof( job->histogram ) );
+
+	ds = job->source + job->first;
+	k = job->keys + job->first;
+	n = job->count;
+	for ( i = 0; i < n; i++ ) {
+		key = ds[i].sort;
+		k[i].key = key;
+		k[i].index = job->first + i;
+		job->histogram[0][ key & RADIX_MASK ]++;
+		job->histogram[1][ ( key >> RADIX_BITS ) & RADIX_MASK ]++;
+		job->histogram[2][ key >> ( RADIX_BITS * 2 ) ]++;
+	}
+}
+
+
+/*
+===============
+R_RadixSort
+
+Sorts compact (key, index) pairs with three 11-bit digit passes, digits
+that are the same for all surfaces are skipped. Histograms of large lists
+are built on worker threads. Stable, so the result is the same as with
+R_RadixSortBytes().
+===============
+*/
+static void R_RadixSort( drawSurf_t *source, int size )
+{
+	int histogram[ RADIX_PASSES ][ RADIX_SIZE ];
+	const sortKey_t *src;
+	sortKey_t *dst, *tmp;
+	int numJobs, count, pass, shift, numPasses;
+	int i, j, sum, c;
+
+	if ( size < 2 ) {
+		return;
+	}
+
+	numJobs = 1;
+	if ( size >= MIN_SORT_JOB_SIZE * 2 ) {
+		numJobs = MIN( size / MIN_SORT_JOB_SIZE, ri.Com_NumJobThreads() );
+		numJobs = MIN( numJobs, MAX_SORT_JOBS );
+	}
+
+	count = ( size + numJobs - 1 ) / numJobs;
+	for ( i = 0; i < numJobs; i++ ) {
+		sortJobs[i].source = source;
+		sortJobs[i].keys = sortKeys[0];
+		sortJobs[i].first = i * count;
+		sortJobs[i].count = MIN( count, size - i * count );
+	}
+
+	if ( numJobs > 1 ) {
+		ri.Com_RunJobs( R_SortHistogramJob, NULL, numJobs );
+		Com_Memcpy( histogram, sortJobs[0].histogram, sizeof( histogram ) );
+		for ( j = 1; j < numJobs; j++ ) {
+			for ( pass = 0; pass < RADIX_PASSES; pass++ ) {
+				for ( i = 0; i < RADIX_SIZE; i++ ) {
+					histogram[pass][i] += sortJobs[j].histogram[pass][i];
+				}
+			}
+		}
+	} else {
+		R_SortHistogramJob( NULL, 0 );
+		Com_Memcpy( histogram, sortJobs[0].histogram, sizeof( histogram ) );
+	}
+
+	src = sortKeys[0];
+	dst = sortKeys[1];
+	numPasses = 0;
+
+	for ( pass = 0, shift = 0; pass < RADIX_PASSES; pass++, shift += RADIX_BITS ) {
+		int *offset = histogram[pass];
+
+		// all keys have the same digit, order stays the same
+		if ( offset[ ( src[0].key >> shift ) & RADIX_MASK ] == size ) {
+			continue;
+		}
+
+		for ( i = 0, sum = 0; i < RADIX_SIZE; i++ ) {
+			c = offset[i];
+			offset[i] = sum;
+			sum += c;
+		}
+
+		for ( i = 0; i < size; i++ ) {
+			dst[ offset[ ( src[i].key >> shift ) & RADIX_MASK ]++ ] = src[i];
+		}
+
+		tmp = (sortKey_t *)src;
+		src = dst;
+		dst = tmp;
+		numPasses++;
+	}
+
+	if ( numPasses == 0 ) {
+		return;	// all keys are equal
+	}
+
+	for ( i = 0; i < size; i++ ) {
+		sortScratch[i] = source[ src[i].index ];
+	}
+	Com_Memcpy( source, sortScratch, size * sizeof( drawSurf_t ) );
+}
+
+
+/*
+===============
+R_SortBench
+
+Runs both sorts on a captured draw surface list and compares results
+===============
+*/
+static void R_SortBench( const drawSurf_t *drawSurfs, int numDrawSurfs )
+{
+	drawSurf_t *list, *ref, *tmp;
+	int64_t start, bytesTime, radixTime;
+	int i, loops, diff;
+
+	tr.sortBench = qfalse;
+
+	list = ri.Malloc( numDrawSurfs * 3 * sizeof( drawSurf_t ) );
+	ref = list + numDrawSurfs;
+	tmp = ref + numDrawSurfs;
+
+	loops = MAX( 10, 2000000 / MAX( numDrawSurfs, 1 ) );
+
+	bytesTime = 0;
+	for ( i = 0; i < loops; i++ ) {
+		Com_Memcpy( ref, drawSurfs, numDrawSurfs * sizeof( drawSurf_t ) );
+		start = ri.Microseconds();
+		R_RadixSortBytes( ref, tmp, numDrawSurfs );
+		bytesTime += ri.Microseconds() - start;
+	}
+
+	radixTime = 0;
+	for ( i = 0; i < loops; i++ ) {
+		Com_Memcpy( list, drawSurfs, numDrawSurfs * sizeof( drawSurf_t ) );
+		start = ri.Microseconds();
+		R_RadixSort( list, numDrawSurfs );
+		radixTime += ri.Microseconds() - start;
+	}
+
+	for ( i = 0, diff = 0; i < numDrawSurfs; i++ ) {
+		if ( list[i].sort != ref[i].sort || list[i].surface != ref[i].surface ) {
+			diff++;
+		}
+	}
+
+	ri.Printf( PRINT_ALL, "%i surfaces, %i loops: 8-bit sort %.2f usec, 11-bit sort %.2f usec, %s\n",
+		numDrawSurfs, loops, (double)bytesTime / loops, (double)radixTime / loops,
+		diff ? S_COLOR_RED "results differ" : "results match" );
+
+	ri.Free( list );
+}
+
+
+/*
+===============
+R_SortBench_f
+===============
+*/
+void R_SortBench_f( void )
+{
+	ri.Printf( PRINT_ALL, "sort benchmark will run on the next rendered view\n" );
+	tr.sortBench = qtrue;
+}
+
+
 #ifdef USE_PMLIGHT
 
 typedef struct litSurf_tape_s {
@@ -1431,7 +1643,7 @@ void R_AddLitSurf( surfaceType_t *surface, shader_t *shader, int fogIndex )
 {
 	struct litSurf_s *litsurf;
 
-	if ( tr.refdef.numLitSurfs >= ARRAY_LEN( backEndData->litSurfs ) )
+	if ( tr.refdef.numLitSurfs >= ARRAY_LEN( backEndData[0]->litSurfs ) )
 		return;
 
 	tr.pc.c_lit_surfs++;
@@ -1522,6 +1734,10 @@ static void R_SortDrawSurfs( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 		return;
 	}
 
+	if ( tr.sortBench ) {
+		R_SortBench( drawSurfs, numDrawSurfs );
+	}
+
 	// sort the drawsurfs by sort type, then orientation, then shader
 	R_RadixSort( drawSurfs, numDrawSurfs );
 
@@ -293,7 +293,7 @@ void R_AddMD3Surfaces( trRefEntity_t *ent ) {
 #ifdef USE_PMLIGHT
 	dlight_t		*dl;
 	int				n;
-	dlight_t		*dlights[ ARRAY_LEN( backEndData->dlights ) ];
+	dlight_t		*dlights[ ARRAY_LEN( backEndData[0]->dlights ) ];
 	int				numDlights;
 #endif
 
@@ -950,6 +950,8 @@ static qboolean R_LoadMDR( model_t *mod, void *buffer, int filesize, const char
 */
 void RE_BeginRegistration( glconfig_t *glconfigOut ) {
 
+	R_SyncRenderThread();
+
 	R_Init();
 
 	*glconfigOut = glConfig;
@@ -47,7 +47,7 @@ R_InitNextFrame
 */
 void R_InitNextFrame( void ) {
 
-	backEndData->commands.used = 0;
+	backEndData[tr.smpFrame]->commands.used = 0;
 
 	r_firstSceneDrawSurf = 0;
 #ifdef USE_PMLIGHT
@@ -142,11 +142,11 @@ void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts
 			return;
 		}
 
-		poly = &backEndData->polys[r_numpolys];
+		poly = &backEndData[tr.smpFrame]->polys[r_numpolys];
 		poly->surfaceType = SF_POLY;
 		poly->hShader = hShader;
 		poly->numVerts = numVerts;
-		poly->verts = &backEndData->polyVerts[r_numpolyverts];
+		poly->verts = &backEndData[tr.smpFrame]->polyVerts[r_numpolyverts];
 		
 		Com_Memcpy( poly->verts, &verts[numVerts*j], numVerts * sizeof( *verts ) );
 #if 0
@@ -230,9 +230,9 @@ void RE_AddRefEntityToScene( const refEntity_t *ent, qboolean intShaderTime ) {
 		ri.Error( ERR_DROP, "RE_AddRefEntityToScene: bad reType %i", ent->reType );
 	}
 
-	backEndData->entities[r_numentities].e = *ent;
-	backEndData->entities[r_numentities].lightingCalculated = qfalse;
-	backEndData->entities[r_numentities].intShaderTime = intShaderTime;
+	backEndData[tr.smpFrame]->entities[r_numentities].e = *ent;
+	backEndData[tr.smpFrame]->entities[r_numentities].lightingCalculated = qfalse;
+	backEndData[tr.smpFrame]->entities[r_numentities].intShaderTime = intShaderTime;
 
 	r_numentities++;
 }
@@ -249,7 +249,7 @@ void RE_AddDynamicLightToScene( const vec3_t org, float intensity, float r, floa
 	if ( !tr.registered ) {
 		return;
 	}
-	if ( r_numdlights >= ARRAY_LEN( backEndData->dlights ) ) {
+	if ( r_numdlights >= ARRAY_LEN( backEndData[0]->dlights ) ) {
 		return;
 	}
 	if ( intensity <= 0 ) {
@@ -281,7 +281,7 @@ void RE_AddDynamicLightToScene( const vec3_t org, float intensity, float r, floa
 		b = LERP( luminance, b, r_dlightSaturation->value );
 	}
 
-	dl = &backEndData->dlights[r_numdlights++];
+	dl = &backEndData[tr.smpFrame]->dlights[r_numdlights++];
 	VectorCopy( org, dl->origin );
 	dl->radius = intensity;
 	dl->color[0] = r;
@@ -306,7 +306,7 @@ void RE_AddLinearLightToScene( const vec3_t start, const vec3_t end, float inten
 	if ( !tr.registered ) {
 		return;
 	}
-	if ( r_numdlights >= ARRAY_LEN( backEndData->dlights ) ) {
+	if ( r_numdlights >= ARRAY_LEN( backEndData[0]->dlights ) ) {
 		return;
 	}
 	if ( intensity <= 0 ) {
@@ -332,7 +332,7 @@ void RE_AddLinearLightToScene( const vec3_t start, const vec3_t end, float inten
 		b = LERP( luminance, b, r_mapGreyScale->value );
 	}
 
-	dl = &backEndData->dlights[ r_numdlights++ ];
+	dl = &backEndData[tr.smpFrame]->dlights[ r_numdlights++ ];
 	VectorCopy( start, dl->origin );
 	VectorCopy( end, dl->origin2 );
 	dl->radius = intensity;
@@ -386,6 +386,7 @@ void RE_RenderScene( const refdef_t *fd ) {
 #endif
 	viewParms_t		parms;
 	int				startTime;
+	int64_t			profileStart;
 
 	if ( !tr.registered ) {
 		return;
@@ -396,6 +397,7 @@ void RE_RenderScene( const refdef_t *fd ) {
 	}
 
 	startTime = ri.Milliseconds();
+	profileStart = ri.Com_ProfileStart( PROFILE_FRAME );
 
 	if (!tr.world && !( fd->rdflags & RDF_NOWORLDMODEL ) ) {
 		ri.Error (ERR_DROP, "R_RenderScene: NULL worldmodel");
@@ -444,21 +446,21 @@ void RE_RenderScene( const refdef_t *fd ) {
 	tr.refdef.floatTime = (double)tr.refdef.time * 0.001; // -EC-: cast to double
 
 	tr.refdef.numDrawSurfs = r_firstSceneDrawSurf;
-	tr.refdef.drawSurfs = backEndData->drawSurfs;
+	tr.refdef.drawSurfs = backEndData[tr.smpFrame]->drawSurfs;
 
 #ifdef USE_PMLIGHT
 	tr.refdef.numLitSurfs = r_firstSceneLitSurf;
-	tr.refdef.litSurfs = backEndData->litSurfs;
+	tr.refdef.litSurfs = backEndData[tr.smpFrame]->litSurfs;
 #endif
 
 	tr.refdef.num_entities = r_numentities - r_firstSceneEntity;
-	tr.refdef.entities = &backEndData->entities[r_firstSceneEntity];
+	tr.refdef.entities = &backEndData[tr.smpFrame]->entities[r_firstSceneEntity];
 
 	tr.refdef.num_dlights = r_numdlights - r_firstSceneDlight;
-	tr.refdef.dlights = &backEndData->dlights[r_firstSceneDlight];
+	tr.refdef.dlights = &backEndData[tr.smpFrame]->dlights[r_firstSceneDlight];
 
 	tr.refdef.numPolys = r_numpolys - r_firstScenePoly;
-	tr.refdef.polys = &backEndData->polys[r_firstScenePoly];
+	tr.refdef.polys = &backEndData[tr.smpFrame]->polys[r_firstScenePoly];
 
 	// turn off dynamic lighting globally by clearing all the
 	// dlights if it needs to be disabled
@@ -558,4 +560,8 @@ void RE_RenderScene( const refdef_t *fd ) {
 	r_firstScenePoly = r_numpolys;
 
 	tr.frontEndMsec += ri.Milliseconds() - startTime;
+
+	if ( profileStart ) {
+		ri.Com_ProfileEvent( "RE_RenderScene", -1, profileStart );
+	}
 }
@@ -2343,7 +2343,7 @@ sortedIndex.
 ==============
 */
 static void FixRenderCommandList( int newShader ) {
-	renderCommandList_t	*cmdList = &backEndData->commands;
+	renderCommandList_t	*cmdList = &backEndData[tr.smpFrame]->commands;
 
 	if( cmdList ) {
 		const void *curCmd = cmdList->cmds;
@@ -3308,6 +3308,60 @@ static const char *FindShaderInShaderText( const char *shadername ) {
 }
 
 
+/*
+====================
+R_PrefetchShaderImages
+
+Queues the images of the given map shaders and decodes them on the worker
+threads before the shaders are parsed
+====================
+*/
+void R_PrefetchShaderImages( const dshader_t *shaders, int count ) {
+	char		strippedName[MAX_QPATH];
+	const char	*text, *token;
+	int			i, depth;
+
+	for ( i = 0; i < count; i++ ) {
+		COM_StripExtension( shaders[i].shader, strippedName, sizeof( strippedName ) );
+		text = FindShaderInShaderText( strippedName );
+		if ( !text ) {
+			// R_FindShader() will look for an image with the same name
+			R_AddImagePrefetch( shaders[i].shader );
+			continue;
+		}
+
+		depth = 0;
+		while ( 1 ) {
+			token = COM_ParseExt( &text, qtrue );
+			if ( !token[0] ) {
+				break;
+			}
+			if ( token[0] == '{' ) {
+				depth++;
+			} else if ( token[0] == '}' ) {
+				if ( --depth <= 0 ) {
+					break;
+				}
+			} else if ( depth == 2 ) {
+				if ( !Q_stricmp( token, "map" ) || !Q_stricmp( token, "clampmap" ) || !Q_stricmp( token, "screenMap" ) ) {
+					token = COM_ParseExt( &text, qfalse );
+					if ( token[0] != '$' && token[0] != '*' ) {
+						R_AddImagePrefetch( token );
+					}
+				} else if ( !Q_stricmp( token, "animMap" ) ) {
+					COM_ParseExt( &text, qfalse );
+					while ( ( token = COM_ParseExt( &text, qfalse ) )[0] ) {
+						R_AddImagePrefetch( token );
+					}
+				}
+			}
+		}
+	}
+
+	R_PrefetchImages();
+}
+
+
 /*
 ==================
 R_FindShaderByName
@@ -3464,6 +3518,10 @@ shader_t *R_FindShader( const char *name, int lightmapIndex, qboolean mipRawImag
 		}
 	}
 
+	// make sure the render thread is stopped, because we are probably
+	// going to have to upload an image and resort shaders
+	R_SyncRenderThread();
+
 	InitShader( strippedName, lightmapIndex );
 
 	// FIXME: set these "need" values appropriately
@@ -3553,6 +3611,8 @@ qhandle_t RE_RegisterShaderFromImage(const char *name, int lightmapIndex, image_
 		}
 	}
 
+	R_SyncRenderThread();
+
 	InitShader( name, lightmapIndex );
 
 	// FIXME: set these "need" values appropriately
@@ -3866,6 +3926,190 @@ static int loadShaderBuffers( char **shaderFiles, const int numShaderFiles, char
 }
 
 
+/*
+=====================================================================
+
+SHADER SCRIPT CACHE
+
+Compressed shader text together with the shader name hash table
+is stored in a single file so that next startup with the same set
+of shader scripts doesn't need to read, validate and scan them.
+Cache is keyed by names of the shader scripts and checksums of pk3
+files they come from, it is not used if any script is loaded from
+a directory.
+
+=====================================================================
+*/
+
+#define SHADER_CACHE_FILE		"shadercache.dat"
+#define SHADER_CACHE_IDENT		(('C'<<24)+('D'<<16)+('H'<<8)+'S')
+#define SHADER_CACHE_VERSION	(1 + (MAX_SHADERTEXT_HASH << 8))
+
+typedef struct {
+	int			ident;
+	int			version;
+	uint32_t	key;
+	int			numFiles;
+	int			numShaders;
+	int			textSize;			// including trailing zero
+	int			extensionOffset;
+	// numShaders shaderCacheEntry_t follows, then shader text
+} shaderCacheHeader_t;
+
+typedef struct {
+	int			offset;				// shader name position in text
+	int			hash;
+} shaderCacheEntry_t;
+
+
+/*
+====================
+ShaderCacheKey
+====================
+*/
+static qboolean ShaderCacheKey( char **fileList, int numFiles, uint32_t *key )
+{
+	char filename[MAX_QPATH+8];
+	const char *s;
+	int i, checksum;
+	uint32_t h;
+
+	h = *key;
+	for ( i = 0; i < numFiles; i++ ) {
+		Com_sprintf( filename, sizeof( filename ), "scripts/%s", fileList[i] );
+		if ( !ri.FS_FilePakChecksum( filename, &checksum ) ) {
+			return qfalse;
+		}
+		// FNV-1a
+		for ( s = fileList[i]; *s; s++ ) {
+			h = ( h ^ (byte)*s ) * 16777619U;
+		}
+		h = ( h ^ (uint32_t)checksum ) * 16777619U;
+	}
+	*key = h;
+
+	return qtrue;
+}
+
+
+/*
+====================
+BuildShaderTextHashTable
+====================
+*/
+static void BuildShaderTextHashTable( const shaderCacheEntry_t *entries, int numShaders )
+{
+	int shaderTextHashTableSizes[MAX_SHADERTEXT_HASH];
+	char *hashMem;
+	int i;
+
+	Com_Memset( shaderTextHashTableSizes, 0, sizeof( shaderTextHashTableSizes ) );
+
+	for ( i = 0; i < numShaders; i++ ) {
+		shaderTextHashTableSizes[ entries[i].hash ]++;
+	}
+
+	hashMem = ri.Hunk_Alloc( ( numShaders + MAX_SHADERTEXT_HASH ) * sizeof( char * ), h_low );
+
+	for ( i = 0; i < MAX_SHADERTEXT_HASH; i++ ) {
+		shaderTextHashTable[i] = (char **) hashMem;
+		hashMem = ((char *) hashMem) + ((shaderTextHashTableSizes[i] + 1) * sizeof(char *));
+	}
+
+	for ( i = 0; i < numShaders; i++ ) {
+		shaderTextHashTable[ entries[i].hash ][ --shaderTextHashTableSizes[ entries[i].hash ] ] = s_shaderText + entries[i].offset;
+	}
+}
+
+
+/*
+====================
+LoadShaderCache
+====================
+*/
+static qboolean LoadShaderCache( uint32_t key, int numFiles )
+{
+	const shaderCacheHeader_t *header;
+	const shaderCacheEntry_t *entries;
+	const char *text;
+	void *buffer;
+	int i, len;
+
+	len = ri.FS_ReadFile( SHADER_CACHE_FILE, &buffer );
+	if ( !buffer ) {
+		return qfalse;
+	}
+
+	header = (const shaderCacheHeader_t *) buffer;
+	if ( len < sizeof( *header ) || header->ident != SHADER_CACHE_IDENT || header->version != SHADER_CACHE_VERSION
+		|| header->key != key || header->numFiles != numFiles || header->numShaders < 0 || header->textSize <= 0
+		|| header->extensionOffset < 0 || header->extensionOffset >= header->textSize
+		|| len != sizeof( *header ) + header->numShaders * sizeof( *entries ) + header->textSize ) {
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	entries = (const shaderCacheEntry_t *)( header + 1 );
+	text = (const char *)( entries + header->numShaders );
+
+	if ( text[ header->textSize - 1 ] != '\0' ) {
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	for ( i = 0; i < header->numShaders; i++ ) {
+		if ( (unsigned)entries[i].offset >= header->textSize || (unsigned)entries[i].hash >= MAX_SHADERTEXT_HASH ) {
+			ri.FS_FreeFile( buffer );
+			return qfalse;
+		}
+	}
+
+	s_shaderText = ri.Hunk_Alloc( header->textSize, h_low );
+	Com_Memcpy( s_shaderText, text, header->textSize );
+	s_extensionOffset = s_shaderText + header->extensionOffset;
+
+	BuildShaderTextHashTable( entries, header->numShaders );
+
+	ri.Printf( PRINT_DEVELOPER, "...loaded %i shaders from %s\n", header->numShaders, SHADER_CACHE_FILE );
+
+	ri.FS_FreeFile( buffer );
+
+	return qtrue;
+}
+
+
+/*
+====================
+SaveShaderCache
+====================
+*/
+static void SaveShaderCache( uint32_t key, int numFiles, const shaderCacheEntry_t *entries, int numShaders, int textSize )
+{
+	shaderCacheHeader_t *header;
+	byte *buffer;
+	int len;
+
+	len = sizeof( *header ) + numShaders * sizeof( *entries ) + textSize;
+	buffer = ri.Hunk_AllocateTempMemory( len );
+
+	header = (shaderCacheHeader_t *) buffer;
+	header->ident = SHADER_CACHE_IDENT;
+	header->version = SHADER_CACHE_VERSION;
+	header->key = key;
+	header->numFiles = numFiles;
+	header->numShaders = numShaders;
+	header->textSize = textSize;
+	header->extensionOffset = s_extensionOffset - s_shaderText;
+
+	Com_Memcpy( header + 1, entries, numShaders * sizeof( *entries ) );
+	Com_Memcpy( buffer + sizeof( *header ) + numShaders * sizeof( *entries ), s_shaderText, textSize );
+
+	ri.FS_WriteFile( SHADER_CACHE_FILE, buffer, len );
+
+	ri.Hunk_FreeTempMemory( buffer );
+}
+
+
 /*
 ====================
 ScanAndLoadShaderFiles
@@ -3881,9 +4125,12 @@ static void ScanAndLoadShaderFiles( void )
 	char *xbuffers[MAX_SHADER_FILES];
 	int numShaderFiles, numShaderxFiles;
 	int i;
-	char *token, *hashMem, *textEnd;
+	char *token, *textEnd;
 	const char *p, *oldp;
-	int shaderTextHashTableSizes[MAX_SHADERTEXT_HASH], hash, size;
+	shaderCacheEntry_t *entries;
+	int numShaders;
+	uint32_t cacheKey;
+	qboolean useCache;
 
 	long sum = 0;
 
@@ -3910,6 +4157,19 @@ static void ScanAndLoadShaderFiles( void )
 		numShaderxFiles = MAX_SHADER_FILES;
 	}
 
+	useCache = qfalse;
+	cacheKey = 2166136261U;
+	if ( r_shaderCache->integer ) {
+		useCache = ShaderCacheKey( shaderxFiles, numShaderxFiles, &cacheKey ) && ShaderCacheKey( shaderFiles, numShaderFiles, &cacheKey );
+		if ( useCache && LoadShaderCache( cacheKey, numShaderxFiles + numShaderFiles ) ) {
+			if ( shaderxFiles )
+				ri.FS_FreeFileList( shaderxFiles );
+			if ( shaderFiles )
+				ri.FS_FreeFileList( shaderFiles );
+			return;
+		}
+	}
+
 	sum = 0;
 	sum += loadShaderBuffers( shaderxFiles, numShaderxFiles, xbuffers );
 	sum += loadShaderBuffers( shaderFiles, numShaderFiles, buffers );
@@ -3950,8 +4210,7 @@ static void ScanAndLoadShaderFiles( void )
 		ri.FS_FreeFileList( shaderFiles );
 
 	//COM_Compress( s_shaderText );
-	Com_Memset( shaderTextHashTableSizes, 0, sizeof( shaderTextHashTableSizes ) );
-	size = 0;
+	numShaders = 0;
 
 	p = s_shaderText;
 	// look for shader names
@@ -3960,35 +4219,29 @@ static void ScanAndLoadShaderFiles( void )
 		if ( token[0] == 0 ) {
 			break;
 		}
-		hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
-		shaderTextHashTableSizes[hash]++;
-		size++;
+		numShaders++;
 		SkipBracedSection(&p, 0);
 	}
 
-	size += MAX_SHADERTEXT_HASH;
-
-	hashMem = ri.Hunk_Alloc( size * sizeof(char *), h_low );
-
-	for (i = 0; i < MAX_SHADERTEXT_HASH; i++) {
-		shaderTextHashTable[i] = (char **) hashMem;
-		hashMem = ((char *) hashMem) + ((shaderTextHashTableSizes[i] + 1) * sizeof(char *));
-	}
+	entries = ri.Hunk_AllocateTempMemory( numShaders * sizeof( entries[0] ) + 1 );
 
 	p = s_shaderText;
 	// look for shader names
-	while ( 1 ) {
+	for ( i = 0; i < numShaders; i++ ) {
 		oldp = p;
 		token = COM_ParseExt( &p, qtrue );
-		if ( token[0] == 0 ) {
-			break;
-		}
+		entries[i].offset = oldp - s_shaderText;
+		entries[i].hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
+		SkipBracedSection(&p, 0);
+	}
 
-		hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
-		shaderTextHashTable[hash][--shaderTextHashTableSizes[hash]] = (char*)oldp;
+	BuildShaderTextHashTable( entries, numShaders );
 
-		SkipBracedSection(&p, 0);
+	if ( useCache ) {
+		SaveShaderCache( cacheKey, numShaderxFiles + numShaderFiles, entries, numShaders, textEnd - s_shaderText + 1 );
 	}
+
+	ri.Hunk_FreeTempMemory( entries );
 }
 
 
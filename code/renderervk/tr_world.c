@@ -20,6 +20,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
 #include "tr_local.h"
+#if idx64
+#include <xmmintrin.h>
+#elif arm64
+#include <arm_neon.h>
+#endif
 
 
 
@@ -50,7 +55,7 @@ Returns true if the grid is completely culled away.
 Also sets the clipped hint bit in tess
 =================
 */
-static qboolean	R_CullGrid( srfGridMesh_t *cv ) {
+static qboolean	R_CullGrid( srfGridMesh_t *cv, frontEndCounters_t *pc ) {
 	int 	boxCull;
 	int 	sphereCull;
 
@@ -67,33 +72,33 @@ static qboolean	R_CullGrid( srfGridMesh_t *cv ) {
 	// check for trivial reject
 	if ( sphereCull == CULL_OUT )
 	{
-		tr.pc.c_sphere_cull_patch_out++;
+		pc->c_sphere_cull_patch_out++;
 		return qtrue;
 	}
 	// check bounding box if necessary
 	else if ( sphereCull == CULL_CLIP )
 	{
-		tr.pc.c_sphere_cull_patch_clip++;
+		pc->c_sphere_cull_patch_clip++;
 
 		boxCull = R_CullLocalBox( cv->meshBounds );
 
 		if ( boxCull == CULL_OUT ) 
 		{
-			tr.pc.c_box_cull_patch_out++;
+			pc->c_box_cull_patch_out++;
 			return qtrue;
 		}
 		else if ( boxCull == CULL_IN )
 		{
-			tr.pc.c_box_cull_patch_in++;
+			pc->c_box_cull_patch_in++;
 		}
 		else
 		{
-			tr.pc.c_box_cull_patch_clip++;
+			pc->c_box_cull_patch_clip++;
 		}
 	}
 	else
 	{
-		tr.pc.c_sphere_cull_patch_in++;
+		pc->c_sphere_cull_patch_in++;
 	}
 
 	return qfalse;
@@ -110,7 +115,7 @@ added to the sorting list.
 This will also allow mirrors on both sides of a model without recursion.
 ================
 */
-static qboolean	R_CullSurface( surfaceType_t *surface, shader_t *shader ) {
+static qboolean	R_CullSurface( const surfaceType_t *surface, const shader_t *shader, frontEndCounters_t *pc ) {
 	srfSurfaceFace_t *sface;
 	float			d;
 
@@ -119,7 +124,7 @@ static qboolean	R_CullSurface( surfaceType_t *surface, shader_t *shader ) {
 	}
 
 	if ( *surface == SF_GRID ) {
-		return R_CullGrid( (srfGridMesh_t *)surface );
+		return R_CullGrid( (srfGridMesh_t *)surface, pc );
 	}
 
 	if ( *surface == SF_TRIANGLES ) {
@@ -242,7 +247,7 @@ static qboolean R_LightCullSurface( const surfaceType_t* surface, const dlight_t
 
 
 #ifdef USE_LEGACY_DLIGHTS
-static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits ) {
+static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits, frontEndCounters_t *pc ) {
 	float		d;
 	int			i;
 	dlight_t	*dl;
@@ -260,7 +265,7 @@ static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits ) {
 	}
 
 	if ( !dlightBits ) {
-		tr.pc.c_dlightSurfacesCulled++;
+		pc->c_dlightSurfacesCulled++;
 	}
 
 	face->dlightBits = dlightBits;
@@ -268,7 +273,7 @@ static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits ) {
 }
 
 
-static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits ) {
+static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits, frontEndCounters_t *pc ) {
 	int			i;
 	dlight_t	*dl;
 
@@ -289,7 +294,7 @@ static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits ) {
 	}
 
 	if ( !dlightBits ) {
-		tr.pc.c_dlightSurfacesCulled++;
+		pc->c_dlightSurfacesCulled++;
 	}
 
 	grid->dlightBits = dlightBits;
@@ -340,11 +345,11 @@ that is touched by one or more dlights, so try to throw out
 more dlights if possible.
 ====================
 */
-static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
+static int R_DlightSurface( msurface_t *surf, int dlightBits, frontEndCounters_t *pc ) {
 	if ( *surf->data == SF_FACE ) {
-		dlightBits = R_DlightFace( (srfSurfaceFace_t *)surf->data, dlightBits );
+		dlightBits = R_DlightFace( (srfSurfaceFace_t *)surf->data, dlightBits, pc );
 	} else if ( *surf->data == SF_GRID ) {
-		dlightBits = R_DlightGrid( (srfGridMesh_t *)surf->data, dlightBits );
+		dlightBits = R_DlightGrid( (srfGridMesh_t *)surf->data, dlightBits, pc );
 	} else if ( *surf->data == SF_TRIANGLES ) {
 		dlightBits = R_DlightTrisurf( (srfTriangles_t *)surf->data, dlightBits );
 	} else {
@@ -352,7 +357,7 @@ static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
 	}
 
 	if ( dlightBits ) {
-		tr.pc.c_dlightSurfaces++;
+		pc->c_dlightSurfaces++;
 	}
 
 	return dlightBits;
@@ -362,20 +367,18 @@ static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
 
 /*
 ======================
-R_AddWorldSurface
+R_CullWorldSurface
+
+Returns qfalse if the surface is culled, otherwise updates dlightBits
+to the value that goes into the draw surface sort key.
+Touches only the surface itself, so different surfaces may be
+processed in parallel.
 ======================
 */
-static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
-	if ( surf->viewCount == tr.viewCount ) {
-		return;		// already in this view
-	}
-
-	surf->viewCount = tr.viewCount;
-	// FIXME: bmodel fog?
-
+static qboolean R_CullWorldSurface( msurface_t *surf, int *dlightBits, frontEndCounters_t *pc ) {
 	// try to cull before dlighting or adding
-	if ( R_CullSurface( surf->data, surf->shader ) ) {
-		return;
+	if ( R_CullSurface( surf->data, surf->shader, pc ) ) {
+		return qfalse;
 	}
 
 #ifdef USE_PMLIGHT
@@ -384,20 +387,39 @@ static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
 #endif
 	{
 		surf->vcVisible = tr.viewCount;
-		R_AddDrawSurf( surf->data, surf->shader, surf->fogIndex, 0 );
-		return;
+		*dlightBits = 0;
+		return qtrue;
 	}
 #endif // USE_PMLIGHT
 
 #ifdef USE_LEGACY_DLIGHTS
 	// check for dlighting
-	if ( dlightBits ) {
-		dlightBits = R_DlightSurface( surf, dlightBits );
-		dlightBits = ( dlightBits != 0 );
+	if ( *dlightBits ) {
+		*dlightBits = R_DlightSurface( surf, *dlightBits, pc );
+		*dlightBits = ( *dlightBits != 0 );
 	}
-
-	R_AddDrawSurf( surf->data, surf->shader, surf->fogIndex, dlightBits );
 #endif // USE_LEGACY_DLIGHTS
+
+	return qtrue;
+}
+
+
+/*
+======================
+R_AddWorldSurface
+======================
+*/
+static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
+	if ( surf->viewCount == tr.viewCount ) {
+		return;		// already in this view
+	}
+
+	surf->viewCount = tr.viewCount;
+	// FIXME: bmodel fog?
+
+	if ( R_CullWorldSurface( surf, &dlightBits, &tr.pc ) ) {
+		R_AddDrawSurf( surf->data, surf->shader, surf->fogIndex, dlightBits );
+	}
 }
 
 
@@ -584,6 +606,184 @@ void R_AddBrushModelSurfaces ( trRefEntity_t *ent ) {
 */
 
 
+// frustum planes in SoA layout for R_CullNodeBox
+static struct {
+	float	nx[4];
+	float	ny[4];
+	float	nz[4];
+	float	dist[4];
+} nodeFrustum;
+
+
+/*
+================
+R_SetupNodeFrustum
+================
+*/
+static void R_SetupNodeFrustum( void ) {
+	int i;
+
+	for ( i = 0; i < 4; i++ ) {
+		nodeFrustum.nx[i] = tr.viewParms.frustum[i].normal[0];
+		nodeFrustum.ny[i] = tr.viewParms.frustum[i].normal[1];
+		nodeFrustum.nz[i] = tr.viewParms.frustum[i].normal[2];
+		nodeFrustum.dist[i] = tr.viewParms.frustum[i].dist;
+	}
+}
+
+
+/*
+================
+R_CullNodeBox
+
+Tests node bounds against all four frustum planes at once, same as calling
+BoxOnPlaneSide() for every plane in planeBits. Returns qtrue if the node is
+behind one of them, otherwise clears bits of the planes that the node is
+completely in front of, so descendants skip them.
+================
+*/
+static qboolean R_CullNodeBox( const mnode_t *node, unsigned int *planeBits ) {
+	int back, front;
+#if idx64
+	const __m128 nx = _mm_loadu_ps( nodeFrustum.nx );
+	const __m128 ny = _mm_loadu_ps( nodeFrustum.ny );
+	const __m128 nz = _mm_loadu_ps( nodeFrustum.nz );
+	const __m128 dist = _mm_loadu_ps( nodeFrustum.dist );
+	__m128 x0, x1, y0, y1, z0, z1, dmax, dmin;
+
+	x0 = _mm_mul_ps( nx, _mm_set1_ps( node->mins[0] ) );
+	x1 = _mm_mul_ps( nx, _mm_set1_ps( node->maxs[0] ) );
+	y0 = _mm_mul_ps( ny, _mm_set1_ps( node->mins[1] ) );
+	y1 = _mm_mul_ps( ny, _mm_set1_ps( node->maxs[1] ) );
+	z0 = _mm_mul_ps( nz, _mm_set1_ps( node->mins[2] ) );
+	z1 = _mm_mul_ps( nz, _mm_set1_ps( node->maxs[2] ) );
+
+	// farthest and nearest box corners along each plane normal
+	dmax = _mm_add_ps( _mm_add_ps( _mm_max_ps( x0, x1 ), _mm_max_ps( y0, y1 ) ), _mm_max_ps( z0, z1 ) );
+	dmin = _mm_add_ps( _mm_add_ps( _mm_min_ps( x0, x1 ), _mm_min_ps( y0, y1 ) ), _mm_min_ps( z0, z1 ) );
+
+	back = _mm_movemask_ps( _mm_cmplt_ps( dmax, dist ) );
+	front = _mm_movemask_ps( _mm_cmpge_ps( dmin, dist ) );
+#elif arm64
+	static const uint32_t bits[4] = { 1, 2, 4, 8 };
+	const float32x4_t nx = vld1q_f32( nodeFrustum.nx );
+	const float32x4_t ny = vld1q_f32( nodeFrustum.ny );
+	const float32x4_t nz = vld1q_f32( nodeFrustum.nz );
+	const float32x4_t dist = vld1q_f32( nodeFrustum.dist );
+	const uint32x4_t mask = vld1q_u32( bits );
+	float32x4_t x0, x1, y0, y1, z0, z1, dmax, dmin;
+
+	x0 = vmulq_n_f32( nx, node->mins[0] );
+	x1 = vmulq_n_f32( nx, node->maxs[0] );
+	y0 = vmulq_n_f32( ny, node->mins[1] );
+	y1 = vmulq_n_f32( ny, node->maxs[1] );
+	z0 = vmulq_n_f32( nz, node->mins[2] );
+	z1 = vmulq_n_f32( nz, node->maxs[2] );
+
+	// farthest and nearest box corners along each plane normal
+	dmax = vaddq_f32( vaddq_f32( vmaxq_f32( x0, x1 ), vmaxq_f32( y0, y1 ) ), vmaxq_f32( z0, z1 ) );
+	dmin = vaddq_f32( vaddq_f32( vminq_f32( x0, x1 ), vminq_f32( y0, y1 ) ), vminq_f32( z0, z1 ) );
+
+	back = vaddvq_u32( vandq_u32( vcltq_f32( dmax, dist ), mask ) );
+	front = vaddvq_u32( vandq_u32( vcgeq_f32( dmin, dist ), mask ) );
+#else
+	float x0, x1, y0, y1, z0, z1, dmax, dmin;
+	int i;
+
+	back = front = 0;
+	for ( i = 0; i < 4; i++ ) {
+		x0 = nodeFrustum.nx[i] * node->mins[0];
+		x1 = nodeFrustum.nx[i] * node->maxs[0];
+		y0 = nodeFrustum.ny[i] * node->mins[1];
+		y1 = nodeFrustum.ny[i] * node->maxs[1];
+		z0 = nodeFrustum.nz[i] * node->mins[2];
+		z1 = nodeFrustum.nz[i] * node->maxs[2];
+		dmax = MAX( x0, x1 ) + MAX( y0, y1 ) + MAX( z0, z1 );
+		dmin = MIN( x0, x1 ) + MIN( y0, y1 ) + MIN( z0, z1 );
+		if ( dmax < nodeFrustum.dist[i] )
+			back |= 1 << i;
+		if ( dmin >= nodeFrustum.dist[i] )
+			front |= 1 << i;
+	}
+#endif
+
+	if ( back & *planeBits ) {
+		return qtrue;					// culled
+	}
+
+	*planeBits &= ~front;				// all descendants will also be in front
+	return qfalse;
+}
+
+
+/*
+================
+R_AddLeafBounds
+
+Adds leaf to z buffer bounds
+================
+*/
+static void R_AddLeafBounds( const mnode_t *node, vec3_t bounds[2] ) {
+	if ( node->mins[0] < bounds[0][0] ) {
+		bounds[0][0] = node->mins[0];
+	}
+	if ( node->mins[1] < bounds[0][1] ) {
+		bounds[0][1] = node->mins[1];
+	}
+	if ( node->mins[2] < bounds[0][2] ) {
+		bounds[0][2] = node->mins[2];
+	}
+
+	if ( node->maxs[0] > bounds[1][0] ) {
+		bounds[1][0] = node->maxs[0];
+	}
+	if ( node->maxs[1] > bounds[1][1] ) {
+		bounds[1][1] = node->maxs[1];
+	}
+	if ( node->maxs[2] > bounds[1][2] ) {
+		bounds[1][2] = node->maxs[2];
+	}
+}
+
+
+/*
+================
+R_NodeDlights
+
+Determines which dlights are needed on each side of the node
+================
+*/
+static ID_INLINE void R_NodeDlights( const mnode_t *node, unsigned int dlightBits, unsigned int newDlights[2] ) {
+	newDlights[0] = 0;
+	newDlights[1] = 0;
+#ifdef USE_LEGACY_DLIGHTS
+#ifdef USE_PMLIGHT
+	if ( !r_dlightMode->integer )
+#endif
+	if ( dlightBits ) {
+		int	i;
+
+		for ( i = 0 ; i < tr.refdef.num_dlights ; i++ ) {
+			dlight_t	*dl;
+			float		dist;
+
+			if ( dlightBits & ( 1 << i ) ) {
+				dl = &tr.refdef.dlights[i];
+				dist = DotProduct( dl->origin, node->plane->normal ) - node->plane->dist;
+				
+				if ( dist > -dl->radius ) {
+					newDlights[0] |= ( 1 << i );
+				}
+				if ( dist < dl->radius ) {
+					newDlights[1] |= ( 1 << i );
+				}
+			}
+		}
+	}
+#endif // USE_LEGACY_DLIGHTS
+}
+
+
 /*
 ================
 R_RecursiveWorldNode
@@ -602,49 +802,10 @@ static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigne
 		// if the bounding volume is outside the frustum, nothing
 		// inside can be visible OPTIMIZE: don't do this all the way to leafs?
 
-		if ( !r_nocull->integer ) {
-			int		r;
-
-			if ( planeBits & 1 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[0]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~1;			// all descendants will also be in front
-				}
-			}
-
-			if ( planeBits & 2 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[1]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~2;			// all descendants will also be in front
-				}
-			}
-
-			if ( planeBits & 4 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[2]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~4;			// all descendants will also be in front
-				}
+		if ( !r_nocull->integer && planeBits ) {
+			if ( R_CullNodeBox( node, &planeBits ) ) {
+				return;
 			}
-
-			if ( planeBits & 8 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[3]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~8;			// all descendants will also be in front
-				}
-			}
-
 		}
 
 		if ( node->contents != CONTENTS_NODE ) {
@@ -653,35 +814,7 @@ static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigne
 
 		// node is just a decision point, so go down both sides
 		// since we don't care about sort orders, just go positive to negative
-
-		// determine which dlights are needed
-		newDlights[0] = 0;
-		newDlights[1] = 0;
-#ifdef USE_LEGACY_DLIGHTS
-#ifdef USE_PMLIGHT
-		if ( !r_dlightMode->integer )
-#endif
-		if ( dlightBits ) {
-			int	i;
-
-			for ( i = 0 ; i < tr.refdef.num_dlights ; i++ ) {
-				dlight_t	*dl;
-				float		dist;
-
-				if ( dlightBits & ( 1 << i ) ) {
-					dl = &tr.refdef.dlights[i];
-					dist = DotProduct( dl->origin, node->plane->normal ) - node->plane->dist;
-					
-					if ( dist > -dl->radius ) {
-						newDlights[0] |= ( 1 << i );
-					}
-					if ( dist < dl->radius ) {
-						newDlights[1] |= ( 1 << i );
-					}
-				}
-			}
-		}
-#endif // USE_LEGACY_DLIGHTS
+		R_NodeDlights( node, dlightBits, newDlights );
 
 		// recurse down the children, front side first
 		R_RecursiveWorldNode( node->children[0], planeBits, newDlights[0] );
@@ -701,25 +834,7 @@ static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigne
 		tr.pc.c_leafs++;
 
 		// add to z buffer bounds
-		if ( node->mins[0] < tr.viewParms.visBounds[0][0] ) {
-			tr.viewParms.visBounds[0][0] = node->mins[0];
-		}
-		if ( node->mins[1] < tr.viewParms.visBounds[0][1] ) {
-			tr.viewParms.visBounds[0][1] = node->mins[1];
-		}
-		if ( node->mins[2] < tr.viewParms.visBounds[0][2] ) {
-			tr.viewParms.visBounds[0][2] = node->mins[2];
-		}
-
-		if ( node->maxs[0] > tr.viewParms.visBounds[1][0] ) {
-			tr.viewParms.visBounds[1][0] = node->maxs[0];
-		}
-		if ( node->maxs[1] > tr.viewParms.visBounds[1][1] ) {
-			tr.viewParms.visBounds[1][1] = node->maxs[1];
-		}
-		if ( node->maxs[2] > tr.viewParms.visBounds[1][2] ) {
-			tr.viewParms.visBounds[1][2] = node->maxs[2];
-		}
+		R_AddLeafBounds( node, tr.viewParms.visBounds );
 
 		// add the individual surfaces
 		mark = node->firstmarksurface;
@@ -735,6 +850,276 @@ static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigne
 }
 
 
+/*
+=============================================================
+
+	PARALLEL WORLD TRAVERSAL
+
+The top of the tree is walked on the main thread until there are
+enough subtrees, which are then traversed on worker threads. Each
+subtree collects its visible leafs into its own slice of visLeafs,
+sized by mnode_t->numLeafs. Leafs are merged in the original order,
+surfaces spanning several leafs are removed and the rest is culled
+in parallel again, every job filling its own slice of visDrawSurfs.
+The result is identical to R_RecursiveWorldNode.
+
+=============================================================
+*/
+
+#define MAX_WORLD_JOBS		64
+#define MIN_SURFS_PER_JOB	128
+
+typedef struct {
+	mnode_t		*node;
+	unsigned int planeBits;
+	unsigned int dlightBits;
+	visLeaf_t	*leafs;
+	int			numLeafs;
+	vec3_t		visBounds[2];
+} worldNodeJob_t;
+
+typedef struct {
+	const visSurf_t	*surfs;
+	int			numSurfs;
+	drawSurf_t	*drawSurfs;
+	int			numDrawSurfs;
+	frontEndCounters_t pc;
+} worldSurfJob_t;
+
+static struct {
+	worldNodeJob_t	nodes[ MAX_WORLD_JOBS ];
+	int				numNodes;
+	worldSurfJob_t	surfs[ MAX_WORLD_JOBS ];
+	int				numSurfs;
+	int				numLeafs;		// next free visLeafs slot
+} worldJobs;
+
+
+/*
+================
+R_CollectWorldLeafs
+
+Same traversal as R_RecursiveWorldNode but only records the visible leafs
+================
+*/
+static void R_CollectWorldLeafs( worldNodeJob_t *job, mnode_t *node, unsigned int planeBits, unsigned int dlightBits ) {
+	visLeaf_t *leaf;
+
+	do {
+		unsigned int newDlights[2];
+
+		if ( node->visframe != tr.visCount ) {
+			return;
+		}
+
+		if ( !r_nocull->integer && planeBits ) {
+			if ( R_CullNodeBox( node, &planeBits ) ) {
+				return;
+			}
+		}
+
+		if ( node->contents != CONTENTS_NODE ) {
+			break;
+		}
+
+		R_NodeDlights( node, dlightBits, newDlights );
+
+		R_CollectWorldLeafs( job, node->children[0], planeBits, newDlights[0] );
+
+		node = node->children[1];
+#ifdef USE_LEGACY_DLIGHTS
+		dlightBits = newDlights[1];
+#endif
+	} while ( 1 );
+
+	R_AddLeafBounds( node, job->visBounds );
+
+	leaf = &job->leafs[ job->numLeafs++ ];
+	leaf->leaf = node;
+	leaf->dlightBits = dlightBits;
+}
+
+
+/*
+================
+R_WorldNodeJob
+================
+*/
+static void R_WorldNodeJob( void *arg, int index ) {
+	worldNodeJob_t *job = &worldJobs.nodes[ index ];
+
+	R_CollectWorldLeafs( job, job->node, job->planeBits, job->dlightBits );
+}
+
+
+/*
+================
+R_SplitWorldNode
+
+Walks the top levels of the tree in traversal order
+and queues a job for every subtree at the given depth
+================
+*/
+static void R_SplitWorldNode( mnode_t *node, unsigned int planeBits, unsigned int dlightBits, int depth ) {
+	worldNodeJob_t *job;
+	unsigned int newDlights[2];
+
+	if ( node->visframe != tr.visCount ) {
+		return;
+	}
+
+	if ( !r_nocull->integer && planeBits ) {
+		if ( R_CullNodeBox( node, &planeBits ) ) {
+			return;
+		}
+	}
+
+	if ( node->contents == CONTENTS_NODE && depth > 0 ) {
+		R_NodeDlights( node, dlightBits, newDlights );
+		R_SplitWorldNode( node->children[0], planeBits, newDlights[0], depth - 1 );
+#ifdef USE_LEGACY_DLIGHTS
+		dlightBits = newDlights[1];
+#endif
+		R_SplitWorldNode( node->children[1], planeBits, dlightBits, depth - 1 );
+		return;
+	}
+
+	job = &worldJobs.nodes[ worldJobs.numNodes++ ];
+	job->node = node;
+	job->planeBits = planeBits;
+	job->dlightBits = dlightBits;
+	job->leafs = tr.world->visLeafs + worldJobs.numLeafs;
+	job->numLeafs = 0;
+	ClearBounds( job->visBounds[0], job->visBounds[1] );
+
+	worldJobs.numLeafs += node->numLeafs;
+}
+
+
+/*
+================
+R_WorldSurfJob
+================
+*/
+static void R_WorldSurfJob( void *arg, int index ) {
+	worldSurfJob_t *job = &worldJobs.surfs[ index ];
+	const visSurf_t *vs;
+	drawSurf_t *ds;
+	int i, dlightBits;
+
+	ds = job->drawSurfs;
+	for ( i = 0, vs = job->surfs; i < job->numSurfs; i++, vs++ ) {
+		dlightBits = vs->dlightBits;
+		if ( !R_CullWorldSurface( vs->surf, &dlightBits, &job->pc ) ) {
+			continue;
+		}
+		ds->sort = (vs->surf->shader->sortedIndex << QSORT_SHADERNUM_SHIFT)
+			| tr.shiftedEntityNum | ( vs->surf->fogIndex << QSORT_FOGNUM_SHIFT ) | dlightBits;
+		ds->surface = vs->surf->data;
+		ds++;
+	}
+
+	job->numDrawSurfs = ds - job->drawSurfs;
+}
+
+
+/*
+================
+R_AddCounters
+================
+*/
+static void R_AddCounters( frontEndCounters_t *dst, const frontEndCounters_t *src ) {
+	const int *s = (const int *)src;
+	int *d = (int *)dst;
+	int i;
+
+	// all fields are integers
+	for ( i = 0; i < sizeof( *src ) / sizeof( int ); i++ ) {
+		d[i] += s[i];
+	}
+}
+
+
+/*
+================
+R_ParallelWorldNode
+================
+*/
+static void R_ParallelWorldNode( unsigned int dlightBits ) {
+	worldNodeJob_t *nodeJob;
+	worldSurfJob_t *surfJob;
+	visSurf_t *vs;
+	msurface_t *surf, **mark;
+	drawSurf_t *ds;
+	int i, j, c, depth, numSurfs, numJobs, count;
+
+	// 2-4 subtrees per thread keep workers busy on unbalanced trees
+	for ( depth = 1; depth < 6 && ( 1 << depth ) < ri.Com_NumJobThreads() * 4; depth++ )
+		;
+
+	worldJobs.numNodes = 0;
+	worldJobs.numLeafs = 0;
+	R_SplitWorldNode( tr.world->nodes, 15, dlightBits, depth );
+
+	ri.Com_RunJobs( R_WorldNodeJob, NULL, worldJobs.numNodes );
+
+	// merge leafs in traversal order, dropping surfaces seen in previous leafs
+	numSurfs = 0;
+	vs = tr.world->visSurfs;
+	for ( i = 0, nodeJob = worldJobs.nodes; i < worldJobs.numNodes; i++, nodeJob++ ) {
+		if ( nodeJob->numLeafs == 0 ) {
+			continue;
+		}
+		tr.pc.c_leafs += nodeJob->numLeafs;
+		AddPointToBounds( nodeJob->visBounds[0], tr.viewParms.visBounds[0], tr.viewParms.visBounds[1] );
+		AddPointToBounds( nodeJob->visBounds[1], tr.viewParms.visBounds[0], tr.viewParms.visBounds[1] );
+		for ( j = 0; j < nodeJob->numLeafs; j++ ) {
+			mark = nodeJob->leafs[j].leaf->firstmarksurface;
+			c = nodeJob->leafs[j].leaf->nummarksurfaces;
+			while ( c-- ) {
+				surf = *mark++;
+				if ( surf->viewCount == tr.viewCount ) {
+					continue;
+				}
+				surf->viewCount = tr.viewCount;
+				vs[ numSurfs ].surf = surf;
+				vs[ numSurfs ].dlightBits = nodeJob->leafs[j].dlightBits;
+				numSurfs++;
+			}
+		}
+	}
+
+	if ( numSurfs == 0 ) {
+		return;
+	}
+
+	numJobs = ( numSurfs + MIN_SURFS_PER_JOB - 1 ) / MIN_SURFS_PER_JOB;
+	numJobs = MIN( numJobs, ri.Com_NumJobThreads() * 4 );
+	numJobs = MIN( numJobs, MAX_WORLD_JOBS );
+	count = ( numSurfs + numJobs - 1 ) / numJobs;
+
+	worldJobs.numSurfs = 0;
+	for ( i = 0; i < numSurfs; i += count ) {
+		surfJob = &worldJobs.surfs[ worldJobs.numSurfs++ ];
+		Com_Memset( surfJob, 0, sizeof( *surfJob ) );
+		surfJob->surfs = vs + i;
+		surfJob->numSurfs = MIN( count, numSurfs - i );
+		surfJob->drawSurfs = tr.world->visDrawSurfs + i;
+	}
+
+	ri.Com_RunJobs( R_WorldSurfJob, NULL, worldJobs.numSurfs );
+
+	// append to the view in the original order
+	for ( i = 0, surfJob = worldJobs.surfs; i < worldJobs.numSurfs; i++, surfJob++ ) {
+		R_AddCounters( &tr.pc, &surfJob->pc );
+		for ( j = 0, ds = surfJob->drawSurfs; j < surfJob->numDrawSurfs; j++, ds++ ) {
+			tr.refdef.drawSurfs[ tr.refdef.numDrawSurfs & DRAWSURF_MASK ] = *ds;
+			tr.refdef.numDrawSurfs++;
+		}
+	}
+}
+
+
 /*
 ===============
 R_PointInLeaf
@@ -912,7 +1297,13 @@ void R_AddWorldSurfaces( void ) {
 		tr.refdef.num_dlights = MAX_DLIGHTS;
 	}
 
-	R_RecursiveWorldNode( tr.world->nodes, 15, ( 1ULL << tr.refdef.num_dlights ) - 1 );
+	R_SetupNodeFrustum();
+
+	if ( r_parallelCull->integer && ri.Com_NumJobThreads() > 1 ) {
+		R_ParallelWorldNode( ( 1ULL << tr.refdef.num_dlights ) - 1 );
+	} else {
+		R_RecursiveWorldNode( tr.world->nodes, 15, ( 1ULL << tr.refdef.num_dlights ) - 1 );
+	}
 
 #ifdef USE_PMLIGHT
 #ifdef USE_LEGACY_DLIGHTS
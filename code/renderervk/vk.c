@@ -100,10 +100,12 @@ PFN_vkFlushMappedMemoryRanges					qvkFlushMappedMemoryRanges;
 PFN_vkFreeCommandBuffers						qvkFreeCommandBuffers;
 PFN_vkFreeDescriptorSets						qvkFreeDescriptorSets;
 PFN_vkFreeMemory								qvkFreeMemory;
+PFN_vkGetFenceStatus							qvkGetFenceStatus;
 PFN_vkGetBufferMemoryRequirements				qvkGetBufferMemoryRequirements;
 PFN_vkGetDeviceQueue							qvkGetDeviceQueue;
 PFN_vkGetImageMemoryRequirements				qvkGetImageMemoryRequirements;
 PFN_vkGetImageSubresourceLayout					qvkGetImageSubresourceLayout;
+PFN_vkGetPipelineCacheData						qvkGetPipelineCacheData;
 PFN_vkInvalidateMappedMemoryRanges				qvkInvalidateMappedMemoryRanges;
 PFN_vkMapMemory									qvkMapMemory;
 PFN_vkQueueSubmit								qvkQueueSubmit;
@@ -129,6 +131,9 @@ PFN_vkDebugMarkerSetObjectNameEXT				qvkDebugMarkerSetObjectNameEXT;
 
 // forward declaration
 VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassIndex );
+static void vk_record_readback( VkCommandBuffer command_buffer, vk_readback_t *rb, qboolean inFrame );
+static void vk_mark_readback_ready( const vk_tess_t *tess );
+static void vk_destroy_readback( void );
 
 static uint32_t find_memory_type( VkPhysicalDevice physical_device, uint32_t memory_type_bits, VkMemoryPropertyFlags properties ) {
 	VkPhysicalDeviceMemoryProperties memory_properties;
@@ -1391,7 +1396,7 @@ static qboolean vk_create_device( VkPhysicalDevice physical_device, int device_i
 
 	// create VkDevice
 	{
-		const char *device_extension_list[4];
+		const char *device_extension_list[5];
 		uint32_t device_extension_count;
 		const char *ext, *end;
 		char *str;
@@ -1406,6 +1411,7 @@ static qboolean vk_create_device( VkPhysicalDevice physical_device, int device_i
 		qboolean dedicatedAllocation = qfalse;
 		qboolean memoryRequirements2 = qfalse;
 		qboolean debugMarker = qfalse;
+		qboolean creationFeedback = qfalse;
 		uint32_t i, len, count = 0;
 
 		VK_CHECK( qvkEnumerateDeviceExtensionProperties( physical_device, NULL, &count, NULL ) );
@@ -1426,6 +1432,8 @@ static qboolean vk_create_device( VkPhysicalDevice physical_device, int device_i
 				memoryRequirements2 = qtrue;
 			} else if ( strcmp( ext, VK_EXT_DEBUG_MARKER_EXTENSION_NAME ) == 0 ) {
 				debugMarker = qtrue;
+			} else if ( strcmp( ext, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME ) == 0 ) {
+				creationFeedback = qtrue;
 			}
 			// add this device extension to glConfig
 			if ( i != 0 ) {
@@ -1469,6 +1477,11 @@ static qboolean vk_create_device( VkPhysicalDevice physical_device, int device_i
 			vk.debugMarkers = qtrue;
 		}
 
+		if ( creationFeedback ) {
+			device_extension_list[ device_extension_count++ ] = VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME;
+			vk.creationFeedback = qtrue;
+		}
+
 		qvkGetPhysicalDeviceFeatures( physical_device, &device_features );
 
 		if ( device_features.fillModeNonSolid == VK_FALSE ) {
@@ -1719,10 +1732,12 @@ static void init_vulkan_library( void )
 	INIT_DEVICE_FUNCTION(vkFreeCommandBuffers)
 	INIT_DEVICE_FUNCTION(vkFreeDescriptorSets)
 	INIT_DEVICE_FUNCTION(vkFreeMemory)
+	INIT_DEVICE_FUNCTION(vkGetFenceStatus)
 	INIT_DEVICE_FUNCTION(vkGetBufferMemoryRequirements)
 	INIT_DEVICE_FUNCTION(vkGetDeviceQueue)
 	INIT_DEVICE_FUNCTION(vkGetImageMemoryRequirements)
 	INIT_DEVICE_FUNCTION(vkGetImageSubresourceLayout)
+	INIT_DEVICE_FUNCTION(vkGetPipelineCacheData)
 	INIT_DEVICE_FUNCTION(vkInvalidateMappedMemoryRanges)
 	INIT_DEVICE_FUNCTION(vkMapMemory)
 	INIT_DEVICE_FUNCTION(vkQueueSubmit)
@@ -1842,10 +1857,12 @@ static void deinit_vulkan_library( void )
 	qvkFreeCommandBuffers						= NULL;
 	qvkFreeDescriptorSets						= NULL;
 	qvkFreeMemory								= NULL;
+	qvkGetFenceStatus							= NULL;
 	qvkGetBufferMemoryRequirements				= NULL;
 	qvkGetDeviceQueue							= NULL;
 	qvkGetImageMemoryRequirements				= NULL;
 	qvkGetImageSubresourceLayout				= NULL;
+	qvkGetPipelineCacheData						= NULL;
 	qvkInvalidateMappedMemoryRanges				= NULL;
 	qvkMapMemory								= NULL;
 	qvkQueueSubmit								= NULL;
@@ -1869,14 +1886,22 @@ static void deinit_vulkan_library( void )
 }
 
 
+// FNV-1a hash of all SPIR-V binaries, invalidates pipelinecache.dat
+static uint32_t shader_binary_key;
+
 static VkShaderModule SHADER_MODULE(const uint8_t *bytes, const int count) {
 	VkShaderModuleCreateInfo desc;
 	VkShaderModule module;
+	int i;
 
 	if ( count % 4 != 0 ) {
 		ri.Error( ERR_FATAL, "Vulkan: SPIR-V binary buffer size is not a multiple of 4" );
 	}
 
+	for ( i = 0; i < count; i++ ) {
+		shader_binary_key = ( shader_binary_key ^ bytes[i] ) * 16777619U;
+	}
+
 	desc.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	desc.pNext = NULL;
 	desc.flags = 0;
@@ -2390,6 +2415,8 @@ static void vk_create_shader_modules( void )
 {
 	int i, j, k, l;
 
+	shader_binary_key = 2166136261U;
+
 	vk.modules.vert.gen[0][0][0][0] = SHADER_MODULE( vert_tx0 );
 	vk.modules.vert.gen[0][0][0][1] = SHADER_MODULE( vert_tx0_fog );
 	vk.modules.vert.gen[0][0][1][0] = SHADER_MODULE( vert_tx0_env );
@@ -3447,6 +3474,132 @@ static void vk_set_render_scale( void )
 }
 
 
+/*
+=====================================================================
+
+PIPELINE CACHE
+
+Contents of the Vulkan pipeline cache are kept in pipelinecache.dat
+so that pipelines compiled during previous sessions are reused.
+Stored data is keyed by the physical device, driver version and
+SPIR-V binaries of the renderer shaders, outdated files are ignored.
+
+=====================================================================
+*/
+
+#define PIPELINE_CACHE_FILE		"pipelinecache.dat"
+#define PIPELINE_CACHE_IDENT	(('C'<<24)+('P'<<16)+('K'<<8)+'V')
+#define PIPELINE_CACHE_VERSION	1
+
+typedef struct {
+	int			ident;
+	int			version;
+	uint32_t	vendorID;
+	uint32_t	deviceID;
+	uint32_t	driverVersion;
+	uint8_t		pipelineCacheUUID[VK_UUID_SIZE];
+	uint32_t	shaderKey;
+	uint32_t	dataSize;
+	// dataSize bytes of vkGetPipelineCacheData() output follows
+} pipelineCacheHeader_t;
+
+static pipelineCacheHeader_t pipelineCacheKey;
+
+
+static void vk_create_pipeline_cache( const VkPhysicalDeviceProperties *props )
+{
+	const pipelineCacheHeader_t *header;
+	VkPipelineCacheCreateInfo ci;
+	void *buffer;
+	int len;
+
+	Com_Memset( &pipelineCacheKey, 0, sizeof( pipelineCacheKey ) );
+	pipelineCacheKey.ident = PIPELINE_CACHE_IDENT;
+	pipelineCacheKey.version = PIPELINE_CACHE_VERSION;
+	pipelineCacheKey.vendorID = props->vendorID;
+	pipelineCacheKey.deviceID = props->deviceID;
+	pipelineCacheKey.driverVersion = props->driverVersion;
+	Com_Memcpy( pipelineCacheKey.pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE );
+	pipelineCacheKey.shaderKey = shader_binary_key;
+
+	Com_Memset( &ci, 0, sizeof( ci ) );
+	ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	vk.pipeline_cache_size = 0;
+	vk.pipeline_cache_dirty = qfalse;
+
+	buffer = NULL;
+	if ( r_pipelineCache->integer ) {
+		len = ri.FS_ReadFile( PIPELINE_CACHE_FILE, &buffer );
+		header = (const pipelineCacheHeader_t *) buffer;
+		if ( buffer && len > sizeof( *header ) && memcmp( header, &pipelineCacheKey, offsetof( pipelineCacheHeader_t, dataSize ) ) == 0
+			&& header->dataSize == len - sizeof( *header ) ) {
+			ci.initialDataSize = header->dataSize;
+			ci.pInitialData = header + 1;
+		} else if ( buffer ) {
+			ri.Printf( PRINT_DEVELOPER, "...ignoring outdated %s\n", PIPELINE_CACHE_FILE );
+		}
+	}
+
+	if ( ci.initialDataSize && qvkCreatePipelineCache( vk.device, &ci, NULL, &vk.pipelineCache ) == VK_SUCCESS ) {
+		vk.pipeline_cache_size = (uint32_t)ci.initialDataSize;
+		ri.Printf( PRINT_DEVELOPER, "...loaded %i bytes from %s\n", vk.pipeline_cache_size, PIPELINE_CACHE_FILE );
+	} else {
+		// start from scratch
+		ci.initialDataSize = 0;
+		ci.pInitialData = NULL;
+		VK_CHECK( qvkCreatePipelineCache( vk.device, &ci, NULL, &vk.pipelineCache ) );
+	}
+
+	if ( buffer ) {
+		ri.FS_FreeFile( buffer );
+	}
+}
+
+
+static void vk_save_pipeline_cache( void )
+{
+	pipelineCacheHeader_t *header;
+	size_t size;
+
+	if ( !vk.pipeline_cache_dirty || !r_pipelineCache->integer )
+		return;
+
+	vk.pipeline_cache_dirty = qfalse;
+
+	if ( qvkGetPipelineCacheData( vk.device, vk.pipelineCache, &size, NULL ) != VK_SUCCESS || size == 0 )
+		return;
+
+	header = ri.Malloc( sizeof( *header ) + size );
+	*header = pipelineCacheKey;
+
+	if ( qvkGetPipelineCacheData( vk.device, vk.pipelineCache, &size, header + 1 ) == VK_SUCCESS ) {
+		header->dataSize = (uint32_t)size;
+		ri.FS_WriteFile( PIPELINE_CACHE_FILE, header, sizeof( *header ) + size );
+	}
+
+	ri.Free( header );
+}
+
+
+/*
+Pipelines requested during map loading are collected there and
+compiled at once by vk_finish_pipeline_batch() using worker threads
+*/
+static struct {
+	qboolean	active;
+	uint32_t	count;
+	uint32_t	index[ MAX_VK_PIPELINES ];
+	byte		queued[ MAX_VK_PIPELINES ];
+} pipelineBatch;
+
+
+static void vk_clear_pipeline_batch( void )
+{
+	Com_Memset( &pipelineBatch, 0, sizeof( pipelineBatch ) );
+}
+
+
 void vk_initialize( void )
 {
 	char buf[64], driver_version[64];
@@ -3758,12 +3911,7 @@ void vk_initialize( void )
 
 	vk_create_shader_modules();
 
-	{
-		VkPipelineCacheCreateInfo ci;
-		Com_Memset( &ci, 0, sizeof( ci ) );
-		ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-		VK_CHECK( qvkCreatePipelineCache( vk.device, &ci, NULL, &vk.pipelineCache ) );
-	}
+	vk_create_pipeline_cache( &props );
 
 	vk.renderPassIndex = RENDER_PASS_MAIN; // default render pass
 
@@ -3972,7 +4120,12 @@ void vk_shutdown( void )
 
 	vk_destroy_swapchain();
 
+	vk_clear_pipeline_batch();
+
+	vk_destroy_readback();
+
 	if ( vk.pipelineCache != VK_NULL_HANDLE ) {
+		vk_save_pipeline_cache();
 		qvkDestroyPipelineCache( vk.device, vk.pipelineCache, NULL );
 		vk.pipelineCache = VK_NULL_HANDLE;
 	}
@@ -4080,6 +4233,7 @@ __cleanup:
 void vk_wait_idle( void )
 {
 	VK_CHECK( qvkDeviceWaitIdle( vk.device ) );
+	vk_mark_readback_ready( NULL );
 }
 
 
@@ -4112,6 +4266,8 @@ void vk_release_resources( void ) {
 	}
 	vk.pipelines_count = vk.pipelines_world_base;
 
+	vk_clear_pipeline_batch();
+
 	VK_CHECK( qvkResetDescriptorPool( vk.device, vk.descriptor_pool, 0 ) );
 
 	if ( vk_world.num_image_chunks > 1 ) {
@@ -4784,32 +4940,11 @@ void vk_create_blur_pipeline( uint32_t index, uint32_t width, uint32_t height, q
 }
 
 
-static VkVertexInputBindingDescription bindings[8];
-static VkVertexInputAttributeDescription attribs[8];
-static uint32_t num_binds;
-static uint32_t num_attrs;
-
-static void push_bind( uint32_t binding, uint32_t stride )
-{
-	bindings[ num_binds ].binding = binding;
-	bindings[ num_binds ].stride = stride;
-	bindings[ num_binds ].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	num_binds++;
-}
-
-static void push_attr( uint32_t location, uint32_t binding, VkFormat format )
-{
-	attribs[ num_attrs ].location = location;
-	attribs[ num_attrs ].binding = binding;
-	attribs[ num_attrs ].format = format;
-	attribs[ num_attrs ].offset = 0;
-	num_attrs++;
-}
-
-
-VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassIndex ) {
-	VkShaderModule *vs_module = NULL;
-	VkShaderModule *fs_module = NULL;
+typedef struct {
+	VkVertexInputBindingDescription bindings[8];
+	VkVertexInputAttributeDescription attribs[8];
+	uint32_t num_binds;
+	uint32_t num_attrs;
 	int32_t vert_spec_data[1]; // clippping
 	floatint_t frag_spec_data[9]; // 0:alpha-test-func, 1:alpha-test-value, 2:depth-fragment, 3:alpha-to-coverage, 4:color_mode, 5:abs_light, 6:multitexture mode, 7:discard mode, 8:identity color
 	VkSpecializationMapEntry spec_entries[10];
@@ -4824,10 +4959,47 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 	VkPipelineColorBlendStateCreateInfo blend_state;
 	VkPipelineColorBlendAttachmentState attachment_blend_state;
 	VkPipelineDynamicStateCreateInfo dynamic_state;
-	VkDynamicState dynamic_state_array[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkDynamicState dynamic_state_array[2];
+	VkPipelineShaderStageCreateInfo shader_stages[2];
+	VkPipelineCreationFeedbackEXT feedback;
+	VkPipelineCreationFeedbackEXT stage_feedback[2];
+	VkPipelineCreationFeedbackCreateInfoEXT feedback_info;
 	VkGraphicsPipelineCreateInfo create_info;
+	// compilation result
 	VkPipeline pipeline;
-	VkPipelineShaderStageCreateInfo shader_stages[2];
+	VkResult result;
+} pipelineState_t;
+
+
+static void push_bind( pipelineState_t *s, uint32_t binding, uint32_t stride )
+{
+	s->bindings[ s->num_binds ].binding = binding;
+	s->bindings[ s->num_binds ].stride = stride;
+	s->bindings[ s->num_binds ].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	s->num_binds++;
+}
+
+static void push_attr( pipelineState_t *s, uint32_t location, uint32_t binding, VkFormat format )
+{
+	s->attribs[ s->num_attrs ].location = location;
+	s->attribs[ s->num_attrs ].binding = binding;
+	s->attribs[ s->num_attrs ].format = format;
+	s->attribs[ s->num_attrs ].offset = 0;
+	s->num_attrs++;
+}
+
+
+/*
+================
+vk_build_pipeline_state
+
+Fills complete pipeline description, create_info references only
+data within the state so it can be compiled later on any thread
+================
+*/
+static void vk_build_pipeline_state( const Vk_Pipeline_Def *def, renderPass_t renderPassIndex, pipelineState_t *s ) {
+	VkShaderModule *vs_module = NULL;
+	VkShaderModule *fs_module = NULL;
 	VkBool32 alphaToCoverage = VK_FALSE;
 	unsigned int atest_bits;
 	unsigned int state_bits = def->state_bits;
@@ -4956,7 +5128,7 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 
 		default:
 			ri.Error(ERR_DROP, "create_pipeline: unknown shader type %i\n", def->shader_type);
-			return 0;
+			return;
 	}
 
 	if ( def->fog_stage ) {
@@ -4977,11 +5149,11 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		}
 	}
 
-	set_shader_stage_desc(shader_stages+0, VK_SHADER_STAGE_VERTEX_BIT, *vs_module, "main");
-	set_shader_stage_desc(shader_stages+1, VK_SHADER_STAGE_FRAGMENT_BIT, *fs_module, "main");
+	set_shader_stage_desc(s->shader_stages+0, VK_SHADER_STAGE_VERTEX_BIT, *vs_module, "main");
+	set_shader_stage_desc(s->shader_stages+1, VK_SHADER_STAGE_FRAGMENT_BIT, *fs_module, "main");
 
-	Com_Memset( vert_spec_data, 0, sizeof( vert_spec_data ) );
-	Com_Memset( frag_spec_data, 0, sizeof( frag_spec_data ) );
+	Com_Memset( s->vert_spec_data, 0, sizeof( s->vert_spec_data ) );
+	Com_Memset( s->frag_spec_data, 0, sizeof( s->frag_spec_data ) );
 
 	//vert_spec_data[0] = def->clipping_plane ? 1 : 0;
 
@@ -4989,43 +5161,43 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 	atest_bits = state_bits & GLS_ATEST_BITS;
 	switch ( atest_bits ) {
 		case GLS_ATEST_GT_0:
-			frag_spec_data[0].i = 1; // not equal
-			frag_spec_data[1].f = 0.0f;
+			s->frag_spec_data[0].i = 1; // not equal
+			s->frag_spec_data[1].f = 0.0f;
 			break;
 		case GLS_ATEST_LT_80:
-			frag_spec_data[0].i = 2; // less than
-			frag_spec_data[1].f = 0.5f;
+			s->frag_spec_data[0].i = 2; // less than
+			s->frag_spec_data[1].f = 0.5f;
 			break;
 		case GLS_ATEST_GE_80:
-			frag_spec_data[0].i = 3; // greater or equal
-			frag_spec_data[1].f = 0.5f;
+			s->frag_spec_data[0].i = 3; // greater or equal
+			s->frag_spec_data[1].f = 0.5f;
 			break;
 		default:
-			frag_spec_data[0].i = 0;
-			frag_spec_data[1].f = 0.0f;
+			s->frag_spec_data[0].i = 0;
+			s->frag_spec_data[1].f = 0.0f;
 			break;
 	};
 
 	// depth fragment threshold
-	frag_spec_data[2].f = 0.85f;
+	s->frag_spec_data[2].f = 0.85f;
 
-	if ( r_ext_alpha_to_coverage->integer && vkSamples != VK_SAMPLE_COUNT_1_BIT && frag_spec_data[0].i ) {
-		frag_spec_data[3].i = 1;
+	if ( r_ext_alpha_to_coverage->integer && vkSamples != VK_SAMPLE_COUNT_1_BIT && s->frag_spec_data[0].i ) {
+		s->frag_spec_data[3].i = 1;
 		alphaToCoverage = VK_TRUE;
 	}
 
 	// constant color
 	switch ( def->shader_type ) {
-		default: frag_spec_data[4].i = 0; break;
-		case TYPE_COLOR_GREEN: frag_spec_data[4].i = 1; break;
-		case TYPE_COLOR_RED:   frag_spec_data[4].i = 2; break;
+		default: s->frag_spec_data[4].i = 0; break;
+		case TYPE_COLOR_GREEN: s->frag_spec_data[4].i = 1; break;
+		case TYPE_COLOR_RED:   s->frag_spec_data[4].i = 2; break;
 	}
 
 	// abs lighting
 	switch ( def->shader_type ) {
 		case TYPE_SIGNLE_TEXTURE_LIGHTING:
 		case TYPE_SIGNLE_TEXTURE_LIGHTING_LINEAR:
-			frag_spec_data[5].i = def->abs_light ? 1 : 0;
+			s->frag_spec_data[5].i = def->abs_light ? 1 : 0;
 		default:
 			break;
 	}
@@ -5040,14 +5212,14 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		case TYPE_BLEND2_MUL_ENV:
 		case TYPE_BLEND3_MUL:
 		case TYPE_BLEND3_MUL_ENV:
-			frag_spec_data[6].i = 0;
+			s->frag_spec_data[6].i = 0;
 			break;
 
 		case TYPE_MULTI_TEXTURE_ADD2_IDENTITY:
 		case TYPE_MULTI_TEXTURE_ADD2_IDENTITY_ENV:
 		case TYPE_MULTI_TEXTURE_ADD3_IDENTITY:
 		case TYPE_MULTI_TEXTURE_ADD3_IDENTITY_ENV:
-			frag_spec_data[6].i = 1;
+			s->frag_spec_data[6].i = 1;
 			break;
 
 		case TYPE_MULTI_TEXTURE_ADD2:
@@ -5058,225 +5230,225 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		case TYPE_BLEND2_ADD_ENV:
 		case TYPE_BLEND3_ADD:
 		case TYPE_BLEND3_ADD_ENV:
-			frag_spec_data[6].i = 2;
+			s->frag_spec_data[6].i = 2;
 			break;
 
 		case TYPE_BLEND2_ALPHA:
 		case TYPE_BLEND2_ALPHA_ENV:
 		case TYPE_BLEND3_ALPHA:
 		case TYPE_BLEND3_ALPHA_ENV:
-			frag_spec_data[6].i = 3;
+			s->frag_spec_data[6].i = 3;
 			break;
 
 		case TYPE_BLEND2_ONE_MINUS_ALPHA:
 		case TYPE_BLEND2_ONE_MINUS_ALPHA_ENV:
 		case TYPE_BLEND3_ONE_MINUS_ALPHA:
 		case TYPE_BLEND3_ONE_MINUS_ALPHA_ENV:
-			frag_spec_data[6].i = 4;
+			s->frag_spec_data[6].i = 4;
 			break;
 
 		case TYPE_BLEND2_MIX_ALPHA:
 		case TYPE_BLEND2_MIX_ALPHA_ENV:
 		case TYPE_BLEND3_MIX_ALPHA:
 		case TYPE_BLEND3_MIX_ALPHA_ENV:
-			frag_spec_data[6].i = 5;
+			s->frag_spec_data[6].i = 5;
 			break;
 
 		case TYPE_BLEND2_MIX_ONE_MINUS_ALPHA:
 		case TYPE_BLEND2_MIX_ONE_MINUS_ALPHA_ENV:
 		case TYPE_BLEND3_MIX_ONE_MINUS_ALPHA:
 		case TYPE_BLEND3_MIX_ONE_MINUS_ALPHA_ENV:
-			frag_spec_data[6].i = 6;
+			s->frag_spec_data[6].i = 6;
 			break;
 
 		case TYPE_BLEND2_DST_COLOR_SRC_ALPHA:
 		case TYPE_BLEND2_DST_COLOR_SRC_ALPHA_ENV:
 		case TYPE_BLEND3_DST_COLOR_SRC_ALPHA:
 		case TYPE_BLEND3_DST_COLOR_SRC_ALPHA_ENV:
-			frag_spec_data[6].i = 7;
+			s->frag_spec_data[6].i = 7;
 			break;
 
 		default:
 			break;
 	}
 
-	frag_spec_data[8].f = tr.identityLight;
+	s->frag_spec_data[8].f = tr.identityLight;
 
 	//
 	// vertex module specialization data
 	//
 
-	spec_entries[0].constantID = 0; // clip_plane
-	spec_entries[0].offset = 0 * sizeof( int32_t );
-	spec_entries[0].size = sizeof( int32_t );
+	s->spec_entries[0].constantID = 0; // clip_plane
+	s->spec_entries[0].offset = 0 * sizeof( int32_t );
+	s->spec_entries[0].size = sizeof( int32_t );
 
-	vert_spec_info.mapEntryCount = 1;
-	vert_spec_info.pMapEntries = spec_entries + 0;
-	vert_spec_info.dataSize = 1 * sizeof( int32_t );
-	vert_spec_info.pData = &vert_spec_data[0];
-	shader_stages[0].pSpecializationInfo = &vert_spec_info;
+	s->vert_spec_info.mapEntryCount = 1;
+	s->vert_spec_info.pMapEntries = s->spec_entries + 0;
+	s->vert_spec_info.dataSize = 1 * sizeof( int32_t );
+	s->vert_spec_info.pData = &s->vert_spec_data[0];
+	s->shader_stages[0].pSpecializationInfo = &s->vert_spec_info;
 
 	//
 	// fragment module specialization data
 	//
 
-	spec_entries[1].constantID = 0;  // alpha-test-function
-	spec_entries[1].offset = 0 * sizeof( int32_t );
-	spec_entries[1].size = sizeof( int32_t );
+	s->spec_entries[1].constantID = 0;  // alpha-test-function
+	s->spec_entries[1].offset = 0 * sizeof( int32_t );
+	s->spec_entries[1].size = sizeof( int32_t );
 
-	spec_entries[2].constantID = 1; // alpha-test-value
-	spec_entries[2].offset = 1 * sizeof( int32_t );
-	spec_entries[2].size = sizeof( float );
+	s->spec_entries[2].constantID = 1; // alpha-test-value
+	s->spec_entries[2].offset = 1 * sizeof( int32_t );
+	s->spec_entries[2].size = sizeof( float );
 
-	spec_entries[3].constantID = 2; // depth-fragment
-	spec_entries[3].offset = 2 * sizeof( int32_t );
-	spec_entries[3].size = sizeof( float );
+	s->spec_entries[3].constantID = 2; // depth-fragment
+	s->spec_entries[3].offset = 2 * sizeof( int32_t );
+	s->spec_entries[3].size = sizeof( float );
 
-	spec_entries[4].constantID = 3; // alpha-to-coverage
-	spec_entries[4].offset = 3 * sizeof( int32_t );
-	spec_entries[4].size = sizeof( int32_t );
+	s->spec_entries[4].constantID = 3; // alpha-to-coverage
+	s->spec_entries[4].offset = 3 * sizeof( int32_t );
+	s->spec_entries[4].size = sizeof( int32_t );
 
-	spec_entries[5].constantID = 4; // color_mode
-	spec_entries[5].offset = 4 * sizeof( int32_t );
-	spec_entries[5].size = sizeof( int32_t );
+	s->spec_entries[5].constantID = 4; // color_mode
+	s->spec_entries[5].offset = 4 * sizeof( int32_t );
+	s->spec_entries[5].size = sizeof( int32_t );
 
-	spec_entries[6].constantID = 5; // abs_light
-	spec_entries[6].offset = 5 * sizeof( int32_t );
-	spec_entries[6].size = sizeof( int32_t );
+	s->spec_entries[6].constantID = 5; // abs_light
+	s->spec_entries[6].offset = 5 * sizeof( int32_t );
+	s->spec_entries[6].size = sizeof( int32_t );
 
-	spec_entries[7].constantID = 6; // multitexture mode
-	spec_entries[7].offset = 6 * sizeof( int32_t );
-	spec_entries[7].size = sizeof( int32_t );
+	s->spec_entries[7].constantID = 6; // multitexture mode
+	s->spec_entries[7].offset = 6 * sizeof( int32_t );
+	s->spec_entries[7].size = sizeof( int32_t );
 
-	spec_entries[8].constantID = 7; // discard mode
-	spec_entries[8].offset = 7 * sizeof( int32_t );
-	spec_entries[8].size = sizeof( int32_t );
+	s->spec_entries[8].constantID = 7; // discard mode
+	s->spec_entries[8].offset = 7 * sizeof( int32_t );
+	s->spec_entries[8].size = sizeof( int32_t );
 
-	spec_entries[9].constantID = 8; // identity color
-	spec_entries[9].offset = 8 * sizeof( int32_t );
-	spec_entries[9].size = sizeof( float );
+	s->spec_entries[9].constantID = 8; // identity color
+	s->spec_entries[9].offset = 8 * sizeof( int32_t );
+	s->spec_entries[9].size = sizeof( float );
 
-	frag_spec_info.mapEntryCount = 9;
-	frag_spec_info.pMapEntries = spec_entries + 1;
-	frag_spec_info.dataSize = sizeof( int32_t ) * 9;
-	frag_spec_info.pData = &frag_spec_data[0];
-	shader_stages[1].pSpecializationInfo = &frag_spec_info;
+	s->frag_spec_info.mapEntryCount = 9;
+	s->frag_spec_info.pMapEntries = s->spec_entries + 1;
+	s->frag_spec_info.dataSize = sizeof( int32_t ) * 9;
+	s->frag_spec_info.pData = &s->frag_spec_data[0];
+	s->shader_stages[1].pSpecializationInfo = &s->frag_spec_info;
 
 	//
 	// Vertex input
 	//
-	num_binds = num_attrs = 0;
+	s->num_binds = s->num_attrs = 0;
 	switch ( def->shader_type ) {
 
 		case TYPE_FOG_ONLY:
 		case TYPE_DOT:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
 			break;
 
 		case TYPE_COLOR_WHITE:
 		case TYPE_COLOR_GREEN:
 		case TYPE_COLOR_RED:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
 			break;
 
 		case TYPE_SIGNLE_TEXTURE_IDENTITY:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
 			break;
 
 		case TYPE_SIGNLE_TEXTURE:
 		case TYPE_SIGNLE_TEXTURE_DF:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color array
-			push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color array
+			push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
 			break;
 
 		case TYPE_SIGNLE_TEXTURE_ENV:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color array
-			//push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 5, sizeof( vec4_t ) );					// normals
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			//push_attr( 2, 2, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color array
+			//push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 5, sizeof( vec4_t ) );					// normals
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			//push_attr( s, 2, 2, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
 			break;
 
 		case TYPE_SIGNLE_TEXTURE_LIGHTING:
 		case TYPE_SIGNLE_TEXTURE_LIGHTING_LINEAR:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( vec2_t ) );					// st0 array
-			push_bind( 2, sizeof( vec4_t ) );					// normals array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 2, 2, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 2, sizeof( vec4_t ) );					// normals array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 2, 2, VK_FORMAT_R32G32B32A32_SFLOAT );
 			break;
 
 		case TYPE_MULTI_TEXTURE_MUL2:
 		case TYPE_MULTI_TEXTURE_ADD2_IDENTITY:
 		case TYPE_MULTI_TEXTURE_ADD2:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color array
-			push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color array
+			push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
 			break;
 
 		case TYPE_MULTI_TEXTURE_MUL2_ENV:
 		case TYPE_MULTI_TEXTURE_ADD2_IDENTITY_ENV:
 		case TYPE_MULTI_TEXTURE_ADD2_ENV:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color array
-			//push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_bind( 5, sizeof( vec4_t ) );					// normals
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			//push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color array
+			//push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_bind( s, 5, sizeof( vec4_t ) );					// normals
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			//push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
 			break;
 
 		case TYPE_MULTI_TEXTURE_MUL3:
 		case TYPE_MULTI_TEXTURE_ADD3_IDENTITY:
 		case TYPE_MULTI_TEXTURE_ADD3:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color array
-			push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_bind( 4, sizeof( vec2_t ) );					// st2 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 4, 4, VK_FORMAT_R32G32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color array
+			push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_bind( s, 4, sizeof( vec2_t ) );					// st2 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 4, 4, VK_FORMAT_R32G32_SFLOAT );
 			break;
 
 		case TYPE_MULTI_TEXTURE_MUL3_ENV:
 		case TYPE_MULTI_TEXTURE_ADD3_IDENTITY_ENV:
 		case TYPE_MULTI_TEXTURE_ADD3_ENV:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color array
-			//push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_bind( 4, sizeof( vec2_t ) );					// st2 array
-			push_bind( 5, sizeof( vec4_t ) );					// normals
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			//push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 4, 4, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color array
+			//push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_bind( s, 4, sizeof( vec2_t ) );					// st2 array
+			push_bind( s, 5, sizeof( vec4_t ) );					// normals
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			//push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 4, 4, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
 			break;
 
 		case TYPE_BLEND2_ADD:
@@ -5286,16 +5458,16 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		case TYPE_BLEND2_MIX_ALPHA:
 		case TYPE_BLEND2_MIX_ONE_MINUS_ALPHA:
 		case TYPE_BLEND2_DST_COLOR_SRC_ALPHA:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color0 array
-			push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_bind( 6, sizeof( color4ub_t ) );				// color1 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color0 array
+			push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_bind( s, 6, sizeof( color4ub_t ) );				// color1 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
 			break;
 
 		case TYPE_BLEND2_ADD_ENV:
@@ -5305,18 +5477,18 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		case TYPE_BLEND2_MIX_ALPHA_ENV:
 		case TYPE_BLEND2_MIX_ONE_MINUS_ALPHA_ENV:
 		case TYPE_BLEND2_DST_COLOR_SRC_ALPHA_ENV:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color0 array
-			//push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_bind( 5, sizeof( vec4_t ) );					// normals
-			push_bind( 6, sizeof( color4ub_t ) );				// color1 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			//push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color0 array
+			//push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_bind( s, 5, sizeof( vec4_t ) );					// normals
+			push_bind( s, 6, sizeof( color4ub_t ) );				// color1 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			//push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
 			break;
 
 		case TYPE_BLEND3_ADD:
@@ -5326,20 +5498,20 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		case TYPE_BLEND3_MIX_ALPHA:
 		case TYPE_BLEND3_MIX_ONE_MINUS_ALPHA:
 		case TYPE_BLEND3_DST_COLOR_SRC_ALPHA:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color0 array
-			push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_bind( 4, sizeof( vec2_t ) );					// st2 array
-			push_bind( 6, sizeof( color4ub_t ) );				// color1 array
-			push_bind( 7, sizeof( color4ub_t ) );				// color2 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 4, 4, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 7, 7, VK_FORMAT_R8G8B8A8_UNORM );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color0 array
+			push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_bind( s, 4, sizeof( vec2_t ) );					// st2 array
+			push_bind( s, 6, sizeof( color4ub_t ) );				// color1 array
+			push_bind( s, 7, sizeof( color4ub_t ) );				// color2 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 4, 4, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 7, 7, VK_FORMAT_R8G8B8A8_UNORM );
 			break;
 
 		case TYPE_BLEND3_ADD_ENV:
@@ -5349,22 +5521,22 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		case TYPE_BLEND3_MIX_ALPHA_ENV:
 		case TYPE_BLEND3_MIX_ONE_MINUS_ALPHA_ENV:
 		case TYPE_BLEND3_DST_COLOR_SRC_ALPHA_ENV:
-			push_bind( 0, sizeof( vec4_t ) );					// xyz array
-			push_bind( 1, sizeof( color4ub_t ) );				// color0 array
-			//push_bind( 2, sizeof( vec2_t ) );					// st0 array
-			push_bind( 3, sizeof( vec2_t ) );					// st1 array
-			push_bind( 4, sizeof( vec2_t ) );					// st2 array
-			push_bind( 5, sizeof( vec4_t ) );					// normals
-			push_bind( 6, sizeof( color4ub_t ) );				// color1 array
-			push_bind( 7, sizeof( color4ub_t ) );				// color2 array
-			push_attr( 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
-			//push_attr( 2, 2, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 3, 3, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 4, 4, VK_FORMAT_R32G32_SFLOAT );
-			push_attr( 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
-			push_attr( 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
-			push_attr( 7, 7, VK_FORMAT_R8G8B8A8_UNORM );
+			push_bind( s, 0, sizeof( vec4_t ) );					// xyz array
+			push_bind( s, 1, sizeof( color4ub_t ) );				// color0 array
+			//push_bind( s, 2, sizeof( vec2_t ) );					// st0 array
+			push_bind( s, 3, sizeof( vec2_t ) );					// st1 array
+			push_bind( s, 4, sizeof( vec2_t ) );					// st2 array
+			push_bind( s, 5, sizeof( vec4_t ) );					// normals
+			push_bind( s, 6, sizeof( color4ub_t ) );				// color1 array
+			push_bind( s, 7, sizeof( color4ub_t ) );				// color2 array
+			push_attr( s, 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 1, 1, VK_FORMAT_R8G8B8A8_UNORM );
+			//push_attr( s, 2, 2, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 3, 3, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 4, 4, VK_FORMAT_R32G32_SFLOAT );
+			push_attr( s, 5, 5, VK_FORMAT_R32G32B32A32_SFLOAT );
+			push_attr( s, 6, 6, VK_FORMAT_R8G8B8A8_UNORM );
+			push_attr( s, 7, 7, VK_FORMAT_R8G8B8A8_UNORM );
 			break;
 
 		default:
@@ -5372,183 +5544,183 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 			break;
 	}
 
-	vertex_input_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertex_input_state.pNext = NULL;
-	vertex_input_state.flags = 0;
-	vertex_input_state.pVertexBindingDescriptions = bindings;
-	vertex_input_state.pVertexAttributeDescriptions = attribs;
-	vertex_input_state.vertexBindingDescriptionCount = num_binds;
-	vertex_input_state.vertexAttributeDescriptionCount = num_attrs;
+	s->vertex_input_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	s->vertex_input_state.pNext = NULL;
+	s->vertex_input_state.flags = 0;
+	s->vertex_input_state.pVertexBindingDescriptions = s->bindings;
+	s->vertex_input_state.pVertexAttributeDescriptions = s->attribs;
+	s->vertex_input_state.vertexBindingDescriptionCount = s->num_binds;
+	s->vertex_input_state.vertexAttributeDescriptionCount = s->num_attrs;
 
 	//
 	// Primitive assembly.
 	//
-	input_assembly_state.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	input_assembly_state.pNext = NULL;
-	input_assembly_state.flags = 0;
-	input_assembly_state.primitiveRestartEnable = VK_FALSE;
+	s->input_assembly_state.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	s->input_assembly_state.pNext = NULL;
+	s->input_assembly_state.flags = 0;
+	s->input_assembly_state.primitiveRestartEnable = VK_FALSE;
 
 	switch ( def->primitives ) {
-		case LINE_LIST: input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST; break;
-		case POINT_LIST: input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST; break;
-		case TRIANGLE_STRIP: input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP; break;
-		default: input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; break;
+		case LINE_LIST: s->input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST; break;
+		case POINT_LIST: s->input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST; break;
+		case TRIANGLE_STRIP: s->input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP; break;
+		default: s->input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; break;
 	}
 
 	//
 	// Viewport.
 	//
-	viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewport_state.pNext = NULL;
-	viewport_state.flags = 0;
-	viewport_state.viewportCount = 1;
-	viewport_state.pViewports = NULL; // dynamic viewport state
-	viewport_state.scissorCount = 1;
-	viewport_state.pScissors = NULL; // dynamic scissor state
+	s->viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	s->viewport_state.pNext = NULL;
+	s->viewport_state.flags = 0;
+	s->viewport_state.viewportCount = 1;
+	s->viewport_state.pViewports = NULL; // dynamic viewport state
+	s->viewport_state.scissorCount = 1;
+	s->viewport_state.pScissors = NULL; // dynamic scissor state
 
 	//
 	// Rasterization.
 	//
-	rasterization_state.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterization_state.pNext = NULL;
-	rasterization_state.flags = 0;
-	rasterization_state.depthClampEnable = VK_FALSE;
-	rasterization_state.rasterizerDiscardEnable = VK_FALSE;
+	s->rasterization_state.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	s->rasterization_state.pNext = NULL;
+	s->rasterization_state.flags = 0;
+	s->rasterization_state.depthClampEnable = VK_FALSE;
+	s->rasterization_state.rasterizerDiscardEnable = VK_FALSE;
 	if ( def->shader_type == TYPE_DOT ) {
-		rasterization_state.polygonMode = VK_POLYGON_MODE_POINT;
+		s->rasterization_state.polygonMode = VK_POLYGON_MODE_POINT;
 	} else {
-		rasterization_state.polygonMode = (state_bits & GLS_POLYMODE_LINE) ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
+		s->rasterization_state.polygonMode = (state_bits & GLS_POLYMODE_LINE) ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
 	}
 
 	switch ( def->face_culling ) {
 		case CT_TWO_SIDED:
-			rasterization_state.cullMode = VK_CULL_MODE_NONE;
+			s->rasterization_state.cullMode = VK_CULL_MODE_NONE;
 			break;
 		case CT_FRONT_SIDED:
-			rasterization_state.cullMode = (def->mirror ? VK_CULL_MODE_FRONT_BIT : VK_CULL_MODE_BACK_BIT);
+			s->rasterization_state.cullMode = (def->mirror ? VK_CULL_MODE_FRONT_BIT : VK_CULL_MODE_BACK_BIT);
 			break;
 		case CT_BACK_SIDED:
-			rasterization_state.cullMode = (def->mirror ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_FRONT_BIT);
+			s->rasterization_state.cullMode = (def->mirror ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_FRONT_BIT);
 			break;
 		default:
 			ri.Error( ERR_DROP, "create_pipeline: invalid face culling mode %i\n", def->face_culling );
 			break;
 	}
 
-	rasterization_state.frontFace = VK_FRONT_FACE_CLOCKWISE; // Q3 defaults to clockwise vertex order
+	s->rasterization_state.frontFace = VK_FRONT_FACE_CLOCKWISE; // Q3 defaults to clockwise vertex order
 
 	 // depth bias state
 	if ( def->polygon_offset ) {
-		rasterization_state.depthBiasEnable = VK_TRUE;
-		rasterization_state.depthBiasClamp = 0.0f;
+		s->rasterization_state.depthBiasEnable = VK_TRUE;
+		s->rasterization_state.depthBiasClamp = 0.0f;
 #ifdef USE_REVERSED_DEPTH
-		rasterization_state.depthBiasConstantFactor = -r_offsetUnits->value;
-		rasterization_state.depthBiasSlopeFactor = -r_offsetFactor->value;
+		s->rasterization_state.depthBiasConstantFactor = -r_offsetUnits->value;
+		s->rasterization_state.depthBiasSlopeFactor = -r_offsetFactor->value;
 #else
-		rasterization_state.depthBiasConstantFactor = r_offsetUnits->value;
-		rasterization_state.depthBiasSlopeFactor = r_offsetFactor->value;
+		s->rasterization_state.depthBiasConstantFactor = r_offsetUnits->value;
+		s->rasterization_state.depthBiasSlopeFactor = r_offsetFactor->value;
 #endif
 	} else {
-		rasterization_state.depthBiasEnable = VK_FALSE;
-		rasterization_state.depthBiasClamp = 0.0f;
-		rasterization_state.depthBiasConstantFactor = 0.0f;
-		rasterization_state.depthBiasSlopeFactor = 0.0f;
+		s->rasterization_state.depthBiasEnable = VK_FALSE;
+		s->rasterization_state.depthBiasClamp = 0.0f;
+		s->rasterization_state.depthBiasConstantFactor = 0.0f;
+		s->rasterization_state.depthBiasSlopeFactor = 0.0f;
 	}
 
 	if ( def->line_width )
-		rasterization_state.lineWidth = (float)def->line_width;
+		s->rasterization_state.lineWidth = (float)def->line_width;
 	else
-		rasterization_state.lineWidth = 1.0f;
+		s->rasterization_state.lineWidth = 1.0f;
 
-	multisample_state.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisample_state.pNext = NULL;
-	multisample_state.flags = 0;
+	s->multisample_state.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	s->multisample_state.pNext = NULL;
+	s->multisample_state.flags = 0;
 
-	multisample_state.rasterizationSamples = (vk.renderPassIndex == RENDER_PASS_SCREENMAP) ? vk.screenMapSamples : vkSamples;
+	s->multisample_state.rasterizationSamples = (vk.renderPassIndex == RENDER_PASS_SCREENMAP) ? vk.screenMapSamples : vkSamples;
 
-	multisample_state.sampleShadingEnable = VK_FALSE;
-	multisample_state.minSampleShading = 1.0f;
-	multisample_state.pSampleMask = NULL;
-	multisample_state.alphaToCoverageEnable = alphaToCoverage;
-	multisample_state.alphaToOneEnable = VK_FALSE;
+	s->multisample_state.sampleShadingEnable = VK_FALSE;
+	s->multisample_state.minSampleShading = 1.0f;
+	s->multisample_state.pSampleMask = NULL;
+	s->multisample_state.alphaToCoverageEnable = alphaToCoverage;
+	s->multisample_state.alphaToOneEnable = VK_FALSE;
 
-	Com_Memset( &depth_stencil_state, 0, sizeof( depth_stencil_state ) );
+	Com_Memset( &s->depth_stencil_state, 0, sizeof( s->depth_stencil_state ) );
 
-	depth_stencil_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depth_stencil_state.pNext = NULL;
-	depth_stencil_state.flags = 0;
-	depth_stencil_state.depthTestEnable = (state_bits & GLS_DEPTHTEST_DISABLE) ? VK_FALSE : VK_TRUE;
-	depth_stencil_state.depthWriteEnable = (state_bits & GLS_DEPTHMASK_TRUE) ? VK_TRUE : VK_FALSE;
+	s->depth_stencil_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	s->depth_stencil_state.pNext = NULL;
+	s->depth_stencil_state.flags = 0;
+	s->depth_stencil_state.depthTestEnable = (state_bits & GLS_DEPTHTEST_DISABLE) ? VK_FALSE : VK_TRUE;
+	s->depth_stencil_state.depthWriteEnable = (state_bits & GLS_DEPTHMASK_TRUE) ? VK_TRUE : VK_FALSE;
 #ifdef USE_REVERSED_DEPTH
-	depth_stencil_state.depthCompareOp = (state_bits & GLS_DEPTHFUNC_EQUAL) ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_GREATER_OR_EQUAL;
+	s->depth_stencil_state.depthCompareOp = (state_bits & GLS_DEPTHFUNC_EQUAL) ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_GREATER_OR_EQUAL;
 #else
-	depth_stencil_state.depthCompareOp = (state_bits & GLS_DEPTHFUNC_EQUAL) ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
+	s->depth_stencil_state.depthCompareOp = (state_bits & GLS_DEPTHFUNC_EQUAL) ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
 #endif
-	depth_stencil_state.depthBoundsTestEnable = VK_FALSE;
-	depth_stencil_state.stencilTestEnable = (def->shadow_phase != SHADOW_DISABLED) ? VK_TRUE : VK_FALSE;
+	s->depth_stencil_state.depthBoundsTestEnable = VK_FALSE;
+	s->depth_stencil_state.stencilTestEnable = (def->shadow_phase != SHADOW_DISABLED) ? VK_TRUE : VK_FALSE;
 
 	if (def->shadow_phase == SHADOW_EDGES) {
-		depth_stencil_state.front.failOp = VK_STENCIL_OP_KEEP;
-		depth_stencil_state.front.passOp = (def->face_culling == CT_FRONT_SIDED) ? VK_STENCIL_OP_INCREMENT_AND_CLAMP : VK_STENCIL_OP_DECREMENT_AND_CLAMP;
-		depth_stencil_state.front.depthFailOp = VK_STENCIL_OP_KEEP;
-		depth_stencil_state.front.compareOp = VK_COMPARE_OP_ALWAYS;
-		depth_stencil_state.front.compareMask = 255;
-		depth_stencil_state.front.writeMask = 255;
-		depth_stencil_state.front.reference = 0;
+		s->depth_stencil_state.front.failOp = VK_STENCIL_OP_KEEP;
+		s->depth_stencil_state.front.passOp = (def->face_culling == CT_FRONT_SIDED) ? VK_STENCIL_OP_INCREMENT_AND_CLAMP : VK_STENCIL_OP_DECREMENT_AND_CLAMP;
+		s->depth_stencil_state.front.depthFailOp = VK_STENCIL_OP_KEEP;
+		s->depth_stencil_state.front.compareOp = VK_COMPARE_OP_ALWAYS;
+		s->depth_stencil_state.front.compareMask = 255;
+		s->depth_stencil_state.front.writeMask = 255;
+		s->depth_stencil_state.front.reference = 0;
 
-		depth_stencil_state.back = depth_stencil_state.front;
+		s->depth_stencil_state.back = s->depth_stencil_state.front;
 
 	}  else if (def->shadow_phase == SHADOW_FS_QUAD) {
-		depth_stencil_state.front.failOp = VK_STENCIL_OP_KEEP;
-		depth_stencil_state.front.passOp = VK_STENCIL_OP_KEEP;
-		depth_stencil_state.front.depthFailOp = VK_STENCIL_OP_KEEP;
-		depth_stencil_state.front.compareOp = VK_COMPARE_OP_NOT_EQUAL;
-		depth_stencil_state.front.compareMask = 255;
-		depth_stencil_state.front.writeMask = 255;
-		depth_stencil_state.front.reference = 0;
+		s->depth_stencil_state.front.failOp = VK_STENCIL_OP_KEEP;
+		s->depth_stencil_state.front.passOp = VK_STENCIL_OP_KEEP;
+		s->depth_stencil_state.front.depthFailOp = VK_STENCIL_OP_KEEP;
+		s->depth_stencil_state.front.compareOp = VK_COMPARE_OP_NOT_EQUAL;
+		s->depth_stencil_state.front.compareMask = 255;
+		s->depth_stencil_state.front.writeMask = 255;
+		s->depth_stencil_state.front.reference = 0;
 
-		depth_stencil_state.back = depth_stencil_state.front;
+		s->depth_stencil_state.back = s->depth_stencil_state.front;
 	}
 
-	depth_stencil_state.minDepthBounds = 0.0f;
-	depth_stencil_state.maxDepthBounds = 1.0f;
+	s->depth_stencil_state.minDepthBounds = 0.0f;
+	s->depth_stencil_state.maxDepthBounds = 1.0f;
 
-	Com_Memset(&attachment_blend_state, 0, sizeof(attachment_blend_state));
-	attachment_blend_state.blendEnable = (state_bits & (GLS_SRCBLEND_BITS | GLS_DSTBLEND_BITS)) ? VK_TRUE : VK_FALSE;
+	Com_Memset(&s->attachment_blend_state, 0, sizeof(s->attachment_blend_state));
+	s->attachment_blend_state.blendEnable = (state_bits & (GLS_SRCBLEND_BITS | GLS_DSTBLEND_BITS)) ? VK_TRUE : VK_FALSE;
 
 	if (def->shadow_phase == SHADOW_EDGES || def->shader_type == TYPE_SIGNLE_TEXTURE_DF)
-		attachment_blend_state.colorWriteMask = 0;
+		s->attachment_blend_state.colorWriteMask = 0;
 	else
-		attachment_blend_state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		s->attachment_blend_state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 
-	if (attachment_blend_state.blendEnable) {
+	if (s->attachment_blend_state.blendEnable) {
 		switch (state_bits & GLS_SRCBLEND_BITS) {
 			case GLS_SRCBLEND_ZERO:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
 				break;
 			case GLS_SRCBLEND_ONE:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
 				break;
 			case GLS_SRCBLEND_DST_COLOR:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_DST_COLOR;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_DST_COLOR;
 				break;
 			case GLS_SRCBLEND_ONE_MINUS_DST_COLOR:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR;
 				break;
 			case GLS_SRCBLEND_SRC_ALPHA:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
 				break;
 			case GLS_SRCBLEND_ONE_MINUS_SRC_ALPHA:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 				break;
 			case GLS_SRCBLEND_DST_ALPHA:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_DST_ALPHA;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_DST_ALPHA;
 				break;
 			case GLS_SRCBLEND_ONE_MINUS_DST_ALPHA:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
 				break;
 			case GLS_SRCBLEND_ALPHA_SATURATE:
-				attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA_SATURATE;
+				s->attachment_blend_state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA_SATURATE;
 				break;
 			default:
 				ri.Error( ERR_DROP, "create_pipeline: invalid src blend state bits\n" );
@@ -5556,101 +5728,142 @@ VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassI
 		}
 		switch (state_bits & GLS_DSTBLEND_BITS) {
 			case GLS_DSTBLEND_ZERO:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
 				break;
 			case GLS_DSTBLEND_ONE:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
 				break;
 			case GLS_DSTBLEND_SRC_COLOR:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_SRC_COLOR;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_SRC_COLOR;
 				break;
 			case GLS_DSTBLEND_ONE_MINUS_SRC_COLOR:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
 				break;
 			case GLS_DSTBLEND_SRC_ALPHA:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
 				break;
 			case GLS_DSTBLEND_ONE_MINUS_SRC_ALPHA:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 				break;
 			case GLS_DSTBLEND_DST_ALPHA:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_DST_ALPHA;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_DST_ALPHA;
 				break;
 			case GLS_DSTBLEND_ONE_MINUS_DST_ALPHA:
-				attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+				s->attachment_blend_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
 				break;
 			default:
 				ri.Error( ERR_DROP, "create_pipeline: invalid dst blend state bits\n" );
 				break;
 		}
 
-		attachment_blend_state.srcAlphaBlendFactor = attachment_blend_state.srcColorBlendFactor;
-		attachment_blend_state.dstAlphaBlendFactor = attachment_blend_state.dstColorBlendFactor;
-		attachment_blend_state.colorBlendOp = VK_BLEND_OP_ADD;
-		attachment_blend_state.alphaBlendOp = VK_BLEND_OP_ADD;
+		s->attachment_blend_state.srcAlphaBlendFactor = s->attachment_blend_state.srcColorBlendFactor;
+		s->attachment_blend_state.dstAlphaBlendFactor = s->attachment_blend_state.dstColorBlendFactor;
+		s->attachment_blend_state.colorBlendOp = VK_BLEND_OP_ADD;
+		s->attachment_blend_state.alphaBlendOp = VK_BLEND_OP_ADD;
 
 		if ( def->allow_discard && vkSamples != VK_SAMPLE_COUNT_1_BIT ) {
 			// try to reduce pixel fillrate for transparent surfaces, this yields 1..10% fps increase when multisampling in enabled
-			if ( attachment_blend_state.srcColorBlendFactor == VK_BLEND_FACTOR_SRC_ALPHA && attachment_blend_state.dstColorBlendFactor == VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA ) {
-				frag_spec_data[7].i = 1;
-			} else if ( attachment_blend_state.srcColorBlendFactor == VK_BLEND_FACTOR_ONE && attachment_blend_state.dstColorBlendFactor == VK_BLEND_FACTOR_ONE ) {
-				frag_spec_data[7].i = 2;
+			if ( s->attachment_blend_state.srcColorBlendFactor == VK_BLEND_FACTOR_SRC_ALPHA && s->attachment_blend_state.dstColorBlendFactor == VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA ) {
+				s->frag_spec_data[7].i = 1;
+			} else if ( s->attachment_blend_state.srcColorBlendFactor == VK_BLEND_FACTOR_ONE && s->attachment_blend_state.dstColorBlendFactor == VK_BLEND_FACTOR_ONE ) {
+				s->frag_spec_data[7].i = 2;
 			}
 		}
 	}
 
-	blend_state.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	blend_state.pNext = NULL;
-	blend_state.flags = 0;
-	blend_state.logicOpEnable = VK_FALSE;
-	blend_state.logicOp = VK_LOGIC_OP_COPY;
-	blend_state.attachmentCount = 1;
-	blend_state.pAttachments = &attachment_blend_state;
-	blend_state.blendConstants[0] = 0.0f;
-	blend_state.blendConstants[1] = 0.0f;
-	blend_state.blendConstants[2] = 0.0f;
-	blend_state.blendConstants[3] = 0.0f;
-
-	dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamic_state.pNext = NULL;
-	dynamic_state.flags = 0;
-	dynamic_state.dynamicStateCount = ARRAY_LEN( dynamic_state_array );
-	dynamic_state.pDynamicStates = dynamic_state_array;
-
-	create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	create_info.pNext = NULL;
-	create_info.flags = 0;
-	create_info.stageCount = ARRAY_LEN(shader_stages);
-	create_info.pStages = shader_stages;
-	create_info.pVertexInputState = &vertex_input_state;
-	create_info.pInputAssemblyState = &input_assembly_state;
-	create_info.pTessellationState = NULL;
-	create_info.pViewportState = &viewport_state;
-	create_info.pRasterizationState = &rasterization_state;
-	create_info.pMultisampleState = &multisample_state;
-	create_info.pDepthStencilState = &depth_stencil_state;
-	create_info.pColorBlendState = &blend_state;
-	create_info.pDynamicState = &dynamic_state;
+	s->blend_state.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	s->blend_state.pNext = NULL;
+	s->blend_state.flags = 0;
+	s->blend_state.logicOpEnable = VK_FALSE;
+	s->blend_state.logicOp = VK_LOGIC_OP_COPY;
+	s->blend_state.attachmentCount = 1;
+	s->blend_state.pAttachments = &s->attachment_blend_state;
+	s->blend_state.blendConstants[0] = 0.0f;
+	s->blend_state.blendConstants[1] = 0.0f;
+	s->blend_state.blendConstants[2] = 0.0f;
+	s->blend_state.blendConstants[3] = 0.0f;
+
+	s->dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	s->dynamic_state.pNext = NULL;
+	s->dynamic_state.flags = 0;
+	s->dynamic_state_array[0] = VK_DYNAMIC_STATE_VIEWPORT;
+	s->dynamic_state_array[1] = VK_DYNAMIC_STATE_SCISSOR;
+	s->dynamic_state.dynamicStateCount = ARRAY_LEN( s->dynamic_state_array );
+	s->dynamic_state.pDynamicStates = s->dynamic_state_array;
+
+	s->create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	s->create_info.pNext = NULL;
+	s->create_info.flags = 0;
+	s->create_info.stageCount = ARRAY_LEN(s->shader_stages);
+	s->create_info.pStages = s->shader_stages;
+	s->create_info.pVertexInputState = &s->vertex_input_state;
+	s->create_info.pInputAssemblyState = &s->input_assembly_state;
+	s->create_info.pTessellationState = NULL;
+	s->create_info.pViewportState = &s->viewport_state;
+	s->create_info.pRasterizationState = &s->rasterization_state;
+	s->create_info.pMultisampleState = &s->multisample_state;
+	s->create_info.pDepthStencilState = &s->depth_stencil_state;
+	s->create_info.pColorBlendState = &s->blend_state;
+	s->create_info.pDynamicState = &s->dynamic_state;
 
 	//if ( def->shader_type == TYPE_DOT )
-	//	create_info.layout = vk.pipeline_layout_storage;
+	//	s->create_info.layout = vk.pipeline_layout_storage;
 	//else
-		create_info.layout = vk.pipeline_layout;
+		s->create_info.layout = vk.pipeline_layout;
 
 	if ( renderPassIndex == RENDER_PASS_SCREENMAP )
-		create_info.renderPass = vk.render_pass.screenmap;
+		s->create_info.renderPass = vk.render_pass.screenmap;
 	else
-		create_info.renderPass = vk.render_pass.main;
+		s->create_info.renderPass = vk.render_pass.main;
 
-	create_info.subpass = 0;
-	create_info.basePipelineHandle = VK_NULL_HANDLE;
-	create_info.basePipelineIndex = -1;
+	s->create_info.subpass = 0;
+	s->create_info.basePipelineHandle = VK_NULL_HANDLE;
+	s->create_info.basePipelineIndex = -1;
 
-	VK_CHECK( qvkCreateGraphicsPipelines( vk.device, vk.pipelineCache, 1, &create_info, NULL, &pipeline ) );
+	if ( vk.creationFeedback ) {
+		Com_Memset( &s->feedback, 0, sizeof( s->feedback ) );
+		Com_Memset( s->stage_feedback, 0, sizeof( s->stage_feedback ) );
+		s->feedback_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+		s->feedback_info.pNext = NULL;
+		s->feedback_info.pPipelineCreationFeedback = &s->feedback;
+		s->feedback_info.pipelineStageCreationFeedbackCount = ARRAY_LEN( s->stage_feedback );
+		s->feedback_info.pPipelineStageCreationFeedbacks = s->stage_feedback;
+		s->create_info.pNext = &s->feedback_info;
+	}
+
+	s->pipeline = VK_NULL_HANDLE;
+	s->result = VK_SUCCESS;
+}
+
+
+static void vk_compile_pipeline_state( pipelineState_t *s ) {
+	s->result = qvkCreateGraphicsPipelines( vk.device, vk.pipelineCache, 1, &s->create_info, NULL, &s->pipeline );
+}
+
+
+static void vk_finish_pipeline_state( const pipelineState_t *s ) {
+	if ( s->result < 0 ) {
+		ri.Error( ERR_FATAL, "Vulkan: vkCreateGraphicsPipelines returned %s", vk_result_string( s->result ) );
+	}
+
+	if ( vk.creationFeedback && ( s->feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT ) ) {
+		vk.pipeline_cache_hits++;
+	} else {
+		vk.pipeline_cache_dirty = qtrue;
+	}
 
 	vk.pipeline_create_count++;
+}
+
+
+VkPipeline create_pipeline( const Vk_Pipeline_Def *def, renderPass_t renderPassIndex ) {
+	pipelineState_t s;
+
+	vk_build_pipeline_state( def, renderPassIndex, &s );
+	vk_compile_pipeline_state( &s );
+	vk_finish_pipeline_state( &s );
 
-	return pipeline;
+	return s.pipeline;
 }
 
 
@@ -5674,8 +5887,14 @@ uint32_t vk_alloc_pipeline( const Vk_Pipeline_Def *def ) {
 VkPipeline vk_gen_pipeline( uint32_t index ) {
 	if ( index < vk.pipelines_count ) {
 		VK_Pipeline_t *pipeline = vk.pipelines + index;
-		if ( pipeline->handle[ vk.renderPassIndex ] == VK_NULL_HANDLE )
+		if ( pipeline->handle[ vk.renderPassIndex ] == VK_NULL_HANDLE ) {
+			const int64_t start = ri.Microseconds();
 			pipeline->handle[ vk.renderPassIndex ] = create_pipeline( &pipeline->def, vk.renderPassIndex );
+			if ( !pipelineBatch.active ) {
+				vk.pipeline_stall_count++;
+				vk.pipeline_stall_time += ri.Microseconds() - start;
+			}
+		}
 		return pipeline->handle[ vk.renderPassIndex ];
 	} else {
 		return VK_NULL_HANDLE;
@@ -5683,6 +5902,92 @@ VkPipeline vk_gen_pipeline( uint32_t index ) {
 }
 
 
+/*
+================
+vk_begin_pipeline_batch
+
+Defer creation of pipelines requested by shaders until vk_finish_pipeline_batch()
+================
+*/
+void vk_begin_pipeline_batch( void ) {
+	vk_clear_pipeline_batch();
+	pipelineBatch.active = qtrue;
+}
+
+
+static void vk_queue_pipeline( uint32_t index ) {
+	if ( pipelineBatch.queued[ index ] || vk.pipelines[ index ].handle[ RENDER_PASS_MAIN ] != VK_NULL_HANDLE )
+		return;
+
+	pipelineBatch.queued[ index ] = 1;
+	pipelineBatch.index[ pipelineBatch.count++ ] = index;
+}
+
+
+static void vk_pipeline_job( void *arg, int index ) {
+	vk_compile_pipeline_state( (pipelineState_t *)arg + index );
+}
+
+
+/*
+================
+vk_finish_pipeline_batch
+
+Compiles all queued pipelines in parallel, access to the pipeline cache
+is synchronized by the driver so vkCreateGraphicsPipelines() is thread-safe
+================
+*/
+void vk_finish_pipeline_batch( void ) {
+	pipelineState_t *states;
+	VK_Pipeline_t *pipeline;
+	int64_t start;
+	uint32_t i, n, index;
+	int hits;
+
+	if ( !pipelineBatch.active )
+		return;
+
+	pipelineBatch.active = qfalse;
+
+	// skip pipelines already created on demand
+	for ( i = 0, n = 0; i < pipelineBatch.count; i++ ) {
+		index = pipelineBatch.index[ i ];
+		if ( vk.pipelines[ index ].handle[ RENDER_PASS_MAIN ] == VK_NULL_HANDLE ) {
+			pipelineBatch.index[ n++ ] = index;
+		}
+	}
+
+	if ( n > 0 ) {
+		start = ri.Microseconds();
+		hits = vk.pipeline_cache_hits;
+
+		states = ri.Hunk_AllocateTempMemory( n * sizeof( *states ) );
+
+		// descriptions may refer cvars and raise errors so build them there
+		for ( i = 0; i < n; i++ ) {
+			vk_build_pipeline_state( &vk.pipelines[ pipelineBatch.index[ i ] ].def, RENDER_PASS_MAIN, states + i );
+		}
+
+		ri.Com_RunJobs( vk_pipeline_job, states, n );
+
+		for ( i = 0; i < n; i++ ) {
+			pipeline = vk.pipelines + pipelineBatch.index[ i ];
+			vk_finish_pipeline_state( states + i );
+			pipeline->handle[ RENDER_PASS_MAIN ] = states[ i ].pipeline;
+		}
+
+		ri.Hunk_FreeTempMemory( states );
+
+		ri.Printf( PRINT_DEVELOPER, "...compiled %i pipelines in %i msec (%i threads, %i cache hits)\n",
+			n, (int)( ( ri.Microseconds() - start ) / 1000 ), ri.Com_NumJobThreads(), vk.pipeline_cache_hits - hits );
+	}
+
+	vk_clear_pipeline_batch();
+
+	vk_save_pipeline_cache();
+}
+
+
 uint32_t vk_find_pipeline_ext( uint32_t base, const Vk_Pipeline_Def *def, qboolean use ) {
 	const Vk_Pipeline_Def *cur_def;
 	uint32_t index;
@@ -5697,8 +6002,12 @@ uint32_t vk_find_pipeline_ext( uint32_t base, const Vk_Pipeline_Def *def, qboole
 	index = vk_alloc_pipeline( def );
 found:
 
-	if ( use )
-		vk_gen_pipeline( index );
+	if ( use ) {
+		if ( pipelineBatch.active && vk.renderPassIndex == RENDER_PASS_MAIN )
+			vk_queue_pipeline( index );
+		else
+			vk_gen_pipeline( index );
+	}
 
 	return index;
 }
@@ -6380,7 +6689,7 @@ void vk_end_render_pass( void )
 
 static qboolean vk_find_screenmap_drawsurfs( void )
 {
-	const void *curCmd = &backEndData->commands.cmds;
+	const void *curCmd = &backEndData[backEnd.smpFrame]->commands.cmds;
 	const drawBufferCommand_t *db_cmd;
 	const drawSurfsCommand_t *ds_cmd;
 
@@ -6441,6 +6750,9 @@ void vk_begin_frame( void )
 
 		vk.cmd->waitForFence = qfalse;
 		VK_CHECK( qvkWaitForFences( vk.device, 1, &vk.cmd->rendering_finished_fence, VK_FALSE, 1e10 ) );
+
+		// fence will be reset below so remember that copies from this command buffer are completed
+		vk_mark_readback_ready( vk.cmd );
 	} else {
 		// current command buffer has been reset due to geometry buffer overflow/update
 		// so we will reuse it with current swapchain image as well
@@ -6546,8 +6858,12 @@ void vk_end_frame( void )
 	VkPipelineStageFlags wait_dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	VkPresentInfoKHR present_info;
 	VkSubmitInfo submit_info;
+	qboolean readback;
 	VkResult res;
 
+	readback = vk.readback.requested;
+	vk.readback.requested = qfalse;
+
 	if ( vk.frame_count == 0 )
 		return;
 
@@ -6600,6 +6916,15 @@ void vk_end_frame( void )
 
 	vk_end_render_pass();
 
+	if ( readback && ( vk.fboActive || !ri.CL_IsMinimized() ) ) {
+		vk_readback_t *rb = &vk.readback.slot[ vk.readback.head ];
+		vk_record_readback( vk.cmd->command_buffer, rb, qtrue );
+		rb->pending = qtrue;
+		rb->ready = qfalse;
+		rb->tess = vk.cmd;
+		vk.readback.head = ( vk.readback.head + 1 ) % VK_READBACK_FRAMES;
+	}
+
 	VK_CHECK( qvkEndCommandBuffer( vk.cmd->command_buffer ) );
 
 	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -6669,10 +6994,8 @@ static qboolean is_bgr( VkFormat format ) {
 }
 
 
-void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
+static void vk_alloc_readback( vk_readback_t *rb, uint32_t width, uint32_t height )
 {
-	VkCommandBuffer command_buffer;
-	VkDeviceMemory memory;
 	VkMemoryRequirements memory_requirements;
 	VkMemoryPropertyFlags memory_reqs;
 	VkMemoryPropertyFlags memory_flags;
@@ -6680,33 +7003,7 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 	VkImageSubresource subresource;
 	VkSubresourceLayout layout;
 	VkImageCreateInfo desc;
-	VkImage srcImage;
-	VkImageLayout srcImageLayout;
-	VkAccessFlagBits srcImageAccess;
-	VkImage dstImage;
-	byte *buffer_ptr;
 	byte *data;
-	uint32_t pixel_width;
-	uint32_t i, n;
-	qboolean invalidate_ptr;
-
-	VK_CHECK( qvkWaitForFences( vk.device, 1, &vk.cmd->rendering_finished_fence, VK_FALSE, 1e12 ) );
-
-	if ( vk.fboActive ) {
-		srcImageAccess = VK_ACCESS_SHADER_READ_BIT;
-		if ( vk.capture.image ) {
-			// dedicated capture buffer
-			srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			srcImage = vk.capture.image;
-		} else {
-			srcImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			srcImage = vk.color_image;
-		}
-	} else {
-		srcImageAccess = VK_ACCESS_MEMORY_READ_BIT;
-		srcImageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		srcImage = vk.swapchain_images[ vk.swapchain_image_index ];
-	}
 
 	Com_Memset( &desc, 0, sizeof( desc ) );
 
@@ -6729,9 +7026,9 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 	desc.pQueueFamilyIndices = NULL;
 	desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-	VK_CHECK( qvkCreateImage( vk.device, &desc, NULL, &dstImage ) );
+	VK_CHECK( qvkCreateImage( vk.device, &desc, NULL, &rb->image ) );
 
-	qvkGetImageMemoryRequirements( vk.device, dstImage, &memory_requirements );
+	qvkGetImageMemoryRequirements( vk.device, rb->image, &memory_requirements );
 
 	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 	alloc_info.pNext = NULL;
@@ -6755,16 +7052,72 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 	}
 
 	if ( memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ) {
-		invalidate_ptr = qfalse;
+		rb->invalidate = qfalse;
 	} else {
 		 // according to specification - must be performed if host_coherent is not set
-		invalidate_ptr = qtrue;
+		rb->invalidate = qtrue;
 	}
 
-	VK_CHECK(qvkAllocateMemory(vk.device, &alloc_info, NULL, &memory));
-	VK_CHECK(qvkBindImageMemory(vk.device, dstImage, memory, 0));
+	VK_CHECK(qvkAllocateMemory(vk.device, &alloc_info, NULL, &rb->memory));
+	VK_CHECK(qvkBindImageMemory(vk.device, rb->image, rb->memory, 0));
 
-	command_buffer = begin_command_buffer();
+	subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subresource.mipLevel = 0;
+	subresource.arrayLayer = 0;
+
+	qvkGetImageSubresourceLayout( vk.device, rb->image, &subresource, &layout );
+
+	VK_CHECK( qvkMapMemory( vk.device, rb->memory, 0, VK_WHOLE_SIZE, 0, (void**)&data ) );
+
+	rb->data = data + layout.offset;
+	rb->rowPitch = layout.rowPitch;
+	rb->width = width;
+	rb->height = height;
+}
+
+
+static void vk_free_readback( vk_readback_t *rb )
+{
+	if ( rb->image != VK_NULL_HANDLE ) {
+		qvkUnmapMemory( vk.device, rb->memory );
+		qvkDestroyImage( vk.device, rb->image, NULL );
+		qvkFreeMemory( vk.device, rb->memory, NULL );
+	}
+
+	Com_Memset( rb, 0, sizeof( *rb ) );
+}
+
+
+/*
+================
+vk_record_readback
+
+Records copy of the current frame into the readback image, source layout
+is restored when the copy is a part of the frame command buffer
+================
+*/
+static void vk_record_readback( VkCommandBuffer command_buffer, vk_readback_t *rb, qboolean inFrame )
+{
+	VkImage srcImage;
+	VkImageLayout srcImageLayout;
+	VkAccessFlagBits srcImageAccess;
+	VkMemoryBarrier barrier;
+
+	if ( vk.fboActive ) {
+		srcImageAccess = VK_ACCESS_SHADER_READ_BIT;
+		if ( vk.capture.image ) {
+			// dedicated capture buffer
+			srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			srcImage = vk.capture.image;
+		} else {
+			srcImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			srcImage = vk.color_image;
+		}
+	} else {
+		srcImageAccess = VK_ACCESS_MEMORY_READ_BIT;
+		srcImageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		srcImage = vk.swapchain_images[ vk.swapchain_image_index ];
+	}
 
 	if ( srcImageLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ) {
 		record_image_layout_transition( command_buffer, srcImage,
@@ -6773,15 +7126,11 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 			VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL );
 	}
 
-	record_image_layout_transition( command_buffer, dstImage,
+	record_image_layout_transition( command_buffer, rb->image,
 		VK_IMAGE_ASPECT_COLOR_BIT,
 		0, VK_IMAGE_LAYOUT_UNDEFINED,
 		VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
 
-	// end_command_buffer( command_buffer );
-
-	// command_buffer = begin_command_buffer();
-
 	if ( vk.blitEnabled ) {
 		VkImageBlit region;
 
@@ -6792,14 +7141,14 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 		region.srcOffsets[0].x = 0;
 		region.srcOffsets[0].y = 0;
 		region.srcOffsets[0].z = 0;
-		region.srcOffsets[1].x = width;
-		region.srcOffsets[1].y = height;
+		region.srcOffsets[1].x = rb->width;
+		region.srcOffsets[1].y = rb->height;
 		region.srcOffsets[1].z = 1;
 		region.dstSubresource = region.srcSubresource;
 		region.dstOffsets[0] = region.srcOffsets[0];
 		region.dstOffsets[1] = region.srcOffsets[1];
 
-		qvkCmdBlitImage( command_buffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_NEAREST );
+		qvkCmdBlitImage( command_buffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, rb->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_NEAREST );
 
 	} else {
 		VkImageCopy region;
@@ -6813,101 +7162,252 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 		region.srcOffset.z = 0;
 		region.dstSubresource = region.srcSubresource;
 		region.dstOffset = region.srcOffset;
-		region.extent.width = width;
-		region.extent.height = height;
+		region.extent.width = rb->width;
+		region.extent.height = rb->height;
 		region.extent.depth = 1;
 
-		qvkCmdCopyImage( command_buffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
+		qvkCmdCopyImage( command_buffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, rb->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
 	}
 
-	end_command_buffer( command_buffer );
-
-	// Copy data from destination image to memory buffer.
-	subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	subresource.mipLevel = 0;
-	subresource.arrayLayer = 0;
-
-	qvkGetImageSubresourceLayout( vk.device, dstImage, &subresource, &layout );
-
-	VK_CHECK( qvkMapMemory( vk.device, memory, 0, VK_WHOLE_SIZE, 0, (void**)&data ) );
+	// make transfer results visible to host reads
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.pNext = NULL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	qvkCmdPipelineBarrier( command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL );
 
-	if ( invalidate_ptr )
-	{
-		VkMappedMemoryRange range;
-		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		range.pNext = NULL;
-		range.memory = memory;
-		range.size = VK_WHOLE_SIZE;
-		range.offset = 0;
-		qvkInvalidateMappedMemoryRanges( vk.device, 1, &range );
+	// restore previous layout
+	if ( srcImage == vk.color_image || ( inFrame && srcImageLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ) ) {
+		record_image_layout_transition( command_buffer, srcImage,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			srcImageAccess, srcImageLayout );
 	}
+}
 
-	data += layout.offset;
 
-	switch ( vk.capture_format ) {
-		case VK_FORMAT_B4G4R4A4_UNORM_PACK16: pixel_width = 2; break;
-		case VK_FORMAT_R16G16B16A16_UNORM: pixel_width = 8; break;
-		default: pixel_width = 4; break;
-	}
+typedef struct {
+	const byte *data;
+	VkDeviceSize rowPitch;
+	uint32_t width;
+	uint32_t height;
+	uint32_t pixel_width;
+	qboolean bgr;
+	byte *buffer;
+} readbackJob_t;
 
-	buffer_ptr = buffer + width * (height - 1) * 3;
-	for ( i = 0; i < height; i++ ) {
-		switch ( pixel_width ) {
+#define READBACK_JOB_ROWS 32
+
+static void vk_readback_job( void *arg, int index )
+{
+	const readbackJob_t *job = (const readbackJob_t *) arg;
+	const byte *data;
+	byte *buffer_ptr;
+	uint32_t i, n, start, end;
+	byte c[3];
+	const int r = job->bgr ? 2 : 0;
+	const int b = job->bgr ? 0 : 2;
+
+	start = index * READBACK_JOB_ROWS;
+	end = MIN( start + READBACK_JOB_ROWS, job->height );
+
+	// output is bottom-up RGB
+	for ( i = start; i < end; i++ ) {
+		data = job->data + i * job->rowPitch;
+		buffer_ptr = job->buffer + job->width * ( job->height - 1 - i ) * 3;
+		switch ( job->pixel_width ) {
 			case 2: {
-				uint16_t *src = (uint16_t*)data;
-				for ( n = 0; n < width; n++ ) {
-					buffer_ptr[n*3+0] = ((src[n]>>12)&0xF)<<4;
-					buffer_ptr[n*3+1] = ((src[n]>>8)&0xF)<<4;
-					buffer_ptr[n*3+2] = ((src[n]>>4)&0xF)<<4;
+				const uint16_t *src = (const uint16_t*)data;
+				for ( n = 0; n < job->width; n++, buffer_ptr += 3 ) {
+					c[0] = ((src[n]>>12)&0xF)<<4;
+					c[1] = ((src[n]>>8)&0xF)<<4;
+					c[2] = ((src[n]>>4)&0xF)<<4;
+					buffer_ptr[0] = c[r];
+					buffer_ptr[1] = c[1];
+					buffer_ptr[2] = c[b];
 				}
 			} break;
 
 			case 4: {
-				for ( n = 0; n < width; n++ ) {
-					Com_Memcpy( &buffer_ptr[n*3], &data[n*4], 3 );
-					//buffer_ptr[n*3+0] = data[n*4+0];
-					//buffer_ptr[n*3+1] = data[n*4+1];
-					//buffer_ptr[n*3+2] = data[n*4+2];
+				for ( n = 0; n < job->width; n++, buffer_ptr += 3 ) {
+					buffer_ptr[0] = data[n*4+r];
+					buffer_ptr[1] = data[n*4+1];
+					buffer_ptr[2] = data[n*4+b];
 				}
 			} break;
 
 			case 8: {
-				const uint16_t *src = (uint16_t*)data;
-				for ( n = 0; n < width; n++ ) {
-					buffer_ptr[n*3+0] = src[n*4+0]>>8;
-					buffer_ptr[n*3+1] = src[n*4+1]>>8;
-					buffer_ptr[n*3+2] = src[n*4+2]>>8;
+				const uint16_t *src = (const uint16_t*)data;
+				for ( n = 0; n < job->width; n++, buffer_ptr += 3 ) {
+					buffer_ptr[0] = src[n*4+r]>>8;
+					buffer_ptr[1] = src[n*4+1]>>8;
+					buffer_ptr[2] = src[n*4+b]>>8;
 				}
 			} break;
 		}
-		buffer_ptr -= width * 3;
-		data += layout.rowPitch;
 	}
+}
+
+
+/*
+================
+vk_convert_readback
+
+Converts completed readback into bottom-up RGB buffer on worker threads
+================
+*/
+static void vk_convert_readback( const vk_readback_t *rb, byte *buffer )
+{
+	readbackJob_t job;
+
+	if ( rb->invalidate ) {
+		VkMappedMemoryRange range;
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.pNext = NULL;
+		range.memory = rb->memory;
+		range.size = VK_WHOLE_SIZE;
+		range.offset = 0;
+		qvkInvalidateMappedMemoryRanges( vk.device, 1, &range );
+	}
+
+	switch ( vk.capture_format ) {
+		case VK_FORMAT_B4G4R4A4_UNORM_PACK16: job.pixel_width = 2; break;
+		case VK_FORMAT_R16G16B16A16_UNORM: job.pixel_width = 8; break;
+		default: job.pixel_width = 4; break;
+	}
+
+	job.data = rb->data;
+	job.rowPitch = rb->rowPitch;
+	job.width = rb->width;
+	job.height = rb->height;
+	job.bgr = is_bgr( vk.capture_format );
+	job.buffer = buffer;
+
+	ri.Com_RunJobs( vk_readback_job, &job, ( rb->height + READBACK_JOB_ROWS - 1 ) / READBACK_JOB_ROWS );
+}
+
+
+void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
+{
+	VkCommandBuffer command_buffer;
+	vk_readback_t rb;
+
+	VK_CHECK( qvkWaitForFences( vk.device, 1, &vk.cmd->rendering_finished_fence, VK_FALSE, 1e12 ) );
+
+	Com_Memset( &rb, 0, sizeof( rb ) );
+	vk_alloc_readback( &rb, width, height );
+
+	command_buffer = begin_command_buffer();
+	vk_record_readback( command_buffer, &rb, qfalse );
+	end_command_buffer( command_buffer );
+
+	vk_convert_readback( &rb, buffer );
+
+	vk_free_readback( &rb );
+}
+
+
+/*
+================
+vk_readback_begin
+
+Reserves readback buffer for the frame being finished, the copy is recorded
+into its command buffer by vk_end_frame() and completes while next frames
+are rendered. Returns -1 if all buffers are still in flight.
+================
+*/
+int vk_readback_begin( uint32_t width, uint32_t height )
+{
+	vk_readback_t *rb = &vk.readback.slot[ vk.readback.head ];
+
+	if ( rb->pending )
+		return -1;
+
+	if ( rb->width != width || rb->height != height ) {
+		vk_free_readback( rb );
+		vk_alloc_readback( rb, width, height );
+	}
+
+	vk.readback.requested = qtrue;
+
+	return vk.readback.head;
+}
+
 
-	if ( is_bgr( vk.capture_format ) ) {
-		buffer_ptr = buffer;
-		for ( i = 0; i < width * height; i++ ) {
-			byte tmp = buffer_ptr[0];
-			buffer_ptr[0] = buffer_ptr[2];
-			buffer_ptr[2] = tmp;
-			buffer_ptr += 3;
+qboolean vk_readback_queued( int slot )
+{
+	if ( slot < 0 || slot >= VK_READBACK_FRAMES )
+		return qfalse;
+
+	return vk.readback.slot[ slot ].pending;
+}
+
+
+/*
+================
+vk_readback_next
+
+Returns oldest readback buffer if its copy has been completed, -1 otherwise
+================
+*/
+int vk_readback_next( qboolean wait )
+{
+	vk_readback_t *rb = &vk.readback.slot[ vk.readback.tail ];
+
+	if ( !rb->pending )
+		return -1;
+
+	// fence can't be reset before the copy is marked as ready in vk_begin_frame()
+	if ( !rb->ready ) {
+		if ( wait ) {
+			VK_CHECK( qvkWaitForFences( vk.device, 1, &rb->tess->rendering_finished_fence, VK_FALSE, 1e12 ) );
+		} else if ( qvkGetFenceStatus( vk.device, rb->tess->rendering_finished_fence ) != VK_SUCCESS ) {
+			return -1;
 		}
+		rb->ready = qtrue;
 	}
 
-	qvkDestroyImage( vk.device, dstImage, NULL );
-	qvkFreeMemory( vk.device, memory, NULL );
+	return vk.readback.tail;
+}
 
-	// restore previous layout
-	if ( srcImage == vk.color_image ) {
-		command_buffer = begin_command_buffer();
 
-		record_image_layout_transition( command_buffer, srcImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			srcImageAccess, srcImageLayout );
+void vk_readback_read( int slot, byte *buffer )
+{
+	vk_readback_t *rb = &vk.readback.slot[ slot ];
 
-		end_command_buffer( command_buffer );
+	vk_convert_readback( rb, buffer );
+
+	rb->pending = qfalse;
+	rb->ready = qfalse;
+	rb->tess = NULL;
+
+	vk.readback.tail = ( slot + 1 ) % VK_READBACK_FRAMES;
+}
+
+
+static void vk_mark_readback_ready( const vk_tess_t *tess )
+{
+	int i;
+
+	for ( i = 0; i < VK_READBACK_FRAMES; i++ ) {
+		if ( vk.readback.slot[ i ].pending && ( tess == NULL || vk.readback.slot[ i ].tess == tess ) ) {
+			vk.readback.slot[ i ].ready = qtrue;
+		}
+	}
+}
+
+
+static void vk_destroy_readback( void )
+{
+	int i;
+
+	for ( i = 0; i < VK_READBACK_FRAMES; i++ ) {
+		vk_free_readback( &vk.readback.slot[ i ] );
 	}
+
+	vk.readback.head = 0;
+	vk.readback.tail = 0;
+	vk.readback.requested = qfalse;
 }
 
 
@@ -16,6 +16,7 @@
 #define MAX_IMAGE_CHUNKS 48
 
 #define NUM_COMMAND_BUFFERS 2	// number of command buffers / render semaphores / framebuffer sets
+#define VK_READBACK_FRAMES (NUM_COMMAND_BUFFERS+1) // frames in flight for video capture
 
 #define USE_REVERSED_DEPTH
 //#define USE_BUFFER_CLEAR
@@ -204,6 +205,8 @@ byte *resample_image_data( const image_t *image, byte *data, const int data_size
 void vk_update_descriptor_set( image_t *image, qboolean mipmap );
 
 uint32_t vk_find_pipeline_ext( uint32_t base, const Vk_Pipeline_Def *def, qboolean use );
+void vk_begin_pipeline_batch( void );
+void vk_finish_pipeline_batch( void );
 void vk_get_pipeline_def( uint32_t pipeline, Vk_Pipeline_Def *def );
 
 void vk_create_post_process_pipeline( int program_index, uint32_t width, uint32_t height );
@@ -232,6 +235,12 @@ void vk_draw_geometry( Vk_Depth_Range depth_range, qboolean indexed );
 void vk_draw_light( uint32_t pipeline, Vk_Depth_Range depth_range, uint32_t uniform_offset, int fog);
 
 void vk_read_pixels( byte* buffer, uint32_t width, uint32_t height ); // screenshots
+
+// asynchronous readback ring used for video capture
+int vk_readback_begin( uint32_t width, uint32_t height );
+qboolean vk_readback_queued( int slot );
+int vk_readback_next( qboolean wait );
+void vk_readback_read( int slot, byte *buffer );
 qboolean vk_bloom( void );
 
 qboolean vk_alloc_vbo( const byte *vbo_data, int vbo_size );
@@ -254,6 +263,14 @@ void VBO_ClearQueue( void );
 
 qboolean vk_surface_format_color_depth( VkFormat format, int* r, int* g, int* b );
 
+#ifdef USE_NULL_RENDERER
+// headless platform layer, see vk_null.c
+void NullImp_Init( glconfig_t *config );
+void NullImp_Shutdown( qboolean unloadDLL );
+void NullImp_InitGamma( glconfig_t *config );
+void NullImp_SetGamma( unsigned char red[256], unsigned char green[256], unsigned char blue[256] );
+#endif
+
 typedef struct vk_tess_s {
 	VkCommandBuffer command_buffer;
 
@@ -288,6 +305,20 @@ typedef struct vk_tess_s {
 	VkRect2D scissor_rect;
 } vk_tess_t;
 
+// host-visible copy of a rendered frame, see vk_readback_begin()
+typedef struct vk_readback_s {
+	VkImage image;
+	VkDeviceMemory memory;
+	byte *data;				// persistently mapped pixels
+	VkDeviceSize rowPitch;
+	uint32_t width;
+	uint32_t height;
+	qboolean invalidate;	// memory is not host-coherent
+	qboolean pending;		// copy is recorded and submitted
+	qboolean ready;			// copy is completed
+	vk_tess_t *tess;		// command buffer that performs the copy
+} vk_readback_t;
+
 
 // Vk_Instance contains engine-specific vulkan resources that persist entire renderer lifetime.
 // This structure is initialized/deinitialized by vk_initialize/vk_shutdown functions correspondingly.
@@ -380,6 +411,14 @@ typedef struct {
 	vk_tess_t tess[ NUM_COMMAND_BUFFERS ], *cmd;
 	int cmd_index;
 
+	// frames being copied to host memory while next ones are rendered
+	struct {
+		vk_readback_t slot[ VK_READBACK_FRAMES ];
+		int head;				// next slot to record
+		int tail;				// oldest pending slot
+		qboolean requested;		// record head slot in vk_end_frame()
+	} readback;
+
 	struct {
 		VkBuffer		buffer;
 		byte			*buffer_ptr;
@@ -449,6 +488,11 @@ typedef struct {
 
 	// pipeline statistics
 	int32_t pipeline_create_count;
+	int32_t pipeline_cache_hits;	// reported by VK_EXT_pipeline_creation_feedback
+	int32_t pipeline_stall_count;	// created on demand after registration
+	int64_t pipeline_stall_time;	// usec
+	uint32_t pipeline_cache_size;	// bytes loaded from pipelinecache.dat
+	qboolean pipeline_cache_dirty;
 
 	//
 	// Standard pipelines.
@@ -511,6 +555,7 @@ typedef struct {
 	qboolean fragmentStores;
 	qboolean dedicatedAllocation;
 	qboolean debugMarkers;
+	qboolean creationFeedback;
 
 	float maxAnisotropy;
 	float maxLod;
@@ -0,0 +1,213 @@
+#include "tr_local.h"
+
+#ifdef USE_NULL_RENDERER
+
+#include "vk.h"
+
+//
+// Headless replacement for vk.c, used to build the "null" renderer module.
+// The whole front end runs as usual (world traversal, entity surfaces,
+// draw surface sorting, image loading and resampling) but no device is
+// created and nothing is submitted, so it works on machines without a GPU.
+//
+
+static void VKAPI_PTR null_DestroyImage( VkDevice device, VkImage image, const VkAllocationCallbacks *pAllocator ) { }
+static void VKAPI_PTR null_DestroyImageView( VkDevice device, VkImageView imageView, const VkAllocationCallbacks *pAllocator ) { }
+static void VKAPI_PTR null_CmdDrawIndexed( VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance ) { }
+
+PFN_vkDestroyImage			qvkDestroyImage = null_DestroyImage;
+PFN_vkDestroyImageView		qvkDestroyImageView = null_DestroyImageView;
+PFN_vkCmdDrawIndexed		qvkCmdDrawIndexed = null_CmdDrawIndexed;
+
+
+/*
+** platform layer replacements, no window is ever created
+*/
+void NullImp_Init( glconfig_t *config )
+{
+	int width, height;
+
+	width = ri.Cvar_VariableIntegerValue( "r_customwidth" );
+	height = ri.Cvar_VariableIntegerValue( "r_customheight" );
+	if ( width <= 0 || height <= 0 ) {
+		width = 640;
+		height = 480;
+	}
+
+	config->vidWidth = width;
+	config->vidHeight = height;
+	config->windowAspect = (float)width / (float)height;
+	config->colorBits = 32;
+	config->depthBits = 24;
+	config->stencilBits = 8;
+	config->displayFrequency = 0;
+	config->isFullscreen = qfalse;
+	config->stereoEnabled = qfalse;
+}
+
+
+void NullImp_Shutdown( qboolean unloadDLL )
+{
+}
+
+
+void NullImp_InitGamma( glconfig_t *config )
+{
+	config->deviceSupportsGamma = qfalse;
+}
+
+
+void NullImp_SetGamma( unsigned char red[256], unsigned char green[256], unsigned char blue[256] )
+{
+}
+
+
+void vk_initialize( void )
+{
+	Com_Memset( &vk, 0, sizeof( vk ) );
+
+	vk.cmd = vk.tess + 0;
+	vk.renderWidth = glConfig.vidWidth;
+	vk.renderHeight = glConfig.vidHeight;
+
+	glConfig.maxTextureSize = MAX_TEXTURE_SIZE;
+	glConfig.numTextureUnits = MAX_TEXTURE_UNITS;
+	glConfig.textureEnvAddAvailable = qtrue;
+	glConfig.textureCompression = TC_NONE;
+
+	Q_strncpyz( glConfig.vendor_string, "none", sizeof( glConfig.vendor_string ) );
+	Q_strncpyz( glConfig.renderer_string, "null renderer", sizeof( glConfig.renderer_string ) );
+	Q_strncpyz( glConfig.version_string, "API: none", sizeof( glConfig.version_string ) );
+	glConfig.extensions_string[0] = '\0';
+
+	vk.maxLod = 1 + Q_log2( glConfig.maxTextureSize );
+
+	vk.active = qtrue;
+}
+
+
+void vk_init_descriptors( void ) { }
+
+
+void vk_shutdown( void )
+{
+	Com_Memset( &vk, 0, sizeof( vk ) );
+}
+
+
+void vk_release_resources( void )
+{
+	vk.pipelines_count = 0;
+	vk.pipelines_world_base = 0;
+}
+
+
+void vk_wait_idle( void ) { }
+
+
+void vk_create_image( int width, int height, VkFormat format, int mip_levels, image_t *image )
+{
+	image->handle = VK_NULL_HANDLE;
+	image->view = VK_NULL_HANDLE;
+	image->descriptor = VK_NULL_HANDLE;
+}
+
+
+void vk_upload_image_data( VkImage image, int x, int y, int width, int height, qboolean mipmap, const uint8_t *pixels, int bytes_per_pixel ) { }
+void vk_update_descriptor_set( image_t *image, qboolean mipmap ) { }
+
+
+uint32_t vk_find_pipeline_ext( uint32_t base, const Vk_Pipeline_Def *def, qboolean use )
+{
+	return 0;
+}
+
+
+void vk_begin_pipeline_batch( void ) { }
+void vk_finish_pipeline_batch( void ) { }
+
+
+void vk_get_pipeline_def( uint32_t pipeline, Vk_Pipeline_Def *def )
+{
+	Com_Memset( def, 0, sizeof( *def ) );
+}
+
+
+void vk_create_pipelines( void ) { }
+void vk_update_post_process_pipelines( void ) { }
+
+
+// world geometry stays in system memory, the VBO layout is still built
+qboolean vk_alloc_vbo( const byte *vbo_data, int vbo_size )
+{
+	return qtrue;
+}
+
+
+const char *vk_format_string( VkFormat format )
+{
+	return "none";
+}
+
+
+//
+// back end entry points, never reached since render commands are not executed
+//
+void vk_clear_color( const vec4_t color ) { }
+void vk_clear_depth( qboolean clear_stencil ) { }
+void vk_begin_frame( void ) { }
+void vk_end_frame( void ) { }
+void vk_end_render_pass( void ) { }
+void vk_begin_main_render_pass( void ) { }
+void vk_bind_pipeline( uint32_t pipeline ) { }
+void vk_bind_index( void ) { }
+void vk_bind_index_ext( const int numIndexes, const uint32_t *indexes ) { }
+void vk_bind_geometry( uint32_t flags ) { }
+void vk_bind_lighting( int stage, int bundle ) { }
+void vk_draw_geometry( Vk_Depth_Range depth_range, qboolean indexed ) { }
+void vk_update_mvp( const float *m ) { }
+void vk_bind_index_buffer( VkBuffer buffer, uint32_t offset ) { }
+void vk_reset_descriptor( int index ) { }
+void vk_update_descriptor( int index, VkDescriptorSet descriptor ) { }
+void vk_update_descriptor_offset( int index, uint32_t offset ) { }
+
+
+uint32_t vk_tess_index( uint32_t numIndexes, const void *src )
+{
+	return 0;
+}
+
+
+qboolean vk_bloom( void )
+{
+	return qfalse;
+}
+
+
+void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
+{
+	Com_Memset( buffer, 0, width * height * 3 );
+}
+
+
+int vk_readback_begin( uint32_t width, uint32_t height )
+{
+	return -1;
+}
+
+
+qboolean vk_readback_queued( int slot )
+{
+	return qfalse;
+}
+
+
+int vk_readback_next( qboolean wait )
+{
+	return -1;
+}
+
+
+void vk_readback_read( int slot, byte *buffer ) { }
+
+#endif // USE_NULL_RENDERER
@@ -86,6 +86,11 @@ typedef struct vbo_s {
 	int *items_queue;
 	int items_queue_count;
 
+	// build state, filled while map images are processed
+	msurface_t **surf_list;
+	int surf_count;
+	const char *error;
+
 } vbo_t;
 
 static vbo_t world_vbo;
@@ -341,13 +346,15 @@ static void VBO_AddGeometry( vbo_t *vbo, vbo_item_t *vi, shaderCommands_t *input
 	offs = input->shader->iboOffset + input->shader->curIndexes * sizeof( input->indexes[0] );
 	size = input->numIndexes * sizeof( input->indexes[ 0 ] );
 	if ( offs + size > vbo->vbo_size ) {
-		ri.Error( ERR_DROP, "Index0 overflow" );
+		vbo->error = "Index0 overflow";
+		return;
 	}
 	memcpy( vbo->vbo_buffer + offs, input->indexes, size );
 
 	// fill soft buffer too
 	if ( vbo->ibo_offset + size > vbo->ibo_size ) {
-		ri.Error( ERR_DROP, "Index1 overflow" );
+		vbo->error = "Index1 overflow";
+		return;
 	}
 	memcpy( vbo->ibo_buffer + vbo->ibo_offset, input->indexes, size );
 	vbo->ibo_offset += size;
@@ -357,7 +364,8 @@ static void VBO_AddGeometry( vbo_t *vbo, vbo_item_t *vi, shaderCommands_t *input
 	offs = input->shader->vboOffset + input->shader->curVertexes * sizeof( input->xyz[0] );
 	size = input->numVertexes * sizeof( input->xyz[ 0 ] );
 	if ( offs + size > vbo->vbo_size ) {
-		ri.Error( ERR_DROP, "Vertex overflow" );
+		vbo->error = "Vertex overflow";
+		return;
 	}
 	//Com_Printf( "v offs=%i size=%i\n", offs, size );
 	memcpy( vbo->vbo_buffer + offs, input->xyz, size );
@@ -366,7 +374,8 @@ static void VBO_AddGeometry( vbo_t *vbo, vbo_item_t *vi, shaderCommands_t *input
 	offs = input->shader->normalOffset + input->shader->curVertexes * sizeof( input->normal[0] );
 	size = input->numVertexes * sizeof( input->normal[ 0 ] );
 	if ( offs + size > vbo->vbo_size ) {
-		ri.Error( ERR_DROP, "Normals overflow" );
+		vbo->error = "Normals overflow";
+		return;
 	}
 	//Com_Printf( "v offs=%i size=%i\n", offs, size );
 	memcpy( vbo->vbo_buffer + offs, input->normal, size );
@@ -401,7 +410,12 @@ void VBO_PushData( int itemIndex, shaderCommands_t *input )
 	vbo_item_t *vi = vbo->items + itemIndex;
 	int i;
 
+	if ( vbo->error )
+		return;
+
 	VBO_AddGeometry( vbo, vi, input );
+	if ( vbo->error )
+		return;
 
 	for ( i = 0; i < MAX_VBO_STAGES; i++ )
 	{
@@ -475,6 +489,197 @@ static void initItem( vbo_item_t *item )
 }
 
 
+/*
+=============
+VBO_FillJob
+
+Tesselates sorted static surfaces and stores their data in the VBO.
+Runs on the main thread while workers process queued map images, so
+failures are reported in vbo->error instead of raising an error with
+jobs in flight.
+=============
+*/
+static void VBO_FillJob( void *arg )
+{
+	vbo_t *vbo = (vbo_t *)arg;
+	msurface_t *sf;
+	srfSurfaceFace_t *face;
+	srfTriangles_t *tris;
+	srfGridMesh_t *grid;
+	int i;
+
+	tess.numIndexes = 0;
+	tess.numVertexes = 0;
+
+	Com_Memset( &backEnd.viewParms, 0, sizeof( backEnd.viewParms ) );
+	backEnd.currentEntity = &tr.worldEntity;
+
+	for ( i = 0; i < vbo->surf_count && !vbo->error; i++ )
+	{
+		sf = vbo->surf_list[ i ];
+		face = (srfSurfaceFace_t *) sf->data;
+		tris = (srfTriangles_t *) sf->data;
+		grid = (srfGridMesh_t *) sf->data;
+		if ( face->surfaceType == SF_FACE )
+			face->vboItemIndex = i + 1;
+		else if ( tris->surfaceType == SF_TRIANGLES ) {
+			tris->vboItemIndex = i + 1;
+		} else {
+			grid->vboItemIndex = i + 1;
+		}
+		initItem( vbo->items + i + 1 );
+		RB_BeginSurface( sf->shader, 0 );
+		tess.allowVBO = qfalse; // block execution of VBO path as we need to tesselate geometry
+#ifdef USE_TESS_NEEDS_NORMAL
+		tess.needsNormal = qtrue;
+#endif
+#ifdef USE_TESS_NEEDS_ST2
+		tess.needsST2 = qtrue;
+#endif
+		// tesselate
+		rb_surfaceTable[ *sf->data ]( sf->data ); // VBO_PushData() may be called multiple times there
+		// setup colors and texture coordinates
+		VBO_PushData( i + 1, &tess );
+		if ( grid->surfaceType == SF_GRID ) {
+			vbo_item_t *vi = vbo->items + i + 1;
+			if ( vi->num_vertexes != grid->vboExpectVertices || vi->num_indexes != grid->vboExpectIndices ) {
+				vbo->error = "Unexpected grid vertexes/indexes count";
+			}
+		}
+		tess.numIndexes = 0;
+		tess.numVertexes = 0;
+	}
+}
+
+
+typedef struct {
+	uint32_t	offset;
+	uint32_t	size;
+	int			shared;		// index of the first identical stream
+	uint32_t	newOffset;
+} vboStream_t;
+
+
+static int shaderOffsetSortFunc( const void *a, const void *b )
+{
+	return (*(const shader_t **)a)->iboOffset - (*(const shader_t **)b)->iboOffset;
+}
+
+
+static uint32_t VBO_RemapOffset( const vboStream_t *streams, int count, uint32_t offset )
+{
+	int i;
+
+	for ( i = 0; i < count; i++ ) {
+		if ( streams[i].offset == offset ) {
+			return streams[ streams[i].shared ].newOffset;
+		}
+	}
+
+	return offset; // not a stream, left as is
+}
+
+
+/*
+=============
+VBO_ShareStreams
+
+Stages of a shader often compute identical colors or texture coordinates,
+e.g. lightmap coordinates or identity colors. Such streams are stored once
+and the buffer is compacted in place, returns its new size.
+=============
+*/
+static int VBO_ShareStreams( vbo_t *vbo )
+{
+	vboStream_t streams[ MAX_VBO_STAGES * NUM_TEXTURE_BUNDLES * 2 ];
+	shaderStage_t *pStage;
+	shader_t **list, *sh;
+	uint32_t offs, dst, headSize;
+	int numShaders, numStreams;
+	int i, j, k, b;
+
+	list = ri.Hunk_AllocateTempMemory( tr.numShaders * sizeof( shader_t * ) );
+
+	for ( i = 0, numShaders = 0; i < tr.numShaders; i++ ) {
+		if ( tr.shaders[ i ]->isStaticShader && tr.shaders[ i ]->iboOffset != -1 ) {
+			list[ numShaders++ ] = tr.shaders[ i ];
+		}
+	}
+
+	// process in buffer order so that data only moves down
+	qsort( list, numShaders, sizeof( list[0] ), shaderOffsetSortFunc );
+
+	dst = 0;
+	for ( i = 0; i < numShaders; i++ ) {
+		sh = list[ i ];
+
+		// collect streams in allocation order, see VBO_AddGeometry()
+		numStreams = 0;
+		for ( j = 0; j < MAX_VBO_STAGES; j++ ) {
+			pStage = sh->stages[ j ];
+			if ( !pStage )
+				break;
+			for ( b = 0; b < NUM_TEXTURE_BUNDLES; b++ ) {
+				if ( pStage->tessFlags & ( TESS_RGBA0 << b ) ) {
+					streams[ numStreams ].offset = pStage->rgb_offset[ b ];
+					streams[ numStreams ].size = sh->numVertexes * sizeof( color4ub_t );
+					numStreams++;
+				}
+			}
+			for ( b = 0; b < NUM_TEXTURE_BUNDLES; b++ ) {
+				if ( pStage->tessFlags & ( TESS_ST0 << b ) ) {
+					streams[ numStreams ].offset = pStage->tex_offset[ b ];
+					streams[ numStreams ].size = sh->numVertexes * sizeof( vec2_t );
+					numStreams++;
+				}
+			}
+		}
+
+		// indexes, xyz and normals are kept as is
+		headSize = sh->normalOffset + sh->numVertexes * sizeof( tess.normal[0] ) - sh->iboOffset;
+		memmove( vbo->vbo_buffer + dst, vbo->vbo_buffer + sh->iboOffset, headSize );
+		offs = dst;
+		dst += headSize;
+
+		for ( j = 0; j < numStreams; j++ ) {
+			streams[ j ].shared = j;
+			for ( k = 0; k < j; k++ ) {
+				// colors are never compared with texture coordinates since
+				// a stream of the same size can't be of another kind here
+				if ( streams[ k ].shared == k && streams[ k ].size == streams[ j ].size
+					&& memcmp( vbo->vbo_buffer + streams[ k ].newOffset, vbo->vbo_buffer + streams[ j ].offset, streams[ j ].size ) == 0 ) {
+					streams[ j ].shared = k;
+					break;
+				}
+			}
+			if ( streams[ j ].shared == j ) {
+				memmove( vbo->vbo_buffer + dst, vbo->vbo_buffer + streams[ j ].offset, streams[ j ].size );
+				streams[ j ].newOffset = dst;
+				dst += streams[ j ].size;
+			}
+		}
+
+		for ( j = 0; j < MAX_VBO_STAGES; j++ ) {
+			pStage = sh->stages[ j ];
+			if ( !pStage )
+				break;
+			for ( b = 0; b < NUM_TEXTURE_BUNDLES; b++ ) {
+				pStage->rgb_offset[ b ] = VBO_RemapOffset( streams, numStreams, pStage->rgb_offset[ b ] );
+				pStage->tex_offset[ b ] = VBO_RemapOffset( streams, numStreams, pStage->tex_offset[ b ] );
+			}
+		}
+
+		sh->vboOffset += offs - sh->iboOffset;
+		sh->normalOffset += offs - sh->iboOffset;
+		sh->iboOffset = offs;
+	}
+
+	ri.Hunk_FreeTempMemory( list );
+
+	return PAD( dst, 32 );
+}
+
+
 void R_BuildWorldVBO( msurface_t *surf, int surfCount )
 {
 	vbo_t *vbo = &world_vbo;
@@ -483,6 +688,7 @@ void R_BuildWorldVBO( msurface_t *surf, int surfCount )
 	srfTriangles_t *tris;
 	srfGridMesh_t *grid;
 	msurface_t *sf;
+	int64_t startTime;
 	int ibo_size;
 	int vbo_size;
 	int i, n;
@@ -501,6 +707,7 @@ void R_BuildWorldVBO( msurface_t *surf, int surfCount )
 
 	VBO_Cleanup();
 
+	startTime = ri.Microseconds();
 	vbo_size = 0;
 
 	// initial scan to count surfaces/indexes/vertexes for memory allocation
@@ -607,54 +814,38 @@ void R_BuildWorldVBO( msurface_t *surf, int surfCount )
 	// sort surfaces by shader
 	qsort( surfList, numStaticSurfaces, sizeof( surfList[0] ), surfSortFunc );
 
-	tess.numIndexes = 0;
-	tess.numVertexes = 0;
-
-	Com_Memset( &backEnd.viewParms, 0, sizeof( backEnd.viewParms ) );
-	backEnd.currentEntity = &tr.worldEntity;
-
-	for ( i = 0; i < numStaticSurfaces; i++ )
-	{
-		sf = surfList[ i ];
-		face = (srfSurfaceFace_t *) sf->data;
-		tris = (srfTriangles_t *) sf->data;
-		grid = (srfGridMesh_t *) sf->data;
-		if ( face->surfaceType == SF_FACE )
-			face->vboItemIndex = i + 1;
-		else if ( tris->surfaceType == SF_TRIANGLES ) {
-			tris->vboItemIndex = i + 1;
-		} else if ( grid->surfaceType == SF_GRID ){
-			grid->vboItemIndex = i + 1;
-		} else {
-			ri.Error( ERR_DROP, "Unexpected surface type" );
-		}
-		initItem( vbo->items + i + 1 );
-		RB_BeginSurface( sf->shader, 0 );
-		tess.allowVBO = qfalse; // block execution of VBO path as we need to tesselate geometry
-#ifdef USE_TESS_NEEDS_NORMAL
-		tess.needsNormal = qtrue;
-#endif
-#ifdef USE_TESS_NEEDS_ST2
-		tess.needsST2 = qtrue;
-#endif
-		// tesselate
-		rb_surfaceTable[ *sf->data ]( sf->data ); // VBO_PushData() may be called multiple times there
-		// setup colors and texture coordinates
-		VBO_PushData( i + 1, &tess );
-		if ( grid->surfaceType == SF_GRID ) {
-			vbo_item_t *vi = vbo->items + i + 1;
-			if ( vi->num_vertexes != grid->vboExpectVertices || vi->num_indexes != grid->vboExpectIndices ) {
-				ri.Error( ERR_DROP, "Unexpected grid vertexes/indexes count" );
-			}
+	for ( i = 0; i < numStaticSurfaces; i++ ) {
+		switch ( *surfList[ i ]->data ) {
+			case SF_FACE:
+			case SF_TRIANGLES:
+			case SF_GRID:
+				break;
+			default:
+				ri.Error( ERR_DROP, "Unexpected surface type" );
 		}
-		tess.numIndexes = 0;
-		tess.numVertexes = 0;
 	}
 
+	vbo->surf_list = surfList;
+	vbo->surf_count = numStaticSurfaces;
+	vbo->error = NULL;
+
+	// tesselate while queued map images are processed
+	R_RunWithImageBatch( VBO_FillJob, vbo );
+
+	vbo->surf_list = NULL;
 	ri.Hunk_FreeTempMemory( surfList );
 
+	if ( vbo->error ) {
+		ri.Error( ERR_DROP, "%s", vbo->error );
+	}
+
+	vbo_size = VBO_ShareStreams( vbo );
+
 //__fail:
-	vk_alloc_vbo( vbo->vbo_buffer, vbo->vbo_size );
+	vk_alloc_vbo( vbo->vbo_buffer, vbo_size );
+
+	ri.Printf( PRINT_ALL, "...world VBO: %i KB (%i KB before sharing stage streams), built in %i msec\n",
+		vbo_size / 1024, vbo->vbo_offset / 1024, (int)( ( ri.Microseconds() - startTime ) / 1000 ) );
 
 	//if ( err == GL_OUT_OF_MEMORY )
 	//	ri.Printf( PRINT_WARNING, "%s: out of memory\n", __func__ );
@@ -173,6 +173,34 @@ struct leakyBucket_s {
 	leakyBucket_t *prev, *next;
 };
 
+// file served over UDP, mapped once and shared by all clients downloading it,
+// blocks are copied with Sys_ReadMappedFile which fails instead of raising
+// SIGBUS on a file truncated in place, downloads stop when the file changes
+typedef struct svDownloadFile_s {
+	char		name[MAX_QPATH];
+	const byte	*data;
+	int			size;
+	fileTime_t	mtime;
+	qboolean	changed;			// modified on disk since it was mapped
+	int			refCount;
+	int			lastUsed;			// svs.time of the last release
+} svDownloadFile_t;
+
+// client commands waiting for the fixed point of the server frame
+#define MAX_INPUT_QUEUE	64	// power of two
+
+typedef struct {
+	usercmd_t	cmds[MAX_INPUT_QUEUE];
+	int			releaseTime[MAX_INPUT_QUEUE];	// Sys_Milliseconds()
+	int			head;
+	int			count;
+	int			lastTime;			// serverTime of the last queued command
+	qboolean	windowStarted;		// arrival delay tracking, see SV_InputLateness
+	int			windowStart;
+	int			windowMin;
+	int			prevWindowMin;
+} inputQueue_t;
+
 
 typedef struct client_s {
 	clientState_t	state;
@@ -188,6 +216,9 @@ typedef struct client_s {
 	int				challenge;
 
 	usercmd_t		lastUsercmd;
+	inputQueue_t	input;
+	int64_t			inputLateness;		// msec behind the earliest arrival of all commands, for metrics
+	int				inputCommands;
     int             lastMessageNum;         // for delta compression
 	int				lastClientCommand;	// reliable client message sequence
 	char			lastClientCommandString[MAX_STRING_CHARS];
@@ -196,14 +227,12 @@ typedef struct client_s {
 
 	// downloading
 	char			downloadName[MAX_QPATH]; // if not empty string, we are downloading
-	fileHandle_t	download;			// file being downloaded
+	svDownloadFile_t *download;			// file being downloaded
  	int				downloadSize;		// total bytes (can't use EOF because of paks)
  	int				downloadCount;		// bytes sent
 	int				downloadClientBlock;	// last block we sent to the client, awaiting ack
 	int				downloadCurrentBlock;	// current block number
 	int				downloadXmitBlock;	// last block we xmited
-	unsigned char	*downloadBlocks[MAX_DOWNLOAD_WINDOW];	// the buffers for the download blocks
-	int				downloadBlockSize[MAX_DOWNLOAD_WINDOW];
 	qboolean		downloadEOF;		// We have sent the EOF block
 	int				downloadSendTime;	// time we last got an ack from the client
 
@@ -212,6 +241,12 @@ typedef struct client_s {
 	int				lastConnectTime;	// svs.time when connection started
 	int				lastDisconnectTime;
 	int				lastSnapshotTime;	// svs.time of last sent snapshot
+	int64_t			snapshotBytes;		// size of all sent snapshots, for metrics
+	int				snapshotCount;
+	byte			entityDefer[MAX_GENTITIES];	// snapshots in a row an entity update was deferred
+	int				numDeferredEntities;		// entities with entityDefer set
+	int64_t			deferredEntities;			// deferred entity updates, for metrics
+	int				deferredSnapshots;			// snapshots with deferred updates
 	qboolean		rateDelayed;		// true if nextSnapshotTime was set based on rate instead of snapshotMsec
 	int				timeoutCount;		// must timeout a few frames in a row so debugging doesn't break
 	clientSnapshot_t	frames[PACKET_BACKUP];	// updates can be delta'd from here
@@ -386,6 +421,9 @@ extern	cvar_t	*sv_gametype;
 extern	cvar_t	*sv_pure;
 extern	cvar_t	*sv_floodProtect;
 extern	cvar_t	*sv_lanForceRate;
+extern	cvar_t	*sv_snapshotPriority;
+extern	cvar_t	*sv_inputQueue;
+extern	cvar_t	*sv_inputJitter;
 extern	cvar_t	*sv_strictAuth;
 
 extern	cvar_t *sv_levelTimeReset;
@@ -464,8 +502,10 @@ void SV_Auth_DropClient( client_t *drop, const char *reason, const char *message
 
 qboolean SV_ExecuteClientCommand( client_t *cl, const char *s );
 void SV_ClientThink( client_t *cl, usercmd_t *cmd );
+void SV_RunInputQueues( void );
 
 int SV_SendDownloadMessages( void );
+void SV_FreeDownloadFiles( void );
 int SV_SendQueuedMessages( void );
 
 void SV_FreeIP4DB( void );
@@ -602,6 +642,39 @@ int SV_Netchan_TransmitNextFragment( client_t *client );
 qboolean SV_Netchan_Process( client_t *client, msg_t *msg );
 void SV_Netchan_FreeQueue( client_t *client );
 
+//
+// sv_metrics.c
+//
+#define MAX_METRICS_BOUNDS 10
+
+typedef struct {
+	const int	*bounds;		// upper bucket bounds, ascending
+	int			numBounds;
+	int64_t		buckets[ MAX_METRICS_BOUNDS + 1 ];	// last one is +Inf
+	int64_t		sum;
+	int64_t		count;
+} metricsHistogram_t;
+
+typedef struct {
+	metricsHistogram_t	frameTime;		// usec
+	metricsHistogram_t	gameFrameTime;	// usec
+	metricsHistogram_t	snapshotSize;	// bytes
+	metricsHistogram_t	inputLateness;	// msec
+	int64_t		packetsReceived;
+	int64_t		bytesReceived;
+	int64_t		rateLimitDrops;
+	int64_t		downloadBytes;
+} serverMetrics_t;
+
+extern serverMetrics_t sv_metrics;
+
+extern	cvar_t	*sv_metricsPort;
+extern	cvar_t	*sv_metricsAddress;
+
+void SV_MetricsInit( void );
+void SV_MetricsFrame( void );
+void SV_MetricsObserve( metricsHistogram_t *h, int value );
+
 //
 // sv_filter.c
 //
@@ -472,6 +472,10 @@ int SV_BotLibSetup( void ) {
 		return -1;
 	}
 
+	// not passed by game modules
+	botlib_export->BotLibVarSet( "precomputeroutingcache", Cvar_VariableString( "bot_precomputeRouting" ) );
+	botlib_export->BotLibVarSet( "max_routingcache", Cvar_VariableString( "bot_maxRoutingCache" ) );
+
 	return botlib_export->BotLibSetup();
 }
 
@@ -511,6 +515,8 @@ void SV_BotInitCvars(void) {
 	Cvar_Get("bot_forcewrite", "0", 0);					//force writing aas file
 	Cvar_Get("bot_aasoptimize", "0", 0);				//no aas file optimisation
 	Cvar_Get("bot_saveroutingcache", "0", 0);			//save routing cache
+	Cvar_Get("bot_precomputeRouting", "0", 0);			//precompute routing cache at map load, 2 = also save it
+	Cvar_Get("bot_maxRoutingCache", "12288", 0);		//routing cache budget in KB
 	Cvar_Get("bot_thinktime", "100", 0);				//msec the bots thinks
 	Cvar_Get("bot_reloadcharacters", "0", 0);			//reload the bot characters each time
 	Cvar_Get("bot_testichat", "0", 0);					//test ichats
@@ -531,6 +537,41 @@ void SV_BotInitCvars(void) {
 	Cvar_Get("bot_interbreedwrite", "", CVAR_CHEAT);	//write interbreeded bots to this file
 }
 
+/*
+==================
+SV_BotRoutingStats_f
+==================
+*/
+static void SV_BotRoutingStats_f( void ) {
+	if ( !botlib_export || !bot_enable ) {
+		Com_Printf( "Bot library is not loaded.\n" );
+		return;
+	}
+
+	botlib_export->BotLibRoutingStats();
+}
+
+
+/*
+==================
+SV_BotChatBench_f
+==================
+*/
+static void SV_BotChatBench_f( void ) {
+	if ( !botlib_export || !bot_enable ) {
+		Com_Printf( "Bot library is not loaded.\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() != 2 ) {
+		Com_Printf( "usage: bot_chatbench <chatlog>\n" );
+		return;
+	}
+
+	botlib_export->BotLibChatBench( Cmd_Argv( 1 ) );
+}
+
+
 /*
 ==================
 SV_BotInitBotLib
@@ -576,8 +617,17 @@ void SV_BotInitBotLib(void) {
 
 	botlib_import.Sys_Milliseconds = Sys_Milliseconds;
 
+	//parallel jobs
+	botlib_import.NumJobThreads = Com_NumJobThreads;
+	botlib_import.RunJobs = Com_RunJobs;
+
 	botlib_export = (botlib_export_t *)GetBotLibAPI( BOTLIB_API_VERSION, &botlib_import );
 	assert(botlib_export); 	// somehow we end up with a zero import.
+
+	Cmd_AddCommand( "bot_routingstats", SV_BotRoutingStats_f );
+	Cmd_SetDescription( "bot_routingstats", "Prints bot routing cache memory use, hits, misses and evictions\nusage: bot_routingstats" );
+	Cmd_AddCommand( "bot_chatbench", SV_BotChatBench_f );
+	Cmd_SetDescription( "bot_chatbench", "Times bot chat matching and synonyms over a chat log with one message per line, with and without compiled match strings\nusage: bot_chatbench <chatlog>" );
 }
 
 
@@ -25,6 +25,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static void SV_CloseDownload( client_t *cl );
 
+#define DOWNLOAD_IDLE_TIME	30000	// msec an unused download mapping is kept
+
+static svDownloadFile_t sv_downloadFiles[ MAX_CLIENTS ];
+
 //
 // Server-side Stateless Challenges
 // backported from https://github.com/JACoders/OpenJK/pull/832
@@ -1194,6 +1198,13 @@ void SV_ClientEnterWorld( client_t *client, usercmd_t *cmd ) {
 	else
 		memset(&client->lastUsercmd, '\0', sizeof(client->lastUsercmd));
 
+	// drop commands queued for the previous gamestate
+	Com_Memset( &client->input, 0, sizeof( client->input ) );
+
+	// and entity updates deferred in it
+	Com_Memset( client->entityDefer, 0, sizeof( client->entityDefer ) );
+	client->numDeferredEntities = 0;
+
 	// call the game begin function
 	VM_Call( gvm, 1, GAME_CLIENT_BEGIN, client - svs.clients );
 }
@@ -1209,30 +1220,110 @@ CLIENT COMMAND EXECUTION
 
 /*
 ==================
-SV_CloseDownload
+SV_OpenDownloadFile
 
-clear/free any download vars
+Returns the shared mapping of a download file, a client holds a single
+reference so there is always a free or idle slot
 ==================
 */
-static void SV_CloseDownload( client_t *cl ) {
+static svDownloadFile_t *SV_OpenDownloadFile( const char *name ) {
+	svDownloadFile_t *file, *slot;
+	fileOffset_t size;
 	int i;
 
-	// EOF
-	if ( cl->download != FS_INVALID_HANDLE ) {
-		FS_FCloseFile( cl->download );
-		cl->download = FS_INVALID_HANDLE;
+	slot = NULL;
+
+	for ( i = 0; i < ARRAY_LEN( sv_downloadFiles ); i++ ) {
+		file = &sv_downloadFiles[ i ];
+		if ( file->data && !file->changed && !strcmp( file->name, name ) ) {
+			file->refCount++;
+			return file;
+		}
+		if ( file->refCount == 0 && ( !slot || ( slot->data && ( !file->data || file->lastUsed < slot->lastUsed ) ) ) ) {
+			slot = file;
+		}
 	}
 
-	*cl->downloadName = '\0';
+	if ( !slot ) {
+		return NULL;
+	}
+
+	if ( slot->data ) {
+		FS_SV_UnmapFile( slot->data, slot->size );
+	}
+
+	Com_Memset( slot, 0, sizeof( *slot ) );
+
+	slot->data = FS_SV_MapFile( name, &slot->size );
+	if ( !slot->data ) {
+		return NULL;
+	}
+
+	FS_SV_FileStats( name, &size, &slot->mtime );
+
+	Q_strncpyz( slot->name, name, sizeof( slot->name ) );
+	slot->refCount = 1;
 
-	// Free the temporary buffer space
-	for (i = 0; i < MAX_DOWNLOAD_WINDOW; i++) {
-		if (cl->downloadBlocks[i]) {
-			Z_Free( cl->downloadBlocks[i] );
-			cl->downloadBlocks[i] = NULL;
+	return slot;
+}
+
+
+/*
+==================
+SV_FreeDownloadFiles
+
+Unmaps download files no client is using
+==================
+*/
+void SV_FreeDownloadFiles( void ) {
+	svDownloadFile_t *file;
+	int i;
+
+	for ( i = 0; i < ARRAY_LEN( sv_downloadFiles ); i++ ) {
+		file = &sv_downloadFiles[ i ];
+		if ( file->data && file->refCount == 0 ) {
+			FS_SV_UnmapFile( file->data, file->size );
+			Com_Memset( file, 0, sizeof( *file ) );
 		}
 	}
+}
+
+
+/*
+==================
+SV_DownloadBlockSize
+
+Blocks are read straight from the mapping, a zero-length block past the end indicates EOF
+==================
+*/
+static int SV_DownloadBlockSize( const client_t *cl, int block ) {
+	int offset = block * MAX_DOWNLOAD_BLKSIZE;
+
+	if ( offset >= cl->downloadSize )
+		return 0;
+
+	return MIN( cl->downloadSize - offset, MAX_DOWNLOAD_BLKSIZE );
+}
+
+
+/*
+==================
+SV_CloseDownload
+
+clear/free any download vars
+==================
+*/
+static void SV_CloseDownload( client_t *cl ) {
+
+	// EOF
+	if ( cl->download ) {
+		// keep the mapping around for other clients
+		cl->download->refCount--;
+		cl->download->lastUsed = svs.time;
+		cl->download = NULL;
+	}
 
+	*cl->downloadName = '\0';
 }
 
 
@@ -1285,7 +1376,7 @@ static void SV_NextDownload_f( client_t *cl )
 		Com_DPrintf( "clientDownload: %d : client acknowledge of block %d\n", (int) (cl - svs.clients), block );
 
 		// Find out if we are done.  A zero-length block indicates EOF
-		if (cl->downloadBlockSize[cl->downloadClientBlock % MAX_DOWNLOAD_WINDOW] == 0) {
+		if ( SV_DownloadBlockSize( cl, cl->downloadClientBlock ) == 0 ) {
 			Com_Printf( "clientDownload: %d : file \"%s\" completed\n", (int) (cl - svs.clients), cl->downloadName );
 			SV_CloseDownload( cl );
 			return;
@@ -1328,15 +1419,16 @@ Fill up msg with data, return number of download blocks added
 */
 static int SV_WriteDownloadToClient( client_t *cl )
 {
-	int curindex;
+	int curindex, blockSize;
 	int unreferenced = 1;
 	char errorMessage[1024];
 	char pakbuf[MAX_QPATH], *pakptr;
 	int numRefPaks;
 	msg_t msg;
 	byte msgBuffer[MAX_DOWNLOAD_BLKSIZE*2+8];
+	byte block[MAX_DOWNLOAD_BLKSIZE];
 
-	if ( cl->download == FS_INVALID_HANDLE ) {
+	if ( !cl->download ) {
 		qboolean idPack = qfalse;
 		qboolean missionPack = qfalse;
  		// Chop off filename extension.
@@ -1372,13 +1464,11 @@ static int SV_WriteDownloadToClient( client_t *cl )
 			}
 		}
 
-		cl->download = FS_INVALID_HANDLE;
-
 		// We open the file here
 		if ( !(sv_allowDownload->integer & DLF_ENABLE) ||
 			(sv_allowDownload->integer & DLF_NO_UDP) ||
 			idPack || unreferenced ||
-			( cl->downloadSize = FS_SV_FOpenFileRead( cl->downloadName, &cl->download ) ) < 0 ) {
+			( cl->download = SV_OpenDownloadFile( cl->downloadName ) ) == NULL ) {
 
 			// cannot auto-download file
 			if(unreferenced)
@@ -1430,42 +1520,30 @@ static int SV_WriteDownloadToClient( client_t *cl )
 
 			*cl->downloadName = '\0';
 
-			if ( cl->download != FS_INVALID_HANDLE ) {
-				FS_FCloseFile( cl->download );
-				cl->download = FS_INVALID_HANDLE;
-			}
-
 			return 1;
 		}
 
 		Com_Printf( "clientDownload: %d : beginning \"%s\"\n", (int) (cl - svs.clients), cl->downloadName );
 
 		// Init
+		cl->downloadSize = cl->download->size;
 		cl->downloadCurrentBlock = cl->downloadClientBlock = cl->downloadXmitBlock = 0;
 		cl->downloadCount = 0;
 		cl->downloadEOF = qfalse;
 	}
 
-	// Perform any reads that we need to
+	// the mapping may not be backed by the file anymore
+	if ( cl->download->changed ) {
+		Com_Printf( "clientDownload: %d : \"%s\" changed on server\n", (int) (cl - svs.clients), cl->downloadName );
+		SV_DropClient( cl, "download file changed on server" );
+		return 0;
+	}
+
+	// Advance the window, blocks need no reads
 	while (cl->downloadCurrentBlock - cl->downloadClientBlock < MAX_DOWNLOAD_WINDOW &&
 		cl->downloadSize != cl->downloadCount) {
 
-		curindex = (cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW);
-
-		if (!cl->downloadBlocks[curindex])
-			cl->downloadBlocks[curindex] = Z_Malloc( MAX_DOWNLOAD_BLKSIZE );
-
-		cl->downloadBlockSize[curindex] = FS_Read( cl->downloadBlocks[curindex], MAX_DOWNLOAD_BLKSIZE, cl->download );
-
-		if (cl->downloadBlockSize[curindex] < 0) {
-			// EOF right now
-			cl->downloadCount = cl->downloadSize;
-			break;
-		}
-
-		cl->downloadCount += cl->downloadBlockSize[curindex];
-
-		// Load in next block
+		cl->downloadCount += SV_DownloadBlockSize( cl, cl->downloadCurrentBlock );
 		cl->downloadCurrentBlock++;
 	}
 
@@ -1474,7 +1552,6 @@ static int SV_WriteDownloadToClient( client_t *cl )
 		!cl->downloadEOF &&
 		cl->downloadCurrentBlock - cl->downloadClientBlock < MAX_DOWNLOAD_WINDOW) {
 
-		cl->downloadBlockSize[cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW] = 0;
 		cl->downloadCurrentBlock++;
 
 		cl->downloadEOF = qtrue;  // We have added the EOF block
@@ -1495,7 +1572,15 @@ static int SV_WriteDownloadToClient( client_t *cl )
 	}
 
 	// Send current block
-	curindex = (cl->downloadXmitBlock % MAX_DOWNLOAD_WINDOW);
+	blockSize = SV_DownloadBlockSize( cl, cl->downloadXmitBlock );
+
+	// the file may have been truncated since the last check
+	if ( blockSize > 0 && !Sys_ReadMappedFile( block, cl->download->data + cl->downloadXmitBlock * MAX_DOWNLOAD_BLKSIZE, blockSize ) ) {
+		cl->download->changed = qtrue;
+		Com_Printf( "clientDownload: %d : \"%s\" changed on server\n", (int) (cl - svs.clients), cl->downloadName );
+		SV_DropClient( cl, "download file changed on server" );
+		return 0;
+	}
 
 	MSG_Init( &msg, msgBuffer, sizeof( msgBuffer ) - 8 );
 	MSG_WriteLong( &msg, cl->lastClientCommand );
@@ -1507,15 +1592,17 @@ static int SV_WriteDownloadToClient( client_t *cl )
 	if ( cl->downloadXmitBlock == 0 )
 		MSG_WriteLong( &msg, cl->downloadSize );
 
-	MSG_WriteShort( &msg, cl->downloadBlockSize[curindex] );
+	MSG_WriteShort( &msg, blockSize );
 
 	// Write the block
-	if ( cl->downloadBlockSize[curindex] > 0 )
-		MSG_WriteData( &msg, cl->downloadBlocks[curindex], cl->downloadBlockSize[curindex] );
+	if ( blockSize > 0 )
+		MSG_WriteData( &msg, block, blockSize );
 
 	MSG_WriteByte( &msg, svc_EOF );
 	SV_Netchan_Transmit( cl, &msg );
 
+	sv_metrics.downloadBytes += blockSize;
+
 	Com_DPrintf( "clientDownload: %d : writing block %d\n", (int) (cl - svs.clients), cl->downloadXmitBlock );
 
 	// Move on to the next block
@@ -1571,6 +1658,20 @@ int SV_SendDownloadMessages( void )
 {
 	int i, numDLs = 0;
 	client_t *cl;
+	svDownloadFile_t *file;
+	fileOffset_t size;
+	fileTime_t mtime;
+
+	// check files in use before reading from their mappings
+	for ( i = 0; i < ARRAY_LEN( sv_downloadFiles ); i++ )
+	{
+		file = &sv_downloadFiles[ i ];
+		if ( file->data && file->refCount && !file->changed )
+		{
+			if ( !FS_SV_FileStats( file->name, &size, &mtime ) || size != file->size || mtime != file->mtime )
+				file->changed = qtrue;
+		}
+	}
 
 	for( i = 0; i < sv_maxclients->integer; i++ )
 	{
@@ -1581,6 +1682,17 @@ int SV_SendDownloadMessages( void )
 		}
 	}
 
+	// drop mappings that are not used anymore
+	for ( i = 0; i < ARRAY_LEN( sv_downloadFiles ); i++ )
+	{
+		file = &sv_downloadFiles[ i ];
+		if ( file->data && file->refCount == 0 && svs.time - file->lastUsed > DOWNLOAD_IDLE_TIME )
+		{
+			FS_SV_UnmapFile( file->data, file->size );
+			Com_Memset( file, 0, sizeof( *file ) );
+		}
+	}
+
 	return numDLs;
 }
 
@@ -2196,6 +2308,155 @@ void SV_ClientThink (client_t *cl, usercmd_t *cmd) {
 }
 
 
+/*
+===========================================================================
+
+INPUT QUEUE
+
+With sv_inputQueue 1 client commands are not run when their packet
+arrives but queued and run from SV_Frame before the game frame, so a
+burst after packet loss doesn't execute mid-frame. Commands which arrive
+on time are held up to sv_inputJitter msec to even out network jitter,
+late ones are released on the next frame.
+
+===========================================================================
+*/
+
+#define INPUT_WINDOW_MSEC	1000
+
+/*
+==================
+SV_InputLateness
+
+Returns how many msec a command arrived later than the earliest
+command of the last one or two seconds, relative to its serverTime
+==================
+*/
+static int SV_InputLateness( client_t *cl, const usercmd_t *cmd, int now ) {
+	inputQueue_t *q = &cl->input;
+	int delay, base;
+
+	delay = now - cmd->serverTime;
+
+	if ( !q->windowStarted ) {
+		q->windowStarted = qtrue;
+		q->windowStart = now;
+		q->windowMin = delay;
+		q->prevWindowMin = delay;
+	} else if ( now - q->windowStart >= INPUT_WINDOW_MSEC ) {
+		q->windowStart = now;
+		q->prevWindowMin = q->windowMin;
+		q->windowMin = delay;
+	} else if ( delay - q->windowMin < 0 ) {
+		q->windowMin = delay;
+	}
+
+	base = ( q->windowMin - q->prevWindowMin < 0 ) ? q->windowMin : q->prevWindowMin;
+
+	return delay - base;
+}
+
+
+/*
+==================
+SV_RunInputQueue
+
+Runs commands which are due or all of them
+==================
+*/
+static void SV_RunInputQueue( client_t *cl, int now, qboolean all ) {
+	inputQueue_t *q = &cl->input;
+	usercmd_t *cmd;
+
+	while ( q->count && ( all || q->releaseTime[ q->head ] - now <= 0 ) ) {
+		cmd = &q->cmds[ q->head ];
+		q->head = ( q->head + 1 ) & ( MAX_INPUT_QUEUE - 1 );
+		q->count--;
+		SV_ClientThink( cl, cmd );
+		if ( cl->state != CS_ACTIVE ) {
+			// kicked by the game
+			q->count = 0;
+			break;
+		}
+	}
+}
+
+
+/*
+==================
+SV_QueueUsercmd
+==================
+*/
+static void SV_QueueUsercmd( client_t *cl, const usercmd_t *cmd, int now, int lateness ) {
+	inputQueue_t *q = &cl->input;
+	int index, release, prev;
+
+	if ( q->count == MAX_INPUT_QUEUE ) {
+		// full, run the oldest one now
+		cl->input.releaseTime[ q->head ] = now;
+		SV_RunInputQueue( cl, now, qfalse );
+		if ( cl->state != CS_ACTIVE ) {
+			return;
+		}
+	}
+
+	// on time commands wait up to sv_inputJitter msec, late ones don't wait
+	release = now + sv_inputJitter->integer - lateness;
+	if ( release - now < 0 ) {
+		release = now;
+	}
+
+	// keep the order
+	if ( q->count ) {
+		prev = q->releaseTime[ ( q->head + q->count - 1 ) & ( MAX_INPUT_QUEUE - 1 ) ];
+		if ( release - prev < 0 ) {
+			release = prev;
+		}
+	}
+
+	index = ( q->head + q->count ) & ( MAX_INPUT_QUEUE - 1 );
+	q->cmds[ index ] = *cmd;
+	q->releaseTime[ index ] = release;
+	q->count++;
+	q->lastTime = cmd->serverTime;
+}
+
+
+/*
+==================
+SV_RunInputQueues
+
+Called from SV_Frame before the game frame, runs the due commands
+of all clients in one batch
+==================
+*/
+void SV_RunInputQueues( void ) {
+	client_t *cl;
+	qboolean all;
+	int i, now;
+
+	if ( !svs.clients ) {
+		return;
+	}
+
+	now = Sys_Milliseconds();
+
+	// commands left when the queue got disabled
+	all = sv_inputQueue->integer ? qfalse : qtrue;
+
+	for ( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ ) {
+		if ( !cl->input.count ) {
+			continue;
+		}
+		if ( cl->state != CS_ACTIVE ) {
+			cl->input.count = 0;
+			continue;
+		}
+		SV_RunInputQueue( cl, now, all );
+	}
+}
+
+
 /*
 ==================
 SV_UserMove
@@ -2211,6 +2472,7 @@ each of the backup packets.
 static void SV_UserMove( client_t *cl, msg_t *msg, qboolean delta ) {
 	int			i, key;
 	int			cmdCount;
+	int			now, lateness;
 	static const usercmd_t nullcmd = { 0 };
 	usercmd_t	cmds[MAX_PACKET_USERCMDS], *cmd;
 	const usercmd_t *oldcmd;
@@ -2278,6 +2540,16 @@ static void SV_UserMove( client_t *cl, msg_t *msg, qboolean delta ) {
 		return;
 	}
 
+	now = Sys_Milliseconds();
+
+	// the queue was disabled, run what is left first
+	if ( !sv_inputQueue->integer && cl->input.count ) {
+		SV_RunInputQueue( cl, now, qtrue );
+		if ( cl->state != CS_ACTIVE ) {
+			return;
+		}
+	}
+
 	// usually, the first couple commands will be duplicates
 	// of ones we have previously received, but the servertimes
 	// in the commands will cause them to be immediately discarded
@@ -2296,7 +2568,21 @@ static void SV_UserMove( client_t *cl, msg_t *msg, qboolean delta ) {
 		if ( cmds[i].serverTime - cl->lastUsercmd.serverTime <= 0 ) {
 			continue;
 		}
-		SV_ClientThink( cl, &cmds[ i ] );
+		// or already queued
+		if ( cl->input.count && cmds[i].serverTime - cl->input.lastTime <= 0 ) {
+			continue;
+		}
+
+		lateness = SV_InputLateness( cl, &cmds[ i ], now );
+		cl->inputLateness += lateness;
+		cl->inputCommands++;
+		SV_MetricsObserve( &sv_metrics.inputLateness, lateness );
+
+		if ( sv_inputQueue->integer ) {
+			SV_QueueUsercmd( cl, &cmds[ i ], now, lateness );
+		} else {
+			SV_ClientThink( cl, &cmds[ i ] );
+		}
 	}
 }
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "server.h"
 
 #include "../botlib/botlib.h"
+#include "../botlib/be_aas.h"
 
 botlib_export_t	*botlib_export;
 
@@ -362,6 +363,12 @@ static qboolean SV_GetValue( char* value, int valueSize, const char* key )
 		return qtrue;
 	}
 
+	if ( !Q_stricmp( key, "trap_AAS_QueryBatch_Q3E" ) )
+	{
+		Com_sprintf( value, valueSize, "%i", BOTLIB_AAS_QUERY_BATCH );
+		return qtrue;
+	}
+
 	return qfalse;
 }
 
@@ -604,6 +611,12 @@ static intptr_t SV_GameSystemCalls( intptr_t *args ) {
 	case BOTLIB_AAS_TIME:
 		return FloatAsInt( botlib_export->aas.AAS_Time() );
 
+	case BOTLIB_AAS_QUERY_BATCH:
+		if ( args[2] <= 0 || args[2] > 0x7FFFFFFF / sizeof( aas_query_t ) )
+			return 0;
+		VM_CHECKBOUNDS( gvm, args[1], args[2] * sizeof( aas_query_t ) );
+		return botlib_export->aas.AAS_QueryBatch( VMA(1), args[2] );
+
 	case BOTLIB_AAS_POINT_AREA_NUM:
 		return botlib_export->aas.AAS_PointAreaNum( VMA(1) );
 	case BOTLIB_AAS_POINT_REACHABILITY_AREA_INDEX:
@@ -479,6 +479,9 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 	CL_ShutdownAll();
 #endif
 
+	// referenced paks change with the map
+	SV_FreeDownloadFiles();
+
 	// clear the whole hunk because we're (re)loading the server
 	Hunk_Clear();
 
@@ -918,6 +921,15 @@ void SV_Init( void )
 
     sv_lanForceRate = Cvar_Get ( "sv_lanForceRate", "1", CVAR_ARCHIVE_ND );
     Cvar_SetDescription( sv_lanForceRate, "Force clients to use the same packet rate as the server\nDefault: 1" );
+	sv_snapshotPriority = Cvar_Get( "sv_snapshotPriority", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_snapshotPriority, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( sv_snapshotPriority, "When a snapshot doesn't fit into the client rate, send close players and missiles first and defer other entity updates to the next snapshots\nDefault: 1" );
+	sv_inputQueue = Cvar_Get( "sv_inputQueue", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_inputQueue, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( sv_inputQueue, "Queue client commands and run them for all clients at once before the game frame instead of when their packets arrive\nDefault: 0" );
+	sv_inputJitter = Cvar_Get( "sv_inputJitter", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_inputJitter, "0", "200", CV_INTEGER );
+	Cvar_SetDescription( sv_inputJitter, "Milliseconds the input queue holds commands arriving on time, so commands of clients with network jitter run at an even pace\nDefault: 0" );
 
     sv_strictAuth = Cvar_Get ( "sv_strictAuth", "1", CVAR_ARCHIVE );
 
@@ -942,6 +954,8 @@ void SV_Init( void )
     sv_filter = Cvar_Get( "sv_filter", "filter.txt", CVAR_ARCHIVE );
     Cvar_SetDescription(sv_filter, "Set the ban filter file\nDefault: filter.txt");
 
+	SV_MetricsInit();
+
     // initialize bot cvars so they are listed and can be set before loading the botlib
 	SV_BotInitCvars();
 
@@ -1061,6 +1075,7 @@ void SV_Shutdown( const char *finalmsg ) {
 
 		Z_Free( svs.clients );
 	}
+	SV_FreeDownloadFiles();
 	Com_Memset( &svs, 0, sizeof( svs ) );
 	sv.time = 0;
 
@@ -73,6 +73,9 @@ cvar_t	*sv_gametype;
 cvar_t	*sv_pure;
 cvar_t	*sv_floodProtect;
 cvar_t	*sv_lanForceRate; // dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
+cvar_t	*sv_snapshotPriority;	// defer less important entity updates when over the client rate
+cvar_t	*sv_inputQueue;			// run client commands from SV_Frame instead of on arrival
+cvar_t	*sv_inputJitter;		// msec on time commands are held in the input queue
 
 cvar_t  *sv_strictAuth;
 
@@ -635,7 +638,13 @@ Rate limit for a particular address
 qboolean SVC_RateLimitAddress( const netadr_t *from, int burst, int period ) {
 	leakyBucket_t *bucket = SVC_BucketForAddress( from, burst, period );
 
-	return bucket ? SVC_RateLimit( &bucket->rate, burst, period ) : qtrue;
+	if ( bucket && !SVC_RateLimit( &bucket->rate, burst, period ) ) {
+		return qfalse;
+	}
+
+	sv_metrics.rateLimitDrops++;
+
+	return qtrue;
 }
 
 
@@ -1059,6 +1068,9 @@ void SV_PacketEvent( const netadr_t *from, msg_t *msg ) {
 	client_t	*cl;
 	int			qport;
 
+	sv_metrics.packetsReceived++;
+	sv_metrics.bytesReceived += msg->cursize;
+
 	if ( msg->cursize < 6 ) // too short for anything
 		return;
 
@@ -1370,6 +1382,9 @@ void SV_Frame( int msec ) {
 	int		frameMsec;
 	int		startTime;
 	int		i, n;
+	int64_t	profileStart, frameStart, gameStart;
+
+	SV_MetricsFrame();
 
 	if ( Cvar_CheckGroup( CVG_SERVER ) )
 		SV_TrackCvarChanges(); // update rate settings, etc.
@@ -1476,10 +1491,23 @@ void SV_Frame( int msec ) {
 		startTime = 0;	// quite a compiler warning
 	}
 
+	frameStart = Sys_Microseconds();
+
 	// update ping based on the all received frames
 	SV_CalcPings();
 
-	if (com_dedicated->integer) SV_BotFrame (sv.time);
+	// run client commands queued since the last frame
+	profileStart = PROFILE_START( PROFILE_FRAME );
+	SV_RunInputQueues();
+	PROFILE_END( profileStart, "SV_RunInputQueues", -1 );
+
+	if (com_dedicated->integer) {
+		profileStart = PROFILE_START( PROFILE_FRAME );
+		SV_BotFrame (sv.time);
+		PROFILE_END( profileStart, "SV_BotFrame", -1 );
+	}
+
+	profileStart = PROFILE_START( PROFILE_FRAME );
 
 #ifdef USE_MV
     svs.emptyFrame = qtrue;
@@ -1492,12 +1520,16 @@ void SV_Frame( int msec ) {
 		sv.time += frameMsec;
 
 		// let everything in the world think and move
+		gameStart = Sys_Microseconds();
 		VM_Call( gvm, 1, GAME_RUN_FRAME, sv.time );
+		SV_MetricsObserve( &sv_metrics.gameFrameTime, (int)( Sys_Microseconds() - gameStart ) );
 #ifdef USE_MV
 		svs.emptyFrame = qfalse; // ok, run recorder
 #endif
 	}
 
+	PROFILE_END( profileStart, "SV_RunGameFrames", -1 );
+
 	if ( com_speeds->integer ) {
 		time_game = Sys_Milliseconds () - startTime;
 	}
@@ -1509,7 +1541,9 @@ void SV_Frame( int msec ) {
 	SV_IssueNewSnapshot();
 
 	// send messages back to the clients
+	profileStart = PROFILE_START( PROFILE_FRAME );
 	SV_SendClientMessages();
+	PROFILE_END( profileStart, "SV_SendClientMessages", -1 );
 
 #ifdef USE_MV
     svs.emptyFrame = qfalse;
@@ -1524,6 +1558,8 @@ void SV_Frame( int msec ) {
 
 	// send a heartbeat to the master if needed
 	SV_MasterHeartbeat(HEARTBEAT_FOR_MASTER);
+
+	SV_MetricsObserve( &sv_metrics.frameTime, (int)( Sys_Microseconds() - frameStart ) );
 }
 
 
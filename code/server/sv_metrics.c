@@ -0,0 +1,274 @@
+// server metrics - counters and histograms exposed in the Prometheus
+// text format on a local TCP port, e.g. curl http://127.0.0.1:27970/metrics
+
+#include "server.h"
+
+serverMetrics_t sv_metrics;
+
+cvar_t *sv_metricsPort;
+cvar_t *sv_metricsAddress;
+
+static tcpListener_t *metricsListener;
+
+// upper bucket bounds
+static const int frameTimeBounds[] = { 250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000, 128000 };	// usec
+static const int snapshotSizeBounds[] = { 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384 };				// bytes
+static const int inputLatenessBounds[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500 };							// msec
+
+typedef struct {
+	char	*data;
+	int		size;
+	int		length;
+} metricsBuffer_t;
+
+
+/*
+=================
+SV_MetricsObserve
+=================
+*/
+void SV_MetricsObserve( metricsHistogram_t *h, int value )
+{
+	int i;
+
+	for ( i = 0; i < h->numBounds; i++ ) {
+		if ( value <= h->bounds[i] ) {
+			break;
+		}
+	}
+
+	// buckets are made cumulative when written
+	h->buckets[i]++;
+	h->sum += value;
+	h->count++;
+}
+
+
+/*
+=================
+SV_MetricsPrintf
+
+Appends whole lines only, the rest is dropped when out of space
+=================
+*/
+static void QDECL SV_MetricsPrintf( metricsBuffer_t *buf, const char *fmt, ... ) __attribute__ ((format (printf, 2, 3)));
+static void QDECL SV_MetricsPrintf( metricsBuffer_t *buf, const char *fmt, ... )
+{
+	char line[ 256 ];
+	va_list argptr;
+	int len;
+
+	va_start( argptr, fmt );
+	len = Q_vsnprintf( line, sizeof( line ), fmt, argptr );
+	va_end( argptr );
+
+	if ( len <= 0 || len >= (int)sizeof( line ) || buf->length + len > buf->size ) {
+		return;
+	}
+
+	Com_Memcpy( buf->data + buf->length, line, len );
+	buf->length += len;
+}
+
+
+/*
+=================
+SV_MetricsCounter
+=================
+*/
+static void SV_MetricsCounter( metricsBuffer_t *buf, const char *name, const char *help, const char *type, int64_t value )
+{
+	SV_MetricsPrintf( buf, "# HELP %s %s\n# TYPE %s %s\n%s %.0f\n", name, help, name, type, name, (double)value );
+}
+
+
+/*
+=================
+SV_MetricsHistogram
+
+Values of histograms with a scale are written in seconds
+=================
+*/
+static void SV_MetricsHistogram( metricsBuffer_t *buf, const char *name, const char *help, const metricsHistogram_t *h, double scale )
+{
+	int64_t count;
+	int i;
+
+	SV_MetricsPrintf( buf, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name );
+
+	count = 0;
+	for ( i = 0; i < h->numBounds; i++ ) {
+		count += h->buckets[i];
+		SV_MetricsPrintf( buf, "%s_bucket{le=\"%g\"} %.0f\n", name, h->bounds[i] * scale, (double)count );
+	}
+	count += h->buckets[i];
+	SV_MetricsPrintf( buf, "%s_bucket{le=\"+Inf\"} %.0f\n", name, (double)count );
+
+	SV_MetricsPrintf( buf, "%s_sum %g\n", name, h->sum * scale );
+	SV_MetricsPrintf( buf, "%s_count %.0f\n", name, (double)h->count );
+}
+
+
+/*
+=================
+SV_MetricsClients
+=================
+*/
+static void SV_MetricsClients( metricsBuffer_t *buf )
+{
+	static const char *names[8] = {
+		"quake3e_client_snapshot_bytes_total",
+		"quake3e_client_snapshots_total",
+		"quake3e_client_deferred_entities_total",
+		"quake3e_client_deferred_snapshots_total",
+		"quake3e_client_input_lateness_milliseconds_total",
+		"quake3e_client_input_commands_total",
+		"quake3e_client_input_queued",
+		"quake3e_client_ping_milliseconds"
+	};
+	static const char *help[8] = {
+		"Snapshot bytes sent to a client slot since it connected.",
+		"Snapshots sent to a client slot since it connected.",
+		"Entity updates deferred to later snapshots by the client rate.",
+		"Snapshots with deferred entity updates.",
+		"Sum of command lateness, divide by commands for the average.",
+		"Client commands received.",
+		"Client commands waiting in the input queue.",
+		"Ping of a client slot."
+	};
+	static const char *types[8] = { "counter", "counter", "counter", "counter", "counter", "counter", "gauge", "gauge" };
+	const client_t *cl;
+	double value;
+	int i, n, connected;
+
+	connected = 0;
+
+	for ( n = 0; n < (int)ARRAY_LEN( names ); n++ ) {
+		SV_MetricsPrintf( buf, "# HELP %s %s\n# TYPE %s %s\n", names[n], help[n], names[n], types[n] );
+		if ( !svs.clients || sv.state == SS_DEAD ) {
+			continue;
+		}
+		for ( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ ) {
+			if ( cl->state < CS_CONNECTED || cl->netchan.remoteAddress.type == NA_BOT ) {
+				continue;
+			}
+			switch ( n ) {
+				case 0: value = (double)cl->snapshotBytes; connected++; break;
+				case 1: value = (double)cl->snapshotCount; break;
+				case 2: value = (double)cl->deferredEntities; break;
+				case 3: value = (double)cl->deferredSnapshots; break;
+				case 4: value = (double)cl->inputLateness; break;
+				case 5: value = (double)cl->inputCommands; break;
+				case 6: value = (double)cl->input.count; break;
+				default: value = (double)cl->ping; break;
+			}
+			SV_MetricsPrintf( buf, "%s{client=\"%i\"} %.0f\n", names[n], i, value );
+		}
+	}
+
+	SV_MetricsPrintf( buf, "# HELP quake3e_clients Connected clients, bots excluded.\n# TYPE quake3e_clients gauge\nquake3e_clients %i\n", connected );
+}
+
+
+/*
+=================
+SV_MetricsRespond
+
+Called from NET_Sleep when a request is complete
+=================
+*/
+static int SV_MetricsRespond( const char *request, int requestLength, char *response, int responseSize )
+{
+	static const char *header = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n";
+	static const char *notFound = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\nnot found\n";
+	const netStats_t *net = &net_stats[ NS_SERVER ];
+	metricsBuffer_t buf;
+
+	if ( Q_strncmp( request, "GET /metrics ", 13 ) && Q_strncmp( request, "GET / ", 6 ) ) {
+		Q_strncpyz( response, notFound, responseSize );
+		return (int)strlen( response );
+	}
+
+	buf.data = response;
+	buf.size = responseSize;
+	buf.length = 0;
+
+	SV_MetricsPrintf( &buf, "%s", header );
+
+	SV_MetricsHistogram( &buf, "quake3e_frame_seconds", "Time spent in server frames.",
+		&sv_metrics.frameTime, 1e-6 );
+	SV_MetricsHistogram( &buf, "quake3e_game_frame_seconds", "Time spent in GAME_RUN_FRAME calls.",
+		&sv_metrics.gameFrameTime, 1e-6 );
+	SV_MetricsHistogram( &buf, "quake3e_snapshot_bytes", "Size of snapshot messages.",
+		&sv_metrics.snapshotSize, 1.0 );
+	SV_MetricsHistogram( &buf, "quake3e_input_lateness_seconds", "Arrival of client commands after the earliest arrival of the last seconds.",
+		&sv_metrics.inputLateness, 1e-3 );
+
+	SV_MetricsCounter( &buf, "quake3e_received_packets_total", "Packets received by the server.", "counter", sv_metrics.packetsReceived );
+	SV_MetricsCounter( &buf, "quake3e_received_bytes_total", "Bytes received by the server.", "counter", sv_metrics.bytesReceived );
+	SV_MetricsCounter( &buf, "quake3e_sent_packets_total", "Packets sent by the server.", "counter", net->packets );
+	SV_MetricsCounter( &buf, "quake3e_sent_bytes_total", "Bytes sent by the server.", "counter", net->bytes );
+	SV_MetricsCounter( &buf, "quake3e_netchan_fragments_total", "Packets of fragmented netchan messages.", "counter", net->fragments );
+	SV_MetricsCounter( &buf, "quake3e_ratelimit_drops_total", "Connectionless requests dropped by the per address rate limit.", "counter", sv_metrics.rateLimitDrops );
+	SV_MetricsCounter( &buf, "quake3e_download_bytes_total", "File bytes sent by UDP downloads.", "counter", sv_metrics.downloadBytes );
+
+	SV_MetricsCounter( &buf, "quake3e_zone_free_bytes", "Free bytes in the main zone.", "gauge", Z_AvailableMemory() );
+	SV_MetricsCounter( &buf, "quake3e_hunk_free_bytes", "Free bytes in the hunk.", "gauge", Hunk_MemoryRemaining() );
+
+	SV_MetricsClients( &buf );
+
+	return buf.length;
+}
+
+
+/*
+=================
+SV_MetricsFrame
+
+Opens or closes the listener when the cvars change
+=================
+*/
+void SV_MetricsFrame( void )
+{
+	if ( !sv_metricsPort->modified && !sv_metricsAddress->modified ) {
+		return;
+	}
+
+	sv_metricsPort->modified = qfalse;
+	sv_metricsAddress->modified = qfalse;
+
+	if ( metricsListener ) {
+		NET_TCPClose( metricsListener );
+		metricsListener = NULL;
+	}
+
+	if ( sv_metricsPort->integer ) {
+		metricsListener = NET_TCPListen( sv_metricsAddress->string, sv_metricsPort->integer, SV_MetricsRespond );
+	}
+}
+
+
+/*
+=================
+SV_MetricsInit
+=================
+*/
+void SV_MetricsInit( void )
+{
+	sv_metrics.frameTime.bounds = frameTimeBounds;
+	sv_metrics.frameTime.numBounds = ARRAY_LEN( frameTimeBounds );
+	sv_metrics.gameFrameTime.bounds = frameTimeBounds;
+	sv_metrics.gameFrameTime.numBounds = ARRAY_LEN( frameTimeBounds );
+	sv_metrics.snapshotSize.bounds = snapshotSizeBounds;
+	sv_metrics.snapshotSize.numBounds = ARRAY_LEN( snapshotSizeBounds );
+	sv_metrics.inputLateness.bounds = inputLatenessBounds;
+	sv_metrics.inputLateness.numBounds = ARRAY_LEN( inputLatenessBounds );
+
+	sv_metricsPort = Cvar_Get( "sv_metricsPort", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_metricsPort, "0", "65535", CV_INTEGER );
+	Cvar_SetDescription( sv_metricsPort, "TCP port serving server metrics in the Prometheus text format, 0 disables it\nDefault: 0" );
+	sv_metricsPort->modified = qtrue;
+
+	sv_metricsAddress = Cvar_Get( "sv_metricsAddress", "127.0.0.1", CVAR_ARCHIVE_ND );
+	Cvar_SetDescription( sv_metricsAddress, "IPv4 address the metrics port is bound to, empty for all interfaces\nDefault: 127.0.0.1" );
+}
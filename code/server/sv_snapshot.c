@@ -112,6 +112,281 @@ static void SV_EmitPacketEntities( const clientSnapshot_t *from, const clientSna
 	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );	// end of packetentities
 }
 
+
+/*
+=============================================================================
+
+Entity prioritization
+
+When the entity deltas don't fit into the bytes a client's rate allows
+per snapshot, updates are ordered by importance and the less important
+ones are deferred. The frame keeps the old state of a deferred entity
+(or leaves a new one out), so it still matches what the client has and
+later snapshots delta from it as usual.
+
+=============================================================================
+*/
+
+#define MAX_ENTITY_DEFER	4	// snapshots an update may be deferred in a row
+
+typedef struct {
+	entityState_t	*oldent;	// NULL for entities new to the client
+	entityState_t	*newent;	// NULL for removed entities
+	int				bits;
+	float			priority;	// lower is sent first
+	qboolean		send;
+} entityDelta_t;
+
+
+/*
+=============
+SV_SnapshotBudget
+
+Returns the number of bytes a snapshot message may take or 0 if unlimited
+=============
+*/
+static int SV_SnapshotBudget( const client_t *client ) {
+	int budget;
+
+	if ( !sv_snapshotPriority->integer || !client->rate ) {
+		return 0;
+	}
+
+	// minus udp/ip and netchan headers
+	budget = client->rate * client->snapshotMsec / 1000 - 36;
+	if ( budget < 1 ) {
+		budget = 1;
+	}
+
+	return budget;
+}
+
+
+/*
+=============
+SV_ClearDeferredEntities
+=============
+*/
+static void SV_ClearDeferredEntities( client_t *client ) {
+	if ( client->numDeferredEntities ) {
+		Com_Memset( client->entityDefer, 0, sizeof( client->entityDefer ) );
+		client->numDeferredEntities = 0;
+	}
+}
+
+
+/*
+=============
+SV_EntityStorageFrame
+
+Returns the snapshot frame whose storage holds a state, kept states
+of deferred entities may be a few frames older than their snapshot
+=============
+*/
+static int SV_EntityStorageFrame( const entityState_t *ent, int defaultFrame ) {
+	const snapshotFrame_t *sf;
+	int index, frame;
+
+	index = (int)( ent - svs.snapshotEntities );
+
+	for ( frame = svs.snapshotFrame - 1; frame - svs.lastValidFrame >= 0; frame-- ) {
+		sf = &svs.snapFrames[ frame % NUM_SNAPSHOT_FRAMES ];
+		if ( sf->count && ( index - sf->start + svs.numSnapshotEntities ) % svs.numSnapshotEntities < sf->count ) {
+			return frame;
+		}
+	}
+
+	return defaultFrame;
+}
+
+
+/*
+=============
+SV_EntityPriority
+
+Close entities first, players and missiles before other entities and
+items last, every deferred snapshot moves an update forward
+=============
+*/
+static float SV_EntityPriority( const client_t *client, const clientSnapshot_t *frame, const entityState_t *ent ) {
+	vec3_t	delta;
+	float	priority;
+
+	VectorSubtract( ent->pos.trBase, frame->ps.origin, delta );
+	priority = VectorLength( delta ) + 64.0f;
+
+	if ( ent->number < MAX_CLIENTS || ent->eType == ET_PLAYER || ent->eType == ET_MISSILE ) {
+		// keep
+	} else if ( ent->eType == ET_ITEM ) {
+		priority *= 4.0f;
+	} else {
+		priority *= 2.0f;
+	}
+
+	return priority / ( 1 + 2 * client->entityDefer[ ent->number ] );
+}
+
+
+static int QDECL SV_CompareEntityDeltas( const void *a, const void *b ) {
+	const entityDelta_t *d1 = *(const entityDelta_t **)a;
+	const entityDelta_t *d2 = *(const entityDelta_t **)b;
+
+	if ( d1->priority < d2->priority )
+		return -1;
+	if ( d1->priority > d2->priority )
+		return 1;
+
+	return d1->newent->number - d2->newent->number;
+}
+
+
+/*
+=============
+SV_EmitPrioritizedEntities
+
+Same as SV_EmitPacketEntities unless the message exceeds the budget,
+delta snapshots only
+=============
+*/
+static void SV_EmitPrioritizedEntities( client_t *client, const clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg, int budget ) {
+	static entityDelta_t	deltas[ MAX_GENTITIES * 2 ];
+	static entityDelta_t	*order[ MAX_GENTITIES * 2 ];
+	static entityState_t	*ents[ MAX_GENTITIES ];
+	static byte				defer[ MAX_GENTITIES ];
+	static byte				scratchBuf[ MAX_MSGLEN_BUF ];
+	entityDelta_t	*d;
+	msg_t			scratch;
+	int				startBit, startSize;
+	int				oldindex, newindex, oldnum, newnum, from_num_entities;
+	int				i, count, numOrder, numEnts, bits, available, deferred;
+	int				frameNum, storageFrame;
+
+	startBit = msg->bit;
+	startSize = msg->cursize;
+
+	// most snapshots fit
+	SV_EmitPacketEntities( from, to, msg );
+	if ( !msg->overflowed && msg->cursize <= budget ) {
+		SV_ClearDeferredEntities( client );
+		return;
+	}
+
+	// rewind, bits past the start are ORed in by huffman writes
+	msg->bit = startBit;
+	msg->cursize = startSize;
+	msg->overflowed = qfalse;
+	if ( startBit & 7 ) {
+		msg->data[ startBit >> 3 ] &= ( 1 << ( startBit & 7 ) ) - 1;
+	}
+
+	// measure all deltas, static huffman makes their sizes independent of position
+	MSG_Init( &scratch, scratchBuf, MAX_MSGLEN );
+
+	from_num_entities = from->num_entities;
+	count = 0;
+	oldindex = 0;
+	newindex = 0;
+	while ( newindex < to->num_entities || oldindex < from_num_entities ) {
+		newnum = ( newindex < to->num_entities ) ? to->ents[ newindex ]->number : MAX_GENTITIES+1;
+		oldnum = ( oldindex < from_num_entities ) ? from->ents[ oldindex ]->number : MAX_GENTITIES+1;
+
+		d = &deltas[ count++ ];
+		d->oldent = ( oldnum <= newnum ) ? from->ents[ oldindex++ ] : NULL;
+		d->newent = ( newnum <= oldnum ) ? to->ents[ newindex++ ] : NULL;
+		d->send = qtrue;
+
+		scratch.bit = 0;
+		if ( !d->newent ) {
+			MSG_WriteDeltaEntity( &scratch, d->oldent, NULL, qtrue );
+		} else if ( d->oldent ) {
+			MSG_WriteDeltaEntity( &scratch, d->oldent, d->newent, qfalse );
+		} else {
+			MSG_WriteDeltaEntity( &scratch, &sv.svEntities[ newnum ].baseline, d->newent, qtrue );
+		}
+		d->bits = scratch.bit;
+	}
+
+	// removals, unchanged entities, events, updates deferred too long and movers
+	// (a stale one breaks prediction of players riding it) always go
+	available = budget * 8 - startBit - GENTITYNUM_BITS - 8;
+	numOrder = 0;
+	for ( i = 0; i < count; i++ ) {
+		d = &deltas[ i ];
+		if ( !d->newent || d->bits == 0 || d->newent->eType >= ET_EVENTS
+			|| ( d->oldent && d->oldent->event != d->newent->event )
+			|| client->entityDefer[ d->newent->number ] >= MAX_ENTITY_DEFER
+			|| d->newent->eType == ET_MOVER || d->newent->number == to->ps.groundEntityNum ) {
+			available -= d->bits;
+			continue;
+		}
+		d->priority = SV_EntityPriority( client, to, d->newent );
+		order[ numOrder++ ] = d;
+	}
+
+	qsort( order, numOrder, sizeof( order[0] ), SV_CompareEntityDeltas );
+
+	for ( i = 0; i < numOrder; i++ ) {
+		bits = order[ i ]->bits;
+		if ( bits <= available ) {
+			available -= bits;
+		} else {
+			order[ i ]->send = qfalse;
+		}
+	}
+
+	// emit in entity number order and fix up the frame, counters of
+	// entities which are sent or left the frame start over
+	Com_Memset( defer, 0, sizeof( defer ) );
+	numEnts = 0;
+	deferred = 0;
+	frameNum = to->frameNum;
+	for ( i = 0; i < count; i++ ) {
+		d = &deltas[ i ];
+
+		if ( !d->newent ) {
+			MSG_WriteDeltaEntity( msg, d->oldent, NULL, qtrue );
+			continue;
+		}
+
+		newnum = d->newent->number;
+
+		if ( d->send ) {
+			if ( d->oldent ) {
+				MSG_WriteDeltaEntity( msg, d->oldent, d->newent, qfalse );
+			} else {
+				MSG_WriteDeltaEntity( msg, &sv.svEntities[ newnum ].baseline, d->newent, qtrue );
+			}
+			ents[ numEnts++ ] = d->newent;
+			continue;
+		}
+
+		// the client keeps what it has, the frame is valid as long as the oldest kept state
+		if ( d->oldent ) {
+			ents[ numEnts++ ] = d->oldent;
+			storageFrame = SV_EntityStorageFrame( d->oldent, from->frameNum );
+			if ( storageFrame - frameNum < 0 ) {
+				frameNum = storageFrame;
+			}
+		}
+		defer[ newnum ] = client->entityDefer[ newnum ] + 1;
+		deferred++;
+	}
+
+	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );	// end of packetentities
+
+	to->num_entities = numEnts;
+	Com_Memcpy( to->ents, ents, numEnts * sizeof( ents[0] ) );
+	to->frameNum = frameNum;
+
+	Com_Memcpy( client->entityDefer, defer, sizeof( defer ) );
+	client->numDeferredEntities = deferred;
+
+	if ( deferred ) {
+		client->deferredEntities += deferred;
+		client->deferredSnapshots++;
+	}
+}
+
 #ifdef USE_MV
 static int SV_GetMergeMaskEntities( clientSnapshot_t *snap )
 {
@@ -278,6 +553,7 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	int					lastframe;
 	int					i;
 	int					snapFlags;
+	int					budget;
 
 	// this is the snapshot we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
@@ -454,7 +730,14 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	}
 
 	// delta encode the entities
-	SV_EmitPacketEntities (oldframe, frame, msg);
+	// full snapshots replace everything the client has, nothing can be deferred
+	budget = SV_SnapshotBudget( client );
+	if ( budget && oldframe ) {
+		SV_EmitPrioritizedEntities( client, oldframe, frame, msg, budget );
+	} else {
+		SV_ClearDeferredEntities( client );
+		SV_EmitPacketEntities( oldframe, frame, msg );
+	}
 
 #ifdef USE_MV
 	} // !client->MVProtocol
@@ -1390,6 +1673,10 @@ void SV_SendClientSnapshot( client_t *client ) {
 		MSG_Clear( &msg );
 	}
 
+	client->snapshotBytes += msg.cursize;
+	client->snapshotCount++;
+	SV_MetricsObserve( &sv_metrics.snapshotSize, msg.cursize );
+
 	SV_SendMessageToClient( &msg, client );
 }
 
@@ -1403,6 +1690,7 @@ void SV_SendClientMessages( void )
 {
 	int		i;
 	client_t	*c;
+	int64_t	profileStart;
 
 	svs.msgTime = Sys_Milliseconds();
 
@@ -1453,7 +1741,9 @@ void SV_SendClientMessages( void )
 		}
 
 		// generate and send a new message
+		profileStart = PROFILE_START( PROFILE_DETAIL );
 		SV_SendClientSnapshot( c );
+		PROFILE_END( profileStart, "SV_SendClientSnapshot", i );
 		c->lastSnapshotTime = svs.time;
 		c->rateDelayed = qfalse;
 	}
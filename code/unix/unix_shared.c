@@ -32,6 +32,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <pwd.h>
 #include <dlfcn.h>
 #include <libgen.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
 
 #include "../qcommon/q_shared.h"
 #include "../qcommon/qcommon.h"
@@ -316,6 +319,74 @@ qboolean Sys_GetFileStats( const char *filename, fileOffset_t *size, fileTime_t
 }
 
 
+/*
+=================
+Sys_MapFile
+=================
+*/
+void *Sys_MapFile( FILE *f, int size )
+{
+	void *data;
+
+	data = mmap( NULL, size, PROT_READ, MAP_SHARED, fileno( f ), 0 );
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	return data;
+}
+
+
+/*
+=================
+Sys_UnmapFile
+=================
+*/
+void Sys_UnmapFile( void *data, int size )
+{
+	munmap( data, size );
+}
+
+
+static sigjmp_buf mapReadFault;
+
+static void Sys_MapReadFault( int sig )
+{
+	siglongjmp( mapReadFault, 1 );
+}
+
+
+/*
+=================
+Sys_ReadMappedFile
+
+Copies from a file mapping, returns qfalse instead of raising SIGBUS
+when the pages are not backed by the file anymore (truncated in place)
+=================
+*/
+qboolean Sys_ReadMappedFile( void *dst, const void *src, int size )
+{
+	struct sigaction sa, old;
+	qboolean ok;
+
+	memset( &sa, 0, sizeof( sa ) );
+	sa.sa_handler = Sys_MapReadFault;
+	sa.sa_flags = SA_NODEFER; // leave SIGBUS unblocked after the jump
+	sigemptyset( &sa.sa_mask );
+	sigaction( SIGBUS, &sa, &old );
+
+	if ( sigsetjmp( mapReadFault, 0 ) == 0 ) {
+		memcpy( dst, src, size );
+		ok = qtrue;
+	} else {
+		ok = qfalse;
+	}
+
+	sigaction( SIGBUS, &old, NULL );
+
+	return ok;
+}
+
+
 /*
 =================
 Sys_Mkdir
@@ -614,3 +685,201 @@ void Sys_SetAffinityMask( int mask )
 	}
 }
 #endif // USE_AFFINITY_MASK
+
+
+/*
+==============================================================================
+
+THREADS
+
+Minimal portable threading primitives used by engine subsystems that
+offload work from the main loop. Semaphores are built on top of
+mutex/condition pairs because unnamed POSIX semaphores are not available
+everywhere (macOS).
+
+==============================================================================
+*/
+
+typedef struct {
+	pthread_t	thread;
+	void		(*func)( void *arg );
+	void		*arg;
+} sysThread_t;
+
+typedef struct {
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	int				count;
+} sysSemaphore_t;
+
+
+static void *Sys_ThreadMain( void *arg )
+{
+	sysThread_t *t = (sysThread_t *)arg;
+
+	t->func( t->arg );
+
+	return NULL;
+}
+
+
+/*
+=================
+Sys_CreateThread
+=================
+*/
+void *Sys_CreateThread( void (*func)( void *arg ), void *arg, const char *name )
+{
+	sysThread_t *t;
+
+	t = malloc( sizeof( *t ) );
+	if ( !t )
+		return NULL;
+
+	t->func = func;
+	t->arg = arg;
+
+	if ( pthread_create( &t->thread, NULL, Sys_ThreadMain, t ) != 0 ) {
+		Com_Printf( S_COLOR_YELLOW "pthread_create() failed for %s\n", name );
+		free( t );
+		return NULL;
+	}
+
+#ifdef __linux__
+	if ( name ) {
+		char buf[16]; // including terminating zero
+		Q_strncpyz( buf, name, sizeof( buf ) );
+		pthread_setname_np( t->thread, buf );
+	}
+#endif
+
+	return t;
+}
+
+
+/*
+=================
+Sys_JoinThread
+=================
+*/
+void Sys_JoinThread( void *thread )
+{
+	sysThread_t *t = (sysThread_t *)thread;
+
+	if ( !t )
+		return;
+
+	pthread_join( t->thread, NULL );
+	free( t );
+}
+
+
+/*
+=================
+Sys_CreateMutex
+=================
+*/
+void *Sys_CreateMutex( void )
+{
+	pthread_mutex_t *m;
+
+	m = malloc( sizeof( *m ) );
+	if ( m ) {
+		pthread_mutex_init( m, NULL );
+	}
+
+	return m;
+}
+
+
+void Sys_DestroyMutex( void *mutex )
+{
+	if ( mutex ) {
+		pthread_mutex_destroy( (pthread_mutex_t *)mutex );
+		free( mutex );
+	}
+}
+
+
+void Sys_MutexLock( void *mutex )
+{
+	pthread_mutex_lock( (pthread_mutex_t *)mutex );
+}
+
+
+void Sys_MutexUnlock( void *mutex )
+{
+	pthread_mutex_unlock( (pthread_mutex_t *)mutex );
+}
+
+
+/*
+=================
+Sys_CreateSemaphore
+=================
+*/
+void *Sys_CreateSemaphore( int initialCount )
+{
+	sysSemaphore_t *s;
+
+	s = malloc( sizeof( *s ) );
+	if ( s ) {
+		pthread_mutex_init( &s->mutex, NULL );
+		pthread_cond_init( &s->cond, NULL );
+		s->count = initialCount;
+	}
+
+	return s;
+}
+
+
+void Sys_DestroySemaphore( void *sem )
+{
+	sysSemaphore_t *s = (sysSemaphore_t *)sem;
+
+	if ( s ) {
+		pthread_cond_destroy( &s->cond );
+		pthread_mutex_destroy( &s->mutex );
+		free( s );
+	}
+}
+
+
+void Sys_SemaphorePost( void *sem )
+{
+	sysSemaphore_t *s = (sysSemaphore_t *)sem;
+
+	pthread_mutex_lock( &s->mutex );
+	s->count++;
+	pthread_cond_signal( &s->cond );
+	pthread_mutex_unlock( &s->mutex );
+}
+
+
+void Sys_SemaphoreWait( void *sem )
+{
+	sysSemaphore_t *s = (sysSemaphore_t *)sem;
+
+	pthread_mutex_lock( &s->mutex );
+	while ( s->count <= 0 ) {
+		pthread_cond_wait( &s->cond, &s->mutex );
+	}
+	s->count--;
+	pthread_mutex_unlock( &s->mutex );
+}
+
+
+/*
+=================
+Sys_CPUCount
+=================
+*/
+int Sys_CPUCount( void )
+{
+	long n = sysconf( _SC_NPROCESSORS_ONLN );
+
+	if ( n < 1 )
+		return 1;
+
+	return (int)n;
+}
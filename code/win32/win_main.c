@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <direct.h>
+#include <io.h>
 
 #ifdef USE_SENTRY
 #define sleep_s(SECONDS) Sleep((SECONDS)*1000)
@@ -479,6 +480,55 @@ qboolean Sys_GetFileStats( const char *filename, fileOffset_t *size, fileTime_t
 }
 
 
+/*
+=============
+Sys_MapFile
+=============
+*/
+void *Sys_MapFile( FILE *f, int size ) {
+	HANDLE file, mapping;
+	void *data;
+
+	file = (HANDLE)_get_osfhandle( _fileno( f ) );
+	if ( file == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( mapping == NULL )
+		return NULL;
+
+	data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, size );
+
+	// view keeps the mapping object alive
+	CloseHandle( mapping );
+
+	return data;
+}
+
+
+/*
+=============
+Sys_UnmapFile
+=============
+*/
+void Sys_UnmapFile( void *data, int size ) {
+	UnmapViewOfFile( data );
+}
+
+
+/*
+=============
+Sys_ReadMappedFile
+
+Files with mapped views can't be truncated, the copy never faults
+=============
+*/
+qboolean Sys_ReadMappedFile( void *dst, const void *src, int size ) {
+	memcpy( dst, src, size );
+	return qtrue;
+}
+
+
 //========================================================
 
 /*
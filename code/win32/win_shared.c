@@ -240,3 +240,160 @@ void Sys_SetAffinityMask( int mask )
 	}
 }
 #endif // USE_AFFINITY_MASK
+
+
+/*
+==============================================================================
+
+THREADS
+
+==============================================================================
+*/
+
+typedef struct {
+	HANDLE		handle;
+	void		(*func)( void *arg );
+	void		*arg;
+} sysThread_t;
+
+
+static DWORD WINAPI Sys_ThreadMain( LPVOID arg )
+{
+	sysThread_t *t = (sysThread_t *)arg;
+
+	t->func( t->arg );
+
+	return 0;
+}
+
+
+/*
+=================
+Sys_CreateThread
+=================
+*/
+void *Sys_CreateThread( void (*func)( void *arg ), void *arg, const char *name )
+{
+	sysThread_t *t;
+
+	t = malloc( sizeof( *t ) );
+	if ( !t )
+		return NULL;
+
+	t->func = func;
+	t->arg = arg;
+	t->handle = CreateThread( NULL, 0, Sys_ThreadMain, t, 0, NULL );
+
+	if ( t->handle == NULL ) {
+		Com_Printf( S_COLOR_YELLOW "CreateThread() failed for %s\n", name );
+		free( t );
+		return NULL;
+	}
+
+	return t;
+}
+
+
+/*
+=================
+Sys_JoinThread
+=================
+*/
+void Sys_JoinThread( void *thread )
+{
+	sysThread_t *t = (sysThread_t *)thread;
+
+	if ( !t )
+		return;
+
+	WaitForSingleObject( t->handle, INFINITE );
+	CloseHandle( t->handle );
+	free( t );
+}
+
+
+/*
+=================
+Sys_CreateMutex
+=================
+*/
+void *Sys_CreateMutex( void )
+{
+	CRITICAL_SECTION *cs;
+
+	cs = malloc( sizeof( *cs ) );
+	if ( cs ) {
+		InitializeCriticalSection( cs );
+	}
+
+	return cs;
+}
+
+
+void Sys_DestroyMutex( void *mutex )
+{
+	if ( mutex ) {
+		DeleteCriticalSection( (CRITICAL_SECTION *)mutex );
+		free( mutex );
+	}
+}
+
+
+void Sys_MutexLock( void *mutex )
+{
+	EnterCriticalSection( (CRITICAL_SECTION *)mutex );
+}
+
+
+void Sys_MutexUnlock( void *mutex )
+{
+	LeaveCriticalSection( (CRITICAL_SECTION *)mutex );
+}
+
+
+/*
+=================
+Sys_CreateSemaphore
+=================
+*/
+void *Sys_CreateSemaphore( int initialCount )
+{
+	return CreateSemaphore( NULL, initialCount, 0x7FFFFFFF, NULL );
+}
+
+
+void Sys_DestroySemaphore( void *sem )
+{
+	if ( sem ) {
+		CloseHandle( (HANDLE)sem );
+	}
+}
+
+
+void Sys_SemaphorePost( void *sem )
+{
+	ReleaseSemaphore( (HANDLE)sem, 1, NULL );
+}
+
+
+void Sys_SemaphoreWait( void *sem )
+{
+	WaitForSingleObject( (HANDLE)sem, INFINITE );
+}
+
+
+/*
+=================
+Sys_CPUCount
+=================
+*/
+int Sys_CPUCount( void )
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+	if ( info.dwNumberOfProcessors < 1 )
+		return 1;
+
+	return (int)info.dwNumberOfProcessors;
+}